@@ -0,0 +1,975 @@
+// bench_serialize.cpp
+// Google Benchmark suite: quark vs. protobuf encode/decode throughput on
+// TestData and on batches of TestData, across every quark stream type.
+//
+// Run with `make bench`; results are also written as JSON (BENCH_OUT) so two
+// runs can be diffed with bench/compare.py.
+
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include "quark/io/async_stream.h"
+#include "quark/io/batch_codec.h"
+#include "quark/io/checksummed_stream.h"
+#include "quark/io/columnar.h"
+#include "quark/io/compressed_stream.h"
+#include "quark/io/fd_stream.h"
+#include "quark/io/int_codec.h"
+#include "quark/io/message_view.h"
+#include "quark/io/record_log.h"
+#include "quark/io/ring_buffer_stream.h"
+#include "quark/io/string_dict.h"
+#include "quark/io/zero_copy_stream.h"
+#include "quark/tlv.hpp"
+#include "message.pb.h"
+#include "message.quark.h"
+
+using namespace quark::io;
+
+// counts every heap allocation in the process, for BM_PerMessageAllocs.
+// Kept out of line so inlined malloc/free pairs do not trip -Wmismatched-new-delete.
+static std::atomic<uint64_t> g_allocations{0};
+
+__attribute__((noinline)) void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+// ---------------------------
+// Fixtures
+// ---------------------------
+
+struct Record {
+    int32_t int_val;
+    float float_val;
+    std::string str_val;
+};
+
+std::vector<Record> MakeRecords(size_t n, size_t str_len) {
+    std::vector<Record> records(n);
+    for (size_t i = 0; i < n; ++i) {
+        records[i].int_val = static_cast<int32_t>(i * 2654435761u);
+        records[i].float_val = static_cast<float>(i) * 0.5f;
+        records[i].str_val.assign(str_len, static_cast<char>('a' + i % 26));
+    }
+    return records;
+}
+
+void FillProto(const std::vector<Record>& records, TestBatch& batch) {
+    for (const Record& r : records) {
+        TestData* d = batch.add_records();
+        d->set_int_val(r.int_val);
+        d->set_float_val(r.float_val);
+        d->set_str_val(r.str_val);
+    }
+}
+
+// args: {records per message, string length}
+void MessageShapes(benchmark::internal::Benchmark* b) {
+    b->Args({1, 16})->Args({1000, 16})->Args({1000, 256});
+}
+
+template <typename S>
+void EncodeRecords(BasicCodedOutputStream<S>* out, const std::vector<Record>& records) {
+    for (const Record& r : records) {
+        SerializeInt32(out, r.int_val);
+        SerializeFloat32(out, r.float_val);
+        SerializeString(out, r.str_val);
+    }
+}
+
+std::vector<uint8_t> EncodeToVector(const std::vector<Record>& records) {
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        EncodeRecords(&out, records);
+    }
+    return vos.buffer();
+}
+
+// decodes every record; the string is consumed as a view. 'Stream' is the
+// static stream type the cursor is instantiated with.
+template <typename Stream>
+bool DecodeRecords(Stream* stream, size_t n, quark::Arena* arena) {
+    BasicCodedInputStream<Stream> in(stream);
+    for (size_t i = 0; i < n; ++i) {
+        int32_t iv;
+        float fv;
+        std::string_view sv;
+        if (!DeserializeInt32(&in, iv) || !DeserializeFloat32(&in, fv) ||
+            !DeserializeString(&in, sv, arena)) {
+            return false;
+        }
+        benchmark::DoNotOptimize(iv);
+        benchmark::DoNotOptimize(fv);
+        benchmark::DoNotOptimize(sv.data());
+    }
+    return true;
+}
+
+void SetThroughput(benchmark::State& state, size_t bytes, size_t msgs) {
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * msgs));
+    state.counters["wire_bytes"] = static_cast<double>(bytes);
+}
+
+// ---------------------------
+// Encode
+// ---------------------------
+
+void BM_Encode_Quark_BufferOutputStream(benchmark::State& state) {
+    auto records = MakeRecords(state.range(0), state.range(1));
+    size_t size = EncodeToVector(records).size();
+    std::vector<uint8_t> buf(size);
+    for (auto _ : state) {
+        BufferOutputStream bos(buf.data(), buf.size());
+        BasicCodedOutputStream<BufferOutputStream> out(&bos);
+        EncodeRecords(&out, records);
+        benchmark::ClobberMemory();
+    }
+    SetThroughput(state, size, records.size());
+}
+BENCHMARK(BM_Encode_Quark_BufferOutputStream)->Apply(MessageShapes);
+
+void BM_Encode_Quark_VectorOutputStream(benchmark::State& state) {
+    auto records = MakeRecords(state.range(0), state.range(1));
+    size_t size = 0;
+    for (auto _ : state) {
+        VectorOutputStream vos;
+        {
+            BasicCodedOutputStream<VectorOutputStream> out(&vos);
+            EncodeRecords(&out, records);
+        }
+        size = vos.buffer().size();
+        benchmark::DoNotOptimize(vos.buffer().data());
+    }
+    SetThroughput(state, size, records.size());
+}
+BENCHMARK(BM_Encode_Quark_VectorOutputStream)->Apply(MessageShapes);
+
+void BM_Encode_Quark_ChainedOutputStream(benchmark::State& state) {
+    auto records = MakeRecords(state.range(0), state.range(1));
+    ChainedOutputStream cos(8192, 1 << 20);
+    size_t size = 0;
+    for (auto _ : state) {
+        cos.Clear();
+        {
+            BasicCodedOutputStream<ChainedOutputStream> out(&cos);
+            EncodeRecords(&out, records);
+        }
+        size = cos.ByteCount();
+        benchmark::DoNotOptimize(cos.iovecs().data());
+    }
+    SetThroughput(state, size, records.size());
+}
+BENCHMARK(BM_Encode_Quark_ChainedOutputStream)->Apply(MessageShapes);
+
+// unchecked raw-buffer API (tlv.hpp); same bytes as the stream encoders
+void BM_Encode_Tlv_Raw(benchmark::State& state) {
+    auto records = MakeRecords(state.range(0), state.range(1));
+    size_t size = EncodeToVector(records).size();
+    std::vector<uint8_t> buf(size);
+    for (auto _ : state) {
+        uint8_t* p = buf.data();
+        for (const Record& r : records) {
+            p += quark::serialize_int32(p, r.int_val);
+            p += quark::serialize_float32(p, r.float_val);
+            p += quark::serialize_string(p, r.str_val);
+        }
+        benchmark::ClobberMemory();
+    }
+    SetThroughput(state, size, records.size());
+}
+BENCHMARK(BM_Encode_Tlv_Raw)->Apply(MessageShapes);
+
+void BM_Encode_Protobuf(benchmark::State& state) {
+    auto records = MakeRecords(state.range(0), state.range(1));
+    TestBatch batch;
+    FillProto(records, batch);
+    std::string out;
+    for (auto _ : state) {
+        out.clear();
+        batch.SerializeToString(&out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    SetThroughput(state, out.size(), records.size());
+}
+BENCHMARK(BM_Encode_Protobuf)->Apply(MessageShapes);
+
+// ---------------------------
+// Decode
+// ---------------------------
+
+void BM_Decode_Quark_BufferInputStream(benchmark::State& state) {
+    auto records = MakeRecords(state.range(0), state.range(1));
+    auto buf = EncodeToVector(records);
+    quark::Arena arena;
+    for (auto _ : state) {
+        BufferInputStream bis(buf.data(), buf.size());
+        if (!DecodeRecords(&bis, records.size(), &arena)) state.SkipWithError("decode failed");
+        arena.Reset();
+    }
+    SetThroughput(state, buf.size(), records.size());
+}
+BENCHMARK(BM_Decode_Quark_BufferInputStream)->Apply(MessageShapes);
+
+// same as above through the type-erased cursor (virtual Next/BackUp)
+void BM_Decode_Quark_BufferInputStream_Virtual(benchmark::State& state) {
+    auto records = MakeRecords(state.range(0), state.range(1));
+    auto buf = EncodeToVector(records);
+    quark::Arena arena;
+    for (auto _ : state) {
+        BufferInputStream bis(buf.data(), buf.size());
+        if (!DecodeRecords<ZeroCopyInputStream>(&bis, records.size(), &arena)) state.SkipWithError("decode failed");
+        arena.Reset();
+    }
+    SetThroughput(state, buf.size(), records.size());
+}
+BENCHMARK(BM_Decode_Quark_BufferInputStream_Virtual)->Apply(MessageShapes);
+
+// 4 KB frames, as delivered by a network stack
+void BM_Decode_Quark_MultiBufferInputStream(benchmark::State& state) {
+    auto records = MakeRecords(state.range(0), state.range(1));
+    auto buf = EncodeToVector(records);
+    std::vector<MultiBufferInputStream::Chunk> chunks;
+    for (size_t off = 0; off < buf.size(); off += 4096) {
+        chunks.push_back({buf.data() + off, std::min<size_t>(4096, buf.size() - off)});
+    }
+    quark::Arena arena;
+    for (auto _ : state) {
+        MultiBufferInputStream mb(chunks);
+        if (!DecodeRecords(&mb, records.size(), &arena)) state.SkipWithError("decode failed");
+        arena.Reset();
+    }
+    SetThroughput(state, buf.size(), records.size());
+}
+BENCHMARK(BM_Decode_Quark_MultiBufferInputStream)->Apply(MessageShapes);
+
+void BM_Decode_Quark_MmapInputStream(benchmark::State& state) {
+    auto records = MakeRecords(state.range(0), state.range(1));
+    auto buf = EncodeToVector(records);
+    char path[] = "/tmp/quark_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || ::write(fd, buf.data(), buf.size()) != static_cast<ssize_t>(buf.size())) {
+        state.SkipWithError("cannot write temp file");
+        return;
+    }
+    ::close(fd);
+
+    quark::Arena arena;
+    for (auto _ : state) {
+        MmapInputStream mis(path);
+        if (!DecodeRecords(&mis, records.size(), &arena)) state.SkipWithError("decode failed");
+        arena.Reset();
+    }
+    std::remove(path);
+    SetThroughput(state, buf.size(), records.size());
+}
+BENCHMARK(BM_Decode_Quark_MmapInputStream)->Apply(MessageShapes);
+
+void BM_Decode_Protobuf(benchmark::State& state) {
+    auto records = MakeRecords(state.range(0), state.range(1));
+    TestBatch batch;
+    FillProto(records, batch);
+    std::string buf = batch.SerializeAsString();
+    TestBatch parsed;
+    for (auto _ : state) {
+        if (!parsed.ParseFromString(buf)) state.SkipWithError("decode failed");
+        benchmark::DoNotOptimize(parsed.records_size());
+    }
+    SetThroughput(state, buf.size(), records.size());
+}
+BENCHMARK(BM_Decode_Protobuf)->Apply(MessageShapes);
+
+// ---------------------------
+// Primitives
+// ---------------------------
+
+void BM_Decode_Varint32(benchmark::State& state) {
+    std::vector<uint32_t> values(1 << 16);
+    for (size_t i = 0; i < values.size(); ++i) values[i] = static_cast<uint32_t>(i * 2654435761u) >> (i % 32);
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        for (uint32_t v : values) out.WriteVarint32(v);
+    }
+    const auto& buf = vos.buffer();
+    std::vector<uint32_t> out(values.size());
+    for (auto _ : state) {
+        BufferInputStream bis(buf.data(), buf.size());
+        if (state.range(0)) {
+            ReadVarint32Batch(&bis, out.data(), out.size());
+        } else {
+            CodedInputStream in(&bis);
+            for (auto& v : out) in.ReadVarint32(v);
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    SetThroughput(state, buf.size(), values.size());
+}
+BENCHMARK(BM_Decode_Varint32)->ArgName("batch")->Arg(0)->Arg(1);
+
+// 10k floats: one FLOAT32 value per element vs. a single FLOAT32_ARRAY
+std::vector<float> MakeFloats() {
+    std::vector<float> values(10000);
+    for (size_t i = 0; i < values.size(); ++i) values[i] = static_cast<float>(i) * 0.125f;
+    return values;
+}
+
+void BM_Encode_Float32Array(benchmark::State& state) {
+    auto values = MakeFloats();
+    std::vector<uint8_t> buf(values.size() * 5 + 16);
+    size_t size = 0;
+    for (auto _ : state) {
+        BufferOutputStream bos(buf.data(), buf.size());
+        {
+            BasicCodedOutputStream<BufferOutputStream> out(&bos);
+            if (state.range(0)) {
+                SerializeFloat32Array(&out, values.data(), values.size());
+            } else {
+                for (float v : values) SerializeFloat32(&out, v);
+            }
+        }
+        size = bos.ByteCount();
+        benchmark::ClobberMemory();
+    }
+    SetThroughput(state, size, values.size());
+}
+BENCHMARK(BM_Encode_Float32Array)->ArgName("packed")->Arg(0)->Arg(1);
+
+void BM_Decode_Float32Array(benchmark::State& state) {
+    auto values = MakeFloats();
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        if (state.range(0)) {
+            SerializeFloat32Array(&out, values.data(), values.size());
+        } else {
+            for (float v : values) SerializeFloat32(&out, v);
+        }
+    }
+    const auto& buf = vos.buffer();
+    std::vector<float> out;
+    out.reserve(values.size());
+    for (auto _ : state) {
+        out.clear();
+        BufferInputStream bis(buf.data(), buf.size());
+        BasicCodedInputStream<BufferInputStream> in(&bis);
+        if (state.range(0)) {
+            DeserializeFloat32Array(&in, out);
+        } else {
+            float v;
+            for (size_t i = 0; i < values.size() && DeserializeFloat32(&in, v); ++i) out.push_back(v);
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    SetThroughput(state, buf.size(), values.size());
+}
+BENCHMARK(BM_Decode_Float32Array)->ArgName("packed")->Arg(0)->Arg(1);
+
+// ---------------------------
+// Checksums
+// ---------------------------
+
+void BM_Crc32c(benchmark::State& state) {
+    std::vector<uint8_t> buf(64 * 1024);
+    for (size_t i = 0; i < buf.size(); ++i) buf[i] = static_cast<uint8_t>(i * 131);
+    for (auto _ : state) {
+        uint32_t crc = state.range(0) ? Crc32c(buf.data(), buf.size())
+                                      : ~detail::Crc32cSoftware(~0u, buf.data(), buf.size());
+        benchmark::DoNotOptimize(crc);
+    }
+    state.SetBytesProcessed(state.iterations() * buf.size());
+}
+BENCHMARK(BM_Crc32c)->ArgName("hw")->Arg(0)->Arg(1);
+
+// TestData records with and without a CRC32C trailer per record
+void BM_Encode_Quark_Checksummed(benchmark::State& state) {
+    auto records = MakeRecords(1000, 16);
+    std::vector<uint8_t> buf(EncodeToVector(records).size() + records.size() * kRecordTrailerSize);
+    size_t size = 0;
+    for (auto _ : state) {
+        BufferOutputStream bos(buf.data(), buf.size());
+        if (state.range(0)) {
+            ChecksummedOutputStream cs(&bos);
+            for (const auto& r : records) {
+                {
+                    BasicCodedOutputStream<ChecksummedOutputStream> out(&cs);
+                    SerializeInt32(&out, r.int_val);
+                    SerializeFloat32(&out, r.float_val);
+                    SerializeString(&out, r.str_val);
+                }
+                cs.EndRecord();
+            }
+        } else {
+            BasicCodedOutputStream<BufferOutputStream> out(&bos);
+            EncodeRecords(&out, records);
+        }
+        size = bos.ByteCount();
+        benchmark::ClobberMemory();
+    }
+    SetThroughput(state, size, records.size());
+}
+BENCHMARK(BM_Encode_Quark_Checksummed)->ArgName("crc")->Arg(0)->Arg(1);
+
+// ---------------------------
+// Compression
+// ---------------------------
+
+// encode a batch then compress the vector (copy) vs. encode through a
+// CompressedOutputStream into a chained sink, both reused across batches (direct)
+void BM_Encode_Quark_Compressed(benchmark::State& state) {
+    auto records = MakeRecords(1000, 16);
+    ChainedOutputStream sink;
+    CompressedOutputStream zs(&sink);
+    std::vector<uint8_t> compressed;
+    size_t size = 0;
+    for (auto _ : state) {
+        if (state.range(0)) {
+            sink.Clear();
+            zs.Reset(&sink);
+            {
+                BasicCodedOutputStream<CompressedOutputStream> out(&zs);
+                EncodeRecords(&out, records);
+            }
+            zs.Finish();
+            size = sink.ByteCount();
+        } else {
+            std::vector<uint8_t> plain = EncodeToVector(records);
+            uLongf len = compressBound(plain.size());
+            compressed.resize(len);
+            compress2(compressed.data(), &len, plain.data(), plain.size(), 1);
+            size = len;
+        }
+        benchmark::ClobberMemory();
+    }
+    SetThroughput(state, size, records.size());
+}
+BENCHMARK(BM_Encode_Quark_Compressed)->ArgName("direct")->Arg(0)->Arg(1);
+
+// ---------------------------
+// Record Log
+// ---------------------------
+
+// fetch the record in the middle of a 100k-record log: index lookup vs.
+// decoding delimited records from the start of an unframed file
+void BM_RecordLog_Get(benchmark::State& state) {
+    auto records = MakeRecords(100000, 16);
+    VectorOutputStream framed;
+    {
+        RecordWriter writer(&framed);
+        for (const auto& r : records) {
+            uint8_t buf[64];
+            BufferOutputStream bos(buf, sizeof(buf));
+            {
+                BasicCodedOutputStream<BufferOutputStream> out(&bos);
+                SerializeInt32(&out, r.int_val);
+                SerializeFloat32(&out, r.float_val);
+                SerializeString(&out, r.str_val);
+            }
+            writer.Append(std::span<const uint8_t>(buf, bos.ByteCount()));
+        }
+        writer.Finish();
+    }
+    RecordReader log(framed.buffer());
+    std::vector<uint8_t> plain = EncodeToVector(records);
+    const uint64_t target = records.size() / 2;
+    quark::Arena arena;
+
+    for (auto _ : state) {
+        if (state.range(0)) {
+            LogRecord rec;
+            if (!log.Get(target, rec)) state.SkipWithError("lookup failed");
+            benchmark::DoNotOptimize(rec.value.data());
+        } else {
+            BufferInputStream bis(plain.data(), plain.size());
+            if (!DecodeRecords(&bis, target + 1, &arena)) state.SkipWithError("decode failed");
+            arena.Reset();
+        }
+    }
+}
+BENCHMARK(BM_RecordLog_Get)->ArgName("index")->Arg(0)->Arg(1);
+
+// ---------------------------
+// Parallel Batches
+// ---------------------------
+
+std::vector<quark_gen::TestData> MakeMessages(size_t n) {
+    std::vector<quark_gen::TestData> msgs(n);
+    for (size_t i = 0; i < n; ++i) {
+        msgs[i].int_val = static_cast<int32_t>(i);
+        msgs[i].float_val = static_cast<float>(i) * 0.5f;
+        msgs[i].str_val = std::string(32, 'a' + i % 26);
+    }
+    return msgs;
+}
+
+// arg: background threads (the caller is one more worker)
+void BM_BatchEncode(benchmark::State& state) {
+    auto msgs = MakeMessages(100000);
+    quark::ThreadPool pool(state.range(0));
+    BatchEncoder<quark_gen::TestData> encoder(&pool);
+    for (auto _ : state) {
+        if (!encoder.Encode(msgs)) state.SkipWithError("encode failed");
+        benchmark::DoNotOptimize(encoder.chunks().data());
+    }
+    SetThroughput(state, encoder.ByteCount(), msgs.size());
+}
+BENCHMARK(BM_BatchEncode)->ArgName("threads")->Arg(0)->Arg(1)->Arg(3)->UseRealTime();
+
+void BM_BatchDecode(benchmark::State& state) {
+    auto msgs = MakeMessages(100000);
+    quark::ThreadPool pool(state.range(0));
+    BatchEncoder<quark_gen::TestData> encoder(&pool);
+    encoder.Encode(msgs);
+    std::vector<uint8_t> flat(encoder.ByteCount());
+    size_t pos = 0;
+    for (const auto& c : encoder.chunks()) {
+        std::memcpy(flat.data() + pos, c.data, c.size);
+        pos += c.size;
+    }
+    BatchDecoder decoder(&pool);
+    std::vector<quark_gen::TestData> out;
+    for (auto _ : state) {
+        if (!decoder.Decode(std::span<const uint8_t>(flat), out)) state.SkipWithError("decode failed");
+        benchmark::DoNotOptimize(out.data());
+    }
+    SetThroughput(state, flat.size(), msgs.size());
+}
+BENCHMARK(BM_BatchDecode)->ArgName("threads")->Arg(0)->Arg(1)->Arg(3)->UseRealTime();
+
+// ---------------------------
+// Cross-Thread Handoff
+// ---------------------------
+
+// 10k messages from a producer thread to this one: a VectorOutputStream per
+// message through a mutex-protected queue vs. an SPSC ring
+void BM_Handoff(benchmark::State& state) {
+    constexpr int kMessages = 10000;
+    auto msgs = MakeMessages(kMessages);
+    RingBuffer ring(64 * 1024);
+    for (auto _ : state) {
+        int received = 0;
+        if (state.range(0)) {
+            std::thread producer([&] {
+                RingBufferOutputStream out(&ring);
+                for (const auto& m : msgs) {
+                    {
+                        BasicCodedOutputStream<RingBufferOutputStream> coded(&out);
+                        SerializeDelimited(m, &coded);
+                    }
+                    out.Publish();
+                }
+            });
+            RingBufferInputStream in(&ring);
+            quark_gen::TestData got;
+            while (received < kMessages) {
+                {
+                    BasicCodedInputStream<RingBufferInputStream> coded(&in);
+                    while (received < kMessages && ParseDelimited(got, &coded)) ++received;
+                }
+                in.Release();
+                if (received < kMessages) std::this_thread::yield();
+            }
+            producer.join();
+        } else {
+            std::mutex mu;
+            std::deque<std::vector<uint8_t>> queue;
+            std::thread producer([&] {
+                for (const auto& m : msgs) {
+                    VectorOutputStream vos;
+                    Serialize(m, &vos);
+                    std::lock_guard<std::mutex> lock(mu);
+                    queue.push_back(std::move(vos.buffer()));
+                }
+            });
+            quark_gen::TestData got;
+            while (received < kMessages) {
+                std::vector<uint8_t> buf;
+                {
+                    std::lock_guard<std::mutex> lock(mu);
+                    if (!queue.empty()) {
+                        buf = std::move(queue.front());
+                        queue.pop_front();
+                    }
+                }
+                if (buf.empty()) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                BufferInputStream bis(buf.data(), buf.size());
+                Parse(got, &bis);
+                ++received;
+            }
+            producer.join();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kMessages);
+}
+BENCHMARK(BM_Handoff)->ArgName("ring")->Arg(0)->Arg(1)->UseRealTime();
+
+// ---------------------------
+// Aliased Writes
+// ---------------------------
+
+// 16 x 64 KiB bytes fields into a reused ChainedOutputStream: copied vs.
+// linked into the chain by reference
+void BM_Encode_Aliased(benchmark::State& state) {
+    std::vector<std::vector<uint8_t>> blobs(16, std::vector<uint8_t>(64 * 1024, 0x5A));
+    ChainedOutputStream sink(64 * 1024);
+    size_t size = 0;
+    for (auto _ : state) {
+        sink.Clear();
+        {
+            BasicCodedOutputStream<ChainedOutputStream> out(&sink);
+            out.EnableAliasing(state.range(0) != 0);
+            for (uint32_t i = 0; i < blobs.size(); ++i) SerializeBytesField(&out, i + 1, blobs[i]);
+        }
+        size = sink.ByteCount();
+        benchmark::ClobberMemory();
+    }
+    SetThroughput(state, size, blobs.size());
+}
+BENCHMARK(BM_Encode_Aliased)->ArgName("alias")->Arg(0)->Arg(1);
+
+// ---------------------------
+// Pinned Views
+// ---------------------------
+
+// 1000 strings out of an owned network chunk: copied into std::string vs.
+// PinnedViews sharing the chunk
+void BM_Decode_PinnedStrings(benchmark::State& state) {
+    VectorOutputStream vos;
+    for (int i = 0; i < 1000; ++i) SerializeString(&vos, std::string(state.range(1), static_cast<char>('a' + i % 26)));
+    auto buf = std::make_shared<const std::vector<uint8_t>>(std::move(vos.buffer()));
+    for (auto _ : state) {
+        // fresh per iteration, as if the decoded strings were kept
+        std::vector<std::string> copies(1000);
+        std::vector<quark::PinnedView> views(1000);
+        MultiBufferInputStream mb({{buf->data(), buf->size(), buf}});
+        BasicCodedInputStream<MultiBufferInputStream> in(&mb);
+        if (state.range(0)) {
+            for (auto& v : views) DeserializeString(&in, v);
+        } else {
+            uint8_t tag;
+            for (auto& s : copies) in.ReadByte(tag) && ReadLengthDelimitedString(&in, s);
+        }
+        benchmark::ClobberMemory();
+    }
+    SetThroughput(state, buf->size(), 1000);
+}
+BENCHMARK(BM_Decode_PinnedStrings)->ArgNames({"pinned", "len"})->ArgsProduct({{0, 1}, {200, 4096}});
+
+// ---------------------------
+// File Output
+// ---------------------------
+
+// 100k records to a temp file: staged in a VectorOutputStream and written
+// with one write() (0), FileOutputStream with writev (1) or io_uring (2)
+void BM_FileOutput(benchmark::State& state) {
+    auto records = MakeRecords(100000, 16);
+    std::string path = "/tmp/quark_bench_fd.bin";
+    size_t size = 0;
+    for (auto _ : state) {
+        if (state.range(0) == 0) {
+            std::vector<uint8_t> buf = EncodeToVector(records);
+            int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (::write(fd, buf.data(), buf.size()) != static_cast<ssize_t>(buf.size())) state.SkipWithError("write failed");
+            ::close(fd);
+            size = buf.size();
+        } else {
+            FdStreamOptions options;
+            options.io_uring = state.range(0) == 2;
+            FileOutputStream file(path, options);
+            {
+                BasicCodedOutputStream<FileOutputStream> out(&file);
+                EncodeRecords(&out, records);
+            }
+            size = file.ByteCount();
+            if (!file.Close()) state.SkipWithError("write failed");
+        }
+    }
+    std::remove(path.c_str());
+    SetThroughput(state, size, records.size());
+}
+BENCHMARK(BM_FileOutput)->ArgName("backend")->Arg(0)->Arg(1)->Arg(2)->UseRealTime();
+
+// ---------------------------
+// Async Input
+// ---------------------------
+
+Task<bool> ParseStrings(AsyncInputStream& in, std::vector<std::string>& out) {
+    for (auto& s : out) {
+        bool ok = co_await in.ReadLengthDelimitedString(s);
+        if (!ok) co_return false;
+    }
+    co_return true;
+}
+
+// 1000 length-delimited strings arriving in 4 KiB chunks: every chunk
+// buffered until the message is complete, then parsed (0), vs. a coroutine
+// parsing each chunk as it is fed (1)
+void BM_Decode_Async(benchmark::State& state) {
+    VectorOutputStream vos;
+    for (int i = 0; i < 1000; ++i) {
+        std::string s(200, static_cast<char>('a' + i % 26));
+        WriteLengthDelimitedBytes(&vos, reinterpret_cast<const uint8_t*>(s.data()), s.size());
+    }
+    const auto& wire = vos.buffer();
+    constexpr size_t kChunk = 4096;
+    std::vector<std::string> strings(1000);
+    std::vector<uint8_t> pending;
+    for (auto _ : state) {
+        if (state.range(0)) {
+            AsyncInputStream in;
+            Task<bool> parse = ParseStrings(in, strings);
+            parse.Start();
+            for (size_t pos = 0; pos < wire.size(); pos += kChunk) in.Feed(wire.data() + pos, std::min(kChunk, wire.size() - pos));
+            if (!parse.done() || !parse.result()) state.SkipWithError("parse failed");
+        } else {
+            pending.clear();
+            for (size_t pos = 0; pos < wire.size(); pos += kChunk) {
+                size_t n = std::min(kChunk, wire.size() - pos);
+                pending.insert(pending.end(), wire.data() + pos, wire.data() + pos + n);
+            }
+            BufferInputStream bis(pending.data(), pending.size());
+            BasicCodedInputStream<BufferInputStream> in(&bis);
+            for (auto& s : strings) ReadLengthDelimitedString(&in, s);
+        }
+        benchmark::ClobberMemory();
+    }
+    SetThroughput(state, wire.size(), strings.size());
+}
+BENCHMARK(BM_Decode_Async)->ArgName("async")->Arg(0)->Arg(1);
+
+// ---------------------------
+// Columnar Batches
+// ---------------------------
+
+// 10k TestData records: a row-wise TestBatch (0) vs. one columnar batch (1)
+void BM_Encode_Columnar(benchmark::State& state) {
+    quark_gen::TestBatch batch;
+    batch.records = MakeMessages(10000);
+    ChainedOutputStream sink(64 * 1024);
+    size_t size = 0;
+    for (auto _ : state) {
+        sink.Clear();
+        bool ok = state.range(0) ? SerializeColumnar(std::span<const quark_gen::TestData>(batch.records), &sink)
+                                 : Serialize(batch, &sink);
+        if (!ok) state.SkipWithError("encode failed");
+        size = sink.ByteCount();
+    }
+    SetThroughput(state, size, batch.records.size());
+}
+BENCHMARK(BM_Encode_Columnar)->ArgName("columnar")->Arg(0)->Arg(1);
+
+// decode of the same batch: whole rows (0), whole columnar batch (1), or
+// only the float column of the columnar batch into an array (2)
+void BM_Decode_Columnar(benchmark::State& state) {
+    quark_gen::TestBatch batch;
+    batch.records = MakeMessages(10000);
+    VectorOutputStream vos;
+    bool ok = state.range(0) ? SerializeColumnar(std::span<const quark_gen::TestData>(batch.records), &vos)
+                             : Serialize(batch, &vos);
+    if (!ok) state.SkipWithError("encode failed");
+    const auto& wire = vos.buffer();
+    quark_gen::TestBatch rows;
+    std::vector<quark_gen::TestData> records;
+    std::vector<float> scores;
+    for (auto _ : state) {
+        if (state.range(0) == 0) {
+            rows.records.clear();
+            BufferInputStream bis(wire.data(), wire.size());
+            ok = Parse(rows, &bis);
+        } else if (state.range(0) == 1) {
+            ok = ParseColumnar(records, wire);
+        } else {
+            ColumnarReader columns;
+            ok = columns.Open(wire);
+            scores.resize(columns.record_count());
+            ok = ok && columns.ReadFixedColumn(2, scores.data());
+        }
+        if (!ok) state.SkipWithError("decode failed");
+        benchmark::ClobberMemory();
+    }
+    SetThroughput(state, wire.size(), batch.records.size());
+}
+BENCHMARK(BM_Decode_Columnar)->ArgName("mode")->Arg(0)->Arg(1)->Arg(2);
+
+// 64k sorted millisecond timestamps: packed varints, zigzag deltas, bit-packed deltas
+void BM_Decode_SortedInt64(benchmark::State& state) {
+    std::vector<int64_t> values(65536);
+    int64_t t = 1700000000000;
+    for (size_t i = 0; i < values.size(); ++i) values[i] = t += static_cast<int64_t>(i * 2654435761u % 16);
+    std::vector<uint64_t> unsigned_values(values.begin(), values.end());
+    VectorOutputStream vos;
+    bool ok = state.range(0) == 0   ? WritePackedVarint64(&vos, unsigned_values.data(), values.size())
+              : state.range(0) == 1 ? WritePackedDelta64(&vos, values.data(), values.size())
+                                    : WritePackedFor64(&vos, values.data(), values.size());
+    if (!ok) state.SkipWithError("encode failed");
+    const auto& wire = vos.buffer();
+    std::vector<uint64_t> plain;
+    std::vector<int64_t> got;
+    for (auto _ : state) {
+        plain.clear();
+        got.clear();
+        BufferInputStream bis(wire.data(), wire.size());
+        ok = state.range(0) == 0   ? ReadPackedVarint64(&bis, plain)
+             : state.range(0) == 1 ? ReadPackedDelta64(&bis, got)
+                                   : ReadPackedFor64(&bis, got);
+        if (!ok) state.SkipWithError("decode failed");
+        benchmark::ClobberMemory();
+    }
+    SetThroughput(state, wire.size(), values.size());
+}
+BENCHMARK(BM_Decode_SortedInt64)->ArgName("codec")->Arg(0)->Arg(1)->Arg(2);
+
+// 10k label fields drawn from 200 hostnames: STRING vs DICT_STRING
+std::vector<std::string> MakeLabels() {
+    std::vector<std::string> labels(10000);
+    for (size_t i = 0; i < labels.size(); ++i) labels[i] = "host-" + std::to_string(i * 7919 % 200) + ".example.com";
+    return labels;
+}
+
+void BM_Encode_DictString(benchmark::State& state) {
+    auto labels = MakeLabels();
+    ChainedOutputStream chain;
+    StringDictWriter dict;
+    for (auto _ : state) {
+        chain.Clear();
+        dict.Reset();
+        CodedOutputStream out(&chain);
+        bool ok = true;
+        for (const auto& s : labels) ok &= state.range(0) ? SerializeDictString(&out, dict, s) : SerializeString(&out, s);
+        if (!ok) state.SkipWithError("encode failed");
+        benchmark::ClobberMemory();
+    }
+    SetThroughput(state, chain.ByteCount(), labels.size());
+}
+BENCHMARK(BM_Encode_DictString)->ArgName("dict")->Arg(0)->Arg(1);
+
+void BM_Decode_DictString(benchmark::State& state) {
+    auto labels = MakeLabels();
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        StringDictWriter dict;
+        for (const auto& s : labels) {
+            if (!(state.range(0) ? SerializeDictString(&out, dict, s) : SerializeString(&out, s))) {
+                state.SkipWithError("encode failed");
+            }
+        }
+    }
+    const auto& wire = vos.buffer();
+    StringDictReader dict;
+    std::vector<std::string> owned(labels.size());
+    std::vector<std::string_view> views(labels.size());
+    for (auto _ : state) {
+        dict.Reset();
+        BufferInputStream bis(wire.data(), wire.size());
+        CodedInputStream in(&bis);
+        bool ok = true;
+        for (size_t i = 0; i < labels.size() && ok; ++i) {
+            if (state.range(0)) {
+                ok = DeserializeDictString(&in, dict, views[i]);
+            } else {
+                // what a message with std::string fields pays
+                std::shared_ptr<std::vector<uint8_t>> spill;
+                ok = DeserializeString(&in, owned[i], spill, views[i]);
+                if (ok && !spill) owned[i].assign(views[i]);
+            }
+        }
+        if (!ok) state.SkipWithError("decode failed");
+        benchmark::ClobberMemory();
+    }
+    SetThroughput(state, wire.size(), labels.size());
+}
+BENCHMARK(BM_Decode_DictString)->ArgName("dict")->Arg(0)->Arg(1);
+
+// routing on 2 of 40 fields: full Parse vs MessageView
+void BM_Route(benchmark::State& state) {
+    std::vector<std::vector<uint8_t>> wire(1000);
+    for (size_t i = 0; i < wire.size(); ++i) {
+        quark_gen::Route r;
+        r.destination = "shard-" + std::to_string(i % 16);
+        r.priority = static_cast<int32_t>(i % 5);
+        r.field_1 = "edge-router-1";
+        r.field_3 = static_cast<int32_t>(i);
+        r.field_7 = std::string(160, 'x');
+        r.field_9 = "svc.example.com/v1/accounts/" + std::to_string(i * 7919);
+        r.field_10 = 0.5 * i;
+        r.field_15 = "trace-" + std::to_string(i);
+        r.field_16 = i * 977;
+        r.field_20 = true;
+        r.field_22 = 1.25f;
+        r.field_39 = std::string(512, 'p');   // the body
+        VectorOutputStream vos;
+        if (!Serialize(r, &vos)) state.SkipWithError("encode failed");
+        wire[i] = vos.buffer();
+    }
+    size_t bytes = 0;
+    for (const auto& w : wire) bytes += w.size();
+    quark_gen::Route parsed;
+    for (auto _ : state) {
+        size_t routed = 0;
+        for (const auto& w : wire) {
+            if (state.range(0)) {
+                MessageView view(std::span<const uint8_t>(w.data(), w.size()));
+                routed += view.get<std::string_view>(2)->size() + *view.get<int32_t>(37);
+            } else {
+                parsed = quark_gen::Route();
+                BufferInputStream bis(w.data(), w.size());
+                if (!Parse(parsed, &bis)) state.SkipWithError("decode failed");
+                routed += parsed.destination.size() + parsed.priority;
+            }
+        }
+        benchmark::DoNotOptimize(routed);
+    }
+    SetThroughput(state, bytes, wire.size());
+}
+BENCHMARK(BM_Route)->ArgName("view")->Arg(0)->Arg(1);
+
+// a fresh stream (or arena) per message, as a request handler builds them;
+// allocs_per_msg is the steady-state heap allocation count per message
+void BM_PerMessageAllocs(benchmark::State& state) {
+    auto records = MakeRecords(1, 200);
+    uint64_t before = g_allocations.load(std::memory_order_relaxed);
+    for (auto _ : state) {
+        if (state.range(0) == 0) {
+            VectorOutputStream vos;
+            {
+                BasicCodedOutputStream<VectorOutputStream> out(&vos);
+                EncodeRecords(&out, records);
+            }
+            benchmark::DoNotOptimize(vos.buffer().data());
+        } else if (state.range(0) == 1) {
+            ChainedOutputStream cos(4096);
+            {
+                BasicCodedOutputStream<ChainedOutputStream> out(&cos);
+                EncodeRecords(&out, records);
+            }
+            benchmark::DoNotOptimize(cos.ByteCount());
+        } else {
+            quark::Arena arena;
+            benchmark::DoNotOptimize(arena.Copy(records[0].str_val.data(), records[0].str_val.size()).data());
+        }
+    }
+    uint64_t allocs = g_allocations.load(std::memory_order_relaxed) - before;
+    state.counters["allocs_per_msg"] = static_cast<double>(allocs) / static_cast<double>(state.iterations());
+    SetThroughput(state, EncodeToVector(records).size(), 1);
+}
+BENCHMARK(BM_PerMessageAllocs)->ArgName("stream")->Arg(0)->Arg(1)->Arg(2);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,45 @@
+#!/usr/bin/env python3
+"""Diff two Google Benchmark JSON result files.
+
+usage: bench/compare.py baseline.json candidate.json [--threshold PCT]
+
+Prints the per-benchmark change in real time and exits non-zero if any
+benchmark regressed by more than the threshold (default 5%).
+"""
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        runs = json.load(f)["benchmarks"]
+    return {r["name"]: r for r in runs if r.get("run_type", "iteration") == "iteration"}
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("baseline")
+    parser.add_argument("candidate")
+    parser.add_argument("--threshold", type=float, default=5.0)
+    args = parser.parse_args()
+
+    base, cand = load(args.baseline), load(args.candidate)
+    regressions = 0
+    print(f"{'benchmark':60} {'base':>12} {'new':>12} {'change':>8}")
+    for name in sorted(base.keys() & cand.keys()):
+        b, c = base[name]["real_time"], cand[name]["real_time"]
+        change = (c - b) / b * 100.0 if b else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        unit = base[name].get("time_unit", "ns")
+        print(f"{name:60} {b:10.1f}{unit} {c:10.1f}{unit} {change:+7.1f}%{flag}")
+    for name in sorted(base.keys() - cand.keys()):
+        print(f"{name:60} missing from candidate")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,157 @@
+#pragma once
+// arena.h
+// Bump-pointer arena for short-lived decode scratch (spilled string/bytes
+// fields, temporary arrays). Everything allocated from an Arena is released
+// at once by Reset() or destruction; there is no per-object free. Blocks
+// come from and go back to the thread's BufferPool.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <span>
+#include <string_view>
+#include <algorithm>
+
+#include "quark/buffer_pool.h"
+
+namespace quark {
+
+/**
+ * @class Arena
+ * @brief Bump allocator with cheap reset and thread-local block reuse.
+ *
+ * Memory is carved out of a chain of blocks. Allocation is a pointer bump in
+ * the common case; a new block is linked only when the current one is full.
+ * Reset() rewinds to an empty arena, keeping the first block and returning
+ * the rest to the thread's BufferPool, so a decode loop that resets the
+ * arena per message, or builds a new one, stops hitting malloc once it
+ * reaches steady state.
+ *
+ * An Arena is not thread-safe; use one per thread (or per message in flight).
+ *
+ * Example usage:
+ * quark::Arena arena;
+ * std::string_view name;
+ * DeserializeString(&in, name, &arena);   // spills land in the arena
+ * ...
+ * arena.Reset();
+ */
+class Arena {
+public:
+    static constexpr size_t kDefaultBlockSize = 8192;
+
+    /**
+     * @brief Construct an empty arena. No memory is taken until first use.
+     * @param block_size Size of regular blocks (minimum 256 bytes). Requests
+     *                   larger than this get a dedicated block.
+     */
+    explicit Arena(size_t block_size = kDefaultBlockSize)
+        : block_size_(std::max<size_t>(256, block_size)),
+          head_(nullptr), ptr_(nullptr), end_(nullptr), space_used_(0) {}
+
+    /// Returns every block to the thread's BufferPool.
+    ~Arena() { ReleaseChain(head_); }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /**
+     * @brief Allocates 'size' bytes aligned to 'align' (a power of two).
+     * @return Pointer valid until Reset() or destruction
+     * @throws std::bad_alloc if the system is out of memory
+     */
+    void* Allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        uintptr_t p = (reinterpret_cast<uintptr_t>(ptr_) + align - 1) & ~(uintptr_t(align) - 1);
+        if (ptr_ == nullptr || p + size > reinterpret_cast<uintptr_t>(end_)) {
+            return AllocateSlow(size, align);
+        }
+        ptr_ = reinterpret_cast<uint8_t*>(p + size);
+        space_used_ += size;
+        return reinterpret_cast<void*>(p);
+    }
+
+    /// Allocates an uninitialized array of 'n' trivially-destructible T.
+    template <typename T>
+    T* AllocateArray(size_t n) {
+        return static_cast<T*>(Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    /**
+     * @brief Copies 'size' bytes into the arena.
+     * @return View of the arena copy
+     */
+    std::span<const uint8_t> Copy(const void* data, size_t size) {
+        uint8_t* dst = static_cast<uint8_t*>(Allocate(size, 1));
+        if (size > 0) std::memcpy(dst, data, size);
+        return std::span<const uint8_t>(dst, size);
+    }
+
+    /**
+     * @brief Rewinds the arena to empty. The first block is kept for reuse,
+     *        the rest go back to the thread's BufferPool.
+     */
+    void Reset() {
+        if (head_ == nullptr) return;
+        Block* first = head_;
+        while (first->next != nullptr) first = first->next;  // oldest block
+        if (first != head_) {
+            Block* b = head_;
+            while (b->next != first) b = b->next;
+            b->next = nullptr;
+            ReleaseChain(head_);
+            first->next = nullptr;
+        }
+        head_ = first;
+        ptr_ = first->data();
+        end_ = ptr_ + first->capacity;
+        space_used_ = 0;
+    }
+
+    /// Bytes handed out by Allocate() since the last Reset().
+    size_t SpaceUsed() const { return space_used_; }
+
+    /// Bytes held in blocks owned by this arena.
+    size_t SpaceAllocated() const {
+        size_t total = 0;
+        for (Block* b = head_; b != nullptr; b = b->next) total += b->capacity;
+        return total;
+    }
+
+private:
+    /// Block header; the usable bytes follow it in the same allocation.
+    struct alignas(std::max_align_t) Block {
+        Block* next;        // Older block in the chain
+        size_t capacity;    // Usable bytes after the header
+        uint8_t* data() { return reinterpret_cast<uint8_t*>(this + 1); }
+    };
+
+    static void ReleaseChain(Block* b) {
+        while (b != nullptr) {
+            Block* next = b->next;
+            BufferPool::Deallocate(b, sizeof(Block) + b->capacity);
+            b = next;
+        }
+    }
+
+    void* AllocateSlow(size_t size, size_t align) {
+        size_t needed = size + align;
+        size_t capacity = std::max(block_size_, needed);
+        size_t actual;
+        Block* b = static_cast<Block*>(BufferPool::Allocate(sizeof(Block) + capacity, &actual));
+        b->capacity = actual - sizeof(Block);
+        b->next = head_;
+        head_ = b;
+        ptr_ = b->data();
+        end_ = ptr_ + b->capacity;
+        return Allocate(size, align);
+    }
+
+    size_t block_size_;     // Size of regular blocks
+    Block* head_;           // Newest block; blocks link towards the oldest
+    uint8_t* ptr_;          // Next free byte in head_
+    uint8_t* end_;          // End of head_'s usable bytes
+    size_t space_used_;     // Bytes handed out since the last Reset()
+};
+
+}
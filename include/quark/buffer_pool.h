@@ -0,0 +1,260 @@
+#pragma once
+// buffer_pool.h
+// Per-thread recycling of the heap storage behind output streams and arenas.
+// A serializer that builds a fresh stream for every message would otherwise
+// pay a malloc/free pair per message; with the pool the storage released by
+// one message is picked up by the next, so steady state allocates nothing.
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace quark {
+
+/**
+ * @class BufferPool
+ * @brief Thread-local, size-classed cache of raw blocks and byte vectors.
+ *
+ * Free storage is sorted into power-of-two size classes: n bytes live in
+ * class floor(log2(n)). Allocate(n) takes the first cached block of at least
+ * n bytes from n's class, else any block from the class above, and falls
+ * back to operator new. Every thread has its own cache, so neither side
+ * takes a lock; storage released on another thread joins that thread's
+ * cache. A cache keeps at most kMaxCachedPerClass entries per class,
+ * kMaxCachedBytes in total and nothing above kMaxPooledSize; anything past
+ * those limits is freed at once. Storage released after the thread's cache
+ * has been destroyed (by a thread_local or static object that outlives it)
+ * is freed directly.
+ *
+ * std::vector storage cannot change owner, so vectors (VectorOutputStream)
+ * are cached whole, apart from raw blocks, and TakeVector() searches every
+ * class above the request: a buffer that grew for one message is reused by
+ * the next instead of growing again.
+ *
+ * Example usage:
+ * size_t size;
+ * void* p = quark::BufferPool::Allocate(4096, &size);
+ * ...
+ * quark::BufferPool::Deallocate(p, size);
+ */
+class BufferPool {
+public:
+    static constexpr size_t kNumClasses = 21;
+    static constexpr size_t kMaxPooledSize = (size_t(1) << kNumClasses) - 1;
+    static constexpr size_t kMaxCachedPerClass = 8;
+    static constexpr size_t kMaxCachedBytes = size_t(4) << 20;
+
+    /**
+     * @brief Returns at least 'size' bytes of uninitialized storage.
+     * @param[out] actual Receives the usable size (>= size)
+     * @throws std::bad_alloc if the system is out of memory
+     */
+    static void* Allocate(size_t size, size_t* actual) {
+        size = std::max<size_t>(size, 1);
+        ThreadCache* cache = size <= kMaxPooledSize ? Cache() : nullptr;
+        if (cache != nullptr) {
+            size_t c = ClassOf(size);
+            for (size_t i = 0; i < cache->block_counts[c]; ++i) {
+                if (cache->blocks[c][i].size >= size) return cache->TakeBlock(c, i, actual);
+            }
+            if (c + 1 < kNumClasses && cache->block_counts[c + 1] > 0) {
+                return cache->TakeBlock(c + 1, cache->block_counts[c + 1] - 1, actual);
+            }
+        }
+        *actual = size;
+        return ::operator new(size);
+    }
+
+    /**
+     * @brief Returns storage from Allocate() to this thread's cache.
+     * @param size The requested size or the reported actual size, or any
+     *             value between them
+     */
+    static void Deallocate(void* p, size_t size) {
+        if (p == nullptr) return;
+        ThreadCache* cache = size <= kMaxPooledSize ? Cache() : nullptr;
+        size_t c = ClassOf(std::max<size_t>(size, 1));
+        if (cache == nullptr || !cache->Fits(c, size, cache->block_counts)) {
+            ::operator delete(p);
+            return;
+        }
+        cache->blocks[c][cache->block_counts[c]++] = Entry{p, size};
+        cache->bytes += size;
+    }
+
+    /**
+     * @brief Returns an empty vector with at least 'capacity' bytes reserved,
+     *        recycled if possible.
+     */
+    static std::vector<uint8_t> TakeVector(size_t capacity) {
+        ThreadCache* cache = capacity <= kMaxPooledSize ? Cache() : nullptr;
+        if (cache != nullptr) {
+            size_t c = ClassOf(std::max<size_t>(capacity, 1));
+            for (size_t i = 0; i < cache->vector_counts[c]; ++i) {
+                if (cache->vectors[c][i].capacity() >= capacity) return cache->TakeVector(c, i);
+            }
+            for (size_t k = c + 1; k < kNumClasses; ++k) {
+                if (cache->vector_counts[k] > 0) return cache->TakeVector(k, cache->vector_counts[k] - 1);
+            }
+        }
+        std::vector<uint8_t> v;
+        v.reserve(capacity);
+        return v;
+    }
+
+    /// Clears 'v' and keeps its storage for a later TakeVector().
+    static void GiveVector(std::vector<uint8_t>&& v) {
+        size_t size = v.capacity();
+        if (size == 0 || size > kMaxPooledSize) return;
+        ThreadCache* cache = Cache();
+        size_t c = ClassOf(size);
+        if (cache == nullptr || !cache->Fits(c, size, cache->vector_counts)) return;
+        v.clear();
+        cache->vectors[c][cache->vector_counts[c]++] = std::move(v);
+        cache->bytes += size;
+    }
+
+    /// Bytes cached for reuse on this thread.
+    static size_t CachedBytes() {
+        ThreadCache* cache = Cache();
+        return cache == nullptr ? 0 : cache->bytes;
+    }
+
+    /// Frees everything cached on this thread.
+    static void Trim() {
+        if (ThreadCache* cache = Cache()) cache->Clear();
+    }
+
+private:
+    struct Entry {
+        void* p;
+        size_t size;
+    };
+
+    struct ThreadCache {
+        std::array<std::array<Entry, kMaxCachedPerClass>, kNumClasses> blocks{};
+        std::array<size_t, kNumClasses> block_counts{};
+        std::array<std::array<std::vector<uint8_t>, kMaxCachedPerClass>, kNumClasses> vectors;
+        std::array<size_t, kNumClasses> vector_counts{};
+        size_t bytes = 0;   // Total size of everything cached
+
+        ~ThreadCache() {
+            Clear();
+            CacheDestroyed() = true;
+        }
+
+        void Clear() {
+            for (size_t c = 0; c < kNumClasses; ++c) {
+                for (size_t i = 0; i < block_counts[c]; ++i) ::operator delete(blocks[c][i].p);
+                for (size_t i = 0; i < vector_counts[c]; ++i) std::vector<uint8_t>().swap(vectors[c][i]);
+                block_counts[c] = 0;
+                vector_counts[c] = 0;
+            }
+            bytes = 0;
+        }
+
+        bool Fits(size_t c, size_t size, const std::array<size_t, kNumClasses>& counts) const {
+            return counts[c] < kMaxCachedPerClass && bytes + size <= kMaxCachedBytes;
+        }
+
+        // removal swaps the last entry into the hole; order within a class does not matter
+        void* TakeBlock(size_t c, size_t i, size_t* actual) {
+            Entry e = blocks[c][i];
+            blocks[c][i] = blocks[c][--block_counts[c]];
+            bytes -= e.size;
+            *actual = e.size;
+            return e.p;
+        }
+
+        std::vector<uint8_t> TakeVector(size_t c, size_t i) {
+            std::vector<uint8_t> v = std::move(vectors[c][i]);
+            size_t last = --vector_counts[c];
+            if (i != last) vectors[c][i] = std::move(vectors[c][last]);
+            bytes -= v.capacity();
+            return v;
+        }
+    };
+
+    static size_t ClassOf(size_t size) { return std::bit_width(size) - 1; }
+
+    // trivially destructible, so it stays readable for the rest of thread exit
+    static bool& CacheDestroyed() {
+        thread_local bool destroyed = false;
+        return destroyed;
+    }
+
+    /// This thread's cache, or nullptr once it has been destroyed.
+    static ThreadCache* Cache() {
+        if (CacheDestroyed()) return nullptr;
+        thread_local ThreadCache cache;
+        return &cache;
+    }
+};
+
+/**
+ * @class PooledBuffer
+ * @brief Move-only owner of a BufferPool block; gives it back on destruction.
+ */
+class PooledBuffer {
+public:
+    PooledBuffer() : data_(nullptr), size_(0) {}
+
+    /// Takes a block of at least 'size' bytes from the pool.
+    explicit PooledBuffer(size_t size)
+        : data_(static_cast<uint8_t*>(BufferPool::Allocate(size, &size_))) {}
+
+    ~PooledBuffer() { BufferPool::Deallocate(data_, size_); }
+
+    PooledBuffer(PooledBuffer&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept {
+        if (this != &other) {
+            BufferPool::Deallocate(data_, size_);
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+
+    uint8_t* get() const { return data_; }
+
+    /// Usable bytes, at least the size asked for.
+    size_t size() const { return size_; }
+
+    explicit operator bool() const { return data_ != nullptr; }
+
+private:
+    uint8_t* data_;
+    size_t size_;
+};
+
+/**
+ * @brief std allocator over BufferPool, for containers that are rebuilt per
+ *        message (e.g. the block list of a ChainedOutputStream).
+ */
+template <typename T>
+struct PoolAllocator {
+    using value_type = T;
+
+    PoolAllocator() = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        size_t actual;
+        return static_cast<T*>(BufferPool::Allocate(n * sizeof(T), &actual));
+    }
+
+    void deallocate(T* p, size_t n) { BufferPool::Deallocate(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>&) const { return true; }
+};
+
+}
@@ -0,0 +1,433 @@
+#pragma once
+// async_stream.h
+// Push-driven input for incremental parsing. An event loop feeds bytes as
+// they arrive; a C++20 coroutine awaits the reads it needs and resumes inside
+// Feed() as soon as they can complete. The readers keep partial state (a half
+// decoded varint, a partly filled string) in the awaiting coroutine's frame,
+// so no chunk has to outlive the Feed() call that delivered it and nothing is
+// buffered per message.
+
+#include <coroutine>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "quark/io/endian.h"
+#include "quark/io/varint.h"
+
+namespace quark {
+namespace io {
+
+/**
+ * @class Task
+ * @brief Lazily started coroutine returning a T, awaitable from another Task.
+ *
+ * A top-level task is started with Start(), runs until it first waits for
+ * input, and is driven from then on by AsyncInputStream::Feed(). Awaiting a
+ * task from another one runs it to completion and resumes the awaiter, so
+ * parsers compose (one task per nested message).
+ *
+ * Example usage:
+ * quark::io::Task<bool> ReadHeader(AsyncInputStream& in, Header& h) {
+ *     bool ok = co_await in.ReadVarint32(h.id);
+ *     if (!ok) co_return false;
+ *     ok = co_await in.ReadFixed64(h.time);
+ *     co_return ok;
+ * }
+ *
+ * Always await into a named local as above. GCC 12 miscompiles a co_await
+ * inside a condition or on either side of && and ||; the await can be
+ * skipped entirely.
+ */
+template <typename T>
+class Task {
+public:
+    struct promise_type {
+        std::optional<T> value;
+        std::exception_ptr error;
+        std::coroutine_handle<> continuation;
+
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                std::coroutine_handle<> next = h.promise().continuation;
+                return next ? next : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void return_value(T v) { value = std::move(v); }
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        if (handle_) handle_.destroy();
+    }
+
+    /// Runs the task until it completes or waits for input.
+    void Start() { handle_.resume(); }
+
+    /// True once the coroutine has returned (or thrown).
+    bool done() const { return handle_.done(); }
+
+    /**
+     * @brief The returned value; only valid once done().
+     * @throws whatever the coroutine threw
+     */
+    T& result() {
+        if (handle_.promise().error) std::rethrow_exception(handle_.promise().error);
+        return *handle_.promise().value;
+    }
+
+    // awaitable from another coroutine
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+        handle_.promise().continuation = caller;
+        return handle_;
+    }
+    T await_resume() { return std::move(result()); }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> h) : handle_(h) {}
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+/**
+ * @class AsyncInputStream
+ * @brief Input stream fed by the caller and read with co_await.
+ *
+ * The reads (Next(), ReadVarint32(), ReadFixed32(), ReadRaw(),
+ * ReadLengthDelimitedString(), ...) complete without suspending when the
+ * bytes are already there. Otherwise the coroutine suspends, and Feed()
+ * continues the read with each new chunk, resuming the coroutine once the
+ * read is complete. Every read yields false if Close() ends the input first
+ * or the data is malformed.
+ *
+ * One coroutine reads at a time, and Feed(), Close() and the coroutine run
+ * on the same thread. Blocks from Next() are valid only until the coroutine
+ * next suspends.
+ *
+ * Example usage:
+ * AsyncInputStream in;
+ * Task<bool> parse = ParseRequest(in, request);
+ * parse.Start();
+ * while (!parse.done()) {
+ *     ssize_t n = ::read(fd, buf, sizeof(buf));   // when epoll says readable
+ *     if (n <= 0) in.Close();
+ *     else in.Feed(buf, n);
+ * }
+ */
+class AsyncInputStream {
+public:
+    /// Base of the read awaitables; holds the suspended coroutine.
+    class Read {
+    public:
+        bool await_ready() { return Step(); }
+        void await_suspend(std::coroutine_handle<> h) {
+            handle_ = h;
+            in_->pending_ = this;
+        }
+        bool await_resume() const { return ok_; }
+
+    protected:
+        explicit Read(AsyncInputStream* in) : in_(in), ok_(false) {}
+        ~Read() = default;
+
+        /// Consumes what it can of the current chunk.
+        /// @return true once the read is finished; ok_ then holds its result
+        virtual bool Step() = 0;
+
+        /// Finishes the read with 'ok'.
+        bool Finish(bool ok) {
+            ok_ = ok;
+            return true;
+        }
+
+        AsyncInputStream* in_;
+        bool ok_;
+
+    private:
+        friend class AsyncInputStream;
+        std::coroutine_handle<> handle_;
+    };
+
+    /// Progress of a resumable decoder.
+    enum class Status { kPending, kDone, kFailed };
+
+    /// Byte-at-a-time varint decoder that can stop at any chunk boundary.
+    template <int kMaxBytes>
+    struct VarintDecoder {
+        uint64_t result = 0;
+        int count = 0;
+
+        Status Step(AsyncInputStream* in) {
+            while (in->ptr_ != in->end_) {
+                uint8_t byte = *in->ptr_++;
+                result |= static_cast<uint64_t>(byte & 0x7F) << (7 * count);
+                if ((byte & 0x80) == 0) return Status::kDone;
+                if (++count == kMaxBytes) return Status::kFailed;
+            }
+            return in->closed_ ? Status::kFailed : Status::kPending;
+        }
+    };
+
+    AsyncInputStream() : ptr_(nullptr), end_(nullptr), last_(0), fed_(0), closed_(false), pending_(nullptr) {}
+
+    AsyncInputStream(const AsyncInputStream&) = delete;
+    AsyncInputStream& operator=(const AsyncInputStream&) = delete;
+
+    // ----- producer side -----
+
+    /**
+     * @brief Hands 'size' bytes to the waiting read and runs the coroutine as
+     *        far as they go. 'data' only needs to stay valid for the call.
+     * @return Bytes consumed; less than 'size' only if the coroutine finished
+     *         or stopped reading, in which case the rest belongs to the caller
+     */
+    size_t Feed(const void* data, size_t size) {
+        ptr_ = static_cast<const uint8_t*>(data);
+        end_ = ptr_ + size;
+        fed_ += static_cast<int64_t>(size);
+        Continue();
+        size_t left = static_cast<size_t>(end_ - ptr_);
+        fed_ -= static_cast<int64_t>(left);
+        ptr_ = end_ = nullptr;
+        last_ = 0;
+        return size - left;
+    }
+
+    /// Marks the end of the input; a waiting read fails and its coroutine resumes.
+    void Close() {
+        closed_ = true;
+        Continue();
+    }
+
+    bool closed() const { return closed_; }
+
+    /// True if a coroutine is suspended waiting for more input.
+    bool waiting() const { return pending_ != nullptr; }
+
+    /// Bytes consumed so far.
+    int64_t ByteCount() const { return fed_ - (end_ - ptr_); }
+
+    // ----- consumer side (co_await the results) -----
+
+    class NextRead final : public Read {
+    public:
+        NextRead(AsyncInputStream* in, const uint8_t** block, size_t* size) : Read(in), block_(block), size_(size) {}
+
+    private:
+        bool Step() override {
+            if (in_->ptr_ != in_->end_) {
+                *block_ = in_->ptr_;
+                *size_ = static_cast<size_t>(in_->end_ - in_->ptr_);
+                in_->last_ = *size_;
+                in_->ptr_ = in_->end_;
+                return Finish(true);
+            }
+            return in_->closed_ ? Finish(false) : false;
+        }
+
+        const uint8_t** block_;
+        size_t* size_;
+    };
+
+    /// The rest of the current chunk, waiting for one if there is none.
+    NextRead Next(const uint8_t** block, size_t* size) { return NextRead(this, block, size); }
+
+    /**
+     * @brief Returns the last 'count' bytes of the block from Next().
+     * @throws std::runtime_error if count exceeds that block
+     */
+    void BackUp(size_t count) {
+        if (count > last_) throw std::runtime_error("BackUp out of range");
+        ptr_ -= count;
+        last_ -= count;
+    }
+
+    template <typename T, int kMaxBytes>
+    class VarintRead final : public Read {
+    public:
+        VarintRead(AsyncInputStream* in, T& value) : Read(in), value_(value) {}
+
+    private:
+        bool Step() override {
+            if (decoder_.count == 0 && in_->end_ - in_->ptr_ >= kMaxVarint64Bytes) {
+                const uint8_t* next;
+                if constexpr (sizeof(T) == 4) next = DecodeVarint32Unchecked(in_->ptr_, value_);
+                else next = DecodeVarint64Unchecked(in_->ptr_, value_);
+                if (next == nullptr) return Finish(false);
+                in_->ptr_ = next;
+                return Finish(true);
+            }
+            Status status = decoder_.Step(in_);
+            if (status == Status::kPending) return false;
+            value_ = static_cast<T>(decoder_.result);
+            return Finish(status == Status::kDone);
+        }
+
+        T& value_;
+        VarintDecoder<kMaxBytes> decoder_;
+    };
+
+    VarintRead<uint32_t, kMaxVarint32Bytes> ReadVarint32(uint32_t& value) { return {this, value}; }
+    VarintRead<uint64_t, kMaxVarint64Bytes> ReadVarint64(uint64_t& value) { return {this, value}; }
+
+    template <typename T>
+    class FixedRead final : public Read {
+    public:
+        FixedRead(AsyncInputStream* in, T& value) : Read(in), value_(value), have_(0) {}
+
+    private:
+        bool Step() override {
+            if (have_ == 0 && static_cast<size_t>(in_->end_ - in_->ptr_) >= sizeof(T)) {
+                value_ = Load(in_->ptr_);
+                in_->ptr_ += sizeof(T);
+                return Finish(true);
+            }
+            have_ += in_->Take(bytes_ + have_, sizeof(T) - have_);
+            if (have_ == sizeof(T)) {
+                value_ = Load(bytes_);
+                return Finish(true);
+            }
+            return in_->closed_ ? Finish(false) : false;
+        }
+
+        static T Load(const uint8_t* p) {
+            if constexpr (sizeof(T) == 4) return LoadLittleEndian32(p);
+            else return LoadLittleEndian64(p);
+        }
+
+        T& value_;
+        uint8_t bytes_[sizeof(T)];
+        size_t have_;
+    };
+
+    FixedRead<uint32_t> ReadFixed32(uint32_t& value) { return {this, value}; }
+    FixedRead<uint64_t> ReadFixed64(uint64_t& value) { return {this, value}; }
+
+    class ByteRead final : public Read {
+    public:
+        ByteRead(AsyncInputStream* in, uint8_t& value) : Read(in), value_(value) {}
+
+    private:
+        bool Step() override {
+            if (in_->ptr_ != in_->end_) {
+                value_ = *in_->ptr_++;
+                return Finish(true);
+            }
+            return in_->closed_ ? Finish(false) : false;
+        }
+
+        uint8_t& value_;
+    };
+
+    ByteRead ReadByte(uint8_t& value) { return {this, value}; }
+
+    class CopyRead final : public Read {
+    public:
+        CopyRead(AsyncInputStream* in, void* dst, size_t size)
+            : Read(in), dst_(static_cast<uint8_t*>(dst)), remaining_(size) {}
+
+    private:
+        bool Step() override {
+            size_t n = in_->Take(dst_, remaining_);
+            dst_ += n;
+            remaining_ -= n;
+            if (remaining_ == 0) return Finish(true);
+            return in_->closed_ ? Finish(false) : false;
+        }
+
+        uint8_t* dst_;
+        size_t remaining_;
+    };
+
+    /// Copies exactly 'size' bytes into 'dst' as they arrive.
+    CopyRead ReadRaw(void* dst, size_t size) { return {this, dst, size}; }
+
+    /**
+     * @class StringRead
+     * @brief Varint length, then that many bytes appended to the string
+     *        chunk by chunk. Capacity is reserved in steps, so a corrupt
+     *        length cannot force a huge allocation before the bytes arrive.
+     */
+    class StringRead final : public Read {
+    public:
+        StringRead(AsyncInputStream* in, std::string& str) : Read(in), str_(str), remaining_(0), have_length_(false) {}
+
+    private:
+        bool Step() override {
+            if (!have_length_) {
+                Status status = length_.Step(in_);
+                if (status == Status::kPending) return false;
+                if (status == Status::kFailed) return Finish(false);
+                have_length_ = true;
+                remaining_ = static_cast<uint32_t>(length_.result);
+                str_.clear();
+                str_.reserve(std::min<size_t>(remaining_, 64 * 1024));
+            }
+            size_t n = std::min(remaining_, static_cast<size_t>(in_->end_ - in_->ptr_));
+            str_.append(reinterpret_cast<const char*>(in_->ptr_), n);
+            in_->ptr_ += n;
+            remaining_ -= n;
+            if (remaining_ == 0) return Finish(true);
+            return in_->closed_ ? Finish(false) : false;
+        }
+
+        std::string& str_;
+        VarintDecoder<kMaxVarint32Bytes> length_;
+        size_t remaining_;
+        bool have_length_;
+    };
+
+    /// Reads a varint length and then that many bytes into 'str'.
+    StringRead ReadLengthDelimitedString(std::string& str) { return {this, str}; }
+
+private:
+    /// Copies up to 'size' bytes of the current chunk to 'dst'.
+    size_t Take(uint8_t* dst, size_t size) {
+        size_t n = std::min(size, static_cast<size_t>(end_ - ptr_));
+        std::memcpy(dst, ptr_, n);
+        ptr_ += n;
+        return n;
+    }
+
+    /// Advances the waiting read; resumes its coroutine once it is finished.
+    void Continue() {
+        if (pending_ == nullptr) return;
+        Read* read = pending_;
+        if (!read->Step()) return;
+        pending_ = nullptr;
+        read->handle_.resume();
+    }
+
+    const uint8_t* ptr_;        // Unread part of the chunk being fed
+    const uint8_t* end_;
+    size_t last_;               // Size of the last block from Next(), for BackUp()
+    int64_t fed_;               // Bytes fed and not handed back by Feed()
+    bool closed_;               // Close() was called
+    Read* pending_;             // Read the suspended coroutine is waiting on
+};
+
+}}
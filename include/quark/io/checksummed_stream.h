@@ -0,0 +1,194 @@
+#pragma once
+// checksummed_stream.h
+// Stream decorators that CRC32C the bytes passing through Next()/BackUp() and
+// frame them into records with a 4-byte checksum trailer. The checksum is
+// taken block by block as the data moves through the stream, so there is no
+// second pass over a serialized buffer.
+//
+// Record layout: [ payload... | masked CRC32C of payload (4 bytes LE) ]
+// The payload carries its own framing (e.g. SerializeDelimited()); the
+// decorators only add and check the trailer.
+
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+
+#include "quark/io/crc32c.h"
+#include "quark/io/endian.h"
+#include "quark/io/zero_copy_stream.h"
+
+namespace quark {
+namespace io {
+
+static constexpr size_t kRecordTrailerSize = 4;
+
+/**
+ * @class ChecksummedOutputStream
+ * @brief Wraps a ZeroCopyOutputStream and appends a CRC32C trailer to each record.
+ *
+ * Each block handed out by Next() is checksummed when the next block is
+ * requested or the record ends, i.e. right after the caller filled it, with
+ * any backed-up tail excluded. EndRecord() writes the trailer and starts a
+ * new record.
+ *
+ * Example usage:
+ * ChecksummedOutputStream cs(&vos);
+ * {
+ *     BasicCodedOutputStream<ChecksummedOutputStream> out(&cs);
+ *     SerializeDelimited(msg, &out);
+ * }                                   // cursor returns its unused window
+ * cs.EndRecord();
+ */
+class ChecksummedOutputStream final : public ZeroCopyOutputStream {
+public:
+    /// @param out Underlying stream; must outlive this object.
+    explicit ChecksummedOutputStream(ZeroCopyOutputStream* out)
+        : out_(out), pending_(nullptr), pending_size_(0), crc_(0) {}
+
+    bool Next(uint8_t** block, size_t* size) override {
+        Settle();
+        if (!out_->Next(block, size)) return false;
+        pending_ = *block;
+        pending_size_ = *size;
+        return true;
+    }
+
+    /**
+     * @brief Returns the unused tail of the last block; it is not checksummed.
+     * @throw std::runtime_error if count exceeds what is left of the last block
+     */
+    void BackUp(size_t count) override {
+        if (count > pending_size_) throw std::runtime_error("BackUp out of range");
+        pending_size_ -= count;
+        out_->BackUp(count);
+    }
+
+    bool Flush() override {
+        Settle();
+        return out_->Flush();
+    }
+
+    /// Bytes written to the underlying stream, trailers included.
+    int64_t ByteCount() const override { return out_->ByteCount(); }
+
+    /**
+     * @brief Writes the trailer for the bytes written since the last record.
+     *
+     * Any coded cursor on this stream must have returned its unused window
+     * first (CodedOutputStream::Trim() or destruction), or the reserved but
+     * unwritten bytes become part of the record.
+     *
+     * @return false if the underlying stream is out of space
+     */
+    bool EndRecord() {
+        Settle();
+        uint8_t trailer[kRecordTrailerSize];
+        StoreLittleEndian32(trailer, MaskCrc32c(crc_));
+        crc_ = 0;
+        return out_->WriteRaw(trailer, sizeof(trailer));
+    }
+
+    /// CRC32C of the current record so far.
+    uint32_t RecordCrc() {
+        Settle();
+        return crc_;
+    }
+
+private:
+    /// Folds the bytes of the last block that were kept into the record CRC.
+    void Settle() {
+        if (pending_size_ == 0) return;
+        crc_ = Crc32cExtend(crc_, pending_, pending_size_);
+        pending_size_ = 0;
+    }
+
+    ZeroCopyOutputStream* out_;     // Underlying stream
+    const uint8_t* pending_;        // Last block from Next(), not yet checksummed
+    size_t pending_size_;           // Bytes of 'pending_' still in use
+    uint32_t crc_;                  // CRC32C of the record's settled bytes
+};
+
+/**
+ * @class ChecksummedInputStream
+ * @brief Wraps a ZeroCopyInputStream and verifies the CRC32C trailer of each record.
+ *
+ * Consumed bytes are checksummed block by block. After reading a record's
+ * payload, VerifyRecord() reads the trailer and compares. Skip() reads the
+ * skipped bytes so they are covered by the checksum too.
+ *
+ * Example usage:
+ * ChecksummedInputStream cs(&bis);
+ * {
+ *     BasicCodedInputStream<ChecksummedInputStream> in(&cs);
+ *     ParseDelimited(msg, &in);
+ * }                                   // cursor returns its unread window
+ * if (!cs.VerifyRecord()) ...         // corrupt record
+ */
+class ChecksummedInputStream final : public ZeroCopyInputStream {
+public:
+    /// @param in Underlying stream; must outlive this object.
+    explicit ChecksummedInputStream(ZeroCopyInputStream* in)
+        : in_(in), pending_(nullptr), pending_size_(0), crc_(0) {}
+
+    bool Next(const uint8_t** block, size_t* size) override {
+        Settle();
+        if (!in_->Next(block, size)) return false;
+        pending_ = *block;
+        pending_size_ = *size;
+        return true;
+    }
+
+    /**
+     * @brief Pushes back the unread tail of the last block; it is not checksummed.
+     * @throw std::runtime_error if count exceeds what is left of the last block
+     */
+    void BackUp(size_t count) override {
+        if (count > pending_size_) throw std::runtime_error("BackUp out of range");
+        pending_size_ -= count;
+        in_->BackUp(count);
+    }
+
+    /// Skips by reading through Next(), so the skipped bytes are checksummed.
+    bool Skip(size_t count) override { return ZeroCopyInputStream::Skip(count); }
+
+    int64_t ByteCount() const override { return in_->ByteCount(); }
+
+    /**
+     * @brief Reads the trailer of the current record and checks it against
+     *        the bytes consumed since the previous record.
+     *
+     * Any coded cursor on this stream must have pushed back its unread window
+     * first (CodedInputStream::BackUpRemaining() or destruction).
+     *
+     * @return false if the trailer is missing or does not match
+     */
+    bool VerifyRecord() {
+        Settle();
+        uint32_t expected = crc_;
+        crc_ = 0;
+        uint8_t trailer[kRecordTrailerSize];
+        if (!in_->ReadRaw(trailer, sizeof(trailer))) return false;
+        return UnmaskCrc32c(LoadLittleEndian32(trailer)) == expected;
+    }
+
+    /// CRC32C of the current record's consumed bytes so far.
+    uint32_t RecordCrc() {
+        Settle();
+        return crc_;
+    }
+
+private:
+    /// Folds the consumed bytes of the last block into the record CRC.
+    void Settle() {
+        if (pending_size_ == 0) return;
+        crc_ = Crc32cExtend(crc_, pending_, pending_size_);
+        pending_size_ = 0;
+    }
+
+    ZeroCopyInputStream* in_;       // Underlying stream
+    const uint8_t* pending_;        // Last block from Next(), not yet checksummed
+    size_t pending_size_;           // Bytes of 'pending_' still consumed
+    uint32_t crc_;                  // CRC32C of the record's settled bytes
+};
+
+}}
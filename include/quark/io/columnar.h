@@ -0,0 +1,397 @@
+#pragma once
+// columnar.h
+// Column-major batch encoding for runs of same-shaped records. A row-wise
+// batch repeats every field's tag in every record; a columnar batch stores
+// each field once, as a column block holding that field of every record.
+// Integer columns are varint, delta or bit-packed, fixed-width columns are raw
+// arrays, and string columns are an offsets array plus one contiguous heap,
+// so a reader can decode a single column into a flat array without
+// touching the others.
+//
+// Batch layout:
+//
+//   [ varint record_count ]
+//   [ column ]*         column = [ tag (field, LENGTH_DELIMITED) | varint length | encoding (1) | payload ]
+//
+// Payloads hold record_count values each (all integers little-endian):
+//
+//   kRaw       fixed-width values, 4 or 8 bytes each
+//   kVarint    zigzag varints of the values
+//   kDelta     zigzag varints of v[i] - v[i - 1], with v[-1] = 0
+//   kStrings   fixed32 end offsets into the heap, then the heap
+//   kFor       bit-packed frame-of-reference blocks of the values (int_codec.h)
+//   kDeltaFor  the same blocks over the kDelta differences
+//
+// Columns are framed like ordinary length-delimited fields, so a reader
+// steps over the columns it does not want with one length decode each.
+// quarkc emits SerializeColumnar()/ParseColumnar() for messages made only of
+// scalar and string fields.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "quark/io/endian.h"
+#include "quark/io/int_codec.h"
+#include "quark/io/varint.h"
+#include "quark/io/zero_copy_stream.h"
+
+namespace quark {
+namespace io {
+
+/// Layout of a column payload; stored in the column's first byte.
+enum class ColumnEncoding : uint8_t {
+    kRaw = 0,
+    kVarint = 1,
+    kDelta = 2,
+    kStrings = 3,
+    kFor = 4,
+    kDeltaFor = 5,
+};
+
+/**
+ * @brief Starts a columnar batch of 'records' records; the columns follow.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool WriteColumnarHeader(BasicCodedOutputStream<S>* out, size_t records) {
+    return out->WriteVarint32(static_cast<uint32_t>(records));
+}
+
+namespace detail {
+
+/// Tag, length and encoding byte of a column with 'payload' bytes.
+template <typename S>
+inline bool WriteColumnFrame(BasicCodedOutputStream<S>* out, uint32_t field, ColumnEncoding encoding, size_t payload) {
+    if (!SerializeMessageFieldHeader(out, field, payload + 1)) return false;
+    return out->WriteByte(static_cast<uint8_t>(encoding));
+}
+
+} // namespace detail
+
+/**
+ * @brief Writes a column of fixed-width values as a raw little-endian array.
+ * @param out The output stream to write to.
+ * @param field Field number of the column.
+ * @param n Number of records.
+ * @param get Returns the value of record i, convertible to T.
+ * @return true on success, false on failure.
+ */
+template <FixedWidth T, typename S, typename Get>
+inline bool WriteFixedColumn(BasicCodedOutputStream<S>* out, uint32_t field, size_t n, Get&& get) {
+    if (!detail::WriteColumnFrame(out, field, ColumnEncoding::kRaw, n * sizeof(T))) return false;
+    uint8_t tmp[256];
+    constexpr size_t kPerChunk = sizeof(tmp) / sizeof(T);
+    for (size_t i = 0; i < n; i += kPerChunk) {
+        size_t k = std::min(kPerChunk, n - i);
+        for (size_t j = 0; j < k; ++j) {
+            T value = static_cast<T>(get(i + j));
+            if constexpr (sizeof(T) == 4) StoreLittleEndian32(tmp + j * 4, std::bit_cast<uint32_t>(value));
+            else StoreLittleEndian64(tmp + j * 8, std::bit_cast<uint64_t>(value));
+        }
+        if (!out->WriteRaw(tmp, k * sizeof(T))) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes a column of integers in whichever of kVarint, kDelta, kFor
+ *        and kDeltaFor is smallest.
+ *
+ * One pass over the values, a block of kForBlockSize at a time, sizes all
+ * four; a second pass writes the winner. Sorted IDs and timestamps end up
+ * as bit-packed deltas, often a few bits a value; values clustered in a
+ * narrow range as bit-packed offsets from the block minimum.
+ *
+ * @param out The output stream to write to.
+ * @param field Field number of the column.
+ * @param n Number of records.
+ * @param get Returns the value of record i; any integral type.
+ * @return true on success, false on failure.
+ */
+template <typename S, typename Get>
+inline bool WriteIntColumn(BasicCodedOutputStream<S>* out, uint32_t field, size_t n, Get&& get) {
+    int64_t values[kForBlockSize];
+    int64_t deltas[kForBlockSize];
+    auto gather = [&](size_t i, size_t k, int64_t prev) {
+        for (size_t j = 0; j < k; ++j) values[j] = static_cast<int64_t>(get(i + j));
+        return DeltaEncode64(values, deltas, k, prev);
+    };
+
+    size_t sizes[4] = {0, 0, 0, 0};     // kVarint, kDelta, kFor, kDeltaFor
+    int64_t prev = 0;
+    for (size_t i = 0; i < n; i += kForBlockSize) {
+        size_t k = std::min(kForBlockSize, n - i);
+        prev = gather(i, k, prev);
+        for (size_t j = 0; j < k; ++j) {
+            sizes[0] += VarintSize64(ZigZagEncode64(values[j]));
+            sizes[1] += VarintSize64(ZigZagEncode64(deltas[j]));
+        }
+        sizes[2] += ForBlockSize(values, k);
+        sizes[3] += ForBlockSize(deltas, k);
+    }
+    size_t best = static_cast<size_t>(std::min_element(sizes, sizes + 4) - sizes);
+    static constexpr ColumnEncoding kChoices[4] = {
+        ColumnEncoding::kVarint, ColumnEncoding::kDelta, ColumnEncoding::kFor, ColumnEncoding::kDeltaFor};
+    if (!detail::WriteColumnFrame(out, field, kChoices[best], sizes[best])) return false;
+
+    bool delta = best == 1 || best == 3;
+    uint8_t encoded[kForBlockSize * kMaxVarint64Bytes];
+    static_assert(sizeof(encoded) >= kMaxForBlockBytes + 8);
+    prev = 0;
+    for (size_t i = 0; i < n; i += kForBlockSize) {
+        size_t k = std::min(kForBlockSize, n - i);
+        prev = gather(i, k, prev);
+        const int64_t* block = delta ? deltas : values;
+        uint8_t* end = encoded;
+        if (best >= 2) {
+            end = EncodeForBlock(encoded, block, k);
+        } else {
+            for (size_t j = 0; j < k; ++j) end = CodedOutputStream::EncodeVarint(end, ZigZagEncode64(block[j]));
+        }
+        if (!out->WriteRaw(encoded, end - encoded)) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes a column of strings: every end offset, then all the bytes.
+ * @param out The output stream to write to.
+ * @param field Field number of the column.
+ * @param n Number of records.
+ * @param get Returns the string of record i, convertible to std::string_view.
+ * @return true on success, false if the heap exceeds 4 GiB or the stream fails.
+ */
+template <typename S, typename Get>
+inline bool WriteStringColumn(BasicCodedOutputStream<S>* out, uint32_t field, size_t n, Get&& get) {
+    size_t heap = 0;
+    for (size_t i = 0; i < n; ++i) heap += std::string_view(get(i)).size();
+    if (heap > UINT32_MAX) return false;
+    if (!detail::WriteColumnFrame(out, field, ColumnEncoding::kStrings, n * 4 + heap)) return false;
+    uint8_t tmp[256];
+    uint32_t end = 0;
+    for (size_t i = 0; i < n; i += sizeof(tmp) / 4) {
+        size_t k = std::min(sizeof(tmp) / 4, n - i);
+        for (size_t j = 0; j < k; ++j) {
+            end += static_cast<uint32_t>(std::string_view(get(i + j)).size());
+            StoreLittleEndian32(tmp + j * 4, end);
+        }
+        if (!out->WriteRaw(tmp, k * 4)) return false;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        std::string_view s = get(i);
+        if (!out->WriteRaw(s.data(), s.size())) return false;
+    }
+    return true;
+}
+
+/**
+ * @class StringColumn
+ * @brief A decoded string column: views into the batch bytes, which must
+ *        outlive it. Offsets are checked once by
+ *        ColumnarReader::ReadStringColumn(), so lookups are unchecked.
+ */
+class StringColumn {
+public:
+    StringColumn() : offsets_(nullptr), heap_(nullptr), size_(0) {}
+
+    size_t size() const { return size_; }
+
+    std::string_view operator[](size_t i) const {
+        uint32_t begin = i == 0 ? 0 : LoadLittleEndian32(offsets_ + (i - 1) * 4);
+        uint32_t end = LoadLittleEndian32(offsets_ + i * 4);
+        return std::string_view(heap_ + begin, end - begin);
+    }
+
+    /// All the strings back to back.
+    std::string_view heap() const {
+        return std::string_view(heap_, size_ == 0 ? 0 : LoadLittleEndian32(offsets_ + (size_ - 1) * 4));
+    }
+
+private:
+    friend class ColumnarReader;
+
+    const uint8_t* offsets_;    // size_ little-endian end offsets
+    const char* heap_;
+    size_t size_;
+};
+
+/**
+ * @class ColumnarReader
+ * @brief Random access to the columns of a batch held in memory.
+ *
+ * Open() reads the record count and the column frames only; each column is
+ * decoded when asked for, into a contiguous array or through a callback.
+ * A field written twice resolves to its last column.
+ *
+ * Example usage:
+ * ColumnarReader batch;
+ * if (!batch.Open(bytes)) return false;
+ * std::vector<float> scores(batch.record_count());
+ * if (!batch.ReadFixedColumn(2, scores.data())) return false;
+ */
+class ColumnarReader {
+public:
+    struct Column {
+        uint32_t field;
+        ColumnEncoding encoding;
+        std::span<const uint8_t> payload;   // After the encoding byte
+    };
+
+    ColumnarReader() : records_(0) {}
+
+    /**
+     * @brief Indexes the batch in 'data', which must outlive the reader.
+     * @return false on a malformed header or column frame, or a column too
+     *         short for the record count
+     */
+    bool Open(std::span<const uint8_t> data) {
+        columns_.clear();
+        records_ = 0;
+        const uint8_t* p = data.data();
+        const uint8_t* end = p + data.size();
+        uint64_t count;
+        if (!DecodeVarint64Checked(p, end, count) || count > UINT32_MAX) return false;
+        while (p != end) {
+            uint64_t tag, length;
+            if (!DecodeVarint64Checked(p, end, tag) || !DecodeVarint64Checked(p, end, length)) return false;
+            if (TagWireType(static_cast<uint32_t>(tag)) != WireType::LENGTH_DELIMITED || tag > UINT32_MAX ||
+                TagFieldNumber(static_cast<uint32_t>(tag)) == 0) {
+                return false;
+            }
+            if (length == 0 || length > static_cast<uint64_t>(end - p) || p[0] > 5) return false;
+            // a FOR block spends at least two bytes, every other layout a byte a record
+            bool packed = p[0] == static_cast<uint8_t>(ColumnEncoding::kFor) ||
+                          p[0] == static_cast<uint8_t>(ColumnEncoding::kDeltaFor);
+            if (length - 1 < (packed ? (count + kForBlockSize - 1) / kForBlockSize * 2 : count)) return false;
+            columns_.push_back({TagFieldNumber(static_cast<uint32_t>(tag)), static_cast<ColumnEncoding>(p[0]),
+                                std::span<const uint8_t>(p + 1, length - 1)});
+            p += length;
+        }
+        records_ = static_cast<size_t>(count);
+        return true;
+    }
+
+    /// Records in the batch.
+    size_t record_count() const { return records_; }
+
+    /// Column frames in batch order.
+    const std::vector<Column>& columns() const { return columns_; }
+
+    /// The column of 'field', or nullptr if the batch has none.
+    const Column* Find(uint32_t field) const {
+        for (auto it = columns_.rbegin(); it != columns_.rend(); ++it) {
+            if (it->field == field) return &*it;
+        }
+        return nullptr;
+    }
+
+    bool Has(uint32_t field) const { return Find(field) != nullptr; }
+
+    /**
+     * @brief Copies a raw column into out[0 .. record_count()).
+     * @return false if the column is missing, not kRaw, or not sizeof(T) wide
+     */
+    template <FixedWidth T>
+    bool ReadFixedColumn(uint32_t field, T* out) const {
+        const Column* column = FindRaw(field, sizeof(T));
+        if (column == nullptr) return false;
+        CopyFromLittleEndian(out, column->payload.data(), records_);
+        return true;
+    }
+
+    /// ReadFixedColumn() through fn(i, value), e.g. to fill record structs.
+    template <FixedWidth T, typename Fn>
+    bool DecodeFixedColumn(uint32_t field, Fn&& fn) const {
+        const Column* column = FindRaw(field, sizeof(T));
+        if (column == nullptr) return false;
+        const uint8_t* p = column->payload.data();
+        for (size_t i = 0; i < records_; ++i, p += sizeof(T)) {
+            if constexpr (sizeof(T) == 4) fn(i, std::bit_cast<T>(LoadLittleEndian32(p)));
+            else fn(i, std::bit_cast<T>(LoadLittleEndian64(p)));
+        }
+        return true;
+    }
+
+    /**
+     * @brief Decodes an integer column into out[0 .. record_count()).
+     * @return false if the column is missing, not an integer column, or malformed
+     */
+    template <std::integral T>
+    bool ReadIntColumn(uint32_t field, T* out) const {
+        return DecodeIntColumn<T>(field, [out](size_t i, T v) { out[i] = v; });
+    }
+
+    /// ReadIntColumn() through fn(i, value), e.g. to fill record structs.
+    template <std::integral T, typename Fn>
+    bool DecodeIntColumn(uint32_t field, Fn&& fn) const {
+        const Column* column = Find(field);
+        if (column == nullptr) return false;
+        ColumnEncoding encoding = column->encoding;
+        bool packed = encoding == ColumnEncoding::kFor || encoding == ColumnEncoding::kDeltaFor;
+        bool delta = encoding == ColumnEncoding::kDelta || encoding == ColumnEncoding::kDeltaFor;
+        if (!packed && encoding != ColumnEncoding::kVarint && !delta) return false;
+        const uint8_t* p = column->payload.data();
+        const uint8_t* end = p + column->payload.size();
+        int64_t block[kForBlockSize];
+        int64_t base = 0;
+        for (size_t i = 0; i < records_; i += kForBlockSize) {
+            size_t k = std::min(kForBlockSize, records_ - i);
+            if (packed) {
+                p = DecodeForBlock(p, end, block, k);
+                if (p == nullptr) return false;
+            } else {
+                for (size_t j = 0; j < k; ++j) {
+                    uint64_t zigzag;
+                    if (!DecodeVarint64Checked(p, end, zigzag)) return false;
+                    block[j] = ZigZagDecode64(zigzag);
+                }
+            }
+            if (delta) base = PrefixSum64(block, k, base);
+            for (size_t j = 0; j < k; ++j) fn(i + j, static_cast<T>(block[j]));
+        }
+        return p == end;
+    }
+
+    /**
+     * @brief Checks a string column's offsets and returns views into it.
+     * @return false if the column is missing, not kStrings, or its offsets
+     *         decrease or do not end exactly at the end of the heap
+     */
+    bool ReadStringColumn(uint32_t field, StringColumn& out) const {
+        const Column* column = Find(field);
+        if (column == nullptr || column->encoding != ColumnEncoding::kStrings) return false;
+        size_t offsets = records_ * 4;
+        if (column->payload.size() < offsets) return false;
+        const uint8_t* p = column->payload.data();
+        uint32_t prev = 0;
+        for (size_t i = 0; i < records_; ++i) {
+            uint32_t end = LoadLittleEndian32(p + i * 4);
+            if (end < prev) return false;
+            prev = end;
+        }
+        if (prev != column->payload.size() - offsets) return false;
+        out.offsets_ = p;
+        out.heap_ = reinterpret_cast<const char*>(p + offsets);
+        out.size_ = records_;
+        return true;
+    }
+
+private:
+    const Column* FindRaw(uint32_t field, size_t width) const {
+        const Column* column = Find(field);
+        if (column == nullptr || column->encoding != ColumnEncoding::kRaw) return nullptr;
+        return column->payload.size() == records_ * width ? column : nullptr;
+    }
+
+    size_t records_;
+    std::vector<Column> columns_;
+};
+
+}}
@@ -0,0 +1,311 @@
+#pragma once
+// compressed_stream.h
+// Stream decorators that deflate data on its way to another stream and
+// inflate it on the way back, so a batch can be serialized straight into a
+// compressing sink instead of being built in a vector and compressed after.
+//
+// The wire format is a raw deflate stream (RFC 1951) with no header or
+// checksum; wrap the inner stream in a ChecksummedOutputStream if integrity
+// matters. Users of this header link with -lz.
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <vector>
+#include <zlib.h>
+
+#include "quark/io/zero_copy_stream.h"
+
+namespace quark {
+namespace io {
+
+/// Settings shared by the compressor and decompressor; both sides must use
+/// the same dictionary.
+struct CompressionOptions {
+    /// Bytes staged per compression step (and per decompressed block).
+    size_t block_size = 64 * 1024;
+
+    /// zlib level: 1 (fastest) to 9 (smallest).
+    int level = 1;
+
+    /**
+     * Preset dictionary: bytes that typical payloads share (field tags,
+     * common strings). Lets small messages compress well on their own.
+     * Must stay alive as long as any stream using it.
+     */
+    std::span<const uint8_t> dictionary;
+};
+
+/**
+ * @class CompressedOutputStream
+ * @brief Compresses everything written to it into another output stream.
+ *
+ * Next() hands out a staging block; each filled block is deflated directly
+ * into the blocks of the underlying stream. Finish() ends the compressed
+ * stream. The deflate context is kept across Reset() calls so one object
+ * can compress any number of batches without reallocating.
+ *
+ * Example usage:
+ * CompressedOutputStream zs(&vos);
+ * {
+ *     CodedOutputStream out(&zs);
+ *     for (auto& m : batch) SerializeDelimited(m, &out);
+ * }
+ * zs.Finish();
+ */
+class CompressedOutputStream final : public ZeroCopyOutputStream {
+public:
+    /// @param out Underlying stream; must outlive this object (or the next Reset()).
+    explicit CompressedOutputStream(ZeroCopyOutputStream* out, const CompressionOptions& options = {})
+        : out_(out), options_(options), buffer_(options.block_size), used_(0), last_provided_(0),
+          total_(0), finished_(false), error_(false) {
+        z_ = {};
+        // negative window bits: raw deflate stream, no zlib header or adler32
+        if (deflateInit2(&z_, options_.level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error("deflateInit2 failed");
+        }
+        SetDictionary();
+    }
+
+    ~CompressedOutputStream() override { deflateEnd(&z_); }
+
+    CompressedOutputStream(const CompressedOutputStream&) = delete;
+    CompressedOutputStream& operator=(const CompressedOutputStream&) = delete;
+
+    bool Next(uint8_t** block, size_t* size) override {
+        if (finished_ || error_) return false;
+        if (used_ == buffer_.size() && !Deflate(Z_NO_FLUSH)) return false;
+        *block = buffer_.data() + used_;
+        *size = buffer_.size() - used_;
+        last_provided_ = *size;
+        used_ = buffer_.size();
+        return true;
+    }
+
+    /// @throw std::runtime_error if count exceeds the last block handed out
+    void BackUp(size_t count) override {
+        if (count > last_provided_) throw std::runtime_error("BackUp out of range");
+        used_ -= count;
+        last_provided_ -= count;
+    }
+
+    /**
+     * @brief Compresses the staged bytes and flushes them to a byte boundary
+     *        in the underlying stream, then flushes that stream.
+     *
+     * Everything written so far can then be decompressed, at the cost of a
+     * few bytes and some ratio; call it at batch boundaries, not per message.
+     */
+    bool Flush() override {
+        if (finished_ || error_) return false;
+        return Deflate(Z_SYNC_FLUSH) && out_->Flush();
+    }
+
+    /// Uncompressed bytes written, excluding backed-up bytes.
+    int64_t ByteCount() const override { return total_ + static_cast<int64_t>(used_); }
+
+    /**
+     * @brief Compresses the remaining bytes and terminates the deflate stream.
+     *
+     * Any coded cursor on this stream must be trimmed or destroyed first.
+     * No more data can be written until Reset().
+     *
+     * @return false if the underlying stream ran out of space
+     */
+    bool Finish() {
+        if (finished_ || error_) return !error_;
+        finished_ = Deflate(Z_FINISH);
+        return finished_;
+    }
+
+    /// True once the underlying stream refused a block or deflate failed.
+    bool HadError() const { return error_; }
+
+    /**
+     * @brief Starts a new compressed stream into 'out', reusing the
+     *        deflate state and staging block.
+     */
+    void Reset(ZeroCopyOutputStream* out) {
+        out_ = out;
+        deflateReset(&z_);
+        SetDictionary();
+        used_ = 0;
+        last_provided_ = 0;
+        total_ = 0;
+        finished_ = false;
+        error_ = false;
+    }
+
+private:
+    void SetDictionary() {
+        if (options_.dictionary.empty()) return;
+        deflateSetDictionary(&z_, options_.dictionary.data(), static_cast<uInt>(options_.dictionary.size()));
+    }
+
+    /// Deflates the staged bytes into the underlying stream's blocks.
+    bool Deflate(int flush) {
+        z_.next_in = buffer_.data();
+        z_.avail_in = static_cast<uInt>(used_);
+        total_ += used_;
+        used_ = 0;
+        last_provided_ = 0;
+
+        int rc;
+        do {
+            uint8_t* block;
+            size_t size;
+            if (!out_->Next(&block, &size)) {
+                error_ = true;
+                return false;
+            }
+            z_.next_out = block;
+            z_.avail_out = static_cast<uInt>(size);
+            rc = deflate(&z_, flush);
+            out_->BackUp(z_.avail_out);
+            if (rc == Z_STREAM_ERROR) {
+                error_ = true;
+                return false;
+            }
+            // with no flush, deflate is done once it has taken all the input;
+            // otherwise it is done once it leaves output space unused
+        } while (flush == Z_FINISH ? rc != Z_STREAM_END
+                                   : (z_.avail_in > 0 || (flush != Z_NO_FLUSH && z_.avail_out == 0)));
+        return true;
+    }
+
+    ZeroCopyOutputStream* out_;     // Underlying stream receiving compressed bytes
+    CompressionOptions options_;
+    z_stream z_;                    // Reused deflate context
+    std::vector<uint8_t> buffer_;   // Staging block handed out by Next()
+    size_t used_;                   // Bytes of 'buffer_' handed out and not backed up
+    size_t last_provided_;          // Size of the last block from Next()
+    int64_t total_;                 // Uncompressed bytes already deflated
+    bool finished_;                 // Finish() has terminated the stream
+    bool error_;                    // Underlying stream full or deflate failed
+};
+
+/**
+ * @class DecompressedInputStream
+ * @brief Reads the data of a compressed stream written by CompressedOutputStream.
+ *
+ * Each Next() inflates another block from the underlying stream. Once the
+ * compressed stream ends, unread bytes after it are backed up to the
+ * underlying stream, so whatever follows can be read from there.
+ */
+class DecompressedInputStream final : public ZeroCopyInputStream {
+public:
+    /// @param in Underlying stream; must outlive this object (or the next Reset()).
+    explicit DecompressedInputStream(ZeroCopyInputStream* in, const CompressionOptions& options = {})
+        : in_(in), options_(options), buffer_(options.block_size), filled_(0), backed_up_(0),
+          last_size_(0), total_(0), ended_(false), error_(false) {
+        z_ = {};
+        if (inflateInit2(&z_, -15) != Z_OK) throw std::runtime_error("inflateInit2 failed");
+        SetDictionary();
+    }
+
+    ~DecompressedInputStream() override { inflateEnd(&z_); }
+
+    DecompressedInputStream(const DecompressedInputStream&) = delete;
+    DecompressedInputStream& operator=(const DecompressedInputStream&) = delete;
+
+    bool Next(const uint8_t** block, size_t* size) override {
+        if (backed_up_ > 0) {
+            *block = buffer_.data() + filled_ - backed_up_;
+            *size = backed_up_;
+            backed_up_ = 0;
+        } else {
+            if (!Inflate()) return false;
+            *block = buffer_.data();
+            *size = filled_;
+        }
+        last_size_ = *size;
+        total_ += *size;
+        return true;
+    }
+
+    /// @throw std::runtime_error if count exceeds the last block returned
+    void BackUp(size_t count) override {
+        if (count > last_size_) throw std::runtime_error("BackUp out of range");
+        backed_up_ += count;
+        last_size_ -= count;
+        total_ -= count;
+    }
+
+    /// Uncompressed bytes consumed.
+    int64_t ByteCount() const override { return total_; }
+
+    /// True if the compressed data was corrupt or truncated; Next() then returns
+    /// false once the bytes inflated before the error have been handed out.
+    bool HadError() const { return error_; }
+
+    /// Starts reading a new compressed stream from 'in', reusing the inflate state.
+    void Reset(ZeroCopyInputStream* in) {
+        in_ = in;
+        inflateReset(&z_);
+        SetDictionary();
+        filled_ = 0;
+        backed_up_ = 0;
+        last_size_ = 0;
+        total_ = 0;
+        ended_ = false;
+        error_ = false;
+    }
+
+private:
+    void SetDictionary() {
+        // raw inflate takes the dictionary up front rather than on Z_NEED_DICT
+        if (options_.dictionary.empty()) return;
+        inflateSetDictionary(&z_, options_.dictionary.data(), static_cast<uInt>(options_.dictionary.size()));
+    }
+
+    /// Refills 'buffer_' with the next inflated bytes; false at end, or on an
+    /// error that left nothing to hand out.
+    bool Inflate() {
+        filled_ = 0;
+        if (ended_ || error_) return false;
+        z_.next_out = buffer_.data();
+        z_.avail_out = static_cast<uInt>(buffer_.size());
+        while (z_.avail_out > 0) {
+            bool input_left = true;
+            if (z_.avail_in == 0) {
+                const uint8_t* block;
+                size_t size;
+                input_left = in_->Next(&block, &size);
+                z_.next_in = input_left ? const_cast<Bytef*>(block) : nullptr;
+                z_.avail_in = input_left ? static_cast<uInt>(size) : 0;
+            }
+            int rc = inflate(&z_, Z_NO_FLUSH);
+            if (rc == Z_STREAM_END) {
+                ended_ = true;
+                in_->BackUp(z_.avail_in);
+                z_.avail_in = 0;
+                break;
+            }
+            // out of input before the deflate stream ended: truncated
+            if ((rc != Z_OK && rc != Z_BUF_ERROR) || !input_left) {
+                error_ = true;
+                break;
+            }
+            // return what is there once the next block would have to be fetched
+            if (z_.avail_in == 0 && z_.avail_out < buffer_.size()) break;
+        }
+        // bytes inflated before an error are still good; the next call
+        // reports the error
+        filled_ = buffer_.size() - z_.avail_out;
+        return filled_ > 0;
+    }
+
+    ZeroCopyInputStream* in_;       // Underlying stream of compressed bytes
+    CompressionOptions options_;
+    z_stream z_;                    // Reused inflate context
+    std::vector<uint8_t> buffer_;   // Inflated block handed out by Next()
+    size_t filled_;                 // Valid bytes in 'buffer_'
+    size_t backed_up_;              // Bytes at the end of 'buffer_' pushed back
+    size_t last_size_;              // Bytes of the last block still consumed
+    int64_t total_;                 // Uncompressed bytes consumed
+    bool ended_;                    // Deflate stream end reached
+    bool error_;                    // Corrupt or truncated input
+};
+
+}}
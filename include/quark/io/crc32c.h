@@ -0,0 +1,148 @@
+#pragma once
+// crc32c.h
+// CRC32C (Castagnoli) for record integrity. Uses the SSE4.2 crc32
+// instruction (checked once at runtime) or the ARMv8 CRC extension when the
+// build targets it, and a slicing-by-8 table otherwise. All paths produce
+// the same value, so checksums written on one host verify on any other.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <array>
+
+#include "quark/io/endian.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    #define QUARK_CRC32C_X86 1
+    #include <immintrin.h>
+#else
+    #define QUARK_CRC32C_X86 0
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+    #define QUARK_CRC32C_ARM 1
+    #include <arm_acle.h>
+#else
+    #define QUARK_CRC32C_ARM 0
+#endif
+
+namespace quark {
+namespace io {
+
+namespace detail {
+
+/// Reflected Castagnoli polynomial.
+static constexpr uint32_t kCrc32cPoly = 0x82F63B78u;
+
+using Crc32cTables = std::array<std::array<uint32_t, 256>, 8>;
+
+/// Slicing-by-8 tables: table[k][b] is the CRC of byte b followed by k zero bytes.
+constexpr Crc32cTables BuildCrc32cTables() {
+    Crc32cTables t{};
+    for (uint32_t b = 0; b < 256; ++b) {
+        uint32_t crc = b;
+        for (int i = 0; i < 8; ++i) crc = (crc >> 1) ^ (kCrc32cPoly & (0u - (crc & 1)));
+        t[0][b] = crc;
+    }
+    for (uint32_t b = 0; b < 256; ++b) {
+        for (int k = 1; k < 8; ++k) t[k][b] = (t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xFF];
+    }
+    return t;
+}
+
+inline constexpr Crc32cTables kCrc32cTables = BuildCrc32cTables();
+
+/// Portable path; 'crc' is the raw (pre-inverted) register.
+inline uint32_t Crc32cSoftware(uint32_t crc, const uint8_t* p, size_t n) {
+    const Crc32cTables& t = kCrc32cTables;
+    while (n >= 8) {
+        uint32_t lo = LoadLittleEndian32(p) ^ crc;
+        uint32_t hi = LoadLittleEndian32(p + 4);
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        p += 8;
+        n -= 8;
+    }
+    while (n-- > 0) crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+    return crc;
+}
+
+#if QUARK_CRC32C_X86
+__attribute__((target("sse4.2")))
+inline uint32_t Crc32cSse42(uint32_t crc, const uint8_t* p, size_t n) {
+    uint64_t c = crc;
+    while (n >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        c = _mm_crc32_u64(c, word);
+        p += 8;
+        n -= 8;
+    }
+    uint32_t c32 = static_cast<uint32_t>(c);
+    while (n-- > 0) c32 = _mm_crc32_u8(c32, *p++);
+    return c32;
+}
+
+inline bool CpuHasSse42() {
+    static const bool has = __builtin_cpu_supports("sse4.2");
+    return has;
+}
+#endif
+
+#if QUARK_CRC32C_ARM
+inline uint32_t Crc32cArm(uint32_t crc, const uint8_t* p, size_t n) {
+    while (n >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        crc = __crc32cd(crc, word);
+        p += 8;
+        n -= 8;
+    }
+    while (n-- > 0) crc = __crc32cb(crc, *p++);
+    return crc;
+}
+#endif
+
+} // namespace detail
+
+/**
+ * @brief Extends a CRC32C over 'n' more bytes.
+ *
+ * Chains: Crc32cExtend(Crc32cExtend(0, a, na), b, nb) == Crc32c of a then b.
+ *
+ * @param crc CRC of the preceding bytes (0 to start)
+ * @param data Bytes to add
+ * @param n Number of bytes
+ * @return CRC32C of the preceding bytes followed by 'data'
+ */
+inline uint32_t Crc32cExtend(uint32_t crc, const void* data, size_t n) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+#if QUARK_CRC32C_ARM
+    crc = detail::Crc32cArm(crc, p, n);
+#else
+#if QUARK_CRC32C_X86
+    if (detail::CpuHasSse42()) return ~detail::Crc32cSse42(crc, p, n);
+#endif
+    crc = detail::Crc32cSoftware(crc, p, n);
+#endif
+    return ~crc;
+}
+
+/// CRC32C of 'n' bytes.
+inline uint32_t Crc32c(const void* data, size_t n) { return Crc32cExtend(0, data, n); }
+
+/// Rotates and offsets a CRC before it is stored next to the data it
+/// covers, so a CRC computed over bytes that themselves contain CRCs (a
+/// record holding another framed record) does not degenerate.
+constexpr uint32_t MaskCrc32c(uint32_t crc) {
+    return ((crc >> 15) | (crc << 17)) + 0xa282ead8u;
+}
+
+/// Inverse of MaskCrc32c().
+constexpr uint32_t UnmaskCrc32c(uint32_t masked) {
+    uint32_t rot = masked - 0xa282ead8u;
+    return (rot >> 17) | (rot << 15);
+}
+
+}}
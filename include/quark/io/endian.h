@@ -0,0 +1,75 @@
+#pragma once
+// endian.h
+// Unaligned little-endian loads and stores used by the wire-format code.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <bit>
+#include <type_traits>
+
+namespace quark {
+namespace io {
+
+/// Unaligned little-endian load. A single memcpy that compiles to one mov on
+/// little-endian targets, so it is safe at any address inside a chunk.
+inline uint32_t LoadLittleEndian32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    if constexpr (std::endian::native == std::endian::big) v = __builtin_bswap32(v);
+    return v;
+}
+
+/// 64-bit counterpart of LoadLittleEndian32.
+inline uint64_t LoadLittleEndian64(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    if constexpr (std::endian::native == std::endian::big) v = __builtin_bswap64(v);
+    return v;
+}
+
+/// Unaligned little-endian store.
+inline void StoreLittleEndian32(uint8_t* p, uint32_t v) {
+    if constexpr (std::endian::native == std::endian::big) v = __builtin_bswap32(v);
+    std::memcpy(p, &v, sizeof(v));
+}
+
+/// 64-bit counterpart of StoreLittleEndian32.
+inline void StoreLittleEndian64(uint8_t* p, uint64_t v) {
+    if constexpr (std::endian::native == std::endian::big) v = __builtin_bswap64(v);
+    std::memcpy(p, &v, sizeof(v));
+}
+
+/// 4- or 8-byte trivially copyable values (int32_t, float, uint64_t, double, ...)
+/// that travel as raw little-endian words in packed arrays.
+template <typename T>
+concept FixedWidth = std::is_trivially_copyable_v<T> && (sizeof(T) == 4 || sizeof(T) == 8);
+
+/// Copies 'n' values to 'dst' in little-endian byte order: one memcpy on
+/// little-endian hosts, a byte swap per value otherwise.
+template <FixedWidth T>
+inline void CopyToLittleEndian(uint8_t* dst, const T* src, size_t n) {
+    if constexpr (std::endian::native == std::endian::little) {
+        if (n > 0) std::memcpy(dst, src, n * sizeof(T));
+    } else {
+        for (size_t i = 0; i < n; ++i, dst += sizeof(T)) {
+            if constexpr (sizeof(T) == 4) StoreLittleEndian32(dst, std::bit_cast<uint32_t>(src[i]));
+            else StoreLittleEndian64(dst, std::bit_cast<uint64_t>(src[i]));
+        }
+    }
+}
+
+/// Inverse of CopyToLittleEndian().
+template <FixedWidth T>
+inline void CopyFromLittleEndian(T* dst, const uint8_t* src, size_t n) {
+    if constexpr (std::endian::native == std::endian::little) {
+        if (n > 0) std::memcpy(dst, src, n * sizeof(T));
+    } else {
+        for (size_t i = 0; i < n; ++i, src += sizeof(T)) {
+            if constexpr (sizeof(T) == 4) dst[i] = std::bit_cast<T>(LoadLittleEndian32(src));
+            else dst[i] = std::bit_cast<T>(LoadLittleEndian64(src));
+        }
+    }
+}
+
+}}
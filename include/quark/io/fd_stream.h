@@ -0,0 +1,549 @@
+#pragma once
+// fd_stream.h
+// Output streams over file descriptors. Serialization goes straight into a
+// fixed pool of reusable blocks; a full pool (or Flush()) is written with a
+// single writev(), so nothing is staged in a growing buffer first. On Linux
+// full blocks can instead be queued on io_uring and written while the next
+// ones are being filled.
+
+#include "quark/io/zero_copy_stream.h"
+
+#if QUARK_POSIX
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+    #define QUARK_IO_URING 1
+    #include <linux/io_uring.h>
+    #include <sys/syscall.h>
+#else
+    #define QUARK_IO_URING 0
+#endif
+
+namespace quark {
+namespace io {
+
+/// Block pool and backend settings for FileOutputStream / SocketOutputStream.
+struct FdStreamOptions {
+    size_t block_size = 64 * 1024;  // Bytes per pool block (minimum 4096)
+    size_t blocks = 8;              // Blocks in the pool (1 to 256)
+    bool io_uring = false;          // Linux: write full blocks through io_uring; ignored if unavailable
+};
+
+#if QUARK_IO_URING
+namespace detail {
+
+/**
+ * @class IoUring
+ * @brief Minimal io_uring submission/completion ring over the raw syscalls,
+ *        just enough for queued writes from registered buffers.
+ */
+class IoUring {
+public:
+    IoUring() = default;
+    ~IoUring() { Close(); }
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    /// @return false if the kernel does not provide io_uring (or forbids it)
+    bool Init(unsigned entries) {
+        io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        int fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &p));
+        if (fd < 0) return false;
+        fd_ = fd;
+
+        sq_size_ = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+        cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+
+        sq_ring_ = Map(sq_size_, IORING_OFF_SQ_RING);
+        cq_ring_ = single ? sq_ring_ : Map(cq_size_, IORING_OFF_CQ_RING);
+        sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = Map(sqes_size_, IORING_OFF_SQES);
+        if (sq_ring_ == nullptr || cq_ring_ == nullptr || sqes == nullptr) {
+            if (sqes != nullptr) ::munmap(sqes, sqes_size_);
+            Close();
+            return false;
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        uint8_t* sq = static_cast<uint8_t*>(sq_ring_);
+        sq_head_ = reinterpret_cast<uint32_t*>(sq + p.sq_off.head);
+        sq_tail_ = reinterpret_cast<uint32_t*>(sq + p.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<uint32_t*>(sq + p.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<uint32_t*>(sq + p.sq_off.array);
+        sq_entries_ = p.sq_entries;
+        uint8_t* cq = static_cast<uint8_t*>(cq_ring_);
+        cq_head_ = reinterpret_cast<uint32_t*>(cq + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<uint32_t*>(cq + p.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<uint32_t*>(cq + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        local_tail_ = *sq_tail_;
+        return true;
+    }
+
+    /// Registers 'count' buffers for IORING_OP_WRITE_FIXED.
+    bool RegisterBuffers(const iovec* iov, unsigned count) {
+        return ::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS, iov, count) == 0;
+    }
+
+    /// Returns a zeroed submission entry, or nullptr if the queue is full.
+    io_uring_sqe* GetSqe() {
+        uint32_t head = std::atomic_ref<uint32_t>(*sq_head_).load(std::memory_order_acquire);
+        if (local_tail_ - head == sq_entries_) return nullptr;
+        uint32_t index = local_tail_ & sq_mask_;
+        sq_array_[index] = index;
+        ++local_tail_;
+        io_uring_sqe* sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    /**
+     * @brief Publishes queued entries and optionally waits for completions.
+     * @return false on a syscall error (errno is set)
+     */
+    bool Submit(unsigned wait_for) {
+        uint32_t submitted = local_tail_ - std::atomic_ref<uint32_t>(*sq_tail_).load(std::memory_order_relaxed);
+        std::atomic_ref<uint32_t>(*sq_tail_).store(local_tail_, std::memory_order_release);
+        unsigned flags = wait_for > 0 ? IORING_ENTER_GETEVENTS : 0;
+        for (;;) {
+            long r = ::syscall(__NR_io_uring_enter, fd_, submitted, wait_for, flags, nullptr, 0);
+            if (r >= 0) return true;
+            if (errno != EINTR) return false;
+        }
+    }
+
+    /// Next completion, or nullptr if none is ready. Call PopCqe() after reading it.
+    io_uring_cqe* PeekCqe() {
+        uint32_t head = *cq_head_;
+        if (head == std::atomic_ref<uint32_t>(*cq_tail_).load(std::memory_order_acquire)) return nullptr;
+        return &cqes_[head & cq_mask_];
+    }
+
+    void PopCqe() { std::atomic_ref<uint32_t>(*cq_head_).store(*cq_head_ + 1, std::memory_order_release); }
+
+private:
+    void* Map(size_t size, off_t offset) {
+        void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    void Close() {
+        if (sqes_ != nullptr) ::munmap(sqes_, sqes_size_);
+        if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) ::munmap(cq_ring_, cq_size_);
+        if (sq_ring_ != nullptr) ::munmap(sq_ring_, sq_size_);
+        if (fd_ >= 0) ::close(fd_);
+        sqes_ = nullptr;
+        sq_ring_ = cq_ring_ = nullptr;
+        fd_ = -1;
+    }
+
+    int fd_ = -1;
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    size_t sq_size_ = 0;
+    size_t cq_size_ = 0;
+    size_t sqes_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    uint32_t* sq_head_ = nullptr;
+    uint32_t* sq_tail_ = nullptr;
+    uint32_t* sq_array_ = nullptr;
+    uint32_t sq_mask_ = 0;
+    uint32_t sq_entries_ = 0;
+    uint32_t local_tail_ = 0;       // Tail including entries not yet published
+    uint32_t* cq_head_ = nullptr;
+    uint32_t* cq_tail_ = nullptr;
+    uint32_t cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+};
+
+}
+#endif // QUARK_IO_URING
+
+/**
+ * @class FdOutputStream
+ * @brief Shared implementation of FileOutputStream and SocketOutputStream.
+ *
+ * Next() hands out the pool blocks in turn. With the writev backend, filling
+ * the last block writes the whole pool in one call and starts over; with
+ * io_uring, each full block is queued as it fills and Next() only waits if
+ * the block it wants back is still being written.
+ *
+ * Large payloads written with WriteAliasedRaw() go to the kernel straight
+ * from the caller's memory, in the same writev() as the blocks before them;
+ * the call returns once they are written, so no lifetime contract outlives it.
+ *
+ * Errors (a failed write, a closed peer) are sticky: Next() and Flush()
+ * return false from then on and error() holds the errno.
+ */
+class FdOutputStream : public ZeroCopyOutputStream {
+public:
+    ~FdOutputStream() override { Close(); }
+
+    FdOutputStream(const FdOutputStream&) = delete;
+    FdOutputStream& operator=(const FdOutputStream&) = delete;
+
+    bool Next(uint8_t** block, size_t* size) override {
+        if (fd_ < 0 || error_ != 0) return false;
+        if (used_ == block_size_ && !Advance()) return false;
+        *block = Block(cur_) + used_;
+        *size = block_size_ - used_;
+        used_ = block_size_;
+        last_provided_ = *size;
+        total_ += static_cast<int64_t>(*size);
+        return true;
+    }
+
+    /// @throw std::runtime_error if count exceeds the last block handed out
+    void BackUp(size_t count) override {
+        if (count > last_provided_) throw std::runtime_error("BackUp out of range");
+        used_ -= count;
+        last_provided_ -= count;
+        total_ -= static_cast<int64_t>(count);
+    }
+
+    /**
+     * @brief Writes every buffered byte and waits for queued writes. Any
+     *        coded cursor must be trimmed first.
+     * @return false if a write failed
+     */
+    bool Flush() override {
+        if (fd_ < 0) return false;
+        last_provided_ = 0;
+        if (error_ != 0) return false;
+#if QUARK_IO_URING
+        if (ring_) {
+            if (used_ > 0) SubmitBlock(cur_, used_);
+            used_ = 0;
+            return WaitAll();
+        }
+#endif
+        return WritePool(nullptr, 0);
+    }
+
+    int64_t ByteCount() const override { return total_; }
+
+    /// Payloads are written from the caller's memory before WriteAliasedRaw() returns.
+    bool AllowsAliasing() const override { return true; }
+
+    bool WriteAliasedRaw(const void* data, size_t size) override {
+        if (fd_ < 0 || error_ != 0) return false;
+        last_provided_ = 0;
+#if QUARK_IO_URING
+        if (ring_) {
+            if (!Flush()) return false;
+            iovec iov{const_cast<void*>(data), size};
+            if (!WriteAll(&iov, 1)) return false;
+            total_ += static_cast<int64_t>(size);
+            return true;
+        }
+#endif
+        if (!WritePool(data, size)) return false;
+        total_ += static_cast<int64_t>(size);
+        return true;
+    }
+
+    /**
+     * @brief Flushes and, if the stream owns its descriptor, closes it.
+     *        Further writes fail. Called by the destructor.
+     * @return false if the final flush or close() failed
+     */
+    bool Close() {
+        if (fd_ < 0) return error_ == 0;
+        bool ok = Flush();
+#if QUARK_IO_URING
+        ring_.reset();
+#endif
+        if (owns_fd_ && ::close(fd_) != 0 && ok) {
+            error_ = errno;
+            ok = false;
+        }
+        fd_ = -1;
+        return ok;
+    }
+
+    /// True if a write failed; error() has the errno.
+    bool HadError() const { return error_ != 0; }
+    int error() const { return error_; }
+
+    /// True if writes go through io_uring rather than writev().
+    bool uses_io_uring() const {
+#if QUARK_IO_URING
+        return ring_ != nullptr;
+#else
+        return false;
+#endif
+    }
+
+protected:
+    /**
+     * @param fd Descriptor to write to
+     * @param owns_fd Close 'fd' in Close()
+     * @param socket Use send() flags that suppress SIGPIPE
+     */
+    FdOutputStream(int fd, bool owns_fd, bool socket, const FdStreamOptions& options)
+        : fd_(fd), owns_fd_(owns_fd), socket_(socket),
+          block_size_(std::max<size_t>(4096, options.block_size)),
+          block_count_(std::clamp<size_t>(options.blocks, 1, 256)),
+          pool_(std::make_unique_for_overwrite<uint8_t[]>(block_size_ * block_count_)),
+          cur_(0), used_(0), last_provided_(0), total_(0), error_(0) {
+        offset_ = socket ? -1 : ::lseek(fd, 0, SEEK_CUR);
+#if QUARK_IO_URING
+        if (options.io_uring) InitRing();
+#else
+        (void)options;
+#endif
+    }
+
+private:
+    uint8_t* Block(size_t i) const { return pool_.get() + i * block_size_; }
+
+    /// Moves to the next block once the current one is full.
+    bool Advance() {
+#if QUARK_IO_URING
+        if (ring_) {
+            SubmitBlock(cur_, used_);
+            size_t next = (cur_ + 1) % block_count_;
+            while (pending_[next].busy && Reap()) {}
+            cur_ = next;
+            used_ = 0;
+            return error_ == 0;
+        }
+#endif
+        if (cur_ + 1 < block_count_) {
+            ++cur_;
+            used_ = 0;
+            return true;
+        }
+        return WritePool(nullptr, 0);
+    }
+
+    /// Writes blocks [0, cur_] and then 'extra' with one writev(), and rewinds the pool.
+    bool WritePool(const void* extra, size_t extra_size) {
+        iovec iov[257];
+        int count = 0;
+        for (size_t i = 0; i <= cur_; ++i) {
+            size_t len = i < cur_ ? block_size_ : used_;
+            if (len > 0) iov[count++] = iovec{Block(i), len};
+        }
+        if (extra_size > 0) iov[count++] = iovec{const_cast<void*>(extra), extra_size};
+        cur_ = 0;
+        used_ = 0;
+        return WriteAll(iov, count);
+    }
+
+    /// Blocking write of a whole scatter list, resuming after short writes.
+    bool WriteAll(iovec* iov, int count) {
+        while (count > 0) {
+            ssize_t n;
+            if (offset_ >= 0) {
+                n = ::pwritev(fd_, iov, count, offset_);
+            } else if (socket_) {
+                msghdr msg;
+                std::memset(&msg, 0, sizeof(msg));
+                msg.msg_iov = iov;
+                msg.msg_iovlen = static_cast<decltype(msg.msg_iovlen)>(count);
+#ifdef MSG_NOSIGNAL
+                n = ::sendmsg(fd_, &msg, MSG_NOSIGNAL);
+#else
+                n = ::sendmsg(fd_, &msg, 0);
+#endif
+            } else {
+                n = ::writev(fd_, iov, count);
+            }
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    pollfd p{fd_, POLLOUT, 0};
+                    ::poll(&p, 1, -1);
+                    continue;
+                }
+                error_ = errno;
+                return false;
+            }
+            if (offset_ >= 0) offset_ += n;
+            size_t written = static_cast<size_t>(n);
+            while (count > 0 && written >= iov->iov_len) {
+                written -= iov->iov_len;
+                ++iov;
+                --count;
+            }
+            if (count > 0) {
+                iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + written;
+                iov->iov_len -= written;
+            }
+        }
+        return true;
+    }
+
+#if QUARK_IO_URING
+    /// Per-block state of a queued write.
+    struct Pending {
+        bool busy = false;
+        size_t size = 0;
+        int64_t offset = -1;
+    };
+
+    void InitRing() {
+        auto ring = std::make_unique<detail::IoUring>();
+        if (!ring->Init(static_cast<unsigned>(block_count_))) return;
+        std::vector<iovec> iov(block_count_);
+        for (size_t i = 0; i < block_count_; ++i) iov[i] = iovec{Block(i), block_size_};
+        // registration needs locked memory; plain writes work without it
+        fixed_ = ring->RegisterBuffers(iov.data(), static_cast<unsigned>(block_count_));
+        pending_.assign(block_count_, Pending());
+        ring_ = std::move(ring);
+    }
+
+    /// Queues block 'b'. Writes to an unseekable descriptor are kept one at
+    /// a time so they cannot be reordered.
+    void SubmitBlock(size_t b, size_t size) {
+        if (size == 0 || error_ != 0) return;
+        if (offset_ < 0) WaitAll();
+        io_uring_sqe* sqe;
+        while ((sqe = ring_->GetSqe()) == nullptr) {
+            if (!Reap()) return;
+        }
+        if (socket_) {
+            sqe->opcode = IORING_OP_SEND;
+#ifdef MSG_NOSIGNAL
+            sqe->msg_flags = MSG_NOSIGNAL;
+#endif
+        } else if (fixed_) {
+            sqe->opcode = IORING_OP_WRITE_FIXED;
+            sqe->buf_index = static_cast<uint16_t>(b);
+        } else {
+            sqe->opcode = IORING_OP_WRITE;
+        }
+        sqe->fd = fd_;
+        sqe->addr = reinterpret_cast<uint64_t>(Block(b));
+        sqe->len = static_cast<uint32_t>(size);
+        sqe->off = offset_ >= 0 ? static_cast<uint64_t>(offset_) : 0;
+        sqe->user_data = b;
+        pending_[b] = Pending{true, size, offset_};
+        if (offset_ >= 0) offset_ += static_cast<int64_t>(size);
+        ++inflight_;
+        if (!ring_->Submit(0)) error_ = errno;
+    }
+
+    /// Waits for and handles one completion. Short writes are finished
+    /// synchronously.
+    /// @return false if the ring itself failed
+    bool Reap() {
+        io_uring_cqe* cqe = ring_->PeekCqe();
+        if (cqe == nullptr) {
+            if (!ring_->Submit(1)) {
+                if (error_ == 0) error_ = errno;
+                return false;
+            }
+            cqe = ring_->PeekCqe();
+        }
+        if (cqe == nullptr) return true;
+        size_t b = static_cast<size_t>(cqe->user_data);
+        int res = cqe->res;
+        ring_->PopCqe();
+        Pending& p = pending_[b];
+        p.busy = false;
+        --inflight_;
+        if (res < 0) {
+            if (error_ == 0) error_ = -res;
+        } else if (static_cast<size_t>(res) < p.size && error_ == 0) {
+            iovec rest{Block(b) + res, p.size - res};
+            int64_t saved = offset_;
+            offset_ = p.offset >= 0 ? p.offset + res : -1;
+            WriteAll(&rest, 1);
+            if (saved >= 0) offset_ = saved;
+        }
+        return true;
+    }
+
+    /// Waits for every queued write, even after an error, so no block is
+    /// reused while the kernel may still read it.
+    bool WaitAll() {
+        while (inflight_ > 0 && Reap()) {}
+        return error_ == 0;
+    }
+
+    std::unique_ptr<detail::IoUring> ring_;
+    std::vector<Pending> pending_;      // One per block
+    size_t inflight_ = 0;               // Queued writes not yet completed
+    bool fixed_ = false;                // Blocks are registered buffers
+#endif
+
+    int fd_;
+    bool owns_fd_;
+    bool socket_;
+    size_t block_size_;
+    size_t block_count_;
+    std::unique_ptr<uint8_t[]> pool_;   // block_count_ blocks of block_size_ bytes
+    size_t cur_;                        // Block being filled
+    size_t used_;                       // Bytes of it handed out and not backed up
+    size_t last_provided_;              // Size of the last block from Next()
+    int64_t total_;                     // Bytes written through the stream
+    int64_t offset_;                    // File offset of the next write; -1 if unseekable
+    int error_;                         // errno of the first failed write, or 0
+};
+
+/**
+ * @class FileOutputStream
+ * @brief Writes to a file through a reusable block pool.
+ *
+ * Example usage:
+ * FileOutputStream file("events.bin");
+ * {
+ *     BasicCodedOutputStream<FileOutputStream> out(&file);
+ *     for (const Event& e : events) SerializeDelimited(e, &out);
+ * }
+ * if (!file.Close()) ...;
+ */
+class FileOutputStream final : public FdOutputStream {
+public:
+    /**
+     * @brief Creates (or truncates) and opens 'path' for writing.
+     * @throws std::runtime_error if the file cannot be opened
+     */
+    explicit FileOutputStream(const std::string& path, const FdStreamOptions& options = FdStreamOptions())
+        : FdOutputStream(Open(path), true, false, options) {}
+
+private:
+    static int Open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) throw std::runtime_error("FileOutputStream: cannot open " + path);
+        return fd;
+    }
+};
+
+/**
+ * @class SocketOutputStream
+ * @brief Writes to a connected stream socket through a reusable block pool.
+ *
+ * The descriptor is borrowed, not closed. Writes never raise SIGPIPE; a
+ * closed peer shows up as a failed Flush() with error() == EPIPE.
+ * Non-blocking sockets are waited on with poll().
+ */
+class SocketOutputStream final : public FdOutputStream {
+public:
+    /// @param fd Connected socket; must stay open for the stream's lifetime.
+    explicit SocketOutputStream(int fd, const FdStreamOptions& options = FdStreamOptions())
+        : FdOutputStream(fd, false, true, options) {}
+};
+
+}}
+
+#endif // QUARK_POSIX
@@ -0,0 +1,381 @@
+#pragma once
+// int_codec.h
+// Integer array encodings for sorted or clustered sequences (timestamps,
+// monotonically increasing IDs) that plain varints store at full
+// magnitude:
+//
+//   delta   zigzag varints of v[i] - v[i - 1], with v[-1] = 0
+//   FOR     frame of reference: blocks of kForBlockSize values stored as
+//           the block minimum plus (v - min) bit-packed at the narrowest
+//           width that holds the block; optionally applied to the deltas
+//
+// A FOR block is [ zigzag varint min | width (1) | ceil(n * width / 8) bytes ],
+// the bits little-endian, value i at bit i * width. Delta decoding ends in
+// a prefix sum, done four lanes at a time with AVX2 when the CPU has it
+// (checked once at runtime) and two lanes with SSE2 otherwise.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <bit>
+#include <span>
+#include <vector>
+
+#include "quark/io/endian.h"
+#include "quark/io/varint.h"
+#include "quark/io/zero_copy_stream.h"
+
+namespace quark {
+namespace io {
+
+static constexpr size_t kForBlockSize = 128;
+
+/// Largest encoded FOR block: minimum, width byte, 64-bit values.
+static constexpr size_t kMaxForBlockBytes = kMaxVarint64Bytes + 1 + kForBlockSize * 8;
+
+namespace detail {
+
+inline int64_t PrefixSum64Scalar(int64_t* v, size_t n, int64_t base) {
+    uint64_t sum = static_cast<uint64_t>(base);
+    for (size_t i = 0; i < n; ++i) {
+        sum += static_cast<uint64_t>(v[i]);
+        v[i] = static_cast<int64_t>(sum);
+    }
+    return static_cast<int64_t>(sum);
+}
+
+#if QUARK_X86_SIMD
+/// Two lanes: [a, b] -> [a, a + b], plus the running total.
+inline int64_t PrefixSum64Sse2(int64_t* v, size_t n, int64_t base) {
+    __m128i carry = _mm_set1_epi64x(base);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i + 2));
+        x = _mm_add_epi64(x, _mm_slli_si128(x, 8));
+        y = _mm_add_epi64(y, _mm_slli_si128(y, 8));
+        x = _mm_add_epi64(x, carry);
+        y = _mm_add_epi64(y, _mm_unpackhi_epi64(x, x));
+        carry = _mm_unpackhi_epi64(y, y);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(v + i), x);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(v + i + 2), y);
+    }
+    return PrefixSum64Scalar(v + i, n - i, _mm_cvtsi128_si64(carry));
+}
+
+/// Four lanes: two in-register shift-and-add steps, then the carry from
+/// the previous vector. Two vectors per iteration keep the carry chain to
+/// one add and one permute per eight values.
+__attribute__((target("avx2")))
+inline int64_t PrefixSum64Avx2(int64_t* v, size_t n, int64_t base) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i carry = _mm256_set1_epi64x(base);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i + 4));
+        // [a b c d] + [0 a b c]
+        x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0x90), zero, 0x03));
+        y = _mm256_add_epi64(y, _mm256_blend_epi32(_mm256_permute4x64_epi64(y, 0x90), zero, 0x03));
+        // + [0 0 a a+b]
+        x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, 0x40), zero, 0x0F));
+        y = _mm256_add_epi64(y, _mm256_blend_epi32(_mm256_permute4x64_epi64(y, 0x40), zero, 0x0F));
+        x = _mm256_add_epi64(x, carry);
+        y = _mm256_add_epi64(y, _mm256_permute4x64_epi64(x, 0xFF));
+        carry = _mm256_permute4x64_epi64(y, 0xFF);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(v + i), x);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(v + i + 4), y);
+    }
+    return PrefixSum64Scalar(v + i, n - i, _mm256_extract_epi64(carry, 0));
+}
+
+inline bool CpuHasAvx2() {
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+}
+#endif
+
+/// Bit width of (max - min) over a block; the FOR width.
+inline int ForWidth(const int64_t* v, size_t n, int64_t& min) {
+    int64_t lo = v[0], hi = v[0];
+    for (size_t i = 1; i < n; ++i) {
+        lo = std::min(lo, v[i]);
+        hi = std::max(hi, v[i]);
+    }
+    min = lo;
+    return std::bit_width(static_cast<uint64_t>(hi) - static_cast<uint64_t>(lo));
+}
+
+} // namespace detail
+
+/**
+ * @brief Replaces v[i] with base + v[0] + ... + v[i] (wrapping), undoing a
+ *        delta encoding in place.
+ * @return The last sum, i.e. the base for the next run
+ */
+inline int64_t PrefixSum64(int64_t* v, size_t n, int64_t base = 0) {
+#if QUARK_X86_SIMD
+    if (detail::CpuHasAvx2()) return detail::PrefixSum64Avx2(v, n, base);
+    return detail::PrefixSum64Sse2(v, n, base);
+#else
+    return detail::PrefixSum64Scalar(v, n, base);
+#endif
+}
+
+/// Writes out[i] = in[i] - in[i - 1] (wrapping), with in[-1] = 'prev'.
+/// 'in' and 'out' may be the same array.
+inline int64_t DeltaEncode64(const int64_t* in, int64_t* out, size_t n, int64_t prev = 0) {
+    for (size_t i = 0; i < n; ++i) {
+        int64_t v = in[i];
+        out[i] = static_cast<int64_t>(static_cast<uint64_t>(v) - static_cast<uint64_t>(prev));
+        prev = v;
+    }
+    return prev;
+}
+
+/// Encoded size of one FOR block of 'n' (1..kForBlockSize) values.
+inline size_t ForBlockSize(const int64_t* v, size_t n) {
+    int64_t min;
+    int width = detail::ForWidth(v, n, min);
+    return VarintSize64(ZigZagEncode64(min)) + 1 + (n * width + 7) / 8;
+}
+
+/**
+ * @brief Encodes one FOR block of 'n' (1..kForBlockSize) values.
+ * @param target Needs ForBlockSize() bytes plus 8 bytes of slack, zeroed
+ *        or not; the slack may be overwritten
+ * @return Pointer past the block
+ */
+inline uint8_t* EncodeForBlock(uint8_t* target, const int64_t* v, size_t n) {
+    int64_t min;
+    int width = detail::ForWidth(v, n, min);
+    target = CodedOutputStream::EncodeVarint(target, ZigZagEncode64(min));
+    *target++ = static_cast<uint8_t>(width);
+    size_t bytes = (n * width + 7) / 8;
+    std::memset(target, 0, bytes + 8);
+    for (size_t i = 0; i < n && width > 0; ++i) {
+        uint64_t diff = static_cast<uint64_t>(v[i]) - static_cast<uint64_t>(min);
+        size_t pos = i * width;
+        uint8_t* q = target + pos / 8;
+        int shift = static_cast<int>(pos % 8);
+        StoreLittleEndian64(q, LoadLittleEndian64(q) | (diff << shift));
+        if (shift + width > 64) q[8] |= static_cast<uint8_t>(diff >> (64 - shift));
+    }
+    return target + bytes;
+}
+
+/**
+ * @brief Decodes one FOR block of 'n' (1..kForBlockSize) values from [p, end).
+ * @return Pointer past the block, or nullptr if it is truncated or malformed
+ */
+inline const uint8_t* DecodeForBlock(const uint8_t* p, const uint8_t* end, int64_t* out, size_t n) {
+    uint64_t zigzag;
+    if (!DecodeVarint64Checked(p, end, zigzag) || p == end || *p > 64) return nullptr;
+    int width = *p++;
+    size_t bytes = (n * width + 7) / 8;
+    if (static_cast<size_t>(end - p) < bytes) return nullptr;
+    uint64_t min = static_cast<uint64_t>(ZigZagDecode64(zigzag));
+    if (width == 0) {
+        std::fill(out, out + n, static_cast<int64_t>(min));
+        return p;
+    }
+
+    // the unpack loads 9 bytes at the last value; pad a copy when the input ends too soon
+    uint8_t padded[kForBlockSize * 8 + 16];
+    const uint8_t* bits = p;
+    if (static_cast<size_t>(end - p) < bytes + 9) {
+        std::memcpy(padded, p, bytes);
+        std::memset(padded + bytes, 0, 16);
+        bits = padded;
+    }
+    uint64_t mask = width == 64 ? ~0ull : (1ull << width) - 1;
+    for (size_t i = 0; i < n; ++i) {
+        size_t pos = i * width;
+        const uint8_t* q = bits + pos / 8;
+        int s = static_cast<int>(pos % 8);
+        uint64_t word = LoadLittleEndian64(q) >> s;
+        if (s + width > 64) word |= static_cast<uint64_t>(q[8]) << (64 - s);
+        out[i] = static_cast<int64_t>(min + (word & mask));
+    }
+    return p + bytes;
+}
+
+/**
+ * @brief Writes an int64 array as zigzag deltas: varint byte length, then
+ *        one varint per difference from the previous value.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool WritePackedDelta64(BasicCodedOutputStream<S>* out, const int64_t* values, size_t n) {
+    auto delta = [values](size_t i) {
+        uint64_t prev = i == 0 ? 0 : static_cast<uint64_t>(values[i - 1]);
+        return ZigZagEncode64(static_cast<int64_t>(static_cast<uint64_t>(values[i]) - prev));
+    };
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; ++i) bytes += VarintSize64(delta(i));
+    if (!out->WriteVarint32(static_cast<uint32_t>(bytes))) return false;
+    for (size_t i = 0; i < n; ++i) {
+        if (!out->WriteVarint64(delta(i))) return false;
+    }
+    return true;
+}
+
+template <OutputStream S>
+inline bool WritePackedDelta64(S* out, const int64_t* values, size_t n) {
+    BasicCodedOutputStream<S> coded(out);
+    return WritePackedDelta64(&coded, values, n);
+}
+
+namespace detail {
+
+/// The next 'bytes' bytes as one contiguous span, copied into 'scratch'
+/// only if they straddle chunks.
+template <typename S>
+inline bool ReadContiguous(BasicCodedInputStream<S>* in, size_t bytes, std::vector<uint8_t>& scratch,
+                           std::span<const uint8_t>& out) {
+    if (in->ReadAliased(bytes, out)) {
+        CountStat(IoStat::kBytesAliased, bytes);
+        return true;
+    }
+    CountStat(IoStat::kSpillCopies);
+    CountStat(IoStat::kBytesCopied, bytes);
+    scratch.resize(bytes);
+    if (!in->ReadRaw(scratch.data(), bytes)) return false;
+    out = std::span<const uint8_t>(scratch.data(), bytes);
+    return true;
+}
+
+/// Zigzag delta varints from [p, end) until 'end', appended to 'out'. On
+/// failure 'out' is cut back to its old size.
+inline bool DecodeDeltaVarints(const uint8_t* p, const uint8_t* end, std::vector<int64_t>& out) {
+    size_t count = 0;
+    for (const uint8_t* q = p; q != end; ++q) count += *q < 0x80;
+    size_t old = out.size();
+    out.resize(old + count);
+    int64_t* dst = out.data() + old;
+    for (size_t i = 0; i < count; ++i) {
+        // small deltas are the common case; skip the general decoder for them
+        uint64_t zigzag = *p;
+        if (zigzag < 0x80) {
+            ++p;
+        } else if (!DecodeVarint64Checked(p, end, zigzag)) {
+            out.resize(old);
+            return false;
+        }
+        dst[i] = ZigZagDecode64(zigzag);
+    }
+    if (p != end) {
+        out.resize(old);
+        return false;
+    }
+    PrefixSum64(dst, count, 0);
+    return true;
+}
+
+} // namespace detail
+
+/**
+ * @brief Reads an array written by WritePackedDelta64(), appending the
+ *        values to 'out': one pass decodes the varints, a SIMD prefix sum
+ *        restores the values.
+ * @return false on truncated or malformed input; 'out' is then unchanged.
+ */
+template <typename S>
+inline bool ReadPackedDelta64(BasicCodedInputStream<S>* in, std::vector<int64_t>& out) {
+    uint32_t bytes;
+    if (!detail::ReadPackedLength(in, 1, bytes)) return false;
+    std::vector<uint8_t> scratch;
+    std::span<const uint8_t> payload;
+    if (!detail::ReadContiguous(in, bytes, scratch, payload)) return false;
+    return detail::DecodeDeltaVarints(payload.data(), payload.data() + payload.size(), out);
+}
+
+template <InputStream S>
+inline bool ReadPackedDelta64(S* in, std::vector<int64_t>& out) {
+    BasicCodedInputStream<S> coded(in);
+    return ReadPackedDelta64(&coded, out);
+}
+
+/**
+ * @brief Writes an int64 array bit-packed in FOR blocks: varint byte length,
+ *        varint count, a flags byte (1 = blocks hold deltas), then the blocks.
+ * @param delta Frame the differences between values rather than the values;
+ *        the better choice for sorted input
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool WritePackedFor64(BasicCodedOutputStream<S>* out, const int64_t* values, size_t n, bool delta = true) {
+    int64_t block[kForBlockSize];
+    size_t bytes = VarintSize64(n) + 1;
+    int64_t prev = 0;
+    for (size_t i = 0; i < n; i += kForBlockSize) {
+        size_t k = std::min(kForBlockSize, n - i);
+        if (delta) prev = DeltaEncode64(values + i, block, k, prev);
+        bytes += ForBlockSize(delta ? block : values + i, k);
+    }
+    if (!out->WriteVarint32(static_cast<uint32_t>(bytes))) return false;
+    if (!out->WriteVarint64(n)) return false;
+    if (!out->WriteByte(delta ? 1 : 0)) return false;
+    uint8_t encoded[kMaxForBlockBytes + 8];
+    prev = 0;
+    for (size_t i = 0; i < n; i += kForBlockSize) {
+        size_t k = std::min(kForBlockSize, n - i);
+        if (delta) prev = DeltaEncode64(values + i, block, k, prev);
+        uint8_t* end = EncodeForBlock(encoded, delta ? block : values + i, k);
+        if (!out->WriteRaw(encoded, end - encoded)) return false;
+    }
+    return true;
+}
+
+template <OutputStream S>
+inline bool WritePackedFor64(S* out, const int64_t* values, size_t n, bool delta = true) {
+    BasicCodedOutputStream<S> coded(out);
+    return WritePackedFor64(&coded, values, n, delta);
+}
+
+/**
+ * @brief Reads an array written by WritePackedFor64(), appending the values
+ *        to 'out'. Blocks unpack straight into 'out'; delta blocks are then
+ *        restored with a SIMD prefix sum.
+ * @return false on truncated or malformed input; 'out' is then unchanged.
+ */
+template <typename S>
+inline bool ReadPackedFor64(BasicCodedInputStream<S>* in, std::vector<int64_t>& out) {
+    uint32_t bytes;
+    if (!detail::ReadPackedLength(in, 1, bytes)) return false;
+    std::vector<uint8_t> scratch;
+    std::span<const uint8_t> payload;
+    if (!detail::ReadContiguous(in, bytes, scratch, payload)) return false;
+    const uint8_t* p = payload.data();
+    const uint8_t* end = p + payload.size();
+
+    uint64_t n;
+    if (!DecodeVarint64Checked(p, end, n) || p == end || *p > 1) return false;
+    bool delta = *p++ == 1;
+    // every block spends at least two bytes
+    if (n > static_cast<uint64_t>(end - p) / 2 * kForBlockSize) return false;
+
+    size_t old = out.size();
+    out.resize(old + n);
+    int64_t* dst = out.data() + old;
+    for (size_t i = 0; i < n; i += kForBlockSize) {
+        size_t k = std::min<size_t>(kForBlockSize, n - i);
+        p = DecodeForBlock(p, end, dst + i, k);
+        if (p == nullptr) break;
+    }
+    if (p != end) {
+        out.resize(old);
+        return false;
+    }
+    if (delta) PrefixSum64(dst, n, 0);
+    return true;
+}
+
+template <InputStream S>
+inline bool ReadPackedFor64(S* in, std::vector<int64_t>& out) {
+    BasicCodedInputStream<S> coded(in);
+    return ReadPackedFor64(&coded, out);
+}
+
+}}
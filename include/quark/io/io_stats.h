@@ -0,0 +1,177 @@
+#pragma once
+// io_stats.h
+// Process-wide counters in the stream slow paths: window refills, spill
+// copies of length-delimited fields, copied vs aliased bytes, vector
+// regrowth and the varint length mix. They show where a workload pays for
+// its block sizes and chunking.
+//
+// Compiled in only with -DQUARK_STATS=1. Otherwise CountStat() is an empty
+// inline function and the hot paths are unchanged; GetIoStats() still
+// links and returns zeros.
+//
+// Each thread bumps its own counters with relaxed stores (no locked
+// instructions); GetIoStats() sums every live thread plus those that have
+// exited.
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <atomic>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+#ifndef QUARK_STATS
+    #define QUARK_STATS 0
+#endif
+
+namespace quark {
+namespace io {
+
+static constexpr bool kStatsEnabled = QUARK_STATS != 0;
+
+/// What each counter in IoStats counts.
+enum class IoStat : size_t {
+    kInputRefills,          // Windows fetched by a coded input cursor
+    kInputRefillBytes,      // Bytes in those windows
+    kOutputRefills,         // Blocks fetched by a coded output cursor
+    kSpillCopies,           // Length-delimited reads copied rather than viewed (crossed a window, misaligned, unpinnable)
+    kBytesCopied,           // Payload bytes in those copies
+    kBytesAliased,          // Length-delimited payload bytes viewed in place
+    kAliasedWrites,         // Payloads referenced rather than copied by WriteRawMaybeAliased()
+    kAliasedWriteBytes,     // Bytes in those payloads
+    kVectorGrows,           // VectorOutputStream reallocations
+    kVectorGrowBytes,       // Bytes moved by those reallocations
+    kVarint1,               // Varints read, by encoded length: kVarint1 + (length - 1)
+    kCount = kVarint1 + 10
+};
+
+/**
+ * @brief A point-in-time copy of the counters, summed over all threads.
+ */
+struct IoStats {
+    std::array<uint64_t, static_cast<size_t>(IoStat::kCount)> counters{};
+
+    uint64_t operator[](IoStat stat) const { return counters[static_cast<size_t>(stat)]; }
+
+    /// Varints read with an encoded length of 'length' (1..10) bytes.
+    uint64_t varints(int length) const { return counters[static_cast<size_t>(IoStat::kVarint1) + length - 1]; }
+
+    /**
+     * @brief Calls f(name, value) for every counter, for export to a metrics
+     *        system. Varint buckets are named "varint_1" .. "varint_10".
+     */
+    template <typename F>
+    void ForEach(F&& f) const {
+        static constexpr const char* kNames[] = {
+            "input_refills", "input_refill_bytes", "output_refills", "spill_copies", "bytes_copied",
+            "bytes_aliased", "aliased_writes", "aliased_write_bytes", "vector_grows", "vector_grow_bytes",
+            "varint_1", "varint_2", "varint_3", "varint_4", "varint_5",
+            "varint_6", "varint_7", "varint_8", "varint_9", "varint_10",
+        };
+        static_assert(std::size(kNames) == static_cast<size_t>(IoStat::kCount));
+        for (size_t i = 0; i < counters.size(); ++i) f(kNames[i], counters[i]);
+    }
+};
+
+namespace detail {
+
+struct IoStatsSlot {
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(IoStat::kCount)> counters{};
+};
+
+/// Live threads' slots and the totals of exited threads.
+struct IoStatsRegistry {
+    std::mutex mu;
+    std::vector<IoStatsSlot*> live;
+    IoStats retired;
+};
+
+inline IoStatsRegistry& StatsRegistry() {
+    static IoStatsRegistry* registry = new IoStatsRegistry();   // outlives thread_local destructors
+    return *registry;
+}
+
+/// This thread's slot, registered on first use and folded into the retired totals on exit.
+struct ThreadIoStats {
+    IoStatsSlot slot;
+
+    ThreadIoStats() {
+        IoStatsRegistry& r = StatsRegistry();
+        std::lock_guard<std::mutex> lock(r.mu);
+        r.live.push_back(&slot);
+    }
+
+    ~ThreadIoStats() {
+        IoStatsRegistry& r = StatsRegistry();
+        std::lock_guard<std::mutex> lock(r.mu);
+        for (size_t i = 0; i < r.retired.counters.size(); ++i) {
+            r.retired.counters[i] += slot.counters[i].load(std::memory_order_relaxed);
+        }
+        std::erase(r.live, &slot);
+    }
+};
+
+inline IoStatsSlot& LocalIoStats() {
+    thread_local ThreadIoStats stats;
+    return stats.slot;
+}
+
+} // namespace detail
+
+/// Adds 'n' to 'stat' for this thread; compiles to nothing unless QUARK_STATS is set.
+inline void CountStat(IoStat stat, uint64_t n = 1) {
+    if constexpr (kStatsEnabled) {
+        // only this thread writes the slot, so a plain load and store is enough
+        std::atomic<uint64_t>& c = detail::LocalIoStats().counters[static_cast<size_t>(stat)];
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    } else {
+        (void)stat;
+        (void)n;
+    }
+}
+
+/// Counts one varint read of 'length' encoded bytes.
+inline void CountVarint(size_t length) {
+    if constexpr (kStatsEnabled) {
+        CountStat(static_cast<IoStat>(static_cast<size_t>(IoStat::kVarint1) + length - 1));
+    } else {
+        (void)length;
+    }
+}
+
+/**
+ * @brief Sums the counters of every thread, live or exited.
+ * @return All zeros unless built with QUARK_STATS
+ */
+inline IoStats GetIoStats() {
+    IoStats total;
+    if constexpr (kStatsEnabled) {
+        detail::IoStatsRegistry& r = detail::StatsRegistry();
+        std::lock_guard<std::mutex> lock(r.mu);
+        total = r.retired;
+        for (const detail::IoStatsSlot* slot : r.live) {
+            for (size_t i = 0; i < total.counters.size(); ++i) {
+                total.counters[i] += slot->counters[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    return total;
+}
+
+/**
+ * @brief Zeroes every counter. Counts made by other threads while this runs
+ *        may survive it; take deltas of GetIoStats() for exact windows.
+ */
+inline void ResetIoStats() {
+    if constexpr (kStatsEnabled) {
+        detail::IoStatsRegistry& r = detail::StatsRegistry();
+        std::lock_guard<std::mutex> lock(r.mu);
+        r.retired = IoStats();
+        for (detail::IoStatsSlot* slot : r.live) {
+            for (auto& c : slot->counters) c.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+}}
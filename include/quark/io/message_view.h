@@ -0,0 +1,271 @@
+#pragma once
+// message_view.h
+// Random access to the tagged fields of an encoded message without decoding
+// it. The first lookup scans tags only, stepping over payloads by their
+// length prefixes or fixed widths, and records where each field's payload
+// starts. Every later lookup reads straight from the original bytes:
+//
+//   MessageView view(std::span<const uint8_t>(bytes, size));
+//   auto dest = view.get<std::string_view>(2);   // scans once
+//   auto prio = view.get<int32_t>(37);           // index lookup + load
+//
+// Meant for readers that touch a few fields of wide messages (routing,
+// filtering); a reader that wants every field is better served by Parse().
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "quark/io/endian.h"
+#include "quark/io/varint.h"
+#include "quark/io/zero_copy_stream.h"
+
+namespace quark {
+namespace io {
+
+/**
+ * @class MessageView
+ * @brief A lazily indexed, read-only view of one encoded message.
+ *
+ * The bytes must outlive the view and every string, span or nested view it
+ * returns. A field present more than once resolves to its last occurrence,
+ * as in Parse(). Lookups of field numbers below kDirectFields are one table
+ * load; larger ones scan the index from the back.
+ *
+ * get<T>() accepts:
+ * - integral types: VARINT fields, or FIXED32 / FIXED64 fields of the same
+ *   width (int32 is FIXED32 on the quark wire). sint32 / sint64 fields come
+ *   back zigzagged; pass them through ZigZagDecode32/64()
+ * - float and double: FIXED32 and FIXED64 fields
+ * - std::string_view, std::span<const uint8_t> and MessageView:
+ *   LENGTH_DELIMITED fields
+ *
+ * Not thread-safe until indexed; call Index() first to share a view.
+ */
+class MessageView {
+public:
+    static constexpr uint32_t kDirectFields = 64;
+
+    /// Field occurrences indexed without a heap allocation.
+    static constexpr size_t kInlineFields = 64;
+
+    /// One field occurrence in wire order.
+    struct Field {
+        uint32_t number;
+        WireType type;
+        uint32_t offset;    // Payload start (after the length for LENGTH_DELIMITED)
+        uint32_t size;      // Payload bytes
+    };
+
+    MessageView() : MessageView(std::span<const uint8_t>()) {}
+
+    /// Views the message in 'bytes'.
+    explicit MessageView(std::span<const uint8_t> bytes) : bytes_(bytes), indexed_(false), valid_(false), count_(0) {}
+
+    /// Views the whole buffer of 'in', regardless of its read position.
+    explicit MessageView(const BufferInputStream& in) : MessageView(std::span<const uint8_t>(in.data(), in.size())) {}
+
+    /// Views the whole mapped file of 'in'.
+    explicit MessageView(const MmapInputStream& in) : MessageView(std::span<const uint8_t>(in.data(), in.size())) {}
+
+    /// Copies only the index entries in use, not the whole inline array.
+    MessageView(const MessageView& other)
+        : bytes_(other.bytes_), indexed_(other.indexed_), valid_(other.valid_), count_(other.count_),
+          overflow_(other.overflow_), direct_(other.direct_) {
+        if (overflow_.empty()) std::copy_n(other.inline_.begin(), count_, inline_.begin());
+    }
+
+    MessageView& operator=(const MessageView& other) {
+        if (this != &other) {
+            bytes_ = other.bytes_;
+            indexed_ = other.indexed_;
+            valid_ = other.valid_;
+            count_ = other.count_;
+            overflow_ = other.overflow_;
+            direct_ = other.direct_;
+            if (overflow_.empty()) std::copy_n(other.inline_.begin(), count_, inline_.begin());
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Builds the index if it is not built yet.
+     * @return false if the message is malformed; every lookup then fails
+     */
+    bool Index() {
+        if (!indexed_) Build();
+        return valid_;
+    }
+
+    /// True if 'field' is present (and the message well formed).
+    bool Has(uint32_t field) { return Find(field) != nullptr; }
+
+    /**
+     * @brief Reads the last occurrence of 'field' as a T.
+     * @return std::nullopt if the field is absent, its wire type does not
+     *         hold a T, or the message is malformed
+     */
+    template <typename T>
+    std::optional<T> get(uint32_t field) {
+        const Field* f = Find(field);
+        if (f == nullptr) return std::nullopt;
+        const uint8_t* p = bytes_.data() + f->offset;
+        // checked when indexed
+        uint64_t varint = 0;
+        if (f->type == WireType::VARINT) DecodeVarint64Checked(p, p + f->size, varint);
+        if constexpr (std::is_same_v<T, bool>) {
+            if (f->type != WireType::VARINT) return std::nullopt;
+            return varint != 0;
+        } else if constexpr (std::is_integral_v<T>) {
+            if (f->type == WireType::VARINT) return static_cast<T>(varint);
+            if (f->type == WireType::FIXED32 && sizeof(T) == 4) return static_cast<T>(LoadLittleEndian32(p));
+            if (f->type == WireType::FIXED64 && sizeof(T) == 8) return static_cast<T>(LoadLittleEndian64(p));
+            return std::nullopt;
+        } else if constexpr (std::is_same_v<T, float>) {
+            if (f->type != WireType::FIXED32) return std::nullopt;
+            return std::bit_cast<float>(LoadLittleEndian32(p));
+        } else if constexpr (std::is_same_v<T, double>) {
+            if (f->type != WireType::FIXED64) return std::nullopt;
+            return std::bit_cast<double>(LoadLittleEndian64(p));
+        } else if constexpr (std::is_same_v<T, std::string_view>) {
+            if (f->type != WireType::LENGTH_DELIMITED) return std::nullopt;
+            return std::string_view(reinterpret_cast<const char*>(p), f->size);
+        } else if constexpr (std::is_same_v<T, std::span<const uint8_t>>) {
+            if (f->type != WireType::LENGTH_DELIMITED) return std::nullopt;
+            return std::span<const uint8_t>(p, f->size);
+        } else if constexpr (std::is_same_v<T, MessageView>) {
+            if (f->type != WireType::LENGTH_DELIMITED) return std::nullopt;
+            return MessageView(std::span<const uint8_t>(p, f->size));
+        } else {
+            static_assert(sizeof(T) == 0, "MessageView::get: unsupported type");
+        }
+    }
+
+    /// Every field occurrence in wire order; empty if the message is malformed.
+    std::span<const Field> fields() {
+        Index();
+        return std::span<const Field>(data(), count_);
+    }
+
+    /// The viewed bytes.
+    std::span<const uint8_t> bytes() const { return bytes_; }
+
+private:
+    // inline until the message outgrows kInlineFields, then all in overflow_
+    const Field* data() const { return overflow_.empty() ? inline_.data() : overflow_.data(); }
+
+    const Field* Find(uint32_t field) {
+        if (!Index()) return nullptr;
+        const Field* fields = data();
+        if (field < kDirectFields) {
+            uint32_t slot = direct_[field];
+            return slot == 0 ? nullptr : &fields[slot - 1];
+        }
+        for (size_t i = count_; i-- > 0;) {
+            if (fields[i].number == field) return &fields[i];
+        }
+        return nullptr;
+    }
+
+    void Add(const Field& f) {
+        if (count_ < kInlineFields) {
+            inline_[count_] = f;
+        } else {
+            if (count_ == kInlineFields) overflow_.assign(inline_.begin(), inline_.end());
+            overflow_.push_back(f);
+        }
+        ++count_;
+        if (f.number < kDirectFields) direct_[f.number] = static_cast<uint32_t>(count_);
+    }
+
+    void Build() {
+        indexed_ = true;
+        valid_ = Scan();
+        if (!valid_) {
+            count_ = 0;
+            overflow_.clear();
+            direct_.fill(0);
+        }
+    }
+
+    // tags and lengths are almost always one or two bytes; skip the general decoder for them
+    static bool ReadShortVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+        if (end - p >= 2) {
+            if (p[0] < 0x80) {
+                value = *p++;
+                return true;
+            }
+            if (p[1] < 0x80) {
+                value = (p[0] & 0x7F) | (static_cast<uint64_t>(p[1]) << 7);
+                p += 2;
+                return true;
+            }
+        }
+        return DecodeVarint64Checked(p, end, value);
+    }
+
+    bool Scan() {
+        if (bytes_.size() > UINT32_MAX) return false;
+        const uint8_t* begin = bytes_.data();
+        const uint8_t* p = begin;
+        const uint8_t* end = p + bytes_.size();
+        while (p != end) {
+            uint64_t tag;
+            if (!ReadShortVarint(p, end, tag) || tag > UINT32_MAX) return false;
+            Field f{TagFieldNumber(static_cast<uint32_t>(tag)), TagWireType(static_cast<uint32_t>(tag)), 0, 0};
+            if (f.number == 0) return false;
+            uint64_t size;
+            switch (f.type) {
+                case WireType::VARINT: {
+                    // the value is decoded on lookup; here only its end is needed
+                    const uint8_t* start = p;
+                    uint64_t stops = end - p >= 8 ? ~LoadLittleEndian64(p) & 0x8080808080808080ull : 0;
+                    uint64_t value;
+                    if (stops != 0) {
+                        p += std::countr_zero(stops) / 8 + 1;
+                    } else if (!DecodeVarint64Checked(p, end, value)) {
+                        return false;
+                    }
+                    f.offset = static_cast<uint32_t>(start - begin);
+                    f.size = static_cast<uint32_t>(p - start);
+                    break;
+                }
+                case WireType::FIXED64:
+                case WireType::FIXED32:
+                    size = f.type == WireType::FIXED64 ? 8 : 4;
+                    if (static_cast<uint64_t>(end - p) < size) return false;
+                    f.offset = static_cast<uint32_t>(p - begin);
+                    f.size = static_cast<uint32_t>(size);
+                    p += size;
+                    break;
+                case WireType::LENGTH_DELIMITED:
+                    if (!ReadShortVarint(p, end, size) || size > static_cast<uint64_t>(end - p)) return false;
+                    f.offset = static_cast<uint32_t>(p - begin);
+                    f.size = static_cast<uint32_t>(size);
+                    p += size;
+                    break;
+                default:
+                    return false;
+            }
+            Add(f);
+        }
+        return true;
+    }
+
+    std::span<const uint8_t> bytes_;
+    bool indexed_;
+    bool valid_;
+    size_t count_;
+    std::array<Field, kInlineFields> inline_;       // Only the first count_ entries are set while overflow_ is empty
+    std::vector<Field> overflow_;
+    std::array<uint32_t, kDirectFields> direct_{};  // Last occurrence's index + 1, 0 = absent
+};
+
+}}
@@ -0,0 +1,496 @@
+#pragma once
+// record_log.h
+// Record-log file format: records stored back to back, grouped into blocks,
+// with a footer index so a reader can jump to record N or key K in
+// O(log blocks) and split a scan across threads by block.
+//
+// File layout (all integers little-endian):
+//
+//   [ magic (8) ]
+//   [ block ]*          block  = [ sync marker (8) | record* ]
+//                       record = [ varint key_len | key | varint value_len | value | crc (4) ]
+//   [ index | crc (4) ] index  = [ varint block_count | (varint offset_delta, varint records,
+//                                  varint key_len, first key)* ]
+//   [ footer (24) ]     footer = [ fixed64 index_offset | fixed64 record_count | magic (8) ]
+//
+// Each crc is the masked CRC32C (see crc32c.h) of the record or index bytes
+// it follows, excluding sync markers. A block closes once it holds at least
+// RecordLogOptions::block_size bytes, so blocks are about that size and
+// records never straddle two blocks.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "quark/io/checksummed_stream.h"
+#include "quark/io/crc32c.h"
+#include "quark/io/endian.h"
+#include "quark/io/varint.h"
+#include "quark/io/zero_copy_stream.h"
+
+namespace quark {
+namespace io {
+
+/// "QRKLOG1\n": first and last 8 bytes of every record log.
+static constexpr uint8_t kRecordLogMagic[8] = {'Q', 'R', 'K', 'L', 'O', 'G', '1', '\n'};
+
+/// Starts every block, so a damaged file can be resynchronized by scanning for it.
+static constexpr uint8_t kRecordLogSync[8] = {0xB7, 0x5A, 0x1C, 0xE3, 0x94, 0x0F, 0x6D, 0xA2};
+
+static constexpr size_t kRecordLogFooterSize = 24;
+
+struct RecordLogOptions {
+    /**
+     * Target block size; a block closes once it holds at least this many
+     * bytes. A lookup scans one block, so smaller blocks mean faster point
+     * reads at the cost of a larger index.
+     */
+    size_t block_size = 4 * 1024;
+};
+
+/**
+ * @class RecordWriter
+ * @brief Appends records to a record log written through a ZeroCopyOutputStream.
+ *
+ * Keys are optional. When used they must be appended in non-decreasing
+ * order (a missing key counts as ""), which is what makes RecordReader::Find()
+ * a binary search. Nothing is readable until Finish() writes the index.
+ *
+ * Example usage:
+ * RecordWriter writer(&file);
+ * for (auto& m : batch) writer.AppendMessage(m, m.name);
+ * writer.Finish();
+ */
+class RecordWriter {
+public:
+    /// @param out Destination stream; must outlive the writer.
+    explicit RecordWriter(ZeroCopyOutputStream* out, const RecordLogOptions& options = {})
+        : out_(out), checksummed_(out), options_(options), base_(out->ByteCount()), records_(0),
+          finished_(false), error_(false) {
+        error_ = !out_->WriteRaw(kRecordLogMagic, sizeof(kRecordLogMagic));
+    }
+
+    RecordWriter(const RecordWriter&) = delete;
+    RecordWriter& operator=(const RecordWriter&) = delete;
+
+    /**
+     * @brief Appends one record.
+     * @param value Record payload (typically a serialized message)
+     * @param key Lookup key; must not sort before the previous record's key
+     * @return false if the key is out of order or the stream is full
+     */
+    bool Append(std::span<const uint8_t> value, std::string_view key = {}) {
+        if (value.size() > UINT32_MAX || !BeginRecord(key)) return false;
+        {
+            BasicCodedOutputStream<ChecksummedOutputStream> out(&checksummed_);
+            WriteKey(&out, key);
+            out.WriteVarint32(static_cast<uint32_t>(value.size()));
+            out.WriteRaw(value.data(), value.size());
+            if (out.HadError()) error_ = true;
+        }
+        return EndRecord();
+    }
+
+    /// Appends a generated message as its length-delimited encoding, without an intermediate copy.
+    template <typename Message>
+    bool AppendMessage(const Message& msg, std::string_view key = {}) {
+        if (!BeginRecord(key)) return false;
+        {
+            BasicCodedOutputStream<ChecksummedOutputStream> out(&checksummed_);
+            WriteKey(&out, key);
+            if (!SerializeDelimited(msg, &out)) error_ = true;
+        }
+        return EndRecord();
+    }
+
+    /**
+     * @brief Writes the block index and footer. No records can be added afterwards.
+     * @return false if the stream is full
+     */
+    bool Finish() {
+        if (finished_ || error_) return !error_;
+        finished_ = true;
+        uint64_t index_offset = Offset();
+        {
+            BasicCodedOutputStream<ChecksummedOutputStream> out(&checksummed_);
+            out.WriteVarint64(blocks_.size());
+            uint64_t prev = 0;
+            for (const Block& b : blocks_) {
+                out.WriteVarint64(b.offset - prev);
+                out.WriteVarint64(b.records);
+                WriteKey(&out, b.first_key);
+                prev = b.offset;
+            }
+            if (out.HadError()) error_ = true;
+        }
+        if (error_ || !checksummed_.EndRecord()) return Fail();
+
+        uint8_t footer[kRecordLogFooterSize];
+        StoreLittleEndian64(footer, index_offset);
+        StoreLittleEndian64(footer + 8, records_);
+        std::memcpy(footer + 16, kRecordLogMagic, sizeof(kRecordLogMagic));
+        if (!out_->WriteRaw(footer, sizeof(footer))) return Fail();
+        return out_->Flush() || Fail();
+    }
+
+    /// Records appended so far.
+    uint64_t record_count() const { return records_; }
+
+    /// Blocks started so far.
+    size_t block_count() const { return blocks_.size(); }
+
+    /// True once a write failed; the log is unusable.
+    bool HadError() const { return error_; }
+
+private:
+    struct Block {
+        uint64_t offset;            // File offset of the sync marker
+        uint64_t records;           // Records in the block
+        std::string first_key;      // Key of the block's first record
+    };
+
+    template <typename S>
+    static void WriteKey(BasicCodedOutputStream<S>* out, std::string_view key) {
+        out->WriteVarint32(static_cast<uint32_t>(key.size()));
+        out->WriteRaw(key.data(), key.size());
+    }
+
+    uint64_t Offset() const { return out_->ByteCount() - base_; }
+
+    bool Fail() {
+        error_ = true;
+        return false;
+    }
+
+    /// Checks key order and opens a new block if the current one is full.
+    bool BeginRecord(std::string_view key) {
+        if (finished_ || error_ || key.size() > UINT32_MAX) return false;
+        if (key < last_key_) return false;
+        if (blocks_.empty() || Offset() - blocks_.back().offset >= options_.block_size) {
+            // the previous record's trailer settled the checksum, so the
+            // marker can bypass it
+            blocks_.push_back({Offset(), 0, std::string(key)});
+            if (!out_->WriteRaw(kRecordLogSync, sizeof(kRecordLogSync))) return Fail();
+        }
+        last_key_.assign(key);
+        return true;
+    }
+
+    bool EndRecord() {
+        if (error_ || !checksummed_.EndRecord()) return Fail();
+        ++blocks_.back().records;
+        ++records_;
+        return true;
+    }
+
+    ZeroCopyOutputStream* out_;             // Destination stream
+    ChecksummedOutputStream checksummed_;   // Adds the per-record CRC trailers
+    RecordLogOptions options_;
+    int64_t base_;                          // out_->ByteCount() at file offset 0
+    uint64_t records_;                      // Records appended
+    std::vector<Block> blocks_;             // Index entries, one per block
+    std::string last_key_;                  // Key of the last record, for the order check
+    bool finished_;                         // Finish() has been called
+    bool error_;                            // A write failed
+};
+
+/// One record as seen by RecordReader; views point into the file.
+struct LogRecord {
+    uint64_t ordinal;                   // Position of the record in the log
+    std::string_view key;               // Empty if none was given
+    std::span<const uint8_t> value;     // Payload
+};
+
+/// One block of a record log, from the footer index.
+struct RecordBlock {
+    uint64_t offset;                    // File offset of the sync marker
+    uint64_t size;                      // Bytes up to the next block (or the index)
+    uint64_t first_ordinal;             // Ordinal of the block's first record
+    uint64_t records;                   // Records in the block
+    std::string_view first_key;         // Key of the block's first record
+};
+
+/// Half-open range of block indices, as produced by RecordReader::Split().
+struct BlockRange {
+    size_t begin;
+    size_t end;
+};
+
+class RecordReader;
+
+/**
+ * @class RecordCursor
+ * @brief Iterates the records of a range of blocks, verifying each checksum.
+ *
+ * Obtained from RecordReader::Scan(). Cursors are independent, so several
+ * threads can scan disjoint ranges of one reader at once.
+ */
+class RecordCursor {
+public:
+    /**
+     * @brief Reads the next record.
+     * @param[out] record Receives views of the record
+     * @return false at the end of the range, or on a damaged block (see HadError())
+     */
+    bool Next(LogRecord& record) { return Step(record) && Verify(record); }
+
+    /// True if a sync marker, record frame, record count or checksum was bad.
+    bool HadError() const { return error_; }
+
+private:
+    friend class RecordReader;
+
+    RecordCursor(const RecordReader* reader, size_t begin_block, size_t end_block)
+        : reader_(reader), next_block_(begin_block), end_block_(end_block), ptr_(nullptr),
+          end_(nullptr), frame_(nullptr), ordinal_(0), block_end_ordinal_(0), error_(false) {}
+
+    bool EnterBlock(size_t index);
+
+    /// Frames the next record without checking its checksum.
+    bool Step(LogRecord& record);
+
+    /// Checks the checksum of the record just returned by Step().
+    bool Verify(const LogRecord& record);
+
+    bool Fail() {
+        error_ = true;
+        ptr_ = end_ = nullptr;
+        next_block_ = end_block_;
+        return false;
+    }
+
+    const RecordReader* reader_;
+    size_t next_block_;                 // Next block to enter
+    size_t end_block_;                  // One past the last block of the range
+    const uint8_t* ptr_;                // Next record in the current block
+    const uint8_t* end_;                // End of the current block
+    const uint8_t* frame_;              // Start of the record last framed by Step()
+    uint64_t ordinal_;                  // Ordinal of the record at 'ptr_'
+    uint64_t block_end_ordinal_;        // Ordinal one past the current block
+    bool error_;                        // Damaged data seen
+};
+
+/**
+ * @class RecordReader
+ * @brief Random access and parallel scans over a record log held in memory.
+ *
+ * Opening reads only the footer and index; block data is touched when it is
+ * read, so a lookup in a freshly mapped file faults in the index and one
+ * block. Returned views point into the file, which must outlive the reader.
+ *
+ * Example usage:
+ * MmapInputStream file("events.qlog");
+ * RecordReader log(file);
+ * LogRecord rec;
+ * if (log.Get(123456, rec)) ParseRecord(rec.value, msg);
+ */
+class RecordReader {
+public:
+    /**
+     * @brief Opens a record log from its bytes.
+     * @throws std::runtime_error if the footer or index is malformed
+     */
+    explicit RecordReader(std::span<const uint8_t> file) : data_(file.data()), size_(file.size()) {
+        constexpr size_t kMinSize = sizeof(kRecordLogMagic) + 1 + kRecordTrailerSize + kRecordLogFooterSize;
+        if (size_ < kMinSize || std::memcmp(data_, kRecordLogMagic, sizeof(kRecordLogMagic)) != 0 ||
+            std::memcmp(data_ + size_ - sizeof(kRecordLogMagic), kRecordLogMagic, sizeof(kRecordLogMagic)) != 0) {
+            throw std::runtime_error("RecordReader: not a record log");
+        }
+        const uint8_t* footer = data_ + size_ - kRecordLogFooterSize;
+        uint64_t index_offset = LoadLittleEndian64(footer);
+        records_ = LoadLittleEndian64(footer + 8);
+        size_t index_end = size_ - kRecordLogFooterSize - kRecordTrailerSize;
+        if (index_offset < sizeof(kRecordLogMagic) || index_offset >= index_end) {
+            throw std::runtime_error("RecordReader: bad index offset");
+        }
+        uint32_t crc = UnmaskCrc32c(LoadLittleEndian32(data_ + index_end));
+        if (crc != Crc32c(data_ + index_offset, index_end - index_offset)) {
+            throw std::runtime_error("RecordReader: index checksum mismatch");
+        }
+        ParseIndex(index_offset, index_end);
+    }
+
+#if QUARK_POSIX
+    /// Opens the record log held by a mapped file.
+    explicit RecordReader(const MmapInputStream& file) : RecordReader(std::span<const uint8_t>(file.data(), file.size())) {}
+#endif
+
+    /// Records in the log.
+    uint64_t record_count() const { return records_; }
+
+    /// Blocks in the log.
+    size_t block_count() const { return blocks_.size(); }
+
+    /// Index entry of block 'i'.
+    const RecordBlock& block(size_t i) const { return blocks_[i]; }
+
+    /**
+     * @brief Reads record 'ordinal': a binary search of the index, then a scan
+     *        of one block.
+     * @return false if out of range or the block is damaged
+     */
+    bool Get(uint64_t ordinal, LogRecord& record) const {
+        if (ordinal >= records_) return false;
+        auto it = std::upper_bound(blocks_.begin(), blocks_.end(), ordinal,
+                                   [](uint64_t o, const RecordBlock& b) { return o < b.first_ordinal; });
+        size_t index = static_cast<size_t>(it - blocks_.begin()) - 1;
+        // records before the target are only framed, not checksummed
+        RecordCursor cursor = Scan(index, index + 1);
+        while (cursor.Step(record)) {
+            if (record.ordinal == ordinal) return cursor.Verify(record);
+        }
+        return false;
+    }
+
+    /**
+     * @brief Reads the first record with 'key'; the log must have been written
+     *        with keys in order.
+     * @return false if no record has the key, or a block is damaged
+     */
+    bool Find(std::string_view key, LogRecord& record) const {
+        // the first match can only be in the last block starting below 'key'
+        // (runs of equal keys may spill from it), or in the first one after
+        auto it = std::lower_bound(blocks_.begin(), blocks_.end(), key,
+                                   [](const RecordBlock& b, std::string_view k) { return b.first_key < k; });
+        size_t index = it == blocks_.begin() ? 0 : static_cast<size_t>(it - blocks_.begin()) - 1;
+        RecordCursor cursor = Scan(index, std::min(blocks_.size(), index + 2));
+        while (cursor.Step(record)) {
+            if (record.key == key) return cursor.Verify(record);
+            if (record.key > key) break;
+        }
+        return false;
+    }
+
+    /// Cursor over blocks [begin_block, end_block).
+    RecordCursor Scan(size_t begin_block = 0, size_t end_block = SIZE_MAX) const {
+        end_block = std::min(end_block, blocks_.size());
+        return RecordCursor(this, std::min(begin_block, end_block), end_block);
+    }
+
+    /**
+     * @brief Splits the blocks into at most 'parts' contiguous ranges of
+     *        roughly equal byte size, for scanning on separate threads.
+     */
+    std::vector<BlockRange> Split(size_t parts) const {
+        std::vector<BlockRange> ranges;
+        if (blocks_.empty() || parts == 0) return ranges;
+        uint64_t total = 0;
+        for (const RecordBlock& b : blocks_) total += b.size;
+
+        size_t begin = 0;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < blocks_.size(); ++i) {
+            seen += blocks_[i].size;
+            // close the range once it reaches its share of the bytes
+            uint64_t target = total * (ranges.size() + 1) / parts;
+            if (seen >= target || i + 1 == blocks_.size()) {
+                ranges.push_back({begin, i + 1});
+                begin = i + 1;
+            }
+        }
+        return ranges;
+    }
+
+private:
+    friend class RecordCursor;
+
+    /// Decodes the index at [begin, end) into 'blocks_' and checks it against the file.
+    void ParseIndex(size_t begin, size_t end) {
+        BufferInputStream bis(data_ + begin, end - begin);
+        CodedInputStream in(&bis);
+        uint64_t count;
+        // every entry takes at least 3 bytes, so a bad count cannot make us over-allocate
+        if (!in.ReadVarint64(count) || count > (end - begin) / 3) {
+            throw std::runtime_error("RecordReader: bad index");
+        }
+        blocks_.resize(count);
+        uint64_t offset = 0;
+        uint64_t ordinal = 0;
+        for (RecordBlock& b : blocks_) {
+            uint64_t delta;
+            uint32_t key_len;
+            std::span<const uint8_t> key;
+            if (!in.ReadVarint64(delta) || !in.ReadVarint64(b.records) || !in.ReadVarint32(key_len) ||
+                !in.ReadAliased(key_len, key)) {
+                throw std::runtime_error("RecordReader: bad index");
+            }
+            if ((&b == &blocks_.front() ? delta != sizeof(kRecordLogMagic) : delta == 0) ||
+                delta > begin - offset) {
+                throw std::runtime_error("RecordReader: bad block offset");
+            }
+            offset += delta;
+            b.offset = offset;
+            b.first_ordinal = ordinal;
+            b.first_key = std::string_view(reinterpret_cast<const char*>(key.data()), key.size());
+            ordinal += b.records;
+        }
+        for (size_t i = 0; i < blocks_.size(); ++i) {
+            uint64_t next = i + 1 < blocks_.size() ? blocks_[i + 1].offset : begin;
+            blocks_[i].size = next - blocks_[i].offset;
+            if (blocks_[i].size < sizeof(kRecordLogSync)) throw std::runtime_error("RecordReader: bad block offset");
+        }
+        if (ordinal != records_) throw std::runtime_error("RecordReader: record count mismatch");
+    }
+
+    const uint8_t* data_;               // Start of the file
+    size_t size_;                       // File size in bytes
+    uint64_t records_;                  // Records in the log
+    std::vector<RecordBlock> blocks_;   // Decoded index
+};
+
+inline bool RecordCursor::EnterBlock(size_t index) {
+    const RecordBlock& b = reader_->blocks_[index];
+    const uint8_t* start = reader_->data_ + b.offset;
+    if (std::memcmp(start, kRecordLogSync, sizeof(kRecordLogSync)) != 0) return false;
+    ptr_ = start + sizeof(kRecordLogSync);
+    end_ = start + b.size;
+    ordinal_ = b.first_ordinal;
+    block_end_ordinal_ = b.first_ordinal + b.records;
+    return true;
+}
+
+inline bool RecordCursor::Step(LogRecord& record) {
+    while (ptr_ == end_) {
+        if (ptr_ != nullptr && ordinal_ != block_end_ordinal_) return Fail();
+        if (next_block_ == end_block_) return false;
+        if (!EnterBlock(next_block_++)) return Fail();
+    }
+    // blocks are followed by at least the index trailer and footer, so the
+    // 8-byte varint loads below stay inside the file
+    frame_ = ptr_;
+    uint32_t key_len, value_len;
+    const uint8_t* p = DecodeVarint32Unchecked(frame_, key_len);
+    if (p == nullptr || key_len >= static_cast<size_t>(end_ - p)) return Fail();
+    record.key = std::string_view(reinterpret_cast<const char*>(p), key_len);
+    p = DecodeVarint32Unchecked(p + key_len, value_len);
+    if (p == nullptr || p > end_ || static_cast<size_t>(end_ - p) < value_len + kRecordTrailerSize) return Fail();
+    if (ordinal_ == block_end_ordinal_) return Fail();
+    record.value = std::span<const uint8_t>(p, value_len);
+    record.ordinal = ordinal_++;
+    ptr_ = p + value_len + kRecordTrailerSize;
+    return true;
+}
+
+inline bool RecordCursor::Verify(const LogRecord& record) {
+    const uint8_t* crc = record.value.data() + record.value.size();
+    return UnmaskCrc32c(LoadLittleEndian32(crc)) == Crc32c(frame_, crc - frame_) || Fail();
+}
+
+/**
+ * @brief Parses a generated message from a record written with
+ *        RecordWriter::AppendMessage().
+ */
+template <typename Message>
+bool ParseRecord(std::span<const uint8_t> value, Message& msg) {
+    BufferInputStream bis(value.data(), value.size());
+    CodedInputStream in(&bis);
+    return Parse(msg, &in);
+}
+
+}}
@@ -0,0 +1,212 @@
+#pragma once
+// ring_buffer_stream.h
+// Lock-free single-producer/single-consumer byte ring with a zero-copy
+// stream on each side. The producer serializes messages in place and
+// publishes them; the consumer parses them straight out of the ring and
+// releases the space. No allocation, no mutex, and the shared indices are
+// only written once per Publish()/Release(), not per byte or per block.
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include "quark/io/zero_copy_stream.h"
+
+namespace quark {
+namespace io {
+
+/// Assumed cache line size, used to keep the two sides' state apart.
+static constexpr size_t kCacheLineSize = 64;
+
+/**
+ * @class RingBuffer
+ * @brief Storage and shared indices for one RingBufferOutputStream /
+ *        RingBufferInputStream pair.
+ *
+ * Positions increase forever and are masked into the buffer, so "full" and
+ * "empty" never need a spare slot. Each index sits on its own cache line so
+ * the producer and consumer do not invalidate each other's writes.
+ */
+class RingBuffer {
+public:
+    /// @param capacity Buffer size in bytes, rounded up to a power of two (minimum 64).
+    explicit RingBuffer(size_t capacity)
+        : capacity_(std::bit_ceil(std::max<size_t>(64, capacity))),
+          data_(std::make_unique_for_overwrite<uint8_t[]>(capacity_)), head_(0), tail_(0) {}
+
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    size_t capacity() const { return capacity_; }
+
+private:
+    friend class RingBufferOutputStream;
+    friend class RingBufferInputStream;
+
+    uint8_t* at(uint64_t pos) const { return data_.get() + (pos & (capacity_ - 1)); }
+
+    const size_t capacity_;
+    const std::unique_ptr<uint8_t[]> data_;
+    alignas(kCacheLineSize) std::atomic<uint64_t> head_;   // End of published data (producer writes)
+    alignas(kCacheLineSize) std::atomic<uint64_t> tail_;   // End of released data (consumer writes)
+};
+
+/**
+ * @class RingBufferOutputStream
+ * @brief Producer side: writes into the ring in place; Publish() makes the
+ *        bytes written so far visible to the consumer.
+ *
+ * Next() hands out the contiguous free space up to the end of the ring and
+ * waits (yielding) while the ring is full. It fails only if the unpublished
+ * bytes alone fill the ring, which no amount of waiting can fix; Rollback()
+ * then drops them. Publish whole messages so the consumer never sees a
+ * partial one.
+ *
+ * Example usage:
+ * RingBufferOutputStream out(&ring);
+ * {
+ *     BasicCodedOutputStream<RingBufferOutputStream> coded(&out);
+ *     SerializeDelimited(msg, &coded);
+ * }
+ * out.Publish();
+ */
+class alignas(kCacheLineSize) RingBufferOutputStream final : public ZeroCopyOutputStream {
+public:
+    /// @param ring Shared ring; must outlive the stream. One producer per ring.
+    explicit RingBufferOutputStream(RingBuffer* ring)
+        : ring_(ring), pos_(ring->head_.load(std::memory_order_relaxed)), published_(pos_),
+          tail_(ring->tail_.load(std::memory_order_acquire)), last_provided_(0) {}
+
+    bool Next(uint8_t** block, size_t* size) override {
+        const size_t capacity = ring_->capacity_;
+        if (pos_ - published_ == capacity) return false;
+        while (pos_ - tail_ == capacity) {
+            // only re-read the consumer's index when the cached one says full
+            tail_ = ring_->tail_.load(std::memory_order_acquire);
+            if (pos_ - tail_ == capacity) std::this_thread::yield();
+        }
+        size_t offset = pos_ & (capacity - 1);
+        size_t n = std::min<size_t>(capacity - (pos_ - tail_), capacity - offset);
+        *block = ring_->at(pos_);
+        *size = n;
+        pos_ += n;
+        last_provided_ = n;
+        return true;
+    }
+
+    /// @throw std::runtime_error if count exceeds the last block handed out
+    void BackUp(size_t count) override {
+        if (count > last_provided_) throw std::runtime_error("BackUp out of range");
+        pos_ -= count;
+        last_provided_ -= count;
+    }
+
+    /// Same as Publish().
+    bool Flush() override {
+        Publish();
+        return true;
+    }
+
+    /// Bytes written since the ring was created, published or not.
+    int64_t ByteCount() const override { return static_cast<int64_t>(pos_); }
+
+    /**
+     * @brief Makes everything written so far visible to the consumer.
+     *
+     * Any coded cursor must be trimmed first. One release store: call it per
+     * message for latency, or per batch to touch the shared line less.
+     */
+    void Publish() {
+        published_ = pos_;
+        last_provided_ = 0;
+        ring_->head_.store(pos_, std::memory_order_release);
+    }
+
+    /// Discards the bytes written since the last Publish() (e.g. a message that did not fit).
+    void Rollback() {
+        pos_ = published_;
+        last_provided_ = 0;
+    }
+
+    /// Bytes written but not yet published.
+    size_t unpublished() const { return static_cast<size_t>(pos_ - published_); }
+
+private:
+    RingBuffer* ring_;
+    uint64_t pos_;              // Next byte to write
+    uint64_t published_;        // Last value stored to ring_->head_
+    uint64_t tail_;             // Cached copy of ring_->tail_
+    size_t last_provided_;      // Size of the last block from Next()
+};
+
+/**
+ * @class RingBufferInputStream
+ * @brief Consumer side: reads published bytes in place; Release() returns
+ *        the consumed space to the producer.
+ *
+ * Next() returns false when everything published has been read; it does
+ * not wait, so a consumer polls (or blocks elsewhere) and tries again.
+ * Blocks stay valid until they are released.
+ */
+class alignas(kCacheLineSize) RingBufferInputStream final : public ZeroCopyInputStream {
+public:
+    /// @param ring Shared ring; must outlive the stream. One consumer per ring.
+    explicit RingBufferInputStream(RingBuffer* ring)
+        : ring_(ring), pos_(ring->tail_.load(std::memory_order_relaxed)),
+          head_(ring->head_.load(std::memory_order_acquire)), last_returned_(0) {}
+
+    bool Next(const uint8_t** block, size_t* size) override {
+        if (pos_ == head_) {
+            // only re-read the producer's index once the cached one is used up
+            head_ = ring_->head_.load(std::memory_order_acquire);
+            if (pos_ == head_) {
+                last_returned_ = 0;
+                return false;
+            }
+        }
+        const size_t capacity = ring_->capacity_;
+        size_t offset = pos_ & (capacity - 1);
+        size_t n = std::min<size_t>(head_ - pos_, capacity - offset);
+        *block = ring_->at(pos_);
+        *size = n;
+        pos_ += n;
+        last_returned_ = n;
+        return true;
+    }
+
+    /// @throw std::runtime_error if count exceeds the last block returned
+    void BackUp(size_t count) override {
+        if (count > last_returned_) throw std::runtime_error("BackUp out of range");
+        pos_ -= count;
+        last_returned_ -= count;
+    }
+
+    /// Bytes consumed since the ring was created.
+    int64_t ByteCount() const override { return static_cast<int64_t>(pos_); }
+
+    /**
+     * @brief Hands the bytes consumed so far back to the producer.
+     *
+     * Any coded cursor must have backed up its unread window first, and
+     * views into released bytes must no longer be used.
+     */
+    void Release() {
+        last_returned_ = 0;
+        ring_->tail_.store(pos_, std::memory_order_release);
+    }
+
+    /// Published bytes not yet consumed, as of the last look at the producer's index.
+    size_t available() const { return static_cast<size_t>(head_ - pos_); }
+
+private:
+    RingBuffer* ring_;
+    uint64_t pos_;              // Next byte to read
+    uint64_t head_;             // Cached copy of ring_->head_
+    size_t last_returned_;      // Size of the last block from Next()
+};
+
+}}
@@ -0,0 +1,164 @@
+#pragma once
+// stats_stream.h
+// Pass-through stream decorators that count the traffic on one stream:
+// Next()/BackUp()/Skip() calls, the bytes they move and the sizes of the
+// blocks handed out. Wrap a stream to see what a message costs it, e.g.
+// how many refills a parse takes at a given chunk size; the process-wide
+// slow-path counters are in io_stats.h.
+//
+// Example usage:
+// StatsInputStream counted(&file);
+// Parse(msg, &counted);
+// const StreamStats& s = counted.stats();   // s.next_calls, s.block_sizes, ...
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <bit>
+#include <memory>
+#include <string>
+
+#include "quark/io/zero_copy_stream.h"
+
+namespace quark {
+namespace io {
+
+/// Block size buckets: block_sizes[i] counts blocks of [2^i, 2^(i+1)) bytes.
+static constexpr size_t kBlockSizeBuckets = 40;
+
+/**
+ * @brief Counters for one decorated stream.
+ */
+struct StreamStats {
+    uint64_t next_calls = 0;
+    uint64_t next_bytes = 0;        // Bytes in the blocks Next() returned
+    uint64_t backup_calls = 0;
+    uint64_t backup_bytes = 0;
+    uint64_t skip_calls = 0;        // Input only
+    uint64_t skip_bytes = 0;
+    uint64_t flush_calls = 0;       // Output only
+    uint64_t aliased_writes = 0;    // Output only: WriteAliasedRaw() calls
+    uint64_t aliased_bytes = 0;
+    std::array<uint64_t, kBlockSizeBuckets> block_sizes{};
+
+    /// Bytes handed out by Next() and not backed up.
+    uint64_t net_bytes() const { return next_bytes - backup_bytes; }
+
+    /**
+     * @brief Calls f(name, value) for every counter, for export to a metrics
+     *        system. Non-empty block size buckets are "blocks_log2_<i>".
+     */
+    template <typename F>
+    void ForEach(F&& f) const {
+        f("next_calls", next_calls);
+        f("next_bytes", next_bytes);
+        f("backup_calls", backup_calls);
+        f("backup_bytes", backup_bytes);
+        f("skip_calls", skip_calls);
+        f("skip_bytes", skip_bytes);
+        f("flush_calls", flush_calls);
+        f("aliased_writes", aliased_writes);
+        f("aliased_bytes", aliased_bytes);
+        for (size_t i = 0; i < block_sizes.size(); ++i) {
+            if (block_sizes[i] != 0) f(("blocks_log2_" + std::to_string(i)).c_str(), block_sizes[i]);
+        }
+    }
+};
+
+namespace detail {
+
+inline void CountBlock(StreamStats& stats, size_t size) {
+    ++stats.next_calls;
+    stats.next_bytes += size;
+    if (size > 0) ++stats.block_sizes[std::min<size_t>(std::bit_width(size) - 1, kBlockSizeBuckets - 1)];
+}
+
+} // namespace detail
+
+/**
+ * @class StatsInputStream
+ * @brief Forwards to an input stream, counting its calls and bytes.
+ */
+class StatsInputStream final : public ZeroCopyInputStream {
+public:
+    /// @param in Underlying stream; must outlive this object.
+    explicit StatsInputStream(ZeroCopyInputStream* in) : in_(in) {}
+
+    bool Next(const uint8_t** block, size_t* size) override {
+        if (!in_->Next(block, size)) return false;
+        detail::CountBlock(stats_, *size);
+        return true;
+    }
+
+    void BackUp(size_t count) override {
+        ++stats_.backup_calls;
+        stats_.backup_bytes += count;
+        in_->BackUp(count);
+    }
+
+    /// Forwards to the underlying Skip(), keeping its O(1) seek if it has one.
+    bool Skip(size_t count) override {
+        ++stats_.skip_calls;
+        stats_.skip_bytes += count;
+        return in_->Skip(count);
+    }
+
+    std::shared_ptr<const void> BlockOwner() const override { return in_->BlockOwner(); }
+
+    int64_t ByteCount() const override { return in_->ByteCount(); }
+
+    const StreamStats& stats() const { return stats_; }
+
+    void ResetStats() { stats_ = StreamStats(); }
+
+private:
+    ZeroCopyInputStream* in_;   // Underlying stream
+    StreamStats stats_;
+};
+
+/**
+ * @class StatsOutputStream
+ * @brief Forwards to an output stream, counting its calls and bytes.
+ */
+class StatsOutputStream final : public ZeroCopyOutputStream {
+public:
+    /// @param out Underlying stream; must outlive this object.
+    explicit StatsOutputStream(ZeroCopyOutputStream* out) : out_(out) {}
+
+    bool Next(uint8_t** block, size_t* size) override {
+        if (!out_->Next(block, size)) return false;
+        detail::CountBlock(stats_, *size);
+        return true;
+    }
+
+    void BackUp(size_t count) override {
+        ++stats_.backup_calls;
+        stats_.backup_bytes += count;
+        out_->BackUp(count);
+    }
+
+    bool Flush() override {
+        ++stats_.flush_calls;
+        return out_->Flush();
+    }
+
+    bool AllowsAliasing() const override { return out_->AllowsAliasing(); }
+
+    bool WriteAliasedRaw(const void* data, size_t size) override {
+        ++stats_.aliased_writes;
+        stats_.aliased_bytes += size;
+        return out_->WriteAliasedRaw(data, size);
+    }
+
+    int64_t ByteCount() const override { return out_->ByteCount(); }
+
+    const StreamStats& stats() const { return stats_; }
+
+    void ResetStats() { stats_ = StreamStats(); }
+
+private:
+    ZeroCopyOutputStream* out_;     // Underlying stream
+    StreamStats stats_;
+};
+
+}}
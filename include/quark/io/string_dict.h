@@ -0,0 +1,268 @@
+#pragma once
+// string_dict.h
+// Dictionary-encoded strings (Type::DICT_STRING) for streams where the same
+// few hundred values (hostnames, metric names, labels) repeat in almost
+// every message. Each distinct string is written once, at its first use,
+// and every later occurrence is a varint index into a table both ends
+// build as they go:
+//
+//   [ DICT_STRING | varint (index << 1) ]             a string seen before
+//   [ DICT_STRING | varint (len << 1 | 1) | bytes ]   a new entry, next index
+//
+// Once the writer's table is full, strings it has not seen are written as
+// plain STRING fields, which the reader also accepts.
+//
+// The tables are scoped to one stream: the reader must decode every
+// DICT_STRING field the writer wrote, in order, and both sides Reset() at
+// the same point (e.g. per batch) to start over.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "quark/arena.h"
+#include "quark/io/endian.h"
+#include "quark/io/zero_copy_stream.h"
+
+namespace quark {
+namespace io {
+
+/// Default cap on distinct strings a StringDictWriter interns.
+static constexpr size_t kDefaultMaxDictEntries = 1 << 16;
+
+namespace detail {
+
+/// Multiplicative hash over 8-byte words; the tail is one overlapping load.
+inline uint32_t HashString(std::string_view s) {
+    constexpr uint64_t kMul = 0x9E3779B97F4A7C15ull;
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(s.data());
+    size_t n = s.size();
+    uint64_t h = n * kMul;
+    if (n < 8) {
+        uint64_t word = 0;
+        std::memcpy(&word, p, n);
+        h = (h ^ word) * kMul;
+    } else {
+        for (size_t i = 0; i + 8 < n; i += 8) h = (h ^ LoadLittleEndian64(p + i)) * kMul;
+        h = (h ^ LoadLittleEndian64(p + n - 8)) * kMul;
+    }
+    // multiplies only carry upward; fold the high bits back before the index is masked off
+    h = (h ^ (h >> 29)) * kMul;
+    return static_cast<uint32_t>(h >> 32);
+}
+
+} // namespace detail
+
+/**
+ * @class StringDictWriter
+ * @brief Encoder-side intern table: maps strings already written on a stream
+ *        to their index.
+ *
+ * An open-addressing hash table with linear probing over copies of the
+ * strings held in an arena, so callers may pass temporaries.
+ *
+ * Not thread-safe; use one per output stream.
+ */
+class StringDictWriter {
+public:
+    /**
+     * @param max_entries Distinct strings to intern before falling back to
+     *        plain STRING fields
+     */
+    explicit StringDictWriter(size_t max_entries = kDefaultMaxDictEntries)
+        : max_entries_(max_entries), slots_(16, 0) {}
+
+    StringDictWriter(const StringDictWriter&) = delete;
+    StringDictWriter& operator=(const StringDictWriter&) = delete;
+
+    /**
+     * @brief Looks up 's', adding it if it is new and there is room.
+     * @param index Receives the entry index when the result is true
+     * @param added Set when 's' was added by this call
+     * @return false if 's' is not in the table and the table is full
+     */
+    bool Intern(std::string_view s, uint32_t& index, bool& added) {
+        uint32_t hash = detail::HashString(s);
+        size_t mask = slots_.size() - 1;
+        size_t i = hash & mask;
+        for (; slots_[i] != 0; i = (i + 1) & mask) {
+            uint32_t e = slots_[i] - 1;
+            if (hashes_[e] == hash && entries_[e] == s) {
+                index = e;
+                added = false;
+                return true;
+            }
+        }
+        if (entries_.size() >= max_entries_) return false;
+
+        char* copy = arena_.AllocateArray<char>(s.size());
+        std::memcpy(copy, s.data(), s.size());
+        index = static_cast<uint32_t>(entries_.size());
+        entries_.emplace_back(copy, s.size());
+        hashes_.push_back(hash);
+        slots_[i] = index + 1;
+        added = true;
+        // keep the load at or under one half
+        if (entries_.size() * 2 > slots_.size()) Grow();
+        return true;
+    }
+
+    /// Number of interned strings.
+    size_t size() const { return entries_.size(); }
+
+    /// The interned strings, in index order.
+    const std::vector<std::string_view>& entries() const { return entries_; }
+
+    /// Forgets every entry; the reader must Reset() at the same point.
+    void Reset() {
+        entries_.clear();
+        hashes_.clear();
+        slots_.assign(16, 0);
+        arena_.Reset();
+    }
+
+private:
+    void Grow() {
+        std::vector<uint32_t> slots(slots_.size() * 2, 0);
+        size_t mask = slots.size() - 1;
+        for (uint32_t e = 0; e < entries_.size(); ++e) {
+            size_t i = hashes_[e] & mask;
+            while (slots[i] != 0) i = (i + 1) & mask;
+            slots[i] = e + 1;
+        }
+        slots_.swap(slots);
+    }
+
+    size_t max_entries_;
+    std::vector<std::string_view> entries_;
+    std::vector<uint32_t> hashes_;  // HashString() of each entry
+    std::vector<uint32_t> slots_;   // entry index + 1, 0 = empty; power-of-two size
+    quark::Arena arena_;            // entry bytes
+};
+
+/**
+ * @class StringDictReader
+ * @brief Decoder-side table: the strings a stream has defined so far.
+ *
+ * Entries are copied once into the reader's arena, so the views handed out
+ * stay valid after the input chunk they came from is gone, until Reset().
+ */
+class StringDictReader {
+public:
+    StringDictReader() = default;
+
+    StringDictReader(const StringDictReader&) = delete;
+    StringDictReader& operator=(const StringDictReader&) = delete;
+
+    /// Number of entries defined so far.
+    size_t size() const { return entries_.size(); }
+
+    /// Entry 'index'; must be below size().
+    std::string_view operator[](size_t index) const { return entries_[index]; }
+
+    /// Appends an entry whose bytes already live in arena().
+    void Add(std::string_view s) { entries_.push_back(s); }
+
+    /// Storage for entry bytes, and for plain STRING fields that straddle chunks.
+    quark::Arena* arena() { return &arena_; }
+
+    /// Forgets every entry; pairs with StringDictWriter::Reset().
+    void Reset() {
+        entries_.clear();
+        arena_.Reset();
+    }
+
+private:
+    std::vector<std::string_view> entries_;
+    quark::Arena arena_;
+};
+
+/**
+ * @brief Serializes a string as a DICT_STRING field: an index when 'dict'
+ *        has seen it, otherwise the bytes, defining the next entry. Falls
+ *        back to a plain STRING field when 'dict' is full.
+ * @param out The output stream to write to.
+ * @param dict The stream's intern table.
+ * @param str The string to serialize.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeDictString(BasicCodedOutputStream<S>* out, StringDictWriter& dict, std::string_view str) {
+    uint32_t index;
+    bool added;
+    if (!dict.Intern(str, index, added)) {
+        if (!out->WriteByte(static_cast<uint8_t>(Type::STRING))) return false;
+        return WriteLengthDelimitedBytes(out, reinterpret_cast<const uint8_t*>(str.data()), str.size());
+    }
+    if (!added) {
+        uint32_t ref = index << 1;
+        if (uint8_t* p = out->GetDirectBufferForNBytesAndAdvance(1 + VarintSize32(ref))) {
+            *p++ = static_cast<uint8_t>(Type::DICT_STRING);
+            BasicCodedOutputStream<S>::EncodeVarint(p, ref);
+            return true;
+        }
+        if (!out->WriteByte(static_cast<uint8_t>(Type::DICT_STRING))) return false;
+        return out->WriteVarint32(ref);
+    }
+    if (!out->WriteByte(static_cast<uint8_t>(Type::DICT_STRING))) return false;
+    if (!out->WriteVarint64((static_cast<uint64_t>(str.size()) << 1) | 1)) return false;
+    return out->WriteRaw(reinterpret_cast<const uint8_t*>(str.data()), str.size());
+}
+
+template <OutputStream S>
+inline bool SerializeDictString(S* out, StringDictWriter& dict, std::string_view str) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeDictString(&coded, dict, str);
+}
+
+/**
+ * @brief Deserializes a DICT_STRING (or plain STRING) field without a
+ *        per-field allocation.
+ *
+ * 'str_view' points into 'dict' for dictionary fields, valid until
+ * dict.Reset(). A plain STRING field is viewed in the input, or copied into
+ * dict.arena() when it is not contiguous, as DeserializeString() does.
+ *
+ * @param in The input stream to read from.
+ * @param dict The stream's table; new entries are added to it.
+ * @param str_view Receives the string.
+ * @return false on truncated input or an index the table does not hold.
+ */
+template <typename S>
+inline bool DeserializeDictString(BasicCodedInputStream<S>* in, StringDictReader& dict, std::string_view& str_view) {
+    uint8_t tag;
+    if (!in->ReadByte(tag)) return false;
+    std::span<const uint8_t> bytes;
+    if (tag == static_cast<uint8_t>(Type::STRING)) {
+        if (!ReadLengthDelimitedBytes(in, bytes, dict.arena())) return false;
+        str_view = std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        return true;
+    }
+    if (tag != static_cast<uint8_t>(Type::DICT_STRING)) return false;
+
+    uint64_t v;
+    if (!in->ReadVarint64(v)) return false;
+    if ((v & 1) == 0) {
+        if ((v >> 1) >= dict.size()) return false;
+        str_view = dict[v >> 1];
+        return true;
+    }
+    uint64_t length = v >> 1;
+    int64_t limit = in->BytesUntilLimit();
+    if (length > UINT32_MAX || (limit >= 0 && length > static_cast<uint64_t>(limit))) return false;
+    char* dst = dict.arena()->AllocateArray<char>(length);
+    if (!in->ReadRaw(reinterpret_cast<uint8_t*>(dst), length)) return false;
+    str_view = std::string_view(dst, length);
+    dict.Add(str_view);
+    return true;
+}
+
+template <InputStream S>
+inline bool DeserializeDictString(S* in, StringDictReader& dict, std::string_view& str_view) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeDictString(&coded, dict, str_view);
+}
+
+}}
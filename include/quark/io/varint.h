@@ -0,0 +1,301 @@
+#pragma once
+// varint.h
+// Raw-pointer varint decoders shared by the stream cursors: a branchless
+// single-load decoder for one value and a Masked-VByte style bulk decoder.
+// More on the bulk technique: Plaisance, Kurz, Lemire, "Vectorized VByte
+// Decoding" (2015).
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <bit>
+
+#include "quark/io/endian.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    #define QUARK_X86_SIMD 1
+    #include <immintrin.h>
+#else
+    #define QUARK_X86_SIMD 0
+#endif
+
+namespace quark {
+namespace io {
+
+static constexpr int kMaxVarint32Bytes = 5;
+static constexpr int kMaxVarint64Bytes = 10;
+
+/// Number of bytes in the varint encoding of 'value' (1..5), without branches.
+constexpr size_t VarintSize32(uint32_t value) {
+    return (static_cast<size_t>(std::bit_width(value | 1)) * 9 + 64) / 64;
+}
+
+/// Number of bytes in the varint encoding of 'value' (1..10), without branches.
+constexpr size_t VarintSize64(uint64_t value) {
+    return (static_cast<size_t>(std::bit_width(value | 1)) * 9 + 64) / 64;
+}
+
+/**
+ * @brief Packs the 7-bit payload groups of up to 8 varint bytes into one value.
+ *
+ * The caller must already have cleared every byte after the terminating one.
+ * Uses BMI2 pext when the build targets it, otherwise three mask-and-shift
+ * steps that close the gaps left by the continuation bits.
+ */
+inline uint64_t CompactVarintBytes(uint64_t word) {
+#if defined(__BMI2__)
+    return _pext_u64(word, 0x7F7F7F7F7F7F7F7Full);
+#else
+    word &= 0x7F7F7F7F7F7F7F7Full;
+    word = ((word & 0x7F007F007F007F00ull) >> 1) | (word & 0x007F007F007F007Full);
+    word = ((word & 0x3FFF00003FFF0000ull) >> 2) | (word & 0x00003FFF00003FFFull);
+    word = ((word & 0x0FFFFFFF00000000ull) >> 4) | (word & 0x000000000FFFFFFFull);
+    return word;
+#endif
+}
+
+/**
+ * @brief Decodes one varint32 with a single 64-bit load and no per-byte branches.
+ * @param p Start of the varint; at least 8 bytes must be readable from here.
+ * @param[out] value Receives the decoded value
+ * @return Pointer past the varint, or nullptr if it is longer than kMaxVarint32Bytes
+ */
+inline const uint8_t* DecodeVarint32Unchecked(const uint8_t* p, uint32_t& value) {
+    uint64_t word = LoadLittleEndian64(p);
+    uint64_t stops = ~word & 0x0000008080808080ull;
+    if (stops == 0) return nullptr;
+    int bits = std::countr_zero(stops) + 1;
+    value = static_cast<uint32_t>(CompactVarintBytes(word & ((1ull << bits) - 1)));
+    return p + bits / 8;
+}
+
+/**
+ * @brief Decodes one varint64 with a single 64-bit load for values up to 8 bytes.
+ * @param p Start of the varint; at least kMaxVarint64Bytes must be readable from here.
+ * @param[out] value Receives the decoded value
+ * @return Pointer past the varint, or nullptr if it is longer than kMaxVarint64Bytes
+ */
+inline const uint8_t* DecodeVarint64Unchecked(const uint8_t* p, uint64_t& value) {
+    uint64_t word = LoadLittleEndian64(p);
+    uint64_t stops = ~word & 0x8080808080808080ull;
+    if (stops != 0) {
+        int bits = std::countr_zero(stops) + 1;
+        uint64_t keep = bits == 64 ? ~0ull : ((1ull << bits) - 1);
+        value = CompactVarintBytes(word & keep);
+        return p + bits / 8;
+    }
+
+    // 9 and 10 byte varints: all eight loaded bytes are payload
+    uint64_t result = CompactVarintBytes(word);
+    result |= static_cast<uint64_t>(p[8] & 0x7F) << 56;
+    if (p[8] < 0x80) {
+        value = result;
+        return p + 9;
+    }
+    if (p[9] >= 0x80) return nullptr;
+    value = result | (static_cast<uint64_t>(p[9]) << 63);
+    return p + 10;
+}
+
+/**
+ * @brief Decodes one varint64 from [p, end), advancing 'p'. Takes the
+ *        single-load path when a full varint's worth of bytes remains.
+ * @return false if the varint is truncated or longer than kMaxVarint64Bytes
+ */
+inline bool DecodeVarint64Checked(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+    if (end - p >= kMaxVarint64Bytes) {
+        const uint8_t* next = DecodeVarint64Unchecked(p, value);
+        if (next == nullptr) return false;
+        p = next;
+        return true;
+    }
+    value = 0;
+    for (int shift = 0; p != end && shift < 64; shift += 7) {
+        uint8_t byte = *p++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (byte < 0x80) return true;
+    }
+    return false;
+}
+
+/// Maps signed values to unsigned so small magnitudes of either sign get
+/// short varints: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+constexpr uint32_t ZigZagEncode32(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+constexpr uint64_t ZigZagEncode64(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+/// Inverse of ZigZagEncode32().
+constexpr int32_t ZigZagDecode32(uint32_t value) {
+    return static_cast<int32_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+/// Inverse of ZigZagEncode64().
+constexpr int64_t ZigZagDecode64(uint64_t value) {
+    return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+namespace detail {
+
+/// One Masked-VByte table entry: how to spread the varints found in the
+/// first 12 input bytes into 16-bit (width 2) or 32-bit (width 4) lanes.
+struct VByteShuffle {
+    uint8_t shuffle[16];    // pshufb control; 0x80 zeroes a lane byte
+    uint8_t count;          // Varints decoded by this entry (0 = use scalar)
+    uint8_t consumed;       // Input bytes consumed
+    uint8_t width;          // Lane width in bytes
+};
+
+using VByteTable = std::array<VByteShuffle, 4096>;
+
+/// Builds the entry for one 12-bit continuation mask. Only complete varints
+/// of at most 2 bytes (up to 8 per entry) or 3 bytes (up to 4) are handled;
+/// anything longer leaves count = 0 and is decoded by the scalar path.
+constexpr VByteShuffle BuildVByteShuffle(unsigned mask) {
+    VByteShuffle e{};
+    for (auto& b : e.shuffle) b = 0x80;
+
+    uint8_t starts[12] = {};
+    uint8_t lens[12] = {};
+    int n = 0;
+    int pos = 0;
+    while (pos < 12) {
+        int end = pos;
+        while (end < 12 && ((mask >> end) & 1)) ++end;
+        if (end >= 12) break;                    // varint runs past byte 12
+        starts[n] = static_cast<uint8_t>(pos);
+        lens[n] = static_cast<uint8_t>(end - pos + 1);
+        ++n;
+        pos = end + 1;
+    }
+
+    int k2 = 0;
+    while (k2 < n && k2 < 8 && lens[k2] <= 2) ++k2;
+    int k3 = 0;
+    while (k3 < n && k3 < 4 && lens[k3] <= 3) ++k3;
+
+    if (k2 > 0 && k2 >= k3) {
+        e.width = 2;
+        e.count = static_cast<uint8_t>(k2);
+        for (int i = 0; i < k2; ++i) {
+            e.shuffle[2 * i] = starts[i];
+            if (lens[i] == 2) e.shuffle[2 * i + 1] = starts[i] + 1;
+            e.consumed = static_cast<uint8_t>(e.consumed + lens[i]);
+        }
+    } else if (k3 > 0) {
+        e.width = 4;
+        e.count = static_cast<uint8_t>(k3);
+        for (int i = 0; i < k3; ++i) {
+            for (int b = 0; b < lens[i]; ++b) e.shuffle[4 * i + b] = starts[i] + b;
+            e.consumed = static_cast<uint8_t>(e.consumed + lens[i]);
+        }
+    }
+    return e;
+}
+
+inline const VByteTable& MaskedVByteTable() {
+    static const VByteTable table = [] {
+        VByteTable t{};
+        for (unsigned m = 0; m < t.size(); ++m) t[m] = BuildVByteShuffle(m);
+        return t;
+    }();
+    return table;
+}
+
+#if QUARK_X86_SIMD
+/**
+ * @brief SSSE3/SSE4.1 bulk decoder. Consumes 16-byte input blocks while at
+ *        least 16 input bytes and 16 output slots remain (stores may write up
+ *        to 16 lanes past the decoded count).
+ * @return Number of values decoded; 'p' is advanced past them.
+ */
+__attribute__((target("ssse3,sse4.1")))
+inline size_t DecodeVarint32BatchSse(const uint8_t*& p, const uint8_t* end, uint32_t* out, size_t n) {
+    const VByteTable& table = MaskedVByteTable();
+    size_t done = 0;
+    while (end - p >= 16 && n - done >= 16) {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(in));
+
+        if (mask == 0) {
+            // sixteen single-byte varints
+            __m128i* dst = reinterpret_cast<__m128i*>(out + done);
+            _mm_storeu_si128(dst + 0, _mm_cvtepu8_epi32(in));
+            _mm_storeu_si128(dst + 1, _mm_cvtepu8_epi32(_mm_srli_si128(in, 4)));
+            _mm_storeu_si128(dst + 2, _mm_cvtepu8_epi32(_mm_srli_si128(in, 8)));
+            _mm_storeu_si128(dst + 3, _mm_cvtepu8_epi32(_mm_srli_si128(in, 12)));
+            p += 16;
+            done += 16;
+            continue;
+        }
+
+        const VByteShuffle& e = table[mask & 0xFFF];
+        if (e.count == 0) {
+            uint32_t v;
+            const uint8_t* next = DecodeVarint32Unchecked(p, v);
+            if (next == nullptr) break;
+            out[done++] = v;
+            p = next;
+            continue;
+        }
+
+        __m128i x = _mm_shuffle_epi8(in, _mm_loadu_si128(reinterpret_cast<const __m128i*>(e.shuffle)));
+        __m128i* dst = reinterpret_cast<__m128i*>(out + done);
+        if (e.width == 2) {
+            __m128i lo = _mm_and_si128(x, _mm_set1_epi16(0x007F));
+            __m128i hi = _mm_srli_epi16(_mm_and_si128(x, _mm_set1_epi16(0x7F00)), 1);
+            __m128i v = _mm_or_si128(lo, hi);
+            _mm_storeu_si128(dst + 0, _mm_cvtepu16_epi32(v));
+            _mm_storeu_si128(dst + 1, _mm_cvtepu16_epi32(_mm_srli_si128(v, 8)));
+        } else {
+            __m128i b0 = _mm_and_si128(x, _mm_set1_epi32(0x0000007F));
+            __m128i b1 = _mm_srli_epi32(_mm_and_si128(x, _mm_set1_epi32(0x00007F00)), 1);
+            __m128i b2 = _mm_srli_epi32(_mm_and_si128(x, _mm_set1_epi32(0x007F0000)), 2);
+            _mm_storeu_si128(dst, _mm_or_si128(_mm_or_si128(b0, b1), b2));
+        }
+        p += e.consumed;
+        done += e.count;
+    }
+    return done;
+}
+
+inline bool CpuHasSse41() {
+    static const bool has = __builtin_cpu_supports("ssse3") && __builtin_cpu_supports("sse4.1");
+    return has;
+}
+#endif
+
+} // namespace detail
+
+/**
+ * @brief Decodes up to 'n' consecutive varint32s from [p, end).
+ *
+ * Uses the SSE4.1 Masked-VByte kernel when the CPU supports it (checked once
+ * at runtime) and the single-load scalar decoder otherwise. Stops early,
+ * without consuming them, at the last few bytes of the buffer (fewer than 8)
+ * or at a malformed varint, so callers finish with a bounds-checked path.
+ *
+ * @param[in,out] p Input position; advanced past the decoded values
+ * @param end End of readable input
+ * @param out Destination array with room for 'n' values
+ * @param n Number of values wanted
+ * @return Number of values decoded
+ */
+inline size_t DecodeVarint32Batch(const uint8_t*& p, const uint8_t* end, uint32_t* out, size_t n) {
+    size_t done = 0;
+#if QUARK_X86_SIMD
+    if (detail::CpuHasSse41()) done = detail::DecodeVarint32BatchSse(p, end, out, n);
+#endif
+    while (done < n && end - p >= 8) {
+        const uint8_t* next = DecodeVarint32Unchecked(p, out[done]);
+        if (next == nullptr) break;
+        p = next;
+        ++done;
+    }
+    return done;
+}
+
+}}
@@ -12,7 +12,17 @@
 #include <algorithm>
 #include <memory>
 #include <limits>
+#include <concepts>
 #include <span>
+#include <bit>
+#include <string_view>
+
+#include "quark/arena.h"
+#include "quark/buffer_pool.h"
+#include "quark/pinned_view.h"
+#include "quark/io/endian.h"
+#include "quark/io/io_stats.h"
+#include "quark/io/varint.h"
 
 #if defined(__unix__) || defined(__APPLE__)
     #define QUARK_POSIX 1
@@ -20,6 +30,7 @@
     #include <sys/mman.h>
     #include <sys/stat.h>
     #include <fcntl.h>
+    #include <sys/uio.h>
 #else
     #define QUARK_POSIX 0
 #endif
@@ -72,21 +83,30 @@ public:
         return true;
     }
 
+    /**
+     * Copies exactly 'size' bytes out of the stream, crossing blocks as needed.
+     * On failure the last partially-copied block is pushed back.
+     * @param buffer Destination for the bytes
+     * @param size Number of bytes to read
+     * @return false if the stream ended before 'size' bytes were read
+     */
     bool ReadRaw(void* buffer, size_t size) {
         uint8_t* out = static_cast<uint8_t*>(buffer);
         size_t remaining = size;
         size_t bytes_read = 0;
+        size_t last_chunk = 0;
 
         while (remaining > 0) {
             const uint8_t* ptr;
             size_t chunk_size;
 
             if (!Next(&ptr, &chunk_size)) {
-                if (bytes_read > 0) {
-                    BackUp(chunk_size);
+                if (bytes_read > 0 && last_chunk > 0) {
+                    BackUp(last_chunk);
                 }
                 return false;
             }
+            last_chunk = chunk_size;
 
             if (chunk_size > remaining) {
                 std::memcpy(out, ptr, remaining);
@@ -104,6 +124,13 @@ public:
         return true;
     }
 
+    /**
+     * Returns a reference keeping the last block from Next() alive, so views
+     * into it can outlive the stream (see quark::PinnedView).
+     * @return null if the stream cannot pin its blocks
+     */
+    virtual std::shared_ptr<const void> BlockOwner() const { return nullptr; }
+
     /**
      * Returns the total number of bytes returned to the caller so far.
      * Excludes bytes that were backed up.
@@ -163,6 +190,23 @@ public:
         return true;
     }
 
+    /**
+     * Whether WriteAliasedRaw() records references instead of copying.
+     * @return false unless the stream overrides it
+     */
+    virtual bool AllowsAliasing() const { return false; }
+
+    /**
+     * Writes 'size' bytes that the stream may reference instead of copy.
+     * When AllowsAliasing() is true the caller's memory must stay valid and
+     * unchanged until the stream's output has been consumed (or cleared);
+     * otherwise this is WriteRaw(). Must not be followed by BackUp().
+     * @param data Pointer to the bytes to write
+     * @param size Number of bytes to write
+     * @return false if writing failed
+     */
+    virtual bool WriteAliasedRaw(const void* data, size_t size) { return WriteRaw(data, size); }
+
     /**
      * Returns the total number of bytes made visible to the caller.
      * Excludes bytes that were backed up.
@@ -171,6 +215,33 @@ public:
     virtual int64_t ByteCount() const = 0;
 };
 
+// ============================
+// Stream Concepts
+// ============================
+//
+// The coded cursors and the free Read/Write/Serialize functions are templates
+// over these concepts rather than the virtual interfaces above. Instantiated
+// with a concrete (final) stream, every Next()/BackUp() resolves statically
+// and can be inlined; instantiated with ZeroCopy{Input,Output}Stream itself
+// they are the type-erased path for streams only known at run time.
+
+/// Anything that hands out readable blocks like ZeroCopyInputStream.
+template <typename S>
+concept InputStream = requires(S& s, const uint8_t** block, size_t* size, size_t count) {
+    { s.Next(block, size) } -> std::same_as<bool>;
+    s.BackUp(count);
+    { s.Skip(count) } -> std::same_as<bool>;
+    { s.ByteCount() } -> std::convertible_to<int64_t>;
+};
+
+/// Anything that hands out writable blocks like ZeroCopyOutputStream.
+template <typename S>
+concept OutputStream = requires(S& s, uint8_t** block, size_t* size, size_t count) {
+    { s.Next(block, size) } -> std::same_as<bool>;
+    s.BackUp(count);
+    { s.ByteCount() } -> std::convertible_to<int64_t>;
+};
+
 // ========================
 // Input APIS
 // ========================
@@ -181,7 +252,7 @@ public:
  *
  * Useful for deserializing in-memory block without copying.
  */
-class BufferInputStream : public ZeroCopyInputStream {
+class BufferInputStream final : public ZeroCopyInputStream {
 public:
     /**
      * @brief Construct a new BufferInputStream
@@ -218,6 +289,21 @@ public:
         last_returned_ -= count;
     }
 
+    /**
+     * @brief Skips 'count' bytes by moving the read position.
+     * @param count Number of bytes to skip
+     * @return false if fewer than 'count' bytes remain (the stream is then exhausted)
+     */
+    bool Skip(size_t count) override {
+        last_returned_ = 0;
+        if (count > size_ - pos_) {
+            pos_ = size_;
+            return false;
+        }
+        pos_ += count;
+        return true;
+    }
+
     /**
      * @brief Returns the total number of bytes returned to the caller so far
      *        (excluding any backed-up bytes)
@@ -225,6 +311,12 @@ public:
      */
     int64_t ByteCount() const override { return pos_; }
 
+    /// Start of the buffer.
+    const uint8_t* data() const { return data_; }
+
+    /// Size of the buffer in bytes.
+    size_t size() const { return size_; }
+
 private:
     const uint8_t* data_;   // Pointer to the start of the buffer
     size_t size_;              // Total size of the buffer
@@ -245,12 +337,13 @@ private:
 /// while (stream.Next(&data, &size)) {
 ///     // process 'size' bytes at 'data'
 /// }
-class MultiBufferInputStream : public ZeroCopyInputStream {
+class MultiBufferInputStream final : public ZeroCopyInputStream {
 public:
     /// Represents a single contiguous chunk of memory
     struct Chunk {
         const uint8_t* data;    // pointer to the chunk memory
         size_t size;               // size of the chunk in bytes
+        std::shared_ptr<const void> owner = nullptr;   // optional refcounted owner of 'data'
     };
 
     /// Constructs the stream from a vector of chunks
@@ -288,9 +381,8 @@ public:
     void BackUp(size_t count) override {
         if (count > last_size_) throw std::runtime_error("BackUp out of range");
         total_ -= count;
+        // backed-up bytes are always the tail of chunks_[idx_ - 1]
         backed_up_ = count;
-
-        if (backed_up_ == last_size_ && idx_ > 0) idx_--;
         last_size_ -= count;
     }
 
@@ -298,6 +390,11 @@ public:
     /// (minus any backed-up bytes)
     int64_t ByteCount() const override { return total_; }
 
+    /// Owner of the chunk last returned by Next(), or null if it has none.
+    std::shared_ptr<const void> BlockOwner() const override {
+        return idx_ > 0 ? chunks_[idx_ - 1].owner : nullptr;
+    }
+
 private:
     std::vector<Chunk> chunks_; // underlying memory chunks
     size_t idx_;                   // index of next chunk to serve
@@ -306,19 +403,165 @@ private:
     int64_t total_;             // total bytes returned so far
 };
 
-// TODO: Implement MmapInputStream usage and tests
-// Description:
-// This class provides a true zero-copy file input stream using POSIX mmap.
-// It maps an entire file into memory, allowing Next() to return direct pointers
-// into the file without any intermediate copying. This can be very useful for
-// low-latency or high-throughput applications that need to process large files
-// efficiently. 
-//
-// Next steps:
-// - Write unit tests that open a file and read chunks using MmapInputStream.
-// - Handle edge cases such as empty files and small files.
-// - Benchmark against BufferInputStream to see latency improvements.
-// - Ensure compatibility with WSL2 and native Linux.
+#if QUARK_POSIX
+
+/// Tuning knobs for MmapInputStream. All hints are advisory: if the kernel
+/// rejects one (e.g. MADV_HUGEPAGE on WSL2 or a filesystem without THP
+/// support) the stream silently carries on without it.
+struct MmapOptions {
+    size_t window_size = 0;      // Max bytes per Next(); 0 = rest of the file
+    bool sequential = true;      // MADV_SEQUENTIAL on the whole mapping
+    bool will_need = false;      // MADV_WILLNEED on the whole mapping up front
+    size_t readahead = 0;        // Bytes past each window to MADV_WILLNEED; 0 = off
+    bool populate = false;       // MAP_POPULATE (Linux): pre-fault the mapping
+    bool huge_pages = false;     // MADV_HUGEPAGE: back the mapping with THP
+};
+
+/**
+ * @class MmapInputStream
+ * @brief True zero-copy file input stream using POSIX mmap.
+ *
+ * Maps an entire file read-only and returns chunks straight out of the
+ * mapping, so large capture files can be replayed without reading them into
+ * an intermediate buffer. Empty files are supported and simply yield no data.
+ *
+ * Example usage:
+ * MmapOptions opts;
+ * opts.window_size = 1 << 20;
+ * opts.readahead = 4 << 20;
+ * MmapInputStream in("capture.bin", opts);
+ * const uint8_t* data;
+ * size_t size;
+ * while (in.Next(&data, &size)) {
+ *     // process 'size' bytes at 'data'
+ * }
+ */
+class MmapInputStream final : public ZeroCopyInputStream {
+public:
+    /**
+     * @brief Opens and maps a file.
+     * @param path Path of the file to map
+     * @param options Window size and kernel hints
+     * @throws std::runtime_error if the file cannot be opened, stat'ed or mapped
+     */
+    explicit MmapInputStream(const std::string& path, const MmapOptions& options = MmapOptions())
+        : data_(nullptr), size_(0), pos_(0), last_returned_(0), options_(options) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("MmapInputStream: cannot open " + path);
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("MmapInputStream: cannot stat " + path);
+        }
+        size_ = static_cast<size_t>(st.st_size);
+
+        if (size_ > 0) {
+            int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+            if (options_.populate) flags |= MAP_POPULATE;
+#endif
+            void* addr = ::mmap(nullptr, size_, PROT_READ, flags, fd, 0);
+            if (addr == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("MmapInputStream: cannot mmap " + path);
+            }
+            data_ = static_cast<const uint8_t*>(addr);
+            ApplyHints();
+        }
+        // The mapping keeps the file referenced; the descriptor is not needed.
+        ::close(fd);
+    }
+
+    /// Unmaps the file.
+    ~MmapInputStream() override {
+        if (data_ != nullptr) ::munmap(const_cast<uint8_t*>(data_), size_);
+    }
+
+    MmapInputStream(const MmapInputStream&) = delete;
+    MmapInputStream& operator=(const MmapInputStream&) = delete;
+
+    /**
+     * @brief Returns the next window of the mapping.
+     * @param block Output pointer to the start of the window
+     * @param size Output number of bytes in the window
+     * @return false once the whole file has been returned
+     */
+    bool Next(const uint8_t** block, size_t* size) override {
+        if (pos_ >= size_) return false;
+        size_t available = size_ - pos_;
+        if (options_.window_size > 0) available = std::min(available, options_.window_size);
+
+        *block = data_ + pos_;
+        *size = available;
+        pos_ += available;
+        last_returned_ = available;
+
+        if (options_.readahead > 0) Advise(pos_, options_.readahead, MADV_WILLNEED);
+        return true;
+    }
+
+    /**
+     * @brief Pushes back 'count' bytes from the last window returned by Next()
+     * @param count Number of bytes to back up; must be <= size of last window
+     * @throw std::runtime_error if count is invalid
+     */
+    void BackUp(size_t count) override {
+        if (count > last_returned_) throw std::runtime_error("BackUp out of range");
+        pos_ -= count;
+        last_returned_ -= count;
+    }
+
+    /**
+     * @brief Skips 'count' bytes in O(1) without touching the skipped pages.
+     * @return false (positioned at end of file) if fewer than 'count' bytes remain
+     */
+    bool Skip(size_t count) override {
+        last_returned_ = 0;
+        if (count > size_ - pos_) {
+            pos_ = size_;
+            return false;
+        }
+        pos_ += count;
+        return true;
+    }
+
+    /// Total bytes returned so far, excluding backed-up bytes.
+    int64_t ByteCount() const override { return pos_; }
+
+    /// Start of the mapping (nullptr for an empty file).
+    const uint8_t* data() const { return data_; }
+
+    /// Size of the mapped file in bytes.
+    size_t size() const { return size_; }
+
+private:
+    void ApplyHints() {
+        if (options_.sequential) Advise(0, size_, MADV_SEQUENTIAL);
+        if (options_.will_need) Advise(0, size_, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+        if (options_.huge_pages) Advise(0, size_, MADV_HUGEPAGE);
+#endif
+    }
+
+    /// madvise() over [offset, offset + len) clipped to the mapping.
+    /// The start is rounded down to a page boundary as madvise requires.
+    void Advise(size_t offset, size_t len, int advice) const {
+        if (offset >= size_) return;
+        static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        size_t start = offset & ~(page - 1);
+        size_t end = std::min(size_, offset + len);
+        ::madvise(const_cast<uint8_t*>(data_) + start, end - start, advice);
+    }
+
+    const uint8_t* data_;      // Start of the read-only mapping
+    size_t size_;              // File size in bytes
+    size_t pos_;               // Current read position in the mapping
+    size_t last_returned_;     // Size of the last window returned by Next()
+    MmapOptions options_;      // Window size and kernel hints
+};
+
+#endif // QUARK_POSIX
 
 // ==================
 // Output APIs
@@ -332,7 +575,7 @@ private:
  * memory buffer without allocating additional memory. It is useful for
  * low-latency or high-performance applications where memory copies should be minimized.
  */
-class BufferOutputStream : public ZeroCopyOutputStream {
+class BufferOutputStream final : public ZeroCopyOutputStream {
 public:
 
     /**
@@ -407,8 +650,12 @@ public:
  * Provides zero-copy semantics: callers can write directly into the vector's
  * underlying memory without intermediate buffers or extra copies. This makes it
  * useful for serialization frameworks that expect ZeroCopyOutputStream.
+ *
+ * The vector is taken from the thread's BufferPool and given back, cleared,
+ * on destruction, so a stream per message reuses the previous message's
+ * storage. Move the vector out of buffer() to keep the bytes.
  */
-class VectorOutputStream : public ZeroCopyOutputStream {
+class VectorOutputStream final : public ZeroCopyOutputStream {
 public:
     /**
      * @brief Construct a new VectorOutputStream.
@@ -421,9 +668,12 @@ public:
             size_(0), 
             last_provided_(0), 
             total_(0) { 
-        buf_.reserve(block_size_); 
+        buf_ = quark::BufferPool::TakeVector(block_size_);
     }
 
+    /// Returns the buffer's storage to the thread's BufferPool.
+    ~VectorOutputStream() override { quark::BufferPool::GiveVector(std::move(buf_)); }
+
     /**
      * @brief Provide the caller with a fresh writable block of memory.
      * 
@@ -433,6 +683,10 @@ public:
      */
     bool Next(uint8_t** block, size_t* size) override {
         if (buf_.size() < size_ + block_size_) {
+            if (buf_.capacity() < size_ + block_size_) {
+                CountStat(IoStat::kVectorGrows);
+                CountStat(IoStat::kVectorGrowBytes, size_);
+            }
             buf_.resize(size_ + block_size_);
         }
 
@@ -501,444 +755,3176 @@ private:
     int64_t total_ = 0;         // Total bytes ever provided
 };
 
-// ================================
-// Read and Write APIs for Zero Copy Streams
-// =====================================
-
-static constexpr int kMaxVarint32Bytes = 5;
-static constexpr int kMaxVarint64Bytes = 10;
-
 /**
- * @brief Writes a 32-bit unsigned integer to a ZeroCopyOutputStream using varint encoding.
- *
- * Varint encoding is a variable-length encoding where:
- * - Each byte uses 7 bits to store data.
- * - The most significant bit (MSB) of each byte is a continuation flag:
- *   - 1 -> more bytes follow
- *   - 0 -> last byte of the varint
+ * @class ChainedOutputStream
+ * @brief Output stream that writes into a chain of linked blocks.
  *
- * This encoding is space-efficient for small numbers: values less than 128
- * fit in a single byte.
+ * Unlike VectorOutputStream, blocks are never reallocated, copied or
+ * zero-filled: Next() hands out uninitialized storage, and once the chain is
+ * full a new block, drawn from the thread's BufferPool, is linked on. Block
+ * sizes are either fixed or grow geometrically (doubling) up to a cap. The
+ * written data is exposed as a scatter list that can be passed straight to
+ * writev()/sendmsg().
  *
- * @param out Pointer to the ZeroCopyOutputStream where the varint will be written.
- * @param varint The 32-bit unsigned integer to encode and write.
- * @return true if the write to the output stream succeeded, false otherwise.
+ * WriteAliasedRaw() links the caller's memory into the chain as a block of
+ * its own instead of copying it, so a large payload reaches writev() as a
+ * separate iovec. The block being written is closed first; its spare
+ * capacity sits unused until Clear().
  *
- * @note The maximum number of bytes used for a 32-bit varint is kMaxVarint32Bytes (5 bytes).
+ * Example usage:
+ * ChainedOutputStream out(4096, 1 << 20);
+ * SerializeString(&out, payload);
+ * auto iov = out.iovecs();
+ * ::writev(fd, iov.data(), static_cast<int>(iov.size()));
  */
-inline bool WriteVarint32(ZeroCopyOutputStream* out, uint32_t varint) {
-    uint8_t tmp[kMaxVarint32Bytes];
-    uint8_t* ptr = tmp;
+class ChainedOutputStream final : public ZeroCopyOutputStream {
+public:
+    /**
+     * @brief Construct a new ChainedOutputStream.
+     * @param block_size Size of the first block (minimum 64).
+     * @param max_block_size Cap for geometric growth. If <= block_size,
+     *                       every block has the same size.
+     */
+    explicit ChainedOutputStream(size_t block_size = 8192, size_t max_block_size = 0)
+        :   block_size_(std::max<size_t>(64, block_size)),
+            max_block_size_(std::max(block_size_, max_block_size)),
+            cur_(0),
+            last_provided_(0),
+            total_(0),
+            last_capacity_(0) {}
+
+    /**
+     * @brief Provide the remaining space of the current block, or link a new one.
+     * @param block Pointer to the start of the writable memory (output).
+     * @param size  Size of the writable block in bytes (output).
+     * @return true (allocation failure throws std::bad_alloc).
+     */
+    bool Next(uint8_t** block, size_t* size) override {
+        while (cur_ < blocks_.size() && (blocks_[cur_].closed || blocks_[cur_].used == blocks_[cur_].capacity)) {
+            ++cur_;
+        }
+        if (cur_ == blocks_.size()) {
+            size_t capacity = last_capacity_ == 0
+                ? block_size_
+                : std::min(max_block_size_, last_capacity_ * 2);
+            quark::PooledBuffer storage(capacity);
+            uint8_t* data = storage.get();
+            blocks_.push_back(Block{std::move(storage), data, capacity, 0, false});
+            last_capacity_ = capacity;
+        }
+
+        Block& b = blocks_[cur_];
+        *block = b.data + b.used;
+        *size = b.capacity - b.used;
+        b.used = b.capacity;
+        last_provided_ = *size;
+        total_ += *size;
+        return true;
+    }
 
-    while (varint >= 0x80) {
-        *ptr++ = static_cast<uint8_t>(varint | 0x80);
-        varint >>= 7;
+    /**
+     * @brief Return unused bytes from the most recent Next() call.
+     * @param count Number of bytes to back up (must be <= last block size).
+     * @throws std::runtime_error if count is out of range.
+     */
+    void BackUp(size_t count) override {
+        if (count > last_provided_) throw std::runtime_error("BackUp out of range");
+        if (count == 0) return;
+        blocks_[cur_].used -= count;
+        last_provided_ -= count;
+        total_ -= count;
     }
-    *ptr++ = static_cast<uint8_t>(varint);
 
-    return out->WriteRaw(tmp, ptr - tmp);
-}
+    /// Total number of bytes written, excluding backed-up bytes.
+    int64_t ByteCount() const override { return total_; }
 
-/**
- * @brief Writes a 64-bit unsigned integer to a ZeroCopyOutputStream using varint encoding.
- *
- * Varint encoding is a variable-length encoding where:
- * - Each byte uses 7 bits to store data.
- * - The most significant bit (MSB) of each byte is a continuation flag:
- *   - 1 -> more bytes follow
- *   - 0 -> last byte of the varint
- *
- * This encoding is space-efficient for small numbers: values less than 128
- * fit in a single byte. Larger values may take multiple bytes, up to
- * kMaxVarint64Bytes (10 bytes for a full 64-bit integer).
- *
- * @param out Pointer to the ZeroCopyOutputStream where the varint will be written.
- * @param varint The 64-bit unsigned integer to encode and write.
- * @return true if the write to the output stream succeeded, false otherwise.
- *
- * @note The maximum number of bytes used for a 64-bit varint is kMaxVarint64Bytes (10 bytes).
- */
-inline bool WriteVarint64(ZeroCopyOutputStream* out, uint64_t varint) {
-    uint8_t tmp[kMaxVarint64Bytes];
-    uint8_t* ptr = tmp;
+    /// Aliased writes are linked into the chain, not copied.
+    bool AllowsAliasing() const override { return true; }
 
-    while (varint >= 0x80) {
-        *ptr++ = static_cast<uint8_t>(varint | 0x80);
-        varint >>= 7;
+    /**
+     * @brief Links 'size' bytes of caller memory into the chain as their own
+     *        block. The memory must stay valid and unchanged until the output
+     *        has been consumed or Clear() is called.
+     * @return true
+     */
+    bool WriteAliasedRaw(const void* data, size_t size) override {
+        if (size == 0) return true;
+        Block alias{quark::PooledBuffer(), const_cast<uint8_t*>(static_cast<const uint8_t*>(data)), size, size, true};
+        if (cur_ < blocks_.size() && blocks_[cur_].used > 0) {
+            // later writes must land after the alias, so this block takes no more
+            blocks_[cur_].closed = true;
+            ++cur_;
+        }
+        blocks_.insert(blocks_.begin() + static_cast<ptrdiff_t>(cur_), std::move(alias));
+        last_provided_ = 0;
+        total_ += static_cast<int64_t>(size);
+        return true;
     }
-    *ptr++ = static_cast<uint8_t>(varint);
-
-    return out->WriteRaw(tmp, ptr - tmp);
-}
 
-/**
- * @brief Reads a 32-bit unsigned integer from a ZeroCopyInputStream using varint encoding.
- *
- * Varint encoding stores integers in a variable number of bytes. Each byte
- * contributes 7 bits to the result, and the most significant bit is a
- * continuation flag: 1 if more bytes follow, 0 if this is the last byte.
- *
- * This function reads directly from the current chunk provided by the stream,
- * minimizing calls to Next() and BackUp(). It handles small and multi-byte
- * varints efficiently.
- *
- * @param[in] in Pointer to a ZeroCopyInputStream to read from.
- * @param[out] out_val Reference to a uint32_t where the decoded value will be stored.
- *                     Will be set to 0 if reading fails.
- * @return true if a varint was successfully read; false if the stream ended
- *         before a complete varint could be read.
- */
-inline bool ReadVarint32(ZeroCopyInputStream* in, uint32_t& out_val) {
-    out_val = 0;
-    size_t shift = 0;
+    /**
+     * @brief Discards the written data and any aliased blocks but keeps the
+     *        owned blocks for reuse, so steady-state serialization allocates
+     *        nothing.
+     */
+    void Clear() {
+        std::erase_if(blocks_, [](const Block& b) { return !b.storage; });
+        for (Block& b : blocks_) {
+            b.used = 0;
+            b.closed = false;
+        }
+        cur_ = 0;
+        last_provided_ = 0;
+        total_ = 0;
+    }
 
-    const uint8_t* data = nullptr;
-    size_t size = 0;
-    const uint8_t* ptr = nullptr;
+    /// Number of blocks currently linked into the chain.
+    size_t block_count() const { return blocks_.size(); }
 
-    while (shift < 35) {
-        if (ptr == nullptr || ptr >= data + size) {
-            if (!in->Next(&data, &size)) return false;
-            if (size == 0) continue;
-            ptr = data;
+    /**
+     * @brief Copies the written bytes into 'dst', which must hold ByteCount() bytes.
+     *        Intended for tests and for sinks that need a flat buffer.
+     */
+    void CopyTo(uint8_t* dst) const {
+        for (const Block& b : blocks_) {
+            std::memcpy(dst, b.data, b.used);
+            dst += b.used;
         }
+    }
 
-        uint8_t byte = *ptr++;
-        out_val |= static_cast<uint32_t>(byte & 0x7F) << shift;
-        shift += 7;
+    /**
+     * @brief Appends the written data to 'chunks', one entry per non-empty
+     *        block, without copying. Lets several chains be stitched into one
+     *        scatter list. Valid until the next Next()/BackUp()/Clear().
+     */
+    void AppendChunks(std::vector<MultiBufferInputStream::Chunk>& chunks) const {
+        for (const Block& b : blocks_) {
+            if (b.used == 0) continue;
+            chunks.push_back({b.data, b.used});
+        }
+    }
 
-        if ((byte & 0x80) == 0) {
-            in->BackUp(data + size - ptr);
-            return true;
+#if QUARK_POSIX
+    /**
+     * @brief Returns the written data as a scatter list, one entry per
+     *        non-empty block. Valid until the next Next()/BackUp()/Clear().
+     * @return std::span<const iovec> ready for writev()/sendmsg().
+     */
+    std::span<const iovec> iovecs() const {
+        iov_.clear();
+        for (const Block& b : blocks_) {
+            if (b.used == 0) continue;
+            iov_.push_back(iovec{b.data, b.used});
         }
+        return iov_;
     }
+#endif
+
+private:
+    struct Block {
+        quark::PooledBuffer storage;           // Uninitialized pooled storage; empty for aliased blocks
+        uint8_t* data;                         // storage.get(), or the caller's memory
+        size_t capacity;                       // Allocated or aliased size
+        size_t used;                           // Bytes handed out and not backed up
+        bool closed;                           // No further writes (aliased, or sealed by one)
+    };
+
+    std::vector<Block, quark::PoolAllocator<Block>> blocks_;    // Chain of blocks, in write order
+    size_t block_size_;            // Size of the first block
+    size_t max_block_size_;        // Cap for geometric growth
+    size_t cur_;                   // Index of the block being written
+    size_t last_provided_;         // Bytes provided in last Next() call
+    int64_t total_;                // Total bytes written
+    size_t last_capacity_;         // Size of the last allocated block
+#if QUARK_POSIX
+    mutable std::vector<iovec, quark::PoolAllocator<iovec>> iov_;   // Scratch storage for iovecs()
+#endif
+};
+
+// ================================
+// Coded Streams (buffered cursors)
+// ================================
 
-    return false;
-}
 
 /**
- * @brief Reads a 64-bit unsigned integer from a ZeroCopyInputStream using varint encoding.
+ * @class BasicCodedInputStream
+ * @brief Buffered decoding cursor over an InputStream.
  *
- * Varint encoding stores integers in a variable number of bytes. Each byte
- * contributes 7 bits to the result, and the most significant bit is a
- * continuation flag: 1 if more bytes follow, 0 if this is the last byte.
+ * Holds the current block as a raw [ptr, end) window and decodes primitives
+ * straight out of it with pointer bumps. The underlying stream is only touched
+ * (one virtual Next()) when the window runs out, and the unread tail of the
+ * window is handed back with a single BackUp() when the cursor is destroyed
+ * or BackUpRemaining() is called.
  *
- * This function reads directly from the current chunk provided by the stream,
- * minimizing calls to Next() and BackUp(). It efficiently handles both
- * small and multi-byte varints, supporting full 64-bit integers.
+ * Example usage:
+ * BufferInputStream bis(data, size);
+ * CodedInputStream in(&bis);
+ * uint32_t a; uint64_t b;
+ * in.ReadVarint32(a);
+ * in.ReadFixed64(b);
  *
- * @param[in] in Pointer to a ZeroCopyInputStream to read from.
- * @param[out] out_val Reference to a uint64_t where the decoded value will be stored.
- *                     Will be set to 0 if reading fails.
- * @return true if a varint was successfully read; false if the stream ended
- *         before a complete varint could be read.
+ * Nested data is bounded with a limit stack instead of copying it out:
+ * PushLimit() clips the window so every read stops at the end of the
+ * sub-message, and PopLimit() restores the enclosing bound.
+ *
+ * 'Stream' is the static type of the underlying stream. CodedInputStream
+ * (over ZeroCopyInputStream) works with any stream through virtual calls;
+ * naming a final stream, e.g. BasicCodedInputStream<BufferInputStream>,
+ * removes the vtable from the refill path.
  */
-inline bool ReadVarint64(ZeroCopyInputStream* in, uint64_t& out_val) {
-    out_val = 0;
-    size_t shift = 0;
+template <InputStream Stream>
+class BasicCodedInputStream {
+public:
+    /// Saved enclosing limit, returned by PushLimit() and passed to PopLimit().
+    using Limit = int64_t;
 
-    const uint8_t* data = nullptr;
-    size_t size = 0;
-    const uint8_t* ptr = nullptr;
+    /// Maximum nesting accepted by IncrementRecursionDepth() by default.
+    static constexpr int kDefaultRecursionLimit = 100;
 
-    while (shift < 70) {
-        if (ptr == nullptr || ptr >= data + size) {
-            if (!in->Next(&data, &size)) return false;
-            if (size == 0) continue;
-            ptr = data;
-        }
+    /**
+     * @brief Construct a cursor over an input stream.
+     * @param in Underlying stream; must outlive the cursor.
+     */
+    explicit BasicCodedInputStream(Stream* in)
+        : in_(in), ptr_(nullptr), end_(nullptr), hidden_(0), limit_(kNoLimit),
+          depth_(0), recursion_limit_(kDefaultRecursionLimit) {}
+
+    /// Returns any unread bytes of the current window to the underlying stream.
+    ~BasicCodedInputStream() { BackUpRemaining(); }
+
+    BasicCodedInputStream(const BasicCodedInputStream&) = delete;
+    BasicCodedInputStream& operator=(const BasicCodedInputStream&) = delete;
+
+    /**
+     * @brief Reads a single byte (e.g. a type tag).
+     * @param[out] byte Receives the byte
+     * @return false if the stream is exhausted
+     */
+    bool ReadByte(uint8_t& byte) {
+        if (ptr_ == end_ && !Refresh()) return false;
+        byte = *ptr_++;
+        return true;
+    }
 
-        uint8_t byte = *ptr++;
-        out_val |= static_cast<uint64_t>(byte & 0x7F) << shift;
-        shift += 7;
+    /**
+     * @brief Copies exactly 'size' bytes out of the stream.
+     * @param buffer Destination for the bytes
+     * @param size Number of bytes to read
+     * @return false if the stream ended before 'size' bytes were read
+     */
+    bool ReadRaw(void* buffer, size_t size) {
+        uint8_t* out = static_cast<uint8_t*>(buffer);
+        while (size > 0) {
+            if (ptr_ == end_ && !Refresh()) return false;
+            size_t n = std::min<size_t>(size, end_ - ptr_);
+            std::memcpy(out, ptr_, n);
+            ptr_ += n;
+            out += n;
+            size -= n;
+        }
+        return true;
+    }
 
-        if ((byte & 0x80) == 0) {
-            in->BackUp(data + size - ptr);
+    /**
+     * @brief Skips 'count' bytes, delegating to the underlying stream's Skip()
+     *        once the current window is exhausted.
+     * @param count Number of bytes to skip
+     * @return false if not enough bytes remain
+     */
+    bool Skip(size_t count) {
+        size_t available = end_ - ptr_;
+        if (count <= available) {
+            ptr_ += count;
             return true;
         }
+        if (limit_ != kNoLimit && static_cast<int64_t>(count) > BytesUntilLimit()) {
+            Skip(BytesUntilLimit());
+            return false;
+        }
+        count -= available;
+        ptr_ = end_ = nullptr;
+        return in_->Skip(count);
     }
 
-    return false;
-}
+    /**
+     * @brief Reads a varint-encoded 32-bit value (at most kMaxVarint32Bytes).
+     * @param[out] value Receives the decoded value
+     * @return false on truncated or over-long input
+     */
+    bool ReadVarint32(uint32_t& value) {
+        if (ptr_ < end_ && *ptr_ < 0x80) {
+            value = *ptr_++;
+            CountVarint(1);
+            return true;
+        }
+        return ReadVarint32Slow(value);
+    }
+
+    /**
+     * @brief Reads a varint-encoded 64-bit value (at most kMaxVarint64Bytes).
+     * @param[out] value Receives the decoded value
+     * @return false on truncated or over-long input
+     */
+    bool ReadVarint64(uint64_t& value) {
+        if (ptr_ < end_ && *ptr_ < 0x80) {
+            value = *ptr_++;
+            CountVarint(1);
+            return true;
+        }
+        return ReadVarint64Slow(value);
+    }
+
+    /**
+     * @brief Reads a field tag (see MakeTag()).
+     *
+     * One-byte tags (field numbers below 16) take a single compare. A
+     * malformed tag varint is reported as tag 0, which no field uses, so
+     * SkipField() and generated parsers reject it.
+     *
+     * @param[out] tag Receives the tag
+     * @return false at the end of the stream or the current limit
+     */
+    bool ReadTag(uint32_t& tag) {
+        if (ptr_ == end_ && !Refresh()) return false;
+        if (*ptr_ < 0x80) {
+            tag = *ptr_++;
+            return true;
+        }
+        if (!ReadVarint32Slow(tag)) tag = 0;
+        return true;
+    }
+
+    /**
+     * @brief Reads 'n' consecutive varint32s into 'out'.
+     *
+     * Decodes in bulk (Masked-VByte on SSE4.1, single-load scalar otherwise)
+     * while the window holds enough bytes, and one value at a time across
+     * window edges.
+     *
+     * @param out Destination array with room for 'n' values
+     * @param n Number of values to read
+     * @return false on truncated or malformed input
+     */
+    bool ReadVarint32Batch(uint32_t* out, size_t n) {
+        while (n > 0) {
+            size_t done = DecodeVarint32Batch(ptr_, end_, out, n);
+            out += done;
+            n -= done;
+            if (n == 0) break;
+            if (!ReadVarint32(*out)) return false;
+            ++out;
+            --n;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Reads a little-endian 32-bit value.
+     *
+     * One unaligned load when the value fits in the current window; otherwise
+     * the bytes are stitched across as many chunks as they span.
+     *
+     * @param[out] value Receives the decoded value
+     * @return false if fewer than 4 bytes remain
+     */
+    bool ReadFixed32(uint32_t& value) {
+        if (end_ - ptr_ >= 4) {
+            value = LoadLittleEndian32(ptr_);
+            ptr_ += 4;
+            return true;
+        }
+        return ReadFixed32Slow(value);
+    }
+
+    /**
+     * @brief Reads a little-endian 64-bit value.
+     *
+     * One unaligned load when the value fits in the current window; otherwise
+     * the bytes are stitched across as many chunks as they span.
+     *
+     * @param[out] value Receives the decoded value
+     * @return false if fewer than 8 bytes remain
+     */
+    bool ReadFixed64(uint64_t& value) {
+        if (end_ - ptr_ >= 8) {
+            value = LoadLittleEndian64(ptr_);
+            ptr_ += 8;
+            return true;
+        }
+        return ReadFixed64Slow(value);
+    }
+
+    /**
+     * @brief Returns a view of 'size' bytes if they are contiguous in the
+     *        current window, consuming them. Does not refill a window that
+     *        is too short.
+     * @param size Number of bytes wanted
+     * @param[out] out Receives the view on success
+     * @return false if the bytes are not contiguous in the current window
+     */
+    bool ReadAliased(size_t size, std::span<const uint8_t>& out) {
+        if (ptr_ == end_) Refresh();
+        if (static_cast<size_t>(end_ - ptr_) < size) return false;
+        out = std::span<const uint8_t>(ptr_, size);
+        ptr_ += size;
+        return true;
+    }
+
+    /**
+     * @brief Reads 'size' bytes as a view that keeps its memory alive: a
+     *        reference to the block's owner when the bytes are contiguous and
+     *        the stream can pin (see ZeroCopyInputStream::BlockOwner()),
+     *        otherwise a private copy.
+     * @param size Number of bytes wanted
+     * @param[out] out Receives the view on success
+     * @return false if the stream ended first
+     */
+    bool ReadPinned(size_t size, quark::PinnedView& out) {
+        std::span<const uint8_t> bytes;
+        if (ReadAliased(size, bytes)) {
+            std::string_view view(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+            if constexpr (requires { in_->BlockOwner(); }) {
+                if (std::shared_ptr<const void> owner = in_->BlockOwner()) {
+                    CountStat(IoStat::kBytesAliased, size);
+                    out = quark::PinnedView(view, std::move(owner));
+                    return true;
+                }
+            }
+            CountStat(IoStat::kSpillCopies);
+            CountStat(IoStat::kBytesCopied, size);
+            out = quark::PinnedView::Copy(view);
+            return true;
+        }
+        if (limit_ != kNoLimit && static_cast<int64_t>(size) > BytesUntilLimit()) return false;
+        CountStat(IoStat::kSpillCopies);
+        CountStat(IoStat::kBytesCopied, size);
+        auto copy = std::make_shared<std::string>(size, '\0');
+        if (!ReadRaw(copy->data(), size)) return false;
+        std::string_view view = *copy;
+        out = quark::PinnedView(view, std::move(copy));
+        return true;
+    }
+
+    /**
+     * @brief Pushes the unread tail of the current window back to the
+     *        underlying stream so it can be used directly again.
+     */
+    void BackUpRemaining() {
+        size_t unread = (end_ - ptr_) + hidden_;
+        if (unread != 0) in_->BackUp(unread);
+        ptr_ = end_ = nullptr;
+        hidden_ = 0;
+    }
+
+    /**
+     * @brief Bounds all further reads to the next 'byte_limit' bytes.
+     *
+     * Reads past the limit fail as if the stream had ended there, so a
+     * nested message can be decoded in place. A limit never extends past an
+     * enclosing one.
+     *
+     * @param byte_limit Number of bytes readable until PopLimit()
+     * @return The enclosing limit, to be passed to PopLimit()
+     */
+    Limit PushLimit(size_t byte_limit) {
+        Limit old = limit_;
+        int64_t pos = ByteCount();
+        if (byte_limit <= static_cast<size_t>(std::numeric_limits<int64_t>::max() - pos)) {
+            limit_ = std::min(old, pos + static_cast<int64_t>(byte_limit));
+        }
+        ApplyLimit();
+        return old;
+    }
+
+    /**
+     * @brief Restores the limit that was in force before the matching PushLimit().
+     * @param old Value returned by that PushLimit()
+     */
+    void PopLimit(Limit old) {
+        end_ += hidden_;
+        hidden_ = 0;
+        limit_ = old;
+        ApplyLimit();
+    }
+
+    /// Bytes left before the current limit, or -1 if no limit is set.
+    int64_t BytesUntilLimit() const {
+        if (limit_ == kNoLimit) return -1;
+        return limit_ - ByteCount();
+    }
+
+    /**
+     * @brief Enters one level of nesting.
+     * @return false if the recursion limit is exceeded (malicious or corrupt input)
+     */
+    bool IncrementRecursionDepth() { return ++depth_ <= recursion_limit_; }
+
+    /// Leaves one level of nesting entered with IncrementRecursionDepth().
+    void DecrementRecursionDepth() { --depth_; }
+
+    /// Sets the maximum nesting depth (kDefaultRecursionLimit by default).
+    void SetRecursionLimit(int limit) { recursion_limit_ = limit; }
+
+    /**
+     * @brief Exposes the current window without consuming it, fetching a new
+     *        block first if the window is empty. Consume with Skip().
+     * @param[out] data Start of the unread window
+     * @param[out] size Bytes available at 'data'
+     * @return false if the stream is exhausted
+     */
+    bool GetDirectBufferPointer(const uint8_t** data, size_t* size) {
+        if (ptr_ == end_ && !Refresh()) return false;
+        *data = ptr_;
+        *size = end_ - ptr_;
+        return true;
+    }
+
+    /**
+     * @brief Consumes 'size' contiguous bytes from the current window for the
+     *        caller to decode directly, fetching a new block first if the
+     *        window is empty. The window never extends past the current limit.
+     * @param size Number of bytes wanted
+     * @return Pointer to the bytes, or nullptr if the window does not hold
+     *         them (nothing is consumed; fall back to the Read* calls)
+     */
+    const uint8_t* GetDirectBufferForNBytesAndAdvance(size_t size) {
+        if (ptr_ == end_ && !Refresh()) return nullptr;
+        if (static_cast<size_t>(end_ - ptr_) < size) return nullptr;
+        const uint8_t* p = ptr_;
+        ptr_ += size;
+        return p;
+    }
+
+    /// Number of bytes left in the current window.
+    size_t BufferSize() const { return end_ - ptr_; }
+
+    /// Total bytes consumed through this cursor and the underlying stream.
+    int64_t ByteCount() const { return in_->ByteCount() - (end_ - ptr_) - hidden_; }
+
+private:
+    static constexpr int64_t kNoLimit = std::numeric_limits<int64_t>::max();
+
+    /// Fetches the next non-empty block. Only valid when the window is empty.
+    /// Fails without touching the underlying stream once the limit is reached.
+    bool Refresh() {
+        if (hidden_ > 0) return false;
+        if (limit_ != kNoLimit && in_->ByteCount() >= limit_) return false;
+        const uint8_t* data;
+        size_t size;
+        do {
+            if (!in_->Next(&data, &size)) {
+                ptr_ = end_ = nullptr;
+                return false;
+            }
+        } while (size == 0);
+        ptr_ = data;
+        end_ = data + size;
+        CountStat(IoStat::kInputRefills);
+        CountStat(IoStat::kInputRefillBytes, size);
+        if (limit_ != kNoLimit) ApplyLimit();
+        return true;
+    }
+
+    /// Clips the window so it ends at the current limit. The clipped bytes
+    /// stay owned by the window (hidden_) until PopLimit() or BackUpRemaining().
+    void ApplyLimit() {
+        const uint8_t* real_end = end_ + hidden_;
+        int64_t real_end_pos = in_->ByteCount();
+        int64_t over = real_end_pos - limit_;
+        if (limit_ == kNoLimit || over <= 0) {
+            end_ = real_end;
+            hidden_ = 0;
+            return;
+        }
+        hidden_ = std::min<size_t>(static_cast<size_t>(over), real_end - ptr_);
+        end_ = real_end - hidden_;
+    }
+
+    bool ReadFixed32Slow(uint32_t& value) {
+        uint8_t tmp[4];
+        if (!ReadRaw(tmp, 4)) return false;
+        value = LoadLittleEndian32(tmp);
+        return true;
+    }
+
+    bool ReadFixed64Slow(uint64_t& value) {
+        uint8_t tmp[8];
+        if (!ReadRaw(tmp, 8)) return false;
+        value = LoadLittleEndian64(tmp);
+        return true;
+    }
+
+    /// Single-load branchless decode when 8 bytes are left in the window,
+    /// byte-by-byte across refills otherwise.
+    bool ReadVarint32Slow(uint32_t& value) {
+        if (end_ - ptr_ >= 8) {
+            const uint8_t* next = DecodeVarint32Unchecked(ptr_, value);
+            if (next == nullptr) return false;
+            CountVarint(next - ptr_);
+            ptr_ = next;
+            return true;
+        }
+        uint64_t tmp;
+        if (!ReadVarintBytewise(tmp, kMaxVarint32Bytes)) return false;
+        value = static_cast<uint32_t>(tmp);
+        return true;
+    }
+
+    /// Single-load branchless decode when kMaxVarint64Bytes are left in the
+    /// window, byte-by-byte across refills otherwise.
+    bool ReadVarint64Slow(uint64_t& value) {
+        if (end_ - ptr_ >= kMaxVarint64Bytes) {
+            const uint8_t* next = DecodeVarint64Unchecked(ptr_, value);
+            if (next == nullptr) return false;
+            CountVarint(next - ptr_);
+            ptr_ = next;
+            return true;
+        }
+        return ReadVarintBytewise(value, kMaxVarint64Bytes);
+    }
+
+    /// Decodes up to 'max_bytes' varint bytes one at a time, refilling the
+    /// window as needed. Only used near window edges.
+    bool ReadVarintBytewise(uint64_t& value, int max_bytes) {
+        uint64_t result = 0;
+        for (int i = 0; i < max_bytes; ++i) {
+            uint8_t byte;
+            if (!ReadByte(byte)) return false;
+            result |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+            if ((byte & 0x80) == 0) {
+                value = result;
+                CountVarint(i + 1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Stream* in_;                // Underlying stream
+    const uint8_t* ptr_;        // Next unread byte of the current window
+    const uint8_t* end_;        // One past the last byte of the current window (clipped to the limit)
+    size_t hidden_;             // Window bytes past end_ hidden by the current limit
+    int64_t limit_;             // Absolute ByteCount() at which reads stop, or kNoLimit
+    int depth_;                 // Current nesting depth
+    int recursion_limit_;       // Maximum nesting depth
+};
+
+/// Type-erased cursor over any ZeroCopyInputStream.
+using CodedInputStream = BasicCodedInputStream<ZeroCopyInputStream>;
+
+/// Smallest payload worth aliasing; shorter ones are cheaper to copy than
+/// to give their own block (and iovec).
+static constexpr size_t kMinAliasedSize = 1024;
+
+/**
+ * @class BasicCodedOutputStream
+ * @brief Buffered encoding cursor over an OutputStream.
+ *
+ * Holds the current writable block as a raw [ptr, end) window and encodes
+ * primitives directly into it. A new block is requested from the underlying
+ * stream only when the window is full, and the unused tail is returned with
+ * a single BackUp() on Trim() or destruction.
+ *
+ * As with BasicCodedInputStream, 'Stream' is the static type of the
+ * underlying stream; CodedOutputStream is the type-erased instantiation.
+ */
+template <OutputStream Stream>
+class BasicCodedOutputStream {
+public:
+    /**
+     * @brief Construct a cursor over an output stream.
+     * @param out Underlying stream; must outlive the cursor.
+     */
+    explicit BasicCodedOutputStream(Stream* out)
+        : out_(out), ptr_(nullptr), end_(nullptr), had_error_(false), aliasing_(false) {}
+
+    /// Returns the unused part of the current window to the underlying stream.
+    ~BasicCodedOutputStream() { Trim(); }
+
+    BasicCodedOutputStream(const BasicCodedOutputStream&) = delete;
+    BasicCodedOutputStream& operator=(const BasicCodedOutputStream&) = delete;
+
+    /**
+     * @brief Writes a single byte (e.g. a type tag).
+     * @param byte The byte to write
+     * @return false if the underlying stream is out of space
+     */
+    bool WriteByte(uint8_t byte) {
+        if (ptr_ == end_ && !Refresh()) return false;
+        *ptr_++ = byte;
+        return true;
+    }
+
+    /**
+     * @brief Copies 'size' bytes into the stream, crossing blocks as needed.
+     * @param src Pointer to the bytes to write
+     * @param size Number of bytes to write
+     * @return false if the underlying stream is out of space
+     */
+    bool WriteRaw(const void* src, size_t size) {
+        const uint8_t* in = static_cast<const uint8_t*>(src);
+        while (size > 0) {
+            if (ptr_ == end_ && !Refresh()) return false;
+            size_t n = std::min<size_t>(size, end_ - ptr_);
+            std::memcpy(ptr_, in, n);
+            ptr_ += n;
+            in += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Writes 'size' bytes by reference if the stream allows aliasing
+     *        (see ZeroCopyOutputStream::AllowsAliasing()), else copies them.
+     *
+     * An aliased write ends the current window. The bytes must stay valid
+     * and unchanged until the stream's output has been consumed.
+     *
+     * @return false if the underlying stream is out of space
+     */
+    bool WriteAliased(const void* data, size_t size) {
+        if constexpr (requires { out_->AllowsAliasing(); out_->WriteAliasedRaw(data, size); }) {
+            if (out_->AllowsAliasing()) {
+                Trim();
+                if (out_->WriteAliasedRaw(data, size)) return true;
+                had_error_ = true;
+                return false;
+            }
+        }
+        return WriteRaw(data, size);
+    }
+
+    /**
+     * @brief Lets string and bytes payloads of at least kMinAliasedSize bytes
+     *        be written with WriteAliased(). Off by default: enabling it means
+     *        the fields being serialized must outlive the stream's output.
+     *        A message that fits the current window is still copied whole.
+     */
+    void EnableAliasing(bool enabled) { aliasing_ = enabled; }
+
+    /// True if a payload of 'size' bytes would be aliased by WriteRawMaybeAliased().
+    bool ShouldAlias(size_t size) const {
+        if constexpr (requires { out_->AllowsAliasing(); }) {
+            return aliasing_ && size >= kMinAliasedSize && out_->AllowsAliasing();
+        } else {
+            return false;
+        }
+    }
+
+    /// WriteAliased() if ShouldAlias(size), otherwise WriteRaw().
+    bool WriteRawMaybeAliased(const void* data, size_t size) {
+        if (ShouldAlias(size)) {
+            CountStat(IoStat::kAliasedWrites);
+            CountStat(IoStat::kAliasedWriteBytes, size);
+            return WriteAliased(data, size);
+        }
+        return WriteRaw(data, size);
+    }
+
+    /**
+     * @brief Writes a 32-bit value using varint encoding.
+     * @param value The value to encode
+     * @return false if the underlying stream is out of space
+     */
+    bool WriteVarint32(uint32_t value) {
+        if (end_ - ptr_ >= kMaxVarint32Bytes) {
+            ptr_ = EncodeVarint(ptr_, value);
+            return true;
+        }
+        uint8_t tmp[kMaxVarint32Bytes];
+        return WriteRaw(tmp, EncodeVarint(tmp, value) - tmp);
+    }
+
+    /**
+     * @brief Writes a 64-bit value using varint encoding.
+     * @param value The value to encode
+     * @return false if the underlying stream is out of space
+     */
+    bool WriteVarint64(uint64_t value) {
+        if (end_ - ptr_ >= kMaxVarint64Bytes) {
+            ptr_ = EncodeVarint(ptr_, value);
+            return true;
+        }
+        uint8_t tmp[kMaxVarint64Bytes];
+        return WriteRaw(tmp, EncodeVarint(tmp, value) - tmp);
+    }
+
+    /**
+     * @brief Writes a 32-bit value in little-endian order.
+     * @param value The value to write
+     * @return false if the underlying stream is out of space
+     */
+    bool WriteFixed32(uint32_t value) {
+        if (end_ - ptr_ >= 4) {
+            StoreLittleEndian32(ptr_, value);
+            ptr_ += 4;
+            return true;
+        }
+        uint8_t tmp[4];
+        StoreLittleEndian32(tmp, value);
+        return WriteRaw(tmp, 4);
+    }
+
+    /**
+     * @brief Writes a field tag (see MakeTag()).
+     * @param tag The tag to write
+     * @return false if the underlying stream is out of space
+     */
+    bool WriteTag(uint32_t tag) {
+        if (ptr_ < end_ && tag < 0x80) {
+            *ptr_++ = static_cast<uint8_t>(tag);
+            return true;
+        }
+        return WriteVarint32(tag);
+    }
+
+    /**
+     * @brief Writes a 64-bit value in little-endian order.
+     * @param value The value to write
+     * @return false if the underlying stream is out of space
+     */
+    bool WriteFixed64(uint64_t value) {
+        if (end_ - ptr_ >= 8) {
+            StoreLittleEndian64(ptr_, value);
+            ptr_ += 8;
+            return true;
+        }
+        uint8_t tmp[8];
+        StoreLittleEndian64(tmp, value);
+        return WriteRaw(tmp, 8);
+    }
+
+    /**
+     * @brief Backs up the unused tail of the current window so the
+     *        underlying stream reflects exactly what was written.
+     */
+    void Trim() {
+        if (end_ != ptr_) out_->BackUp(end_ - ptr_);
+        ptr_ = end_ = nullptr;
+    }
+
+    /**
+     * @brief Reserves 'size' contiguous bytes in the current window for the
+     *        caller to fill directly, fetching a new block first if the
+     *        window is empty.
+     * @param size Number of bytes wanted
+     * @return Pointer to the reserved bytes, or nullptr if the window cannot
+     *         hold them (nothing is consumed; fall back to the Write* calls)
+     */
+    uint8_t* GetDirectBufferForNBytesAndAdvance(size_t size) {
+        if (ptr_ == end_ && !Refresh()) return nullptr;
+        if (static_cast<size_t>(end_ - ptr_) < size) return nullptr;
+        uint8_t* p = ptr_;
+        ptr_ += size;
+        return p;
+    }
+
+    /// True if a write failed because the underlying stream ran out of space.
+    bool HadError() const { return had_error_; }
+
+    /// Total bytes written through this cursor and the underlying stream.
+    int64_t ByteCount() const { return out_->ByteCount() - (end_ - ptr_); }
+
+    /**
+     * @brief Encodes a varint into 'target', which must have room for it.
+     * @return Pointer one past the last byte written
+     */
+    template <typename T>
+    static uint8_t* EncodeVarint(uint8_t* target, T value) {
+        while (value >= 0x80) {
+            *target++ = static_cast<uint8_t>(value | 0x80);
+            value >>= 7;
+        }
+        *target++ = static_cast<uint8_t>(value);
+        return target;
+    }
+
+private:
+    /// Obtains the next writable block. Only valid when the window is full.
+    bool Refresh() {
+        uint8_t* data;
+        size_t size;
+        do {
+            if (!out_->Next(&data, &size)) {
+                ptr_ = end_ = nullptr;
+                had_error_ = true;
+                return false;
+            }
+        } while (size == 0);
+        ptr_ = data;
+        end_ = data + size;
+        CountStat(IoStat::kOutputRefills);
+        return true;
+    }
+
+    Stream* out_;               // Underlying stream
+    uint8_t* ptr_;              // Next writable byte of the current window
+    uint8_t* end_;              // One past the last byte of the current window
+    bool had_error_;            // Set once Next() has failed
+    bool aliasing_;             // Set by EnableAliasing()
+};
+
+/// Type-erased cursor over any ZeroCopyOutputStream.
+using CodedOutputStream = BasicCodedOutputStream<ZeroCopyOutputStream>;
+
+// ================================
+// Read and Write APIs for Zero Copy Streams
+// =====================================
+//
+// Every primitive has two overloads: one taking a Coded{Input,Output}Stream
+// cursor (the fast path, for sequences of values), and one taking the raw
+// stream, which wraps a temporary cursor around a single value. Both are
+// templates over the stream type, so passing a concrete stream (or a cursor
+// over one) keeps the whole call chain free of virtual dispatch.
+
+/**
+ * @brief Writes a 32-bit unsigned integer to a ZeroCopyOutputStream using varint encoding.
+ *
+ * Varint encoding is a variable-length encoding where:
+ * - Each byte uses 7 bits to store data.
+ * - The most significant bit (MSB) of each byte is a continuation flag:
+ *   - 1 -> more bytes follow
+ *   - 0 -> last byte of the varint
+ *
+ * This encoding is space-efficient for small numbers: values less than 128
+ * fit in a single byte.
+ *
+ * @param out Pointer to the ZeroCopyOutputStream where the varint will be written.
+ * @param varint The 32-bit unsigned integer to encode and write.
+ * @return true if the write to the output stream succeeded, false otherwise.
+ *
+ * @note The maximum number of bytes used for a 32-bit varint is kMaxVarint32Bytes (5 bytes).
+ */
+template <typename S>
+inline bool WriteVarint32(BasicCodedOutputStream<S>* out, uint32_t varint) {
+    return out->WriteVarint32(varint);
+}
+
+template <OutputStream S>
+inline bool WriteVarint32(S* out, uint32_t varint) {
+    BasicCodedOutputStream<S> coded(out);
+    return WriteVarint32(&coded, varint);
+}
+
+/**
+ * @brief Writes a 64-bit unsigned integer to a ZeroCopyOutputStream using varint encoding.
+ *
+ * Varint encoding is a variable-length encoding where:
+ * - Each byte uses 7 bits to store data.
+ * - The most significant bit (MSB) of each byte is a continuation flag:
+ *   - 1 -> more bytes follow
+ *   - 0 -> last byte of the varint
+ *
+ * This encoding is space-efficient for small numbers: values less than 128
+ * fit in a single byte. Larger values may take multiple bytes, up to
+ * kMaxVarint64Bytes (10 bytes for a full 64-bit integer).
+ *
+ * @param out Pointer to the ZeroCopyOutputStream where the varint will be written.
+ * @param varint The 64-bit unsigned integer to encode and write.
+ * @return true if the write to the output stream succeeded, false otherwise.
+ *
+ * @note The maximum number of bytes used for a 64-bit varint is kMaxVarint64Bytes (10 bytes).
+ */
+template <typename S>
+inline bool WriteVarint64(BasicCodedOutputStream<S>* out, uint64_t varint) {
+    return out->WriteVarint64(varint);
+}
+
+template <OutputStream S>
+inline bool WriteVarint64(S* out, uint64_t varint) {
+    BasicCodedOutputStream<S> coded(out);
+    return WriteVarint64(&coded, varint);
+}
+
+/**
+ * @brief Reads a 32-bit unsigned integer from a ZeroCopyInputStream using varint encoding.
+ *
+ * Varint encoding stores integers in a variable number of bytes. Each byte
+ * contributes 7 bits to the result, and the most significant bit is a
+ * continuation flag: 1 if more bytes follow, 0 if this is the last byte.
+ *
+ * This function reads directly from the current chunk provided by the stream,
+ * minimizing calls to Next() and BackUp(). It handles small and multi-byte
+ * varints efficiently.
+ *
+ * @param[in] in Pointer to a ZeroCopyInputStream to read from.
+ * @param[out] out_val Reference to a uint32_t where the decoded value will be stored.
+ *                     Will be set to 0 if reading fails.
+ * @return true if a varint was successfully read; false if the stream ended
+ *         before a complete varint could be read.
+ */
+template <typename S>
+inline bool ReadVarint32(BasicCodedInputStream<S>* in, uint32_t& out_val) {
+    out_val = 0;
+    return in->ReadVarint32(out_val);
+}
+
+template <InputStream S>
+inline bool ReadVarint32(S* in, uint32_t& out_val) {
+    BasicCodedInputStream<S> coded(in);
+    return ReadVarint32(&coded, out_val);
+}
+
+/**
+ * @brief Reads 'n' consecutive varint32s from the stream into 'out'.
+ *
+ * Equivalent to calling ReadVarint32 'n' times, but decodes many values per
+ * step with SIMD shuffle tables where available, with a scalar fallback.
+ *
+ * @param in Stream or cursor to read from.
+ * @param out Destination array with room for 'n' values.
+ * @param n Number of values to read.
+ * @return true if all 'n' values were read.
+ */
+template <typename S>
+inline bool ReadVarint32Batch(BasicCodedInputStream<S>* in, uint32_t* out, size_t n) {
+    return in->ReadVarint32Batch(out, n);
+}
+
+template <InputStream S>
+inline bool ReadVarint32Batch(S* in, uint32_t* out, size_t n) {
+    BasicCodedInputStream<S> coded(in);
+    return ReadVarint32Batch(&coded, out, n);
+}
+
+/**
+ * @brief Reads a 64-bit unsigned integer from a ZeroCopyInputStream using varint encoding.
+ *
+ * Varint encoding stores integers in a variable number of bytes. Each byte
+ * contributes 7 bits to the result, and the most significant bit is a
+ * continuation flag: 1 if more bytes follow, 0 if this is the last byte.
+ *
+ * This function reads directly from the current chunk provided by the stream,
+ * minimizing calls to Next() and BackUp(). It efficiently handles both
+ * small and multi-byte varints, supporting full 64-bit integers.
+ *
+ * @param[in] in Pointer to a ZeroCopyInputStream to read from.
+ * @param[out] out_val Reference to a uint64_t where the decoded value will be stored.
+ *                     Will be set to 0 if reading fails.
+ * @return true if a varint was successfully read; false if the stream ended
+ *         before a complete varint could be read.
+ */
+template <typename S>
+inline bool ReadVarint64(BasicCodedInputStream<S>* in, uint64_t& out_val) {
+    out_val = 0;
+    return in->ReadVarint64(out_val);
+}
+
+template <InputStream S>
+inline bool ReadVarint64(S* in, uint64_t& out_val) {
+    BasicCodedInputStream<S> coded(in);
+    return ReadVarint64(&coded, out_val);
+}
+
+/**
+ * @brief Writes a 32-bit unsigned integer in little-endian order to a ZeroCopyOutputStream.
+ *
+ * Each byte of the integer is written in order from least-significant to most-significant.
+ * This ensures cross-platform consistency regardless of host endianness.
+ *
+ * @param out Pointer to the ZeroCopyOutputStream where the data will be written.
+ * @param v The 32-bit unsigned integer value to write.
+ * @return true if the write succeeded, false otherwise.
+ */
+template <typename S>
+inline bool WriteFixed32(BasicCodedOutputStream<S>* out, uint32_t v) {
+    return out->WriteFixed32(v);
+}
+
+template <OutputStream S>
+inline bool WriteFixed32(S* out, uint32_t v) {
+    BasicCodedOutputStream<S> coded(out);
+    return WriteFixed32(&coded, v);
+}
+
+/**
+ * @brief Writes a 64-bit unsigned integer in little-endian order to a ZeroCopyOutputStream.
+ *
+ * Each byte of the integer is written in order from least-significant to most-significant.
+ * This ensures cross-platform consistency regardless of host endianness.
+ *
+ * @param out Pointer to the ZeroCopyOutputStream where the data will be written.
+ * @param v The 64-bit unsigned integer value to write.
+ * @return true if the write succeeded, false otherwise.
+ */
+template <typename S>
+inline bool WriteFixed64(BasicCodedOutputStream<S>* out, uint64_t v) {
+    return out->WriteFixed64(v);
+}
+
+template <OutputStream S>
+inline bool WriteFixed64(S* out, uint64_t v) {
+    BasicCodedOutputStream<S> coded(out);
+    return WriteFixed64(&coded, v);
+}
+
+/**
+ * @brief Reads a 32-bit fixed-size unsigned integer from the input stream.
+ * 
+ * This function reads exactly 4 bytes from the provided ZeroCopyInputStream
+ * and reconstructs a little-endian 32-bit unsigned integer. The bytes may
+ * span any number of chunks, so fragmented input does not need coalescing.
+ * 
+ * @param[in,out] in Pointer to the ZeroCopyInputStream to read from.
+ * @param[out] v Reference to a uint32_t where the result will be stored.
+ * 
+ * @return true if 4 bytes were successfully read and decoded.
+ * @return false if there were fewer than 4 bytes available in the stream.
+ */
+template <typename S>
+inline bool ReadFixed32(BasicCodedInputStream<S>* in, uint32_t &v) {
+    return in->ReadFixed32(v);
+}
+
+template <InputStream S>
+inline bool ReadFixed32(S* in, uint32_t &v) {
+    BasicCodedInputStream<S> coded(in);
+    return ReadFixed32(&coded, v);
+}
+
+/**
+ * @brief Reads a 64-bit fixed-size unsigned integer from the input stream.
+ * 
+ * This function reads exactly 8 bytes from the provided ZeroCopyInputStream
+ * and reconstructs a little-endian 64-bit unsigned integer. The bytes may
+ * span any number of chunks, so fragmented input does not need coalescing.
+ * 
+ * @param[in,out] in Pointer to the ZeroCopyInputStream to read from.
+ * @param[out] v Reference to a uint64_t where the result will be stored.
+ * 
+ * @return true if 8 bytes were successfully read and decoded.
+ * @return false if there were fewer than 8 bytes available in the stream.
+ */
+template <typename S>
+inline bool ReadFixed64(BasicCodedInputStream<S>* in, uint64_t &v) {
+    return in->ReadFixed64(v);
+}
+
+template <InputStream S>
+inline bool ReadFixed64(S* in, uint64_t &v) {
+    BasicCodedInputStream<S> coded(in);
+    return ReadFixed64(&coded, v);
+}
+
+/**
+ * @brief Writes a length-delimited byte array to the output stream.
+ * 
+ * This function first writes the length of the data as a varint (32-bit), 
+ * then writes the raw bytes themselves. This is useful for writing strings 
+ * or arbitrary binary blobs in a zero-copy, protobuf-style format.
+ * 
+ * @param out Pointer to the ZeroCopyOutputStream to write to.
+ * @param data Pointer to the byte array to write.
+ * @param len Length of the byte array.
+ * @return true if the length and data were successfully written; false otherwise.
+ */
+template <typename S>
+inline bool WriteLengthDelimitedBytes(BasicCodedOutputStream<S>* out, const uint8_t* data, size_t len) {
+    if (!out->WriteVarint32(static_cast<uint32_t>(len))) return false;
+    return out->WriteRawMaybeAliased(data, len);
+}
+
+template <OutputStream S>
+inline bool WriteLengthDelimitedBytes(S* out, const uint8_t* data, size_t len) {
+    BasicCodedOutputStream<S> coded(out);
+    return WriteLengthDelimitedBytes(&coded, data, len);
+}
+
+/**
+ * @brief Reads a length-delimited byte sequence from the input stream.
+ * @param in The input stream to read from.
+ * @param out Span that will point to the read bytes.
+ * @param persistent_buffer Optional buffer to hold data if not contiguous.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool ReadLengthDelimitedBytes(BasicCodedInputStream<S>* in,  std::span<const uint8_t>& out, std::shared_ptr<std::vector<uint8_t>>& persistent_buffer) {
+    uint32_t length;
+    if (!in->ReadVarint32(length)) return false;
+    int64_t limit = in->BytesUntilLimit();
+    if (limit >= 0 && length > limit) return false;
+
+    if (in->ReadAliased(length, out)) {
+        CountStat(IoStat::kBytesAliased, length);
+        persistent_buffer.reset();
+        return true;
+    }
+
+    CountStat(IoStat::kSpillCopies);
+    CountStat(IoStat::kBytesCopied, length);
+    persistent_buffer = std::make_shared<std::vector<uint8_t>>(length);
+    if (!in->ReadRaw(persistent_buffer->data(), length)) return false;
+
+    out = std::span<const uint8_t>(persistent_buffer->data(), length);
+    return true;
+}
+
+template <InputStream S>
+inline bool ReadLengthDelimitedBytes(S* in,  std::span<const uint8_t>& out, std::shared_ptr<std::vector<uint8_t>>& persistent_buffer) {
+    BasicCodedInputStream<S> coded(in);
+    return ReadLengthDelimitedBytes(&coded, out, persistent_buffer);
+}
+
+/**
+ * @brief Reads a length-delimited byte sequence, spilling into an arena.
+ *
+ * If the bytes are contiguous in the current chunk, 'out' points into the
+ * input. Otherwise they are stitched with a single copy into 'arena' and
+ * 'out' points there, valid until the arena is reset.
+ *
+ * @param in The input stream to read from.
+ * @param out Span that will point to the read bytes.
+ * @param arena Arena that receives the bytes if they are not contiguous.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool ReadLengthDelimitedBytes(BasicCodedInputStream<S>* in, std::span<const uint8_t>& out, quark::Arena* arena) {
+    uint32_t length;
+    if (!in->ReadVarint32(length)) return false;
+    int64_t limit = in->BytesUntilLimit();
+    if (limit >= 0 && length > limit) return false;
+
+    if (in->ReadAliased(length, out)) {
+        CountStat(IoStat::kBytesAliased, length);
+        return true;
+    }
+
+    CountStat(IoStat::kSpillCopies);
+    CountStat(IoStat::kBytesCopied, length);
+    uint8_t* dst = arena->AllocateArray<uint8_t>(length);
+    if (!in->ReadRaw(dst, length)) return false;
+
+    out = std::span<const uint8_t>(dst, length);
+    return true;
+}
+
+template <InputStream S>
+inline bool ReadLengthDelimitedBytes(S* in, std::span<const uint8_t>& out, quark::Arena* arena) {
+    BasicCodedInputStream<S> coded(in);
+    return ReadLengthDelimitedBytes(&coded, out, arena);
+}
+
+/**
+ * @brief Reads a length-delimited byte sequence as a pinned view.
+ *
+ * If the input chunk carries an owner, 'out' points into it and holds a
+ * reference; otherwise 'out' owns a copy. Either way it stays valid after
+ * the stream and its chunks are gone.
+ *
+ * @param in The input stream to read from.
+ * @param out Receives the bytes.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool ReadLengthDelimitedBytes(BasicCodedInputStream<S>* in, quark::PinnedView& out) {
+    uint32_t length;
+    if (!in->ReadVarint32(length)) return false;
+    return in->ReadPinned(length, out);
+}
+
+template <InputStream S>
+inline bool ReadLengthDelimitedBytes(S* in, quark::PinnedView& out) {
+    BasicCodedInputStream<S> coded(in);
+    return ReadLengthDelimitedBytes(&coded, out);
+}
+
+/**
+ * @brief Reads a length-delimited byte sequence into 'str' with one copy.
+ *
+ * The length is checked against the current limit (if any) before 'str' is
+ * resized, so a corrupt length cannot trigger a huge allocation inside a
+ * bounded sub-message.
+ *
+ * @param in The input stream to read from.
+ * @param str Receives the bytes.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool ReadLengthDelimitedString(BasicCodedInputStream<S>* in, std::string& str) {
+    uint32_t length;
+    if (!in->ReadVarint32(length)) return false;
+    int64_t limit = in->BytesUntilLimit();
+    if (limit >= 0 && length > limit) return false;
+    str.resize(length);
+    return in->ReadRaw(str.data(), length);
+}
+
+template <InputStream S>
+inline bool ReadLengthDelimitedString(S* in, std::string& str) {
+    BasicCodedInputStream<S> coded(in);
+    return ReadLengthDelimitedString(&coded, str);
+}
+
+/**
+ * @brief Writes a packed array of fixed-width values: varint byte length,
+ *        then the values as raw little-endian words.
+ *
+ * On little-endian hosts the payload is a single WriteRaw() of the array.
+ *
+ * @param out The output stream to write to.
+ * @param values Pointer to the first value.
+ * @param n Number of values.
+ * @return true on success, false on failure.
+ */
+template <FixedWidth T, typename S>
+inline bool WritePackedFixed(BasicCodedOutputStream<S>* out, const T* values, size_t n) {
+    size_t bytes = n * sizeof(T);
+    if (!out->WriteVarint32(static_cast<uint32_t>(bytes))) return false;
+    if constexpr (std::endian::native == std::endian::little) {
+        return out->WriteRaw(values, bytes);
+    } else {
+        uint8_t tmp[256];
+        constexpr size_t kPerChunk = sizeof(tmp) / sizeof(T);
+        for (size_t i = 0; i < n; i += kPerChunk) {
+            size_t k = std::min(kPerChunk, n - i);
+            CopyToLittleEndian(tmp, values + i, k);
+            if (!out->WriteRaw(tmp, k * sizeof(T))) return false;
+        }
+        return true;
+    }
+}
+
+template <FixedWidth T, OutputStream S>
+inline bool WritePackedFixed(S* out, const T* values, size_t n) {
+    BasicCodedOutputStream<S> coded(out);
+    return WritePackedFixed(&coded, values, n);
+}
+
+namespace detail {
+
+/// Reads the byte length of a packed array and checks it against the
+/// element size and the current limit.
+template <typename S>
+inline bool ReadPackedLength(BasicCodedInputStream<S>* in, size_t element_size, uint32_t& bytes) {
+    if (!in->ReadVarint32(bytes)) return false;
+    if (bytes % element_size != 0) return false;
+    int64_t limit = in->BytesUntilLimit();
+    return limit < 0 || bytes <= limit;
+}
+
+} // namespace detail
+
+/**
+ * @brief Reads a packed fixed-width array written by WritePackedFixed(),
+ *        appending the values to 'out' with a single ReadRaw().
+ * @param in The input stream to read from.
+ * @param out Vector the values are appended to.
+ * @return false on truncated input or a length that is not a whole number of values.
+ */
+template <FixedWidth T, typename S>
+inline bool ReadPackedFixed(BasicCodedInputStream<S>* in, std::vector<T>& out) {
+    uint32_t bytes;
+    if (!detail::ReadPackedLength(in, sizeof(T), bytes)) return false;
+    size_t old = out.size();
+    size_t n = bytes / sizeof(T);
+    out.resize(old + n);
+    if (!in->ReadRaw(out.data() + old, bytes)) return false;
+    if constexpr (std::endian::native != std::endian::little) {
+        CopyFromLittleEndian(out.data() + old, reinterpret_cast<const uint8_t*>(out.data() + old), n);
+    }
+    return true;
+}
+
+template <FixedWidth T, InputStream S>
+inline bool ReadPackedFixed(S* in, std::vector<T>& out) {
+    BasicCodedInputStream<S> coded(in);
+    return ReadPackedFixed(&coded, out);
+}
+
+/**
+ * @brief Reads a packed fixed-width array without copying when possible.
+ *
+ * On little-endian hosts, if the payload is contiguous in the current chunk
+ * and suitably aligned, 'out' points straight into the input. Otherwise the
+ * values are copied once into 'arena'.
+ *
+ * @param in The input stream to read from.
+ * @param out Span that will point to the values.
+ * @param arena Arena that receives the values if they cannot be aliased.
+ * @return false on truncated input or a length that is not a whole number of values.
+ */
+template <FixedWidth T, typename S>
+inline bool ReadPackedFixed(BasicCodedInputStream<S>* in, std::span<const T>& out, quark::Arena* arena) {
+    uint32_t bytes;
+    if (!detail::ReadPackedLength(in, sizeof(T), bytes)) return false;
+    size_t n = bytes / sizeof(T);
+
+    if constexpr (std::endian::native == std::endian::little) {
+        std::span<const uint8_t> raw;
+        if (in->ReadAliased(bytes, raw)) {
+            if (reinterpret_cast<uintptr_t>(raw.data()) % alignof(T) == 0) {
+                CountStat(IoStat::kBytesAliased, bytes);
+                out = std::span<const T>(reinterpret_cast<const T*>(raw.data()), n);
+                return true;
+            }
+            CountStat(IoStat::kSpillCopies);
+            CountStat(IoStat::kBytesCopied, bytes);
+            T* dst = arena->AllocateArray<T>(n);
+            if (n > 0) std::memcpy(dst, raw.data(), bytes);
+            out = std::span<const T>(dst, n);
+            return true;
+        }
+    }
+
+    CountStat(IoStat::kSpillCopies);
+    CountStat(IoStat::kBytesCopied, bytes);
+    T* dst = arena->AllocateArray<T>(n);
+    if (!in->ReadRaw(dst, bytes)) return false;
+    if constexpr (std::endian::native != std::endian::little) {
+        CopyFromLittleEndian(dst, reinterpret_cast<const uint8_t*>(dst), n);
+    }
+    out = std::span<const T>(dst, n);
+    return true;
+}
+
+template <FixedWidth T, InputStream S>
+inline bool ReadPackedFixed(S* in, std::span<const T>& out, quark::Arena* arena) {
+    BasicCodedInputStream<S> coded(in);
+    return ReadPackedFixed(&coded, out, arena);
+}
+
+/**
+ * @brief Writes a packed array of varint32s: varint byte length, then the values.
+ * @param out The output stream to write to.
+ * @param values Pointer to the first value.
+ * @param n Number of values.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool WritePackedVarint32(BasicCodedOutputStream<S>* out, const uint32_t* values, size_t n) {
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; ++i) bytes += VarintSize32(values[i]);
+    if (!out->WriteVarint32(static_cast<uint32_t>(bytes))) return false;
+    for (size_t i = 0; i < n; ++i) {
+        if (!out->WriteVarint32(values[i])) return false;
+    }
+    return true;
+}
+
+template <OutputStream S>
+inline bool WritePackedVarint32(S* out, const uint32_t* values, size_t n) {
+    BasicCodedOutputStream<S> coded(out);
+    return WritePackedVarint32(&coded, values, n);
+}
+
+/**
+ * @brief Reads a packed varint32 array written by WritePackedVarint32(),
+ *        appending the values to 'out'.
+ *
+ * When the payload is contiguous the values are counted up front (one
+ * terminating byte each) and decoded with ReadVarint32Batch().
+ *
+ * @param in The input stream to read from.
+ * @param out Vector the values are appended to.
+ * @return false on truncated or malformed input.
+ */
+template <typename S>
+inline bool ReadPackedVarint32(BasicCodedInputStream<S>* in, std::vector<uint32_t>& out) {
+    uint32_t bytes;
+    if (!detail::ReadPackedLength(in, 1, bytes)) return false;
+    auto limit = in->PushLimit(bytes);
+
+    bool ok = true;
+    const uint8_t* p;
+    size_t available;
+    if (bytes > 0 && in->GetDirectBufferPointer(&p, &available) && available >= bytes) {
+        size_t count = 0;
+        for (size_t i = 0; i < bytes; ++i) count += p[i] < 0x80;
+        size_t old = out.size();
+        out.resize(old + count);
+        ok = in->ReadVarint32Batch(out.data() + old, count);
+    } else {
+        uint32_t v;
+        while (ok && in->BytesUntilLimit() > 0) {
+            ok = in->ReadVarint32(v);
+            if (ok) out.push_back(v);
+        }
+    }
+    ok = ok && in->BytesUntilLimit() == 0;
+    in->PopLimit(limit);
+    return ok;
+}
+
+template <InputStream S>
+inline bool ReadPackedVarint32(S* in, std::vector<uint32_t>& out) {
+    BasicCodedInputStream<S> coded(in);
+    return ReadPackedVarint32(&coded, out);
+}
+
+/**
+ * @brief Writes a packed array of varint64s: varint byte length, then the values.
+ * @param out The output stream to write to.
+ * @param values Pointer to the first value.
+ * @param n Number of values.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool WritePackedVarint64(BasicCodedOutputStream<S>* out, const uint64_t* values, size_t n) {
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; ++i) bytes += VarintSize64(values[i]);
+    if (!out->WriteVarint32(static_cast<uint32_t>(bytes))) return false;
+    for (size_t i = 0; i < n; ++i) {
+        if (!out->WriteVarint64(values[i])) return false;
+    }
+    return true;
+}
+
+template <OutputStream S>
+inline bool WritePackedVarint64(S* out, const uint64_t* values, size_t n) {
+    BasicCodedOutputStream<S> coded(out);
+    return WritePackedVarint64(&coded, values, n);
+}
+
+/**
+ * @brief Reads a packed varint64 array written by WritePackedVarint64(),
+ *        appending the values to 'out'.
+ * @param in The input stream to read from.
+ * @param out Vector the values are appended to.
+ * @return false on truncated or malformed input.
+ */
+template <typename S>
+inline bool ReadPackedVarint64(BasicCodedInputStream<S>* in, std::vector<uint64_t>& out) {
+    uint32_t bytes;
+    if (!detail::ReadPackedLength(in, 1, bytes)) return false;
+    auto limit = in->PushLimit(bytes);
+    bool ok = true;
+    uint64_t v;
+    while (ok && in->BytesUntilLimit() > 0) {
+        ok = in->ReadVarint64(v);
+        if (ok) out.push_back(v);
+    }
+    ok = ok && in->BytesUntilLimit() == 0;
+    in->PopLimit(limit);
+    return ok;
+}
+
+template <InputStream S>
+inline bool ReadPackedVarint64(S* in, std::vector<uint64_t>& out) {
+    BasicCodedInputStream<S> coded(in);
+    return ReadPackedVarint64(&coded, out);
+}
+
+// Packed arrays of typed varint values (int64_t, uint64_t, bool, or zigzag
+// int32_t/int64_t when 'ZigZag' is set), as repeated varint fields of
+// quarkc-generated messages hold them. The layout is the one above: byte
+// length, then one varint per element.
+
+namespace detail {
+
+/// The unsigned varint an element is written as.
+template <bool ZigZag, typename T>
+constexpr uint64_t PackedVarintValue(T value) {
+    if constexpr (!ZigZag) return static_cast<uint64_t>(value);
+    else if constexpr (sizeof(T) == 4) return ZigZagEncode32(value);
+    else return ZigZagEncode64(value);
+}
+
+/// Inverse of PackedVarintValue().
+template <bool ZigZag, typename T>
+constexpr T PackedVarintElement(uint64_t value) {
+    if constexpr (!ZigZag) return static_cast<T>(value);
+    else if constexpr (sizeof(T) == 4) return ZigZagDecode32(static_cast<uint32_t>(value));
+    else return ZigZagDecode64(value);
+}
+
+} // namespace detail
+
+/// Payload bytes of a packed varint array, without the length prefix.
+template <bool ZigZag = false, typename T>
+inline size_t PackedVarintPayloadSize(const std::vector<T>& values) {
+    size_t bytes = 0;
+    for (T v : values) bytes += VarintSize64(detail::PackedVarintValue<ZigZag>(v));
+    return bytes;
+}
+
+/**
+ * @brief Writes 'values' as a packed varint array: varint byte length, then
+ *        the values.
+ * @param out The output stream to write to.
+ * @param values The values to write.
+ * @return true on success, false on failure.
+ */
+template <bool ZigZag = false, typename T, typename S>
+inline bool WritePackedVarint(BasicCodedOutputStream<S>* out, const std::vector<T>& values) {
+    if (!out->WriteVarint32(static_cast<uint32_t>(PackedVarintPayloadSize<ZigZag>(values)))) return false;
+    for (T v : values) {
+        if (!out->WriteVarint64(detail::PackedVarintValue<ZigZag>(v))) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Reads a packed varint array written by WritePackedVarint(),
+ *        appending the values to 'out'.
+ * @param in The input stream to read from.
+ * @param out Vector the values are appended to.
+ * @return false on truncated or malformed input.
+ */
+template <bool ZigZag = false, typename T, typename S>
+inline bool ReadPackedVarint(BasicCodedInputStream<S>* in, std::vector<T>& out) {
+    uint32_t bytes;
+    if (!detail::ReadPackedLength(in, 1, bytes)) return false;
+    auto limit = in->PushLimit(bytes);
+    bool ok = true;
+    uint64_t v;
+    while (ok && in->BytesUntilLimit() > 0) {
+        ok = in->ReadVarint64(v);
+        if (ok) out.push_back(detail::PackedVarintElement<ZigZag, T>(v));
+    }
+    ok = ok && in->BytesUntilLimit() == 0;
+    in->PopLimit(limit);
+    return ok;
+}
+
+// ===========================
+// Unchecked Array Codecs
+// ===========================
+//
+// The positional encodings as raw-pointer writers (*ToArray) and readers
+// (*FromArray) with no bounds checks. They are the single encoding core:
+// the stream functions below run them inside windows reserved with
+// GetDirectBufferForNBytesAndAdvance() and only take the checked path at a
+// window edge. Callers that manage their own buffers can use them directly
+// once the bytes are known to be there (see the *Size helpers).
+
+/**
+ * @brief Enumeration of supported serialization types.
+ */
+enum class Type : uint8_t { 
+    INT32 = 1, 
+    FLOAT32 = 2, 
+    STRING = 3,
+    MESSAGE = 4,            // Length-prefixed nested message
+    INT32_ARRAY = 5,        // Byte length + raw little-endian int32s
+    FLOAT32_ARRAY = 6,      // Byte length + raw little-endian floats
+    FIXED64_ARRAY = 7,      // Byte length + raw little-endian 64-bit words
+    VARINT32_ARRAY = 8,     // Byte length + varint32s
+    INT64 = 9,              // Varint (negative values take 10 bytes)
+    UINT64 = 10,            // Varint
+    SINT32 = 11,            // Zigzag varint
+    SINT64 = 12,            // Zigzag varint
+    FIXED64 = 13,           // 8 bytes little-endian
+    DOUBLE = 14,            // 8 bytes little-endian
+    BOOL = 15,              // One-byte varint (0 or 1)
+    BYTES = 16,             // Length-prefixed raw bytes
+    DICT_STRING = 17        // Varint index into a per-stream table, or a new entry (string_dict.h)
+};
+
+/// Encoded size of an INT32 field: tag + 4 bytes.
+static constexpr size_t kInt32FieldSize = 1 + 4;
+
+/// Encoded size of a FLOAT32 field: tag + 4 bytes.
+static constexpr size_t kFloat32FieldSize = 1 + 4;
+
+/// Encoded size of a length prefix plus 'len' payload bytes.
+constexpr size_t LengthDelimitedSize(size_t len) {
+    return VarintSize32(static_cast<uint32_t>(len)) + len;
+}
+
+/// Encoded size of a STRING field holding 'len' bytes: tag + length + data.
+constexpr size_t StringFieldSize(size_t len) {
+    return 1 + LengthDelimitedSize(len);
+}
+
+/// Encoded size of a nested MESSAGE field with a 'len' byte body: tag + length + body.
+constexpr size_t MessageFieldSize(size_t len) {
+    return 1 + LengthDelimitedSize(len);
+}
+
+/**
+ * @brief Writes an INT32 field into 'target' without bounds checks.
+ * @param target Destination with room for kInt32FieldSize bytes.
+ * @param value The integer value to serialize.
+ * @return Pointer one past the last byte written.
+ */
+inline uint8_t* SerializeInt32ToArray(uint8_t* target, int32_t value) {
+    target[0] = static_cast<uint8_t>(Type::INT32);
+    StoreLittleEndian32(target + 1, static_cast<uint32_t>(value));
+    return target + kInt32FieldSize;
+}
+
+/**
+ * @brief Writes a FLOAT32 field into 'target' without bounds checks.
+ * @param target Destination with room for kFloat32FieldSize bytes.
+ * @param value The float value to serialize.
+ * @return Pointer one past the last byte written.
+ */
+inline uint8_t* SerializeFloat32ToArray(uint8_t* target, float value) {
+    target[0] = static_cast<uint8_t>(Type::FLOAT32);
+    StoreLittleEndian32(target + 1, std::bit_cast<uint32_t>(value));
+    return target + kFloat32FieldSize;
+}
+
+/**
+ * @brief Writes a length prefix and 'len' bytes into 'target' without bounds checks.
+ * @param target Destination with room for LengthDelimitedSize(len) bytes.
+ * @return Pointer one past the last byte written.
+ */
+inline uint8_t* WriteLengthDelimitedBytesToArray(uint8_t* target, const uint8_t* data, size_t len) {
+    target = CodedOutputStream::EncodeVarint(target, static_cast<uint32_t>(len));
+    if (len > 0) std::memcpy(target, data, len);
+    return target + len;
+}
+
+/**
+ * @brief Writes a STRING field into 'target' without bounds checks.
+ * @param target Destination with room for StringFieldSize(str.size()) bytes.
+ * @param str The string to serialize.
+ * @return Pointer one past the last byte written.
+ */
+inline uint8_t* SerializeStringToArray(uint8_t* target, std::string_view str) {
+    *target++ = static_cast<uint8_t>(Type::STRING);
+    return WriteLengthDelimitedBytesToArray(target, reinterpret_cast<const uint8_t*>(str.data()), str.size());
+}
+
+/**
+ * @brief Writes a nested message header into 'target' without bounds checks.
+ * @param target Destination with room for 1 + VarintSize32(size) bytes.
+ * @param size Encoded size of the message body that follows.
+ * @return Pointer one past the last byte written.
+ */
+inline uint8_t* SerializeMessageHeaderToArray(uint8_t* target, size_t size) {
+    *target++ = static_cast<uint8_t>(Type::MESSAGE);
+    return CodedOutputStream::EncodeVarint(target, static_cast<uint32_t>(size));
+}
+
+/**
+ * @brief Reads an INT32 field from 'p' without bounds checks.
+ * @param p Source with kInt32FieldSize readable bytes.
+ * @param[out] value Receives the integer.
+ * @return Pointer past the field, or nullptr if the type tag is not INT32.
+ */
+inline const uint8_t* DeserializeInt32FromArray(const uint8_t* p, int32_t& value) {
+    if (p[0] != static_cast<uint8_t>(Type::INT32)) return nullptr;
+    value = static_cast<int32_t>(LoadLittleEndian32(p + 1));
+    return p + kInt32FieldSize;
+}
+
+/**
+ * @brief Reads a FLOAT32 field from 'p' without bounds checks.
+ * @param p Source with kFloat32FieldSize readable bytes.
+ * @param[out] value Receives the float.
+ * @return Pointer past the field, or nullptr if the type tag is not FLOAT32.
+ */
+inline const uint8_t* DeserializeFloat32FromArray(const uint8_t* p, float& value) {
+    if (p[0] != static_cast<uint8_t>(Type::FLOAT32)) return nullptr;
+    value = std::bit_cast<float>(LoadLittleEndian32(p + 1));
+    return p + kFloat32FieldSize;
+}
+
+/**
+ * @brief Reads a STRING field from 'p' without bounds checks; 'str' points
+ *        into the source.
+ * @param p Source holding the complete field.
+ * @param[out] str View of the string bytes.
+ * @return Pointer past the field, or nullptr if the type tag is not STRING
+ *         or the length varint is malformed.
+ */
+inline const uint8_t* DeserializeStringFromArray(const uint8_t* p, std::string_view& str) {
+    if (*p++ != static_cast<uint8_t>(Type::STRING)) return nullptr;
+    uint32_t len = 0;
+    for (int shift = 0;; shift += 7) {
+        if (shift >= 7 * kMaxVarint32Bytes) return nullptr;
+        uint8_t b = *p++;
+        len |= static_cast<uint32_t>(b & 0x7F) << shift;
+        if (b < 0x80) break;
+    }
+    str = std::string_view(reinterpret_cast<const char*>(p), len);
+    return p + len;
+}
+
+// ===========================
+// Serialization Apis
+// ===========================
+
+/**
+ * @brief Serializes a 32-bit integer to the output stream.
+ * @param out The output stream to write to.
+ * @param value The integer value to serialize.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeInt32(BasicCodedOutputStream<S>* out, int32_t value) {
+    if (uint8_t* p = out->GetDirectBufferForNBytesAndAdvance(kInt32FieldSize)) {
+        SerializeInt32ToArray(p, value);
+        return true;
+    }
+    if (!out->WriteByte(static_cast<uint8_t>(Type::INT32))) return false;
+    return out->WriteFixed32(static_cast<uint32_t>(value));
+}
+
+template <OutputStream S>
+inline bool SerializeInt32(S* out, int32_t value) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeInt32(&coded, value);
+}
+
+/**
+ * @brief Deserializes a 32-bit integer from the input stream.
+ * @param in The input stream to read from.
+ * @param value The integer variable to store the deserialized value.
+ * @return true on success, false on failure. A wrong type tag is consumed,
+ *         the bytes after it are not.
+ */
+template <typename S>
+inline bool DeserializeInt32(BasicCodedInputStream<S>* in, int32_t& value) {
+    // the tag is checked before anything is consumed; a mismatch takes the
+    // slow path, which stops just past the tag byte as it always has
+    const uint8_t* p;
+    size_t available;
+    if (in->GetDirectBufferPointer(&p, &available) && available >= kInt32FieldSize &&
+        DeserializeInt32FromArray(p, value) != nullptr) {
+        return in->Skip(kInt32FieldSize);
+    }
+    uint8_t tag;
+    if (!in->ReadByte(tag)) return false;
+    if (tag != static_cast<uint8_t>(Type::INT32)) return false;
+
+    uint32_t tmp;
+    if (!in->ReadFixed32(tmp)) return false;
+    value = static_cast<int32_t>(tmp);
+    return true;
+}
+
+template <InputStream S>
+inline bool DeserializeInt32(S* in, int32_t& value) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeInt32(&coded, value);
+}
+
+/**
+ * @brief Serializes a 32-bit float to the output stream.
+ * @param out The output stream to write to.
+ * @param value The float value to serialize.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeFloat32(BasicCodedOutputStream<S>* out, float value) {
+    if (uint8_t* p = out->GetDirectBufferForNBytesAndAdvance(kFloat32FieldSize)) {
+        SerializeFloat32ToArray(p, value);
+        return true;
+    }
+    if (!out->WriteByte(static_cast<uint8_t>(Type::FLOAT32))) return false;
+
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return out->WriteFixed32(bits);
+}
+
+template <OutputStream S>
+inline bool SerializeFloat32(S* out, float value) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeFloat32(&coded, value);
+}
+
+/**
+ * @brief Deserializes a 32-bit float from the input stream.
+ * @param in The input stream to read from.
+ * @param value The float variable to store the deserialized value.
+ * @return true on success, false on failure. A wrong type tag is consumed,
+ *         the bytes after it are not.
+ */
+template <typename S>
+inline bool DeserializeFloat32(BasicCodedInputStream<S>* in, float& value) {
+    // tag checked before consuming, as in DeserializeInt32()
+    const uint8_t* p;
+    size_t available;
+    if (in->GetDirectBufferPointer(&p, &available) && available >= kFloat32FieldSize &&
+        DeserializeFloat32FromArray(p, value) != nullptr) {
+        return in->Skip(kFloat32FieldSize);
+    }
+    uint8_t tag;
+    if (!in->ReadByte(tag)) return false;
+    if (tag != static_cast<uint8_t>(Type::FLOAT32)) return false;
+
+    uint32_t bits;
+    if (!in->ReadFixed32(bits)) return false;
+
+    std::memcpy(&value, &bits, sizeof(value));
+    return true;
+}
+
+template <InputStream S>
+inline bool DeserializeFloat32(S* in, float& value) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeFloat32(&coded, value);
+}
+
+/**
+ * @brief Serializes a string to the output stream.
+ * @param out The output stream to write to.
+ * @param str The string to serialize.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeString(BasicCodedOutputStream<S>* out, const std::string& str) {
+    bool alias = out->ShouldAlias(str.size());
+    if (uint8_t* p = alias ? nullptr : out->GetDirectBufferForNBytesAndAdvance(StringFieldSize(str.size()))) {
+        SerializeStringToArray(p, str);
+        return true;
+    }
+    if (!out->WriteByte(static_cast<uint8_t>(Type::STRING))) return false;
+
+    if (!out->WriteVarint32(static_cast<uint32_t>(str.size()))) return false;
+
+    return out->WriteRawMaybeAliased(reinterpret_cast<const uint8_t*>(str.data()), str.size());
+}
+
+template <OutputStream S>
+inline bool SerializeString(S* out, const std::string& str) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeString(&coded, str);
+}
+
+/**
+ * @brief Deserializes a string from the input stream.
+ * @param in The input stream to read from.
+ * @param str The string to store the deserialized data (if copy is needed).
+ * @param persistent_buffer Optional buffer to hold data if not contiguous.
+ * @param str_view String view pointing to the deserialized data.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool DeserializeString(
+    BasicCodedInputStream<S>* in,
+    std::string& str,
+    std::shared_ptr<std::vector<uint8_t>>& persistent_buffer,
+    std::string_view& str_view)
+{
+    uint8_t tag;
+    if (!in->ReadByte(tag)) return false;
+    if (tag != static_cast<uint8_t>(Type::STRING)) return false;
+
+    std::span<const uint8_t> bytes;
+
+    if (!ReadLengthDelimitedBytes(in, bytes, persistent_buffer)) {
+        return false;
+    }
+
+    if (persistent_buffer) {
+        str.assign(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        str_view = str;
+    } else {
+        str_view = std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+
+    return true;
+}
+
+template <InputStream S>
+inline bool DeserializeString(
+    S* in,
+    std::string& str,
+    std::shared_ptr<std::vector<uint8_t>>& persistent_buffer,
+    std::string_view& str_view)
+{
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeString(&coded, str, persistent_buffer, str_view);
+}
+
+/**
+ * @brief Deserializes a string without heap allocation.
+ *
+ * 'str_view' points into the input when the string is contiguous, or into a
+ * single arena copy when it straddles chunks.
+ *
+ * @param in The input stream to read from.
+ * @param str_view String view pointing to the deserialized data.
+ * @param arena Arena that receives the bytes if they are not contiguous.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool DeserializeString(BasicCodedInputStream<S>* in, std::string_view& str_view, quark::Arena* arena) {
+    uint8_t tag;
+    if (!in->ReadByte(tag)) return false;
+    if (tag != static_cast<uint8_t>(Type::STRING)) return false;
+
+    std::span<const uint8_t> bytes;
+    if (!ReadLengthDelimitedBytes(in, bytes, arena)) return false;
+
+    str_view = std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    return true;
+}
+
+template <InputStream S>
+inline bool DeserializeString(S* in, std::string_view& str_view, quark::Arena* arena) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeString(&coded, str_view, arena);
+}
+
+/**
+ * @brief Deserializes a string as a view that pins the input chunk.
+ *
+ * No copy is made when the string is contiguous in a chunk with an owner;
+ * the view then keeps that chunk's buffer alive. Otherwise it owns a copy.
+ *
+ * @param in The input stream to read from.
+ * @param str Receives the string.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool DeserializeString(BasicCodedInputStream<S>* in, quark::PinnedView& str) {
+    uint8_t tag;
+    if (!in->ReadByte(tag)) return false;
+    if (tag != static_cast<uint8_t>(Type::STRING)) return false;
+    return ReadLengthDelimitedBytes(in, str);
+}
+
+template <InputStream S>
+inline bool DeserializeString(S* in, quark::PinnedView& str) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeString(&coded, str);
+}
 
 /**
- * @brief Writes a 32-bit unsigned integer in little-endian order to a ZeroCopyOutputStream.
+ * @brief Writes the header of a nested message: MESSAGE tag + varint length.
  *
- * Each byte of the integer is written in order from least-significant to most-significant.
- * This ensures cross-platform consistency regardless of host endianness.
+ * The message body follows directly, so 'size' must be known up front
+ * (e.g. from a generated ByteSizeLong()); no temporary buffer is needed.
  *
- * @param out Pointer to the ZeroCopyOutputStream where the data will be written.
- * @param v The 32-bit unsigned integer value to write.
- * @return true if the write succeeded, false otherwise.
+ * @param out The output stream to write to.
+ * @param size Encoded size of the message body that follows.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeMessageHeader(BasicCodedOutputStream<S>* out, size_t size) {
+    if (!out->WriteByte(static_cast<uint8_t>(Type::MESSAGE))) return false;
+    return out->WriteVarint32(static_cast<uint32_t>(size));
+}
+
+template <OutputStream S>
+inline bool SerializeMessageHeader(S* out, size_t size) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeMessageHeader(&coded, size);
+}
+
+/**
+ * @brief Reads the header of a nested message written by SerializeMessageHeader().
+ *
+ * Typically followed by in->PushLimit(size) so the body is decoded in place
+ * and cannot read past its own end.
+ *
+ * @param in The input stream to read from.
+ * @param size Receives the encoded size of the message body.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool DeserializeMessageHeader(BasicCodedInputStream<S>* in, size_t& size) {
+    uint8_t tag;
+    if (!in->ReadByte(tag)) return false;
+    if (tag != static_cast<uint8_t>(Type::MESSAGE)) return false;
+
+    uint32_t len;
+    if (!in->ReadVarint32(len)) return false;
+    size = len;
+    return true;
+}
+
+template <InputStream S>
+inline bool DeserializeMessageHeader(S* in, size_t& size) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeMessageHeader(&coded, size);
+}
+
+namespace detail {
+
+/// Reads a type tag and checks that it is 'expected'.
+template <typename S>
+inline bool ReadTypeTag(BasicCodedInputStream<S>* in, Type expected) {
+    uint8_t tag;
+    if (!in->ReadByte(tag)) return false;
+    return tag == static_cast<uint8_t>(expected);
+}
+
+} // namespace detail
+
+/**
+ * @brief Serializes an array of 32-bit integers: INT32_ARRAY tag, byte length,
+ *        raw little-endian values.
+ * @param out The output stream to write to.
+ * @param values Pointer to the first value.
+ * @param n Number of values.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeInt32Array(BasicCodedOutputStream<S>* out, const int32_t* values, size_t n) {
+    if (!out->WriteByte(static_cast<uint8_t>(Type::INT32_ARRAY))) return false;
+    return WritePackedFixed(out, values, n);
+}
+
+template <OutputStream S>
+inline bool SerializeInt32Array(S* out, const int32_t* values, size_t n) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeInt32Array(&coded, values, n);
+}
+
+/**
+ * @brief Deserializes an INT32_ARRAY, appending the values to 'values'.
+ * @param in The input stream to read from.
+ * @param values Vector the values are appended to.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool DeserializeInt32Array(BasicCodedInputStream<S>* in, std::vector<int32_t>& values) {
+    return detail::ReadTypeTag(in, Type::INT32_ARRAY) && ReadPackedFixed(in, values);
+}
+
+template <InputStream S>
+inline bool DeserializeInt32Array(S* in, std::vector<int32_t>& values) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeInt32Array(&coded, values);
+}
+
+/**
+ * @brief Deserializes an INT32_ARRAY as a view into the input, or into a
+ *        single arena copy when it cannot be aliased (see ReadPackedFixed()).
+ * @param in The input stream to read from.
+ * @param values Span that will point to the values.
+ * @param arena Arena that receives the values if they cannot be aliased.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool DeserializeInt32Array(BasicCodedInputStream<S>* in, std::span<const int32_t>& values, quark::Arena* arena) {
+    return detail::ReadTypeTag(in, Type::INT32_ARRAY) && ReadPackedFixed(in, values, arena);
+}
+
+template <InputStream S>
+inline bool DeserializeInt32Array(S* in, std::span<const int32_t>& values, quark::Arena* arena) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeInt32Array(&coded, values, arena);
+}
+
+/**
+ * @brief Serializes an array of 32-bit floats: FLOAT32_ARRAY tag, byte length,
+ *        raw little-endian values.
+ * @param out The output stream to write to.
+ * @param values Pointer to the first value.
+ * @param n Number of values.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeFloat32Array(BasicCodedOutputStream<S>* out, const float* values, size_t n) {
+    if (!out->WriteByte(static_cast<uint8_t>(Type::FLOAT32_ARRAY))) return false;
+    return WritePackedFixed(out, values, n);
+}
+
+template <OutputStream S>
+inline bool SerializeFloat32Array(S* out, const float* values, size_t n) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeFloat32Array(&coded, values, n);
+}
+
+/**
+ * @brief Deserializes a FLOAT32_ARRAY, appending the values to 'values'.
+ * @param in The input stream to read from.
+ * @param values Vector the values are appended to.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool DeserializeFloat32Array(BasicCodedInputStream<S>* in, std::vector<float>& values) {
+    return detail::ReadTypeTag(in, Type::FLOAT32_ARRAY) && ReadPackedFixed(in, values);
+}
+
+template <InputStream S>
+inline bool DeserializeFloat32Array(S* in, std::vector<float>& values) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeFloat32Array(&coded, values);
+}
+
+/**
+ * @brief Deserializes a FLOAT32_ARRAY as a view into the input, or into a
+ *        single arena copy when it cannot be aliased (see ReadPackedFixed()).
+ * @param in The input stream to read from.
+ * @param values Span that will point to the values.
+ * @param arena Arena that receives the values if they cannot be aliased.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool DeserializeFloat32Array(BasicCodedInputStream<S>* in, std::span<const float>& values, quark::Arena* arena) {
+    return detail::ReadTypeTag(in, Type::FLOAT32_ARRAY) && ReadPackedFixed(in, values, arena);
+}
+
+template <InputStream S>
+inline bool DeserializeFloat32Array(S* in, std::span<const float>& values, quark::Arena* arena) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeFloat32Array(&coded, values, arena);
+}
+
+/**
+ * @brief Serializes an array of 64-bit words: FIXED64_ARRAY tag, byte length,
+ *        raw little-endian values.
+ * @param out The output stream to write to.
+ * @param values Pointer to the first value.
+ * @param n Number of values.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeFixed64Array(BasicCodedOutputStream<S>* out, const uint64_t* values, size_t n) {
+    if (!out->WriteByte(static_cast<uint8_t>(Type::FIXED64_ARRAY))) return false;
+    return WritePackedFixed(out, values, n);
+}
+
+template <OutputStream S>
+inline bool SerializeFixed64Array(S* out, const uint64_t* values, size_t n) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeFixed64Array(&coded, values, n);
+}
+
+/**
+ * @brief Deserializes a FIXED64_ARRAY, appending the values to 'values'.
+ * @param in The input stream to read from.
+ * @param values Vector the values are appended to.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool DeserializeFixed64Array(BasicCodedInputStream<S>* in, std::vector<uint64_t>& values) {
+    return detail::ReadTypeTag(in, Type::FIXED64_ARRAY) && ReadPackedFixed(in, values);
+}
+
+template <InputStream S>
+inline bool DeserializeFixed64Array(S* in, std::vector<uint64_t>& values) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeFixed64Array(&coded, values);
+}
+
+/**
+ * @brief Deserializes a FIXED64_ARRAY as a view into the input, or into a
+ *        single arena copy when it cannot be aliased (see ReadPackedFixed()).
+ * @param in The input stream to read from.
+ * @param values Span that will point to the values.
+ * @param arena Arena that receives the values if they cannot be aliased.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool DeserializeFixed64Array(BasicCodedInputStream<S>* in, std::span<const uint64_t>& values, quark::Arena* arena) {
+    return detail::ReadTypeTag(in, Type::FIXED64_ARRAY) && ReadPackedFixed(in, values, arena);
+}
+
+template <InputStream S>
+inline bool DeserializeFixed64Array(S* in, std::span<const uint64_t>& values, quark::Arena* arena) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeFixed64Array(&coded, values, arena);
+}
+
+/**
+ * @brief Serializes an array of varint-encoded 32-bit values: VARINT32_ARRAY
+ *        tag, byte length, varints. Smaller than INT32_ARRAY for small values.
+ * @param out The output stream to write to.
+ * @param values Pointer to the first value.
+ * @param n Number of values.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeVarint32Array(BasicCodedOutputStream<S>* out, const uint32_t* values, size_t n) {
+    if (!out->WriteByte(static_cast<uint8_t>(Type::VARINT32_ARRAY))) return false;
+    return WritePackedVarint32(out, values, n);
+}
+
+template <OutputStream S>
+inline bool SerializeVarint32Array(S* out, const uint32_t* values, size_t n) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeVarint32Array(&coded, values, n);
+}
+
+/**
+ * @brief Deserializes a VARINT32_ARRAY, appending the values to 'values'.
+ * @param in The input stream to read from.
+ * @param values Vector the values are appended to.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool DeserializeVarint32Array(BasicCodedInputStream<S>* in, std::vector<uint32_t>& values) {
+    return detail::ReadTypeTag(in, Type::VARINT32_ARRAY) && ReadPackedVarint32(in, values);
+}
+
+template <InputStream S>
+inline bool DeserializeVarint32Array(S* in, std::vector<uint32_t>& values) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeVarint32Array(&coded, values);
+}
+
+/**
+ * @brief Serializes a 64-bit integer as a varint (negative values take 10 bytes; see SerializeSInt64()) to the output stream.
+ * @param out The output stream to write to.
+ * @param value The value to serialize.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeInt64(BasicCodedOutputStream<S>* out, int64_t value) {
+    if (!out->WriteByte(static_cast<uint8_t>(Type::INT64))) return false;
+    return out->WriteVarint64(static_cast<uint64_t>(value));
+}
+
+template <OutputStream S>
+inline bool SerializeInt64(S* out, int64_t value) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeInt64(&coded, value);
+}
+
+/**
+ * @brief Deserializes a 64-bit integer as a varint (negative values take 10 bytes; see SerializeSInt64()) from the input stream.
+ * @param in The input stream to read from.
+ * @param value Receives the deserialized value.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool DeserializeInt64(BasicCodedInputStream<S>* in, int64_t& value) {
+    if (!detail::ReadTypeTag(in, Type::INT64)) return false;
+    uint64_t tmp;
+    if (!in->ReadVarint64(tmp)) return false;
+    value = static_cast<int64_t>(tmp);
+    return true;
+}
+
+template <InputStream S>
+inline bool DeserializeInt64(S* in, int64_t& value) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeInt64(&coded, value);
+}
+
+/**
+ * @brief Serializes an unsigned 64-bit integer as a varint to the output stream.
+ * @param out The output stream to write to.
+ * @param value The value to serialize.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeUInt64(BasicCodedOutputStream<S>* out, uint64_t value) {
+    if (!out->WriteByte(static_cast<uint8_t>(Type::UINT64))) return false;
+    return out->WriteVarint64(value);
+}
+
+template <OutputStream S>
+inline bool SerializeUInt64(S* out, uint64_t value) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeUInt64(&coded, value);
+}
+
+/**
+ * @brief Deserializes an unsigned 64-bit integer as a varint from the input stream.
+ * @param in The input stream to read from.
+ * @param value Receives the deserialized value.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool DeserializeUInt64(BasicCodedInputStream<S>* in, uint64_t& value) {
+    if (!detail::ReadTypeTag(in, Type::UINT64)) return false;
+    return in->ReadVarint64(value);
+}
+
+template <InputStream S>
+inline bool DeserializeUInt64(S* in, uint64_t& value) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeUInt64(&coded, value);
+}
+
+/**
+ * @brief Serializes a signed 32-bit integer as a zigzag varint to the output stream.
+ * @param out The output stream to write to.
+ * @param value The value to serialize.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeSInt32(BasicCodedOutputStream<S>* out, int32_t value) {
+    if (!out->WriteByte(static_cast<uint8_t>(Type::SINT32))) return false;
+    return out->WriteVarint32(ZigZagEncode32(value));
+}
+
+template <OutputStream S>
+inline bool SerializeSInt32(S* out, int32_t value) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeSInt32(&coded, value);
+}
+
+/**
+ * @brief Deserializes a signed 32-bit integer as a zigzag varint from the input stream.
+ * @param in The input stream to read from.
+ * @param value Receives the deserialized value.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool DeserializeSInt32(BasicCodedInputStream<S>* in, int32_t& value) {
+    if (!detail::ReadTypeTag(in, Type::SINT32)) return false;
+    uint32_t tmp;
+    if (!in->ReadVarint32(tmp)) return false;
+    value = ZigZagDecode32(tmp);
+    return true;
+}
+
+template <InputStream S>
+inline bool DeserializeSInt32(S* in, int32_t& value) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeSInt32(&coded, value);
+}
+
+/**
+ * @brief Serializes a signed 64-bit integer as a zigzag varint to the output stream.
+ * @param out The output stream to write to.
+ * @param value The value to serialize.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeSInt64(BasicCodedOutputStream<S>* out, int64_t value) {
+    if (!out->WriteByte(static_cast<uint8_t>(Type::SINT64))) return false;
+    return out->WriteVarint64(ZigZagEncode64(value));
+}
+
+template <OutputStream S>
+inline bool SerializeSInt64(S* out, int64_t value) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeSInt64(&coded, value);
+}
+
+/**
+ * @brief Deserializes a signed 64-bit integer as a zigzag varint from the input stream.
+ * @param in The input stream to read from.
+ * @param value Receives the deserialized value.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool DeserializeSInt64(BasicCodedInputStream<S>* in, int64_t& value) {
+    if (!detail::ReadTypeTag(in, Type::SINT64)) return false;
+    uint64_t tmp;
+    if (!in->ReadVarint64(tmp)) return false;
+    value = ZigZagDecode64(tmp);
+    return true;
+}
+
+template <InputStream S>
+inline bool DeserializeSInt64(S* in, int64_t& value) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeSInt64(&coded, value);
+}
+
+/**
+ * @brief Serializes a 64-bit word as 8 little-endian bytes to the output stream.
+ * @param out The output stream to write to.
+ * @param value The value to serialize.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeFixed64(BasicCodedOutputStream<S>* out, uint64_t value) {
+    if (!out->WriteByte(static_cast<uint8_t>(Type::FIXED64))) return false;
+    return out->WriteFixed64(value);
+}
+
+template <OutputStream S>
+inline bool SerializeFixed64(S* out, uint64_t value) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeFixed64(&coded, value);
+}
+
+/**
+ * @brief Deserializes a 64-bit word as 8 little-endian bytes from the input stream.
+ * @param in The input stream to read from.
+ * @param value Receives the deserialized value.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool DeserializeFixed64(BasicCodedInputStream<S>* in, uint64_t& value) {
+    if (!detail::ReadTypeTag(in, Type::FIXED64)) return false;
+    return in->ReadFixed64(value);
+}
+
+template <InputStream S>
+inline bool DeserializeFixed64(S* in, uint64_t& value) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeFixed64(&coded, value);
+}
+
+/**
+ * @brief Serializes a 64-bit double as 8 little-endian bytes to the output stream.
+ * @param out The output stream to write to.
+ * @param value The value to serialize.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeDouble(BasicCodedOutputStream<S>* out, double value) {
+    if (!out->WriteByte(static_cast<uint8_t>(Type::DOUBLE))) return false;
+    return out->WriteFixed64(std::bit_cast<uint64_t>(value));
+}
+
+template <OutputStream S>
+inline bool SerializeDouble(S* out, double value) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeDouble(&coded, value);
+}
+
+/**
+ * @brief Deserializes a 64-bit double as 8 little-endian bytes from the input stream.
+ * @param in The input stream to read from.
+ * @param value Receives the deserialized value.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool DeserializeDouble(BasicCodedInputStream<S>* in, double& value) {
+    if (!detail::ReadTypeTag(in, Type::DOUBLE)) return false;
+    uint64_t bits;
+    if (!in->ReadFixed64(bits)) return false;
+    value = std::bit_cast<double>(bits);
+    return true;
+}
+
+template <InputStream S>
+inline bool DeserializeDouble(S* in, double& value) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeDouble(&coded, value);
+}
+
+/**
+ * @brief Serializes a bool as a one-byte varint to the output stream.
+ * @param out The output stream to write to.
+ * @param value The value to serialize.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeBool(BasicCodedOutputStream<S>* out, bool value) {
+    if (!out->WriteByte(static_cast<uint8_t>(Type::BOOL))) return false;
+    return out->WriteByte(value ? 1 : 0);
+}
+
+template <OutputStream S>
+inline bool SerializeBool(S* out, bool value) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeBool(&coded, value);
+}
+
+/**
+ * @brief Deserializes a bool as a one-byte varint from the input stream.
+ * @param in The input stream to read from.
+ * @param value Receives the deserialized value.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool DeserializeBool(BasicCodedInputStream<S>* in, bool& value) {
+    if (!detail::ReadTypeTag(in, Type::BOOL)) return false;
+    uint64_t tmp;
+    if (!in->ReadVarint64(tmp)) return false;
+    value = tmp != 0;
+    return true;
+}
+
+template <InputStream S>
+inline bool DeserializeBool(S* in, bool& value) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeBool(&coded, value);
+}
+
+/**
+ * @brief Serializes raw bytes (BYTES tag + varint length + data).
+ * @param out The output stream to write to.
+ * @param bytes The bytes to serialize.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeBytes(BasicCodedOutputStream<S>* out, std::span<const uint8_t> bytes) {
+    if (!out->WriteByte(static_cast<uint8_t>(Type::BYTES))) return false;
+    return WriteLengthDelimitedBytes(out, bytes.data(), bytes.size());
+}
+
+template <OutputStream S>
+inline bool SerializeBytes(S* out, std::span<const uint8_t> bytes) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeBytes(&coded, bytes);
+}
+
+/**
+ * @brief Deserializes raw bytes into 'bytes' with one copy. The length is
+ *        checked against the current limit before resizing.
+ * @param in The input stream to read from.
+ * @param bytes Receives the bytes.
+ * @return true on success, false on failure.
  */
-inline bool WriteFixed32(ZeroCopyOutputStream* out, uint32_t v) {
-    uint8_t b[4];
-    b[0] = static_cast<uint8_t>(v); 
-    b[1] = static_cast<uint8_t>(v >> 8);
-    b[2] = static_cast<uint8_t>(v >> 16); 
-    b[3] = static_cast<uint8_t>(v >> 24);
-    return out->WriteRaw(b, 4);
+template <typename S>
+inline bool DeserializeBytes(BasicCodedInputStream<S>* in, std::vector<uint8_t>& bytes) {
+    if (!detail::ReadTypeTag(in, Type::BYTES)) return false;
+    uint32_t length;
+    if (!in->ReadVarint32(length)) return false;
+    int64_t limit = in->BytesUntilLimit();
+    if (limit >= 0 && length > limit) return false;
+    bytes.resize(length);
+    return in->ReadRaw(bytes.data(), length);
+}
+
+template <InputStream S>
+inline bool DeserializeBytes(S* in, std::vector<uint8_t>& bytes) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeBytes(&coded, bytes);
 }
 
 /**
- * @brief Writes a 64-bit unsigned integer in little-endian order to a ZeroCopyOutputStream.
- *
- * Each byte of the integer is written in order from least-significant to most-significant.
- * This ensures cross-platform consistency regardless of host endianness.
- *
- * @param out Pointer to the ZeroCopyOutputStream where the data will be written.
- * @param v The 64-bit unsigned integer value to write.
- * @return true if the write succeeded, false otherwise.
+ * @brief Deserializes raw bytes as a view into the input, or into a single
+ *        arena copy when they straddle chunks.
+ * @param in The input stream to read from.
+ * @param bytes Span that will point to the bytes.
+ * @param arena Arena that receives the bytes if they are not contiguous.
+ * @return true on success, false on failure.
  */
-inline bool WriteFixed64(ZeroCopyOutputStream* out, uint64_t v) {
-    uint8_t b[8];
-    b[0] = static_cast<uint8_t>(v); 
-    b[1] = static_cast<uint8_t>(v >> 8);
-    b[2] = static_cast<uint8_t>(v >> 16); 
-    b[3] = static_cast<uint8_t>(v >> 24);
-    b[4] = static_cast<uint8_t>(v >> 32); 
-    b[5] = static_cast<uint8_t>(v >> 40);
-    b[6] = static_cast<uint8_t>(v >> 48); 
-    b[7] = static_cast<uint8_t>(v >> 56);
-    return out->WriteRaw(b, 8);
+template <typename S>
+inline bool DeserializeBytes(BasicCodedInputStream<S>* in, std::span<const uint8_t>& bytes, quark::Arena* arena) {
+    if (!detail::ReadTypeTag(in, Type::BYTES)) return false;
+    return ReadLengthDelimitedBytes(in, bytes, arena);
+}
+
+template <InputStream S>
+inline bool DeserializeBytes(S* in, std::span<const uint8_t>& bytes, quark::Arena* arena) {
+    BasicCodedInputStream<S> coded(in);
+    return DeserializeBytes(&coded, bytes, arena);
 }
 
+// ===========================
+// Tagged Field APIs
+// ===========================
+//
+// The Type-byte functions above encode fields positionally: a reader must
+// know every field, in order. The functions below prefix each field with a
+// varint tag holding its field number and wire type (the protobuf key
+// layout), so readers can dispatch on field numbers and step over fields
+// they do not know with SkipField(), without looking at their payloads.
+
 /**
- * @brief Reads a 32-bit fixed-size unsigned integer from the input stream.
- * 
- * This function reads exactly 4 bytes from the provided ZeroCopyInputStream
- * and reconstructs a little-endian 32-bit unsigned integer.
- * 
- * @param[in,out] in Pointer to the ZeroCopyInputStream to read from.
- * @param[out] v Reference to a uint32_t where the result will be stored.
- * 
- * @return true if 4 bytes were successfully read and decoded.
- * @return false if there were fewer than 4 bytes available in the stream.
+ * @brief How a tagged field's payload is laid out, i.e. how to skip it.
  */
-inline bool ReadFixed32(ZeroCopyInputStream* in, uint32_t &v) {
-    const uint8_t* ptr;
-    size_t n;
-    if (!in->Next(&ptr, &n) || n < 4) {
-        if (n > 0) {
-            in->BackUp(n);
-        }
-        return false;
-    }
+enum class WireType : uint8_t {
+    VARINT = 0,             // Varint payload
+    FIXED64 = 1,            // 8 little-endian bytes
+    LENGTH_DELIMITED = 2,   // Varint length + bytes (strings, nested messages)
+    FIXED32 = 5             // 4 little-endian bytes
+};
 
-    v = static_cast<uint32_t>(ptr[0]);
-    v |= (static_cast<uint32_t>(ptr[1]) << 8);
-    v |=(static_cast<uint32_t>(ptr[2]) << 16);
-    v |= (static_cast<uint32_t>(ptr[3]) << 24);
+static constexpr int kTagTypeBits = 3;
+static constexpr uint32_t kMaxFieldNumber = (1u << 29) - 1;
 
-    if (n > 4) {
-        in->BackUp(n - 4);
-    }
-    return true;
+/// Builds the tag for 'field_number' (1..kMaxFieldNumber) with 'type'.
+constexpr uint32_t MakeTag(uint32_t field_number, WireType type) {
+    return (field_number << kTagTypeBits) | static_cast<uint32_t>(type);
+}
+
+/// Field number stored in 'tag'.
+constexpr uint32_t TagFieldNumber(uint32_t tag) { return tag >> kTagTypeBits; }
+
+/// Wire type stored in 'tag'.
+constexpr WireType TagWireType(uint32_t tag) {
+    return static_cast<WireType>(tag & ((1u << kTagTypeBits) - 1));
 }
 
 /**
- * @brief Reads a 64-bit fixed-size unsigned integer from the input stream.
- * 
- * This function reads exactly 8 bytes from the provided ZeroCopyInputStream
- * and reconstructs a little-endian 64-bit unsigned integer.
- * 
- * @param[in,out] in Pointer to the ZeroCopyInputStream to read from.
- * @param[out] v Reference to a uint64_t where the result will be stored.
- * 
- * @return true if 8 bytes were successfully read and decoded.
- * @return false if there were fewer than 8 bytes available in the stream.
+ * @brief Writes the tag for 'field_number' with wire type 'type'.
+ * @param out The output stream to write to.
+ * @param field_number Field number (1..kMaxFieldNumber).
+ * @param type Wire type of the payload that follows.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool WriteTag(BasicCodedOutputStream<S>* out, uint32_t field_number, WireType type) {
+    return out->WriteTag(MakeTag(field_number, type));
+}
+
+template <OutputStream S>
+inline bool WriteTag(S* out, uint32_t field_number, WireType type) {
+    BasicCodedOutputStream<S> coded(out);
+    return WriteTag(&coded, field_number, type);
+}
+
+/**
+ * @brief Reads a field tag.
+ * @param in The input stream to read from.
+ * @param tag Receives the tag; 0 if the tag was malformed.
+ * @return false at the end of the stream (or of the current limit).
+ */
+template <typename S>
+inline bool ReadTag(BasicCodedInputStream<S>* in, uint32_t& tag) {
+    return in->ReadTag(tag);
+}
+
+template <InputStream S>
+inline bool ReadTag(S* in, uint32_t& tag) {
+    BasicCodedInputStream<S> coded(in);
+    return ReadTag(&coded, tag);
+}
+
+/**
+ * @brief Skips the payload of a field whose tag has just been read.
+ *
+ * Fixed-width and length-delimited payloads are skipped with the stream's
+ * Skip(), so an unknown string or nested message costs a varint decode and
+ * a pointer bump (or an O(1) seek on Buffer and Mmap streams) regardless of
+ * its size.
+ *
+ * @param in The input stream to read from.
+ * @param tag Tag returned by ReadTag().
+ * @return false on a malformed tag, an unknown wire type, or truncated input.
  */
-inline bool ReadFixed64(ZeroCopyInputStream* in, uint64_t &v) {
-    const uint8_t* ptr;
-    size_t n;
-    if (!in->Next(&ptr, &n) || n < 8) {
-        if (n > 0) {
-            in->BackUp(n);
+template <typename S>
+inline bool SkipField(BasicCodedInputStream<S>* in, uint32_t tag) {
+    if (TagFieldNumber(tag) == 0) return false;
+    switch (TagWireType(tag)) {
+        case WireType::VARINT: {
+            uint64_t value;
+            return in->ReadVarint64(value);
         }
-        return false;
+        case WireType::FIXED64:
+            return in->Skip(8);
+        case WireType::LENGTH_DELIMITED: {
+            uint32_t length;
+            if (!in->ReadVarint32(length)) return false;
+            return in->Skip(length);
+        }
+        case WireType::FIXED32:
+            return in->Skip(4);
     }
+    return false;
+}
 
-    v = static_cast<uint64_t>(ptr[0]);
-    v |= (static_cast<uint64_t>(ptr[1]) << 8);
-    v |=(static_cast<uint64_t>(ptr[2]) << 16);
-    v |= (static_cast<uint64_t>(ptr[3]) << 24);
-    v |= (static_cast<uint64_t>(ptr[4]) << 32);
-    v |=(static_cast<uint64_t>(ptr[5]) << 40);
-    v |= (static_cast<uint64_t>(ptr[6]) << 48);
-    v |= (static_cast<uint64_t>(ptr[7]) << 56);
+template <InputStream S>
+inline bool SkipField(S* in, uint32_t tag) {
+    BasicCodedInputStream<S> coded(in);
+    return SkipField(&coded, tag);
+}
 
-    if (n > 8) {
-        in->BackUp(n - 8);
-    }
-    return true;
+/**
+ * @brief Serializes a 32-bit integer as tagged field 'field_number' (FIXED32).
+ * @param out The output stream to write to.
+ * @param field_number Field number (1..kMaxFieldNumber).
+ * @param value The integer value to serialize.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeInt32Field(BasicCodedOutputStream<S>* out, uint32_t field_number, int32_t value) {
+    if (!out->WriteTag(MakeTag(field_number, WireType::FIXED32))) return false;
+    return out->WriteFixed32(static_cast<uint32_t>(value));
+}
+
+template <OutputStream S>
+inline bool SerializeInt32Field(S* out, uint32_t field_number, int32_t value) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeInt32Field(&coded, field_number, value);
 }
 
 /**
- * @brief Writes a length-delimited byte array to the output stream.
- * 
- * This function first writes the length of the data as a varint (32-bit), 
- * then writes the raw bytes themselves. This is useful for writing strings 
- * or arbitrary binary blobs in a zero-copy, protobuf-style format.
- * 
- * @param out Pointer to the ZeroCopyOutputStream to write to.
- * @param data Pointer to the byte array to write.
- * @param len Length of the byte array.
- * @return true if the length and data were successfully written; false otherwise.
+ * @brief Serializes a 32-bit float as tagged field 'field_number' (FIXED32).
+ * @param out The output stream to write to.
+ * @param field_number Field number (1..kMaxFieldNumber).
+ * @param value The float value to serialize.
+ * @return true on success, false on failure.
  */
-inline bool WriteLengthDelimitedBytes(ZeroCopyOutputStream* out, const uint8_t* data, size_t len) {
-    if (!WriteVarint32(out, len)) return false;
-    return out->WriteRaw(data, len);
+template <typename S>
+inline bool SerializeFloat32Field(BasicCodedOutputStream<S>* out, uint32_t field_number, float value) {
+    if (!out->WriteTag(MakeTag(field_number, WireType::FIXED32))) return false;
+    return out->WriteFixed32(std::bit_cast<uint32_t>(value));
+}
+
+template <OutputStream S>
+inline bool SerializeFloat32Field(S* out, uint32_t field_number, float value) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeFloat32Field(&coded, field_number, value);
 }
 
 /**
- * @brief Reads a length-delimited byte sequence from the input stream.
- * @param in The input stream to read from.
- * @param out Span that will point to the read bytes.
- * @param persistent_buffer Optional buffer to hold data if not contiguous.
+ * @brief Serializes a string as tagged field 'field_number' (LENGTH_DELIMITED).
+ * @param out The output stream to write to.
+ * @param field_number Field number (1..kMaxFieldNumber).
+ * @param str The string to serialize.
  * @return true on success, false on failure.
  */
-inline bool ReadLengthDelimitedBytes(ZeroCopyInputStream* in,  std::span<const uint8_t>& out, std::shared_ptr<std::vector<uint8_t>>& persistent_buffer) {
-    uint32_t length;
-    if (!ReadVarint32(in, length)) return false;
+template <typename S>
+inline bool SerializeStringField(BasicCodedOutputStream<S>* out, uint32_t field_number, std::string_view str) {
+    if (!out->WriteTag(MakeTag(field_number, WireType::LENGTH_DELIMITED))) return false;
+    return WriteLengthDelimitedBytes(out, reinterpret_cast<const uint8_t*>(str.data()), str.size());
+}
 
-    const uint8_t* ptr;
-    size_t n;
-    if (!in->Next(&ptr, &n)) return false;
+template <OutputStream S>
+inline bool SerializeStringField(S* out, uint32_t field_number, std::string_view str) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeStringField(&coded, field_number, str);
+}
 
-    if (n >= length) {
-        out = std::span<const uint8_t>(ptr, length);
-        in->BackUp(n - length);
-        persistent_buffer.reset();
-        return true;
-    }
+/**
+ * @brief Serializes a 64-bit integer as tagged field 'field_number' (VARINT).
+ * @param out The output stream to write to.
+ * @param field_number Field number (1..kMaxFieldNumber).
+ * @param value The value to serialize.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeInt64Field(BasicCodedOutputStream<S>* out, uint32_t field_number, int64_t value) {
+    if (!out->WriteTag(MakeTag(field_number, WireType::VARINT))) return false;
+    return out->WriteVarint64(static_cast<uint64_t>(value));
+}
 
-    persistent_buffer = std::make_shared<std::vector<uint8_t>>(length);
-    if (!in->ReadRaw(persistent_buffer->data(), length)) return false;
+template <OutputStream S>
+inline bool SerializeInt64Field(S* out, uint32_t field_number, int64_t value) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeInt64Field(&coded, field_number, value);
+}
 
-    out = std::span<const uint8_t>(persistent_buffer->data(), length);
-    return true;
+/**
+ * @brief Serializes an unsigned 64-bit integer as tagged field 'field_number' (VARINT).
+ * @param out The output stream to write to.
+ * @param field_number Field number (1..kMaxFieldNumber).
+ * @param value The value to serialize.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeUInt64Field(BasicCodedOutputStream<S>* out, uint32_t field_number, uint64_t value) {
+    if (!out->WriteTag(MakeTag(field_number, WireType::VARINT))) return false;
+    return out->WriteVarint64(value);
 }
 
-// ===========================
-// Serialization Apis
-// ===========================
+template <OutputStream S>
+inline bool SerializeUInt64Field(S* out, uint32_t field_number, uint64_t value) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeUInt64Field(&coded, field_number, value);
+}
 
 /**
- * @brief Enumeration of supported serialization types.
+ * @brief Serializes a zigzag-encoded 32-bit integer as tagged field 'field_number' (VARINT).
+ * @param out The output stream to write to.
+ * @param field_number Field number (1..kMaxFieldNumber).
+ * @param value The value to serialize.
+ * @return true on success, false on failure.
  */
-enum class Type : uint8_t { 
-    INT32 = 1, 
-    FLOAT32 = 2, 
-    STRING = 3
-};
+template <typename S>
+inline bool SerializeSInt32Field(BasicCodedOutputStream<S>* out, uint32_t field_number, int32_t value) {
+    if (!out->WriteTag(MakeTag(field_number, WireType::VARINT))) return false;
+    return out->WriteVarint32(ZigZagEncode32(value));
+}
+
+template <OutputStream S>
+inline bool SerializeSInt32Field(S* out, uint32_t field_number, int32_t value) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeSInt32Field(&coded, field_number, value);
+}
 
 /**
- * @brief Serializes a 32-bit integer to the output stream.
+ * @brief Serializes a zigzag-encoded 64-bit integer as tagged field 'field_number' (VARINT).
  * @param out The output stream to write to.
- * @param value The integer value to serialize.
+ * @param field_number Field number (1..kMaxFieldNumber).
+ * @param value The value to serialize.
  * @return true on success, false on failure.
  */
-inline bool SerializeInt32(ZeroCopyOutputStream* out, int32_t value) {
-    uint8_t tag = static_cast<uint8_t>(Type::INT32);
-    
-    if (!out->WriteRaw(&tag, 1)) return false;
-    return WriteFixed32(out, static_cast<uint32_t>(value));
+template <typename S>
+inline bool SerializeSInt64Field(BasicCodedOutputStream<S>* out, uint32_t field_number, int64_t value) {
+    if (!out->WriteTag(MakeTag(field_number, WireType::VARINT))) return false;
+    return out->WriteVarint64(ZigZagEncode64(value));
+}
+
+template <OutputStream S>
+inline bool SerializeSInt64Field(S* out, uint32_t field_number, int64_t value) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeSInt64Field(&coded, field_number, value);
 }
 
 /**
- * @brief Deserializes a 32-bit integer from the input stream.
- * @param in The input stream to read from.
- * @param value The integer variable to store the deserialized value.
+ * @brief Serializes a 64-bit word as tagged field 'field_number' (FIXED64).
+ * @param out The output stream to write to.
+ * @param field_number Field number (1..kMaxFieldNumber).
+ * @param value The value to serialize.
  * @return true on success, false on failure.
  */
-inline bool DeserializeInt32(ZeroCopyInputStream* in, int32_t& value) {
-    uint8_t tag;
-    if (!in->ReadRaw(&tag, 1)) return false;
-    if (tag != static_cast<uint8_t>(Type::INT32)) return false;
+template <typename S>
+inline bool SerializeFixed64Field(BasicCodedOutputStream<S>* out, uint32_t field_number, uint64_t value) {
+    if (!out->WriteTag(MakeTag(field_number, WireType::FIXED64))) return false;
+    return out->WriteFixed64(value);
+}
 
-    uint32_t tmp;
-    if (!ReadFixed32(in, tmp)) return false;
-    value = static_cast<int32_t>(tmp);
-    return true;
+template <OutputStream S>
+inline bool SerializeFixed64Field(S* out, uint32_t field_number, uint64_t value) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeFixed64Field(&coded, field_number, value);
 }
 
 /**
- * @brief Serializes a 32-bit float to the output stream.
+ * @brief Serializes a 64-bit double as tagged field 'field_number' (FIXED64).
  * @param out The output stream to write to.
- * @param value The float value to serialize.
+ * @param field_number Field number (1..kMaxFieldNumber).
+ * @param value The value to serialize.
  * @return true on success, false on failure.
  */
-inline bool SerializeFloat32(ZeroCopyOutputStream* out, float value) {
-    uint8_t tag = static_cast<uint8_t>(Type::FLOAT32);
-    if (!out->WriteRaw(&tag, 1)) return false;
+template <typename S>
+inline bool SerializeDoubleField(BasicCodedOutputStream<S>* out, uint32_t field_number, double value) {
+    if (!out->WriteTag(MakeTag(field_number, WireType::FIXED64))) return false;
+    return out->WriteFixed64(std::bit_cast<uint64_t>(value));
+}
 
-    uint32_t bits;
-    std::memcpy(&bits, &value, sizeof(bits));
-    return WriteFixed32(out, bits);
+template <OutputStream S>
+inline bool SerializeDoubleField(S* out, uint32_t field_number, double value) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeDoubleField(&coded, field_number, value);
 }
 
 /**
- * @brief Deserializes a 32-bit float from the input stream.
- * @param in The input stream to read from.
- * @param value The float variable to store the deserialized value.
+ * @brief Serializes a bool as tagged field 'field_number' (VARINT).
+ * @param out The output stream to write to.
+ * @param field_number Field number (1..kMaxFieldNumber).
+ * @param value The value to serialize.
  * @return true on success, false on failure.
  */
-inline bool DeserializeFloat32(ZeroCopyInputStream* in, float& value) {
-    uint8_t tag;
-    if (!in->ReadRaw(&tag, 1)) return false;
-    if (tag != static_cast<uint8_t>(Type::FLOAT32)) return false;
+template <typename S>
+inline bool SerializeBoolField(BasicCodedOutputStream<S>* out, uint32_t field_number, bool value) {
+    if (!out->WriteTag(MakeTag(field_number, WireType::VARINT))) return false;
+    return out->WriteByte(value ? 1 : 0);
+}
 
-    uint32_t bits;
-    if (!ReadFixed32(in, bits)) return false;
+template <OutputStream S>
+inline bool SerializeBoolField(S* out, uint32_t field_number, bool value) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeBoolField(&coded, field_number, value);
+}
 
-    std::memcpy(&value, &bits, sizeof(value));
-    return true;
+/**
+ * @brief Serializes raw bytes as tagged field 'field_number' (LENGTH_DELIMITED).
+ * @param out The output stream to write to.
+ * @param field_number Field number (1..kMaxFieldNumber).
+ * @param bytes The bytes to serialize.
+ * @return true on success, false on failure.
+ */
+template <typename S>
+inline bool SerializeBytesField(BasicCodedOutputStream<S>* out, uint32_t field_number, std::span<const uint8_t> bytes) {
+    if (!out->WriteTag(MakeTag(field_number, WireType::LENGTH_DELIMITED))) return false;
+    return WriteLengthDelimitedBytes(out, bytes.data(), bytes.size());
+}
+
+template <OutputStream S>
+inline bool SerializeBytesField(S* out, uint32_t field_number, std::span<const uint8_t> bytes) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeBytesField(&coded, field_number, bytes);
 }
 
 /**
- * @brief Serializes a string to the output stream.
+ * @brief Writes the tag and length of nested message field 'field_number'.
+ *        The message body (of exactly 'size' bytes) must follow.
  * @param out The output stream to write to.
- * @param str The string to serialize.
+ * @param field_number Field number (1..kMaxFieldNumber).
+ * @param size Encoded size of the message body.
  * @return true on success, false on failure.
  */
-inline bool SerializeString(ZeroCopyOutputStream* out, const std::string& str) {
-    uint8_t tag = static_cast<uint8_t>(Type::STRING);
-    if (!out->WriteRaw(&tag, 1)) return false;
+template <typename S>
+inline bool SerializeMessageFieldHeader(BasicCodedOutputStream<S>* out, uint32_t field_number, size_t size) {
+    if (!out->WriteTag(MakeTag(field_number, WireType::LENGTH_DELIMITED))) return false;
+    return out->WriteVarint32(static_cast<uint32_t>(size));
+}
 
-    if (!WriteVarint32(out, static_cast<uint32_t>(str.size()))) return false;
+template <OutputStream S>
+inline bool SerializeMessageFieldHeader(S* out, uint32_t field_number, size_t size) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializeMessageFieldHeader(&coded, field_number, size);
+}
+
+/**
+ * @brief Serializes a packed fixed-width array as tagged field 'field_number'
+ *        (LENGTH_DELIMITED). Read the payload back with ReadPackedFixed().
+ * @param out The output stream to write to.
+ * @param field_number Field number (1..kMaxFieldNumber).
+ * @param values Pointer to the first value.
+ * @param n Number of values.
+ * @return true on success, false on failure.
+ */
+template <FixedWidth T, typename S>
+inline bool SerializePackedFixedField(BasicCodedOutputStream<S>* out, uint32_t field_number, const T* values, size_t n) {
+    if (!out->WriteTag(MakeTag(field_number, WireType::LENGTH_DELIMITED))) return false;
+    return WritePackedFixed(out, values, n);
+}
 
-    return out->WriteRaw(reinterpret_cast<const uint8_t*>(str.data()), str.size());
+template <FixedWidth T, OutputStream S>
+inline bool SerializePackedFixedField(S* out, uint32_t field_number, const T* values, size_t n) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializePackedFixedField(&coded, field_number, values, n);
 }
 
 /**
- * @brief Deserializes a string from the input stream.
- * @param in The input stream to read from.
- * @param str The string to store the deserialized data (if copy is needed).
- * @param persistent_buffer Optional buffer to hold data if not contiguous.
- * @param str_view String view pointing to the deserialized data.
+ * @brief Serializes a packed varint32 array as tagged field 'field_number'
+ *        (LENGTH_DELIMITED). Read the payload back with ReadPackedVarint32().
+ * @param out The output stream to write to.
+ * @param field_number Field number (1..kMaxFieldNumber).
+ * @param values Pointer to the first value.
+ * @param n Number of values.
  * @return true on success, false on failure.
  */
-inline bool DeserializeString(
-    ZeroCopyInputStream* in,
-    std::string& str,
-    std::shared_ptr<std::vector<uint8_t>>& persistent_buffer,
-    std::string_view& str_view)
-{
-    std::span<const uint8_t> bytes;
+template <typename S>
+inline bool SerializePackedVarint32Field(BasicCodedOutputStream<S>* out, uint32_t field_number, const uint32_t* values, size_t n) {
+    if (!out->WriteTag(MakeTag(field_number, WireType::LENGTH_DELIMITED))) return false;
+    return WritePackedVarint32(out, values, n);
+}
 
-    if (!ReadLengthDelimitedBytes(in, bytes, persistent_buffer)) {
-        return false;
-    }
+template <OutputStream S>
+inline bool SerializePackedVarint32Field(S* out, uint32_t field_number, const uint32_t* values, size_t n) {
+    BasicCodedOutputStream<S> coded(out);
+    return SerializePackedVarint32Field(&coded, field_number, values, n);
+}
 
-    if (persistent_buffer) {
-        str.assign(reinterpret_cast<const char*>(bytes.data()), bytes.size());
-        str_view = str;
-    } else {
-        str_view = std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size());
-    }
+/**
+ * @brief Serializes a packed array of typed varints as tagged field
+ *        'field_number' (LENGTH_DELIMITED). Read the payload back with
+ *        ReadPackedVarint() and the same 'ZigZag'.
+ * @param out The output stream to write to.
+ * @param field_number Field number (1..kMaxFieldNumber).
+ * @param values The values to serialize.
+ * @return true on success, false on failure.
+ */
+template <bool ZigZag = false, typename T, typename S>
+inline bool SerializePackedVarintField(BasicCodedOutputStream<S>* out, uint32_t field_number, const std::vector<T>& values) {
+    if (!out->WriteTag(MakeTag(field_number, WireType::LENGTH_DELIMITED))) return false;
+    return WritePackedVarint<ZigZag>(out, values);
+}
 
-    return true;
+// ===========================
+// Size Computation & Unchecked Array Writers
+// ===========================
+//
+// Exact encoded sizes let a serializer reserve a message's bytes once (e.g.
+// with CodedOutputStream::GetDirectBufferForNBytesAndAdvance) and then fill
+// them with the *ToArray writers below, which bump a raw pointer with no
+// bounds or space checks. The positional ones live in Unchecked Array Codecs.
+
+/// Encoded size of the tag for 'field_number'.
+constexpr size_t TagSize(uint32_t field_number) {
+    return VarintSize32(MakeTag(field_number, WireType::VARINT));
+}
+
+/// Encoded size of a tagged FIXED32 field (INT32 or FLOAT32).
+constexpr size_t Fixed32FieldSize(uint32_t field_number) {
+    return TagSize(field_number) + 4;
+}
+
+/// Encoded size of a tagged LENGTH_DELIMITED field with 'len' payload bytes.
+constexpr size_t LengthDelimitedFieldSize(uint32_t field_number, size_t len) {
+    return TagSize(field_number) + LengthDelimitedSize(len);
+}
+
+/// Writes 'tag' into 'target' without bounds checks; returns the end pointer.
+inline uint8_t* WriteTagToArray(uint8_t* target, uint32_t tag) {
+    return CodedOutputStream::EncodeVarint(target, tag);
+}
+
+/// Unchecked SerializeInt32Field(); 'target' needs Fixed32FieldSize() bytes.
+inline uint8_t* SerializeInt32FieldToArray(uint8_t* target, uint32_t field_number, int32_t value) {
+    target = WriteTagToArray(target, MakeTag(field_number, WireType::FIXED32));
+    StoreLittleEndian32(target, static_cast<uint32_t>(value));
+    return target + 4;
+}
+
+/// Unchecked SerializeFloat32Field(); 'target' needs Fixed32FieldSize() bytes.
+inline uint8_t* SerializeFloat32FieldToArray(uint8_t* target, uint32_t field_number, float value) {
+    target = WriteTagToArray(target, MakeTag(field_number, WireType::FIXED32));
+    StoreLittleEndian32(target, std::bit_cast<uint32_t>(value));
+    return target + 4;
+}
+
+/// Unchecked SerializeStringField(); 'target' needs LengthDelimitedFieldSize() bytes.
+inline uint8_t* SerializeStringFieldToArray(uint8_t* target, uint32_t field_number, std::string_view str) {
+    target = WriteTagToArray(target, MakeTag(field_number, WireType::LENGTH_DELIMITED));
+    return WriteLengthDelimitedBytesToArray(target, reinterpret_cast<const uint8_t*>(str.data()), str.size());
+}
+
+/// Unchecked SerializeMessageFieldHeader(); the 'size' body bytes follow.
+inline uint8_t* SerializeMessageFieldHeaderToArray(uint8_t* target, uint32_t field_number, size_t size) {
+    target = WriteTagToArray(target, MakeTag(field_number, WireType::LENGTH_DELIMITED));
+    return CodedOutputStream::EncodeVarint(target, static_cast<uint32_t>(size));
+}
+
+/// Encoded size of a tagged VARINT field whose varint is 'value'.
+constexpr size_t VarintFieldSize(uint32_t field_number, uint64_t value) {
+    return TagSize(field_number) + VarintSize64(value);
+}
+
+/// Encoded size of a tagged FIXED64 field (FIXED64 or DOUBLE).
+constexpr size_t Fixed64FieldSize(uint32_t field_number) {
+    return TagSize(field_number) + 8;
+}
+
+/// Unchecked SerializeInt64Field(); 'target' needs VarintFieldSize() bytes.
+inline uint8_t* SerializeInt64FieldToArray(uint8_t* target, uint32_t field_number, int64_t value) {
+    target = WriteTagToArray(target, MakeTag(field_number, WireType::VARINT));
+    return CodedOutputStream::EncodeVarint(target, static_cast<uint64_t>(value));
+}
+
+/// Unchecked SerializeUInt64Field(); 'target' needs VarintFieldSize() bytes.
+inline uint8_t* SerializeUInt64FieldToArray(uint8_t* target, uint32_t field_number, uint64_t value) {
+    target = WriteTagToArray(target, MakeTag(field_number, WireType::VARINT));
+    return CodedOutputStream::EncodeVarint(target, value);
+}
+
+/// Unchecked SerializeSInt32Field(); 'target' needs VarintFieldSize() bytes.
+inline uint8_t* SerializeSInt32FieldToArray(uint8_t* target, uint32_t field_number, int32_t value) {
+    target = WriteTagToArray(target, MakeTag(field_number, WireType::VARINT));
+    return CodedOutputStream::EncodeVarint(target, ZigZagEncode32(value));
+}
+
+/// Unchecked SerializeSInt64Field(); 'target' needs VarintFieldSize() bytes.
+inline uint8_t* SerializeSInt64FieldToArray(uint8_t* target, uint32_t field_number, int64_t value) {
+    target = WriteTagToArray(target, MakeTag(field_number, WireType::VARINT));
+    return CodedOutputStream::EncodeVarint(target, ZigZagEncode64(value));
+}
+
+/// Unchecked SerializeFixed64Field(); 'target' needs Fixed64FieldSize() bytes.
+inline uint8_t* SerializeFixed64FieldToArray(uint8_t* target, uint32_t field_number, uint64_t value) {
+    target = WriteTagToArray(target, MakeTag(field_number, WireType::FIXED64));
+    StoreLittleEndian64(target, value);
+    return target + 8;
+}
+
+/// Unchecked SerializeDoubleField(); 'target' needs Fixed64FieldSize() bytes.
+inline uint8_t* SerializeDoubleFieldToArray(uint8_t* target, uint32_t field_number, double value) {
+    target = WriteTagToArray(target, MakeTag(field_number, WireType::FIXED64));
+    StoreLittleEndian64(target, std::bit_cast<uint64_t>(value));
+    return target + 8;
+}
+
+/// Unchecked SerializeBoolField(); 'target' needs TagSize() + 1 bytes.
+inline uint8_t* SerializeBoolFieldToArray(uint8_t* target, uint32_t field_number, bool value) {
+    target = WriteTagToArray(target, MakeTag(field_number, WireType::VARINT));
+    *target = value ? 1 : 0;
+    return target + 1;
+}
+
+/// Unchecked SerializeBytesField(); 'target' needs LengthDelimitedFieldSize() bytes.
+inline uint8_t* SerializeBytesFieldToArray(uint8_t* target, uint32_t field_number, std::span<const uint8_t> bytes) {
+    target = WriteTagToArray(target, MakeTag(field_number, WireType::LENGTH_DELIMITED));
+    return WriteLengthDelimitedBytesToArray(target, bytes.data(), bytes.size());
+}
+
+/// Encoded size of a packed fixed-width array body: length prefix + raw values.
+template <FixedWidth T>
+constexpr size_t PackedFixedSize(size_t n) {
+    return LengthDelimitedSize(n * sizeof(T));
+}
+
+/// Encoded size of a packed varint array body: length prefix + varints.
+template <bool ZigZag = false, typename T>
+inline size_t PackedVarintSize(const std::vector<T>& values) {
+    return LengthDelimitedSize(PackedVarintPayloadSize<ZigZag>(values));
+}
+
+/**
+ * @brief Writes a packed fixed-width array (length + raw values) into 'target'
+ *        without bounds checks.
+ * @param target Destination with room for PackedFixedSize<T>(n) bytes.
+ * @return Pointer one past the last byte written.
+ */
+template <FixedWidth T>
+inline uint8_t* WritePackedFixedToArray(uint8_t* target, const T* values, size_t n) {
+    target = CodedOutputStream::EncodeVarint(target, static_cast<uint32_t>(n * sizeof(T)));
+    CopyToLittleEndian(target, values, n);
+    return target + n * sizeof(T);
+}
+
+/// Unchecked SerializePackedFixedField(); 'target' needs
+/// TagSize(field_number) + PackedFixedSize<T>(n) bytes.
+template <FixedWidth T>
+inline uint8_t* SerializePackedFixedFieldToArray(uint8_t* target, uint32_t field_number, const T* values, size_t n) {
+    target = WriteTagToArray(target, MakeTag(field_number, WireType::LENGTH_DELIMITED));
+    return WritePackedFixedToArray(target, values, n);
 }
 
+/// Unchecked SerializePackedVarintField(); 'target' needs
+/// TagSize(field_number) + PackedVarintSize<ZigZag>(values) bytes.
+template <bool ZigZag = false, typename T>
+inline uint8_t* SerializePackedVarintFieldToArray(uint8_t* target, uint32_t field_number, const std::vector<T>& values) {
+    target = WriteTagToArray(target, MakeTag(field_number, WireType::LENGTH_DELIMITED));
+    target = CodedOutputStream::EncodeVarint(target, static_cast<uint32_t>(PackedVarintPayloadSize<ZigZag>(values)));
+    for (T v : values) target = CodedOutputStream::EncodeVarint(target, detail::PackedVarintValue<ZigZag>(v));
+    return target;
+}
 
-}}
\ No newline at end of file
+}}
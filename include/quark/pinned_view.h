@@ -0,0 +1,64 @@
+#pragma once
+// pinned_view.h
+// A string view that keeps the memory it points into alive. Decoding from
+// chunks that carry a refcounted owner (see MultiBufferInputStream::Chunk)
+// yields views that share that owner, so a network buffer is released only
+// when the last view into it is dropped.
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace quark {
+
+/**
+ * @class PinnedView
+ * @brief Read-only bytes plus a reference to whatever owns them.
+ *
+ * The owner is type-erased (std::shared_ptr<const void>), so any buffer
+ * type can be pinned: a std::vector, a pooled network buffer, a mapping.
+ * Copying a PinnedView copies the reference, never the bytes.
+ *
+ * Example usage:
+ * quark::PinnedView name;
+ * DeserializeString(&coded, name);
+ * names.push_back(std::move(name));   // input chunks may be dropped now
+ */
+class PinnedView {
+public:
+    PinnedView() = default;
+
+    /// @param view Bytes owned (directly or indirectly) by 'owner'
+    PinnedView(std::string_view view, std::shared_ptr<const void> owner)
+        : view_(view), owner_(std::move(owner)) {}
+
+    /// Makes a view that owns a private copy of 'bytes'.
+    static PinnedView Copy(std::string_view bytes) {
+        auto copy = std::make_shared<const std::string>(bytes);
+        std::string_view view = *copy;
+        return PinnedView(view, std::move(copy));
+    }
+
+    std::string_view view() const { return view_; }
+    operator std::string_view() const { return view_; }
+
+    const char* data() const { return view_.data(); }
+    size_t size() const { return view_.size(); }
+    bool empty() const { return view_.empty(); }
+
+    /// The reference keeping the bytes alive; null only for a default-constructed view.
+    const std::shared_ptr<const void>& owner() const { return owner_; }
+
+    /// Drops the view and its reference.
+    void Reset() {
+        view_ = {};
+        owner_.reset();
+    }
+
+private:
+    std::string_view view_;
+    std::shared_ptr<const void> owner_;
+};
+
+}
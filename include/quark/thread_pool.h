@@ -0,0 +1,185 @@
+#pragma once
+// thread_pool.h
+// Fixed-size work-stealing thread pool for data-parallel loops (batch
+// encode/decode). Each worker owns a task queue; an idle worker steals from
+// the others, so uneven shards still keep every core busy.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace quark {
+
+/**
+ * @class ThreadPool
+ * @brief Runs ParallelFor() loops on a set of long-lived threads.
+ *
+ * The calling thread takes part as the last worker, so a pool with zero
+ * threads runs everything inline. Each worker index in [0, concurrency())
+ * is used by one thread at a time, so per-worker scratch (an Arena, an
+ * output buffer) can be indexed by it without locking.
+ *
+ * Example usage:
+ * quark::ThreadPool pool(7);
+ * std::vector<quark::Arena> arenas(pool.concurrency());
+ * pool.ParallelFor(shards, [&](size_t shard, size_t worker) {
+ *     Decode(shard, &arenas[worker]);
+ * });
+ */
+class ThreadPool {
+public:
+    /// @param threads Background threads; the caller of ParallelFor() adds one more.
+    explicit ThreadPool(size_t threads = DefaultThreads())
+        : queues_(std::make_unique<Queue[]>(threads + 1)), concurrency_(threads + 1),
+          invoke_(nullptr), context_(nullptr), remaining_(0), generation_(0), stop_(false) {
+        threads_.reserve(threads);
+        for (size_t w = 0; w < threads; ++w) threads_.emplace_back([this, w] { WorkerLoop(w); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (std::thread& t : threads_) t.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// Hardware threads minus the caller's.
+    static size_t DefaultThreads() {
+        unsigned n = std::thread::hardware_concurrency();
+        return n > 1 ? n - 1 : 0;
+    }
+
+    /// Threads that run tasks, including the caller of ParallelFor().
+    size_t concurrency() const { return concurrency_; }
+
+    /**
+     * @brief Calls fn(task, worker) for every task in [0, n) and waits for all of them.
+     *
+     * Tasks are dealt out in contiguous runs, one run per worker queue, and
+     * rebalanced by stealing. Concurrent calls are serialized. If a task
+     * throws, the remaining tasks still run and the first exception is
+     * rethrown here.
+     */
+    template <typename Fn>
+    void ParallelFor(size_t n, Fn&& fn) {
+        if (n == 0) return;
+        std::lock_guard<std::mutex> run(run_mu_);
+        if (concurrency_ == 1 || n == 1) {
+            for (size_t i = 0; i < n; ++i) fn(i, concurrency_ - 1);
+            return;
+        }
+
+        using F = std::remove_reference_t<Fn>;
+        invoke_ = [](void* ctx, size_t task, size_t worker) { (*static_cast<F*>(ctx))(task, worker); };
+        context_ = const_cast<void*>(static_cast<const void*>(&fn));
+        error_ = nullptr;
+        remaining_.store(n, std::memory_order_relaxed);
+        for (size_t q = 0; q < concurrency_; ++q) {
+            std::lock_guard<std::mutex> lock(queues_[q].mu);
+            for (size_t i = q * n / concurrency_; i < (q + 1) * n / concurrency_; ++i) {
+                queues_[q].tasks.push_back(i);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        while (RunOne(concurrency_ - 1)) {}
+        std::unique_lock<std::mutex> lock(mu_);
+        done_.wait(lock, [this] { return remaining_.load(std::memory_order_acquire) == 0; });
+        if (error_) std::rethrow_exception(error_);
+    }
+
+private:
+    /// One worker's tasks: the owner pops from the front, thieves from the back.
+    struct alignas(64) Queue {
+        std::mutex mu;
+        std::deque<size_t> tasks;
+    };
+
+    void WorkerLoop(size_t worker) {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mu_);
+                wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_) return;
+                seen = generation_;
+            }
+            while (RunOne(worker)) {}
+        }
+    }
+
+    /// Runs one task from the worker's own queue or stolen from another's.
+    bool RunOne(size_t worker) {
+        size_t task;
+        if (!Pop(worker, task)) return false;
+        try {
+            invoke_(context_, task, worker);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (!error_) error_ = std::current_exception();
+        }
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(mu_);
+            done_.notify_all();
+        }
+        return true;
+    }
+
+    bool Pop(size_t worker, size_t& task) {
+        {
+            Queue& own = queues_[worker];
+            std::lock_guard<std::mutex> lock(own.mu);
+            if (!own.tasks.empty()) {
+                task = own.tasks.front();
+                own.tasks.pop_front();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < concurrency_; ++i) {
+            Queue& victim = queues_[(worker + i) % concurrency_];
+            std::lock_guard<std::mutex> lock(victim.mu);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.back();
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<std::thread> threads_;
+    std::unique_ptr<Queue[]> queues_;       // One per worker; the caller's is last
+    size_t concurrency_;                    // threads_.size() + 1
+
+    // current loop, valid while tasks remain
+    void (*invoke_)(void*, size_t, size_t);
+    void* context_;
+    std::atomic<size_t> remaining_;         // Tasks not yet finished
+    std::exception_ptr error_;              // First exception thrown by a task
+
+    std::mutex run_mu_;                     // Serializes ParallelFor() calls
+    std::mutex mu_;                         // Guards generation_, stop_, error_
+    std::condition_variable wake_;          // Workers wait here for a new loop
+    std::condition_variable done_;          // ParallelFor() waits here for the last task
+    uint64_t generation_;                   // Bumped once per loop
+    bool stop_;
+};
+
+}
@@ -1,83 +1,81 @@
 #pragma once
+// tlv.hpp
+// Raw-buffer form of the positional encoding, kept for existing callers.
+// These are thin wrappers over the unchecked *ToArray / *FromArray codecs in
+// quark/io/zero_copy_stream.h, so both APIs produce identical bytes
+// (little-endian on every host). Nothing here checks bounds: size buffers
+// with the serialized_size_* helpers. New code should write through a
+// CodedOutputStream, which runs the same codecs inside its window and only
+// takes the checked path at window edges.
+
 #include <cstdint>
 #include <cstring>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <stdexcept>
 
+#include "quark/io/zero_copy_stream.h"
+
 namespace quark {
-    enum class Type : uint8_t {
-        INT32 = 1,
-        FLOAT32 = 2,
-        STRING = 3
-    };
+    using io::Type;
 
     // protobuf-like varint encoding
     // varints store integers in a variable number of bytes
-    // each byte will encoe 7 bits of the integer
-    // the most significant bit of each byte will be the continuation byte
+    // each byte will encode 7 bits of the integer
+    // the most significant bit of each byte will be the continuation bit
     //      1 -> more bytes to come
-    //      2 -> this is the last byte
-
-    // this funciton stores a variable uint of up to 32 bits in
-    // a buffer of uint8s
+    //      0 -> this is the last byte
     // more on varint encoding: https://protobuf.dev/programming-guides/encoding/
 
+    // stores a variable uint of up to 32 bits in 'buffer'
+    // returns the number of bytes written
     inline size_t encode_varint(uint32_t value, uint8_t* buffer) {
-        ssize_t i = 0;
-        while (value > 127) {
-            // 0x7F = 0111 1111, this masks the lowest 7 bytes
-            // 0x80 = 1000 0000, this sets the ocntinuation bit
-            buffer[i++] = static_cast<uint8_t>((value & 0x7F) | 0x80);
-            value >>= 7;
-        }
-        buffer[i++] = static_cast<uint8_t>(value & 0x7F);
-        return i;
+        return io::CodedOutputStream::EncodeVarint(buffer, value) - buffer;
     }
 
     // decodes varint
-    // see how encoding works
+    // returns the number of bytes consumed
     inline size_t decode_varint(const uint8_t* buffer, uint32_t& value) {
         value = 0;
-        ssize_t shift = 0;
-        ssize_t i = 0;
-        while (true) {
+        size_t i = 0;
+        for (int shift = 0;; shift += 7) {
+            if (shift >= 7 * io::kMaxVarint32Bytes) throw std::runtime_error("Varint too long");
             uint8_t byte = buffer[i++];
-            value |= (byte & 0x7F) << shift;
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
             if (!(byte & 0x80)) break;
-            shift += 7;
-            if (shift > 28) throw std::runtime_error("Varint too long");
         }
         return i;
     }
 
+    // number of bytes encode_varint will write for value
+    inline size_t varint_size(uint32_t value) { return io::VarintSize32(value); }
+
+    // exact buffer sizes for the serialize_* functions below
+    // so callers can size buffers instead of guessing
+    inline size_t serialized_size_int32() { return io::kInt32FieldSize; }
+    inline size_t serialized_size_float32() { return io::kFloat32FieldSize; }
+    inline size_t serialized_size_string(const std::string& str) { return io::StringFieldSize(str.size()); }
+
     // type tag is stored at the first byte of the buffer
     // return num bytes written (tracks next spot in buffer)
     // [ INT32 | int32_data ]
     inline size_t serialize_int32(uint8_t* buffer, int32_t value) {
-        buffer[0] = static_cast<uint8_t>(Type::INT32);
-        std::memcpy(buffer + 1, &value, sizeof(int32_t));
-        return 1 + sizeof(int32_t);
+        return io::SerializeInt32ToArray(buffer, value) - buffer;
     }
 
-    // return value of deserialize int32
-    inline size_t deserialize_int32(const uint8_t* buffer) {
-        if (buffer[0] != static_cast<uint8_t>(Type::INT32)) {
+    inline int32_t deserialize_int32(const uint8_t* buffer) {
+        int32_t value;
+        if (io::DeserializeInt32FromArray(buffer, value) == nullptr) {
             throw std::runtime_error("Type mismatch: expected INT32");
         }
-
-        int32_t value;
-        std::memcpy(&value, buffer + 1, sizeof(int32_t));
         return value;
     }
 
     // encode string
     // [ String | Length | string_data ]
     inline size_t serialize_string(uint8_t* buffer, const std::string& str) {
-        buffer[0] = static_cast<uint8_t>(Type::STRING);
-        size_t len_bytes = encode_varint(str.size(), buffer + 1);
-        std::memcpy(buffer + 1 + len_bytes, str.data(), str.size());
-        return 1 + len_bytes + str.size();
+        return io::SerializeStringToArray(buffer, str) - buffer;
     }
 
     // out_size tells the caller how many bytes were consumed from the buffer
@@ -85,27 +83,23 @@ namespace quark {
         if (buffer[0] != static_cast<uint8_t>(Type::STRING)) {
             throw std::runtime_error("Type mismatch: expected STRING");
         }
-
-        uint32_t len;
-        ssize_t len_bytes = decode_varint(buffer + 1, len);
-        out_size = 1 + len_bytes + len;
-        return std::string(reinterpret_cast<const char*>(buffer + 1 + len_bytes), len);
+        std::string_view str;
+        const uint8_t* end = io::DeserializeStringFromArray(buffer, str);
+        if (end == nullptr) throw std::runtime_error("Varint too long");
+        out_size = end - buffer;
+        return std::string(str);
     }
 
     // [ FLOAT32 | float_data ]
     inline size_t serialize_float32(uint8_t* buffer, float value) {
-        buffer[0] = static_cast<uint8_t>(Type::FLOAT32);
-        std::memcpy(buffer + 1, &value, sizeof(float));
-        return 1 + sizeof(float);
+        return io::SerializeFloat32ToArray(buffer, value) - buffer;
     }
 
     inline float deserialize_float32(const uint8_t* buffer) {
-        if (buffer[0] != static_cast<uint8_t>(Type::FLOAT32)) {
+        float value;
+        if (io::DeserializeFloat32FromArray(buffer, value) == nullptr) {
             throw std::runtime_error("Type mismatch: expected FLOAT32");
         }
-
-        float value;
-        std::memcpy(&value, buffer + 1, sizeof(float));
         return value;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include "quark/arena.h"
+#include "quark/io/zero_copy_stream.h"
+
+using namespace quark;
+using namespace quark::io;
+
+// ---------------------------
+// Allocation Tests
+// ---------------------------
+TEST(Arena, AlignedBumpAllocation) {
+    Arena arena(256);
+    uint8_t* a = static_cast<uint8_t*>(arena.Allocate(3, 1));
+    uint64_t* b = arena.AllocateArray<uint64_t>(4);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % alignof(uint64_t), 0u);
+    EXPECT_GT(reinterpret_cast<uint8_t*>(b), a);
+    EXPECT_EQ(arena.SpaceUsed(), 3u + 32u);
+    EXPECT_EQ(arena.SpaceAllocated(), 256u);
+}
+
+TEST(Arena, LargeAllocationGetsOwnBlock) {
+    Arena arena(256);
+    arena.Allocate(10);
+    std::vector<uint8_t> big(10000, 7);
+    auto copy = arena.Copy(big.data(), big.size());
+    EXPECT_EQ(copy.size(), 10000u);
+    EXPECT_EQ(copy[9999], 7);
+    EXPECT_GE(arena.SpaceAllocated(), 10000u + 256u);
+}
+
+// Reset keeps one block and recycles the rest through the thread cache
+TEST(Arena, ResetReusesBlocks) {
+    // block size larger than anything earlier tests left in the thread cache
+    const size_t kBlock = 1 << 16;
+    Arena arena(kBlock);
+    std::vector<void*> handed_out;
+    for (int i = 0; i < 10; ++i) handed_out.push_back(arena.Allocate(40000));
+    EXPECT_EQ(arena.SpaceAllocated(), kBlock * 10);
+
+    arena.Reset();
+    EXPECT_EQ(arena.SpaceUsed(), 0u);
+    EXPECT_EQ(arena.SpaceAllocated(), kBlock);
+    EXPECT_EQ(arena.Allocate(40000), handed_out[0]);
+
+    // a second arena on this thread picks up a recycled block
+    Arena other(kBlock);
+    void* p = other.Allocate(40000);
+    EXPECT_NE(std::find(handed_out.begin(), handed_out.end(), p), handed_out.end());
+}
+
+// ---------------------------
+// Stream Integration Tests
+// ---------------------------
+
+// a string straddling chunks spills into the arena; a contiguous one aliases the input
+TEST(Arena, DeserializeStringSpillsIntoArena) {
+    VectorOutputStream vos;
+    SerializeString(&vos, "contiguous");
+    SerializeString(&vos, "straddles two frames");
+    const auto& buf = vos.buffer();
+
+    std::vector<MultiBufferInputStream::Chunk> chunks = {
+        {buf.data(), 20},
+        {buf.data() + 20, buf.size() - 20},
+    };
+    MultiBufferInputStream mb(chunks);
+    CodedInputStream in(&mb);
+
+    Arena arena;
+    std::string_view a, b;
+    EXPECT_TRUE(DeserializeString(&in, a, &arena));
+    EXPECT_TRUE(DeserializeString(&in, b, &arena));
+    EXPECT_EQ(a, "contiguous");
+    EXPECT_EQ(b, "straddles two frames");
+
+    EXPECT_GE(reinterpret_cast<const uint8_t*>(a.data()), buf.data());
+    EXPECT_LT(reinterpret_cast<const uint8_t*>(a.data()), buf.data() + buf.size());
+    EXPECT_EQ(arena.SpaceUsed(), b.size());
+}
+
+// a corrupt length inside a bounded sub-message fails before anything is reserved
+TEST(Arena, LengthPastLimitReservesNothing) {
+    // length varint 0xFFFFFFFF, then a few payload bytes split across chunks
+    std::vector<uint8_t> buf = {0xFF, 0xFF, 0xFF, 0xFF, 0x0F, 'a', 'b', 'c', 'd', 'e', 'f', 'g'};
+    std::vector<MultiBufferInputStream::Chunk> chunks = {
+        {buf.data(), 6},
+        {buf.data() + 6, buf.size() - 6},
+    };
+
+    {
+        MultiBufferInputStream mb(chunks);
+        CodedInputStream in(&mb);
+        in.PushLimit(buf.size());
+        Arena arena;
+        std::span<const uint8_t> out;
+        EXPECT_FALSE(ReadLengthDelimitedBytes(&in, out, &arena));
+        EXPECT_EQ(arena.SpaceAllocated(), 0u);
+    }
+    {
+        MultiBufferInputStream mb(chunks);
+        CodedInputStream in(&mb);
+        in.PushLimit(buf.size());
+        std::span<const uint8_t> out;
+        std::shared_ptr<std::vector<uint8_t>> spilled;
+        EXPECT_FALSE(ReadLengthDelimitedBytes(&in, out, spilled));
+        EXPECT_EQ(spilled, nullptr);
+    }
+}
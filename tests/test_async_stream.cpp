@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+#include "quark/io/async_stream.h"
+#include "quark/io/zero_copy_stream.h"
+
+using namespace quark::io;
+
+struct Record {
+    uint32_t id = 0;
+    uint32_t flags = 0;
+    uint64_t time = 0;
+    std::string name;
+    uint64_t big = 0;
+};
+
+static Record MakeRecord(uint32_t i) {
+    Record r;
+    r.id = i * 2654435761u;
+    r.flags = i;
+    r.time = 0x0123456789ABCDEFull ^ i;
+    r.name = std::string(i * 7 % 300, static_cast<char>('a' + i % 26));
+    r.big = ~0ull >> (i % 64);
+    return r;
+}
+
+static void Encode(VectorOutputStream* out, const Record& r) {
+    WriteVarint32(out, r.id);
+    WriteFixed32(out, r.flags);
+    WriteFixed64(out, r.time);
+    WriteLengthDelimitedBytes(out, reinterpret_cast<const uint8_t*>(r.name.data()), r.name.size());
+    WriteVarint64(out, r.big);
+}
+
+// every result is awaited into a local; see the GCC 12 note on Task
+static Task<bool> ParseRecord(AsyncInputStream& in, Record& r) {
+    bool ok = co_await in.ReadVarint32(r.id);
+    if (!ok) co_return false;
+    ok = co_await in.ReadFixed32(r.flags);
+    if (!ok) co_return false;
+    ok = co_await in.ReadFixed64(r.time);
+    if (!ok) co_return false;
+    ok = co_await in.ReadLengthDelimitedString(r.name);
+    if (!ok) co_return false;
+    ok = co_await in.ReadVarint64(r.big);
+    co_return ok;
+}
+
+static Task<bool> ParseAll(AsyncInputStream& in, std::vector<Record>& out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        Record r;
+        bool ok = co_await ParseRecord(in, r);
+        if (!ok) co_return false;
+        out.push_back(std::move(r));
+    }
+    co_return true;
+}
+
+static void ExpectSame(const Record& a, const Record& b) {
+    EXPECT_EQ(a.id, b.id);
+    EXPECT_EQ(a.flags, b.flags);
+    EXPECT_EQ(a.time, b.time);
+    EXPECT_EQ(a.name, b.name);
+    EXPECT_EQ(a.big, b.big);
+}
+
+// ---------------------------
+// Async Input Stream Tests
+// ---------------------------
+
+// every field type resumes correctly no matter where the chunks are cut;
+// the parse finishes exactly when the last byte lands
+TEST(AsyncStream, ParsesAcrossAnyChunking) {
+    VectorOutputStream vos;
+    for (uint32_t i = 0; i < 40; ++i) Encode(&vos, MakeRecord(i));
+    const auto& buf = vos.buffer();
+
+    for (size_t chunk : {1, 2, 3, 7, 64, 1000, 100000}) {
+        AsyncInputStream in;
+        std::vector<Record> got;
+        Task<bool> parse = ParseAll(in, got, 40);
+        parse.Start();
+        EXPECT_TRUE(in.waiting());
+        for (size_t pos = 0; pos < buf.size(); pos += chunk) {
+            EXPECT_FALSE(parse.done()) << "chunk " << chunk << " pos " << pos;
+            size_t n = std::min(chunk, buf.size() - pos);
+            EXPECT_EQ(in.Feed(buf.data() + pos, n), n);
+        }
+        ASSERT_TRUE(parse.done()) << "chunk " << chunk;
+        EXPECT_TRUE(parse.result());
+        EXPECT_FALSE(in.waiting());
+        EXPECT_EQ(in.ByteCount(), static_cast<int64_t>(buf.size()));
+        ASSERT_EQ(got.size(), 40u);
+        for (uint32_t i = 0; i < 40; ++i) ExpectSame(got[i], MakeRecord(i));
+    }
+}
+
+// bytes past the end of what the coroutine wants are handed back by Feed()
+TEST(AsyncStream, FeedReturnsUnconsumedTail) {
+    VectorOutputStream vos;
+    Encode(&vos, MakeRecord(5));
+    Encode(&vos, MakeRecord(6));
+    const auto& buf = vos.buffer();
+
+    AsyncInputStream in;
+    Record r;
+    Task<bool> parse = ParseRecord(in, r);
+    parse.Start();
+    size_t used = in.Feed(buf.data(), buf.size());
+    ASSERT_TRUE(parse.done());
+    EXPECT_TRUE(parse.result());
+    ExpectSame(r, MakeRecord(5));
+    EXPECT_EQ(in.ByteCount(), static_cast<int64_t>(used));
+
+    // the tail starts the next record
+    Record next;
+    Task<bool> again = ParseRecord(in, next);
+    again.Start();
+    EXPECT_EQ(in.Feed(buf.data() + used, buf.size() - used), buf.size() - used);
+    ASSERT_TRUE(again.done());
+    ExpectSame(next, MakeRecord(6));
+}
+
+TEST(AsyncStream, CloseFailsPendingRead) {
+    VectorOutputStream vos;
+    Encode(&vos, MakeRecord(100));
+    const auto& buf = vos.buffer();
+
+    AsyncInputStream in;
+    Record r;
+    Task<bool> parse = ParseRecord(in, r);
+    parse.Start();
+    in.Feed(buf.data(), 20);   // stops inside the string
+    EXPECT_FALSE(parse.done());
+    in.Close();
+    ASSERT_TRUE(parse.done());
+    EXPECT_FALSE(parse.result());
+
+    // reads after the end fail without suspending
+    AsyncInputStream empty;
+    empty.Close();
+    Task<bool> none = ParseRecord(empty, r);
+    none.Start();
+    ASSERT_TRUE(none.done());
+    EXPECT_FALSE(none.result());
+}
+
+TEST(AsyncStream, OverlongVarintFails) {
+    const uint8_t bad[6] = {0x80, 0x80, 0x80, 0x80, 0x80, 0x01};
+    for (size_t split : {1, 6}) {
+        AsyncInputStream in;
+        Record r;
+        Task<bool> parse = ParseRecord(in, r);
+        parse.Start();
+        in.Feed(bad, split);
+        if (split < 6) in.Feed(bad + split, 6 - split);
+        ASSERT_TRUE(parse.done());
+        EXPECT_FALSE(parse.result());
+    }
+}
+
+static Task<size_t> CountUntil(AsyncInputStream& in, uint8_t stop) {
+    size_t count = 0;
+    const uint8_t* block;
+    size_t size;
+    for (;;) {
+        bool ok = co_await in.Next(&block, &size);
+        if (!ok) break;
+        const uint8_t* hit = static_cast<const uint8_t*>(std::memchr(block, stop, size));
+        if (hit != nullptr) {
+            // leave the stop byte and everything after it unread
+            in.BackUp(size - (hit - block));
+            co_return count + (hit - block);
+        }
+        count += size;
+    }
+    co_return count;
+}
+
+// Next()/BackUp() give zero-copy access to each chunk
+TEST(AsyncStream, NextAndBackUp) {
+    AsyncInputStream in;
+    Task<size_t> count = CountUntil(in, '!');
+    count.Start();
+    EXPECT_EQ(in.Feed("hello ", 6), 6u);
+    EXPECT_FALSE(count.done());
+    EXPECT_EQ(in.Feed("world!tail", 10), 5u);
+    ASSERT_TRUE(count.done());
+    EXPECT_EQ(count.result(), 11u);
+    EXPECT_EQ(in.ByteCount(), 11);
+}
+
+static Task<bool> Throws(AsyncInputStream& in) {
+    uint8_t b;
+    bool ok = co_await in.ReadByte(b);
+    if (ok) throw std::runtime_error("bad byte");
+    co_return false;
+}
+
+TEST(AsyncStream, ExceptionsReachResult) {
+    AsyncInputStream in;
+    Task<bool> t = Throws(in);
+    t.Start();
+    in.Feed("x", 1);
+    ASSERT_TRUE(t.done());
+    EXPECT_THROW(t.result(), std::runtime_error);
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include "quark/io/batch_codec.h"
+#include "test_util.h"
+
+using namespace quark::io;
+
+static void ExpectEqual(const std::vector<quark_test::Mixed>& got, const std::vector<quark_test::Mixed>& want) {
+    ASSERT_EQ(got.size(), want.size());
+    for (size_t i = 0; i < want.size(); ++i) {
+        EXPECT_EQ(got[i].id, want[i].id);
+        EXPECT_EQ(got[i].name, want[i].name);
+        EXPECT_EQ(got[i].b, want[i].b);
+    }
+}
+
+// ---------------------------
+// Batch Codec Tests
+// ---------------------------
+
+// the stitched output is byte-identical to a sequential encode
+TEST(BatchCodec, EncodeMatchesSequential) {
+    quark::ThreadPool pool(3);
+    BatchEncoder<quark_test::Mixed> encoder(&pool, 16);
+    for (size_t n : {0u, 1u, 100u, 5000u}) {
+        auto batch = MakeRecords(n);
+        ASSERT_TRUE(encoder.Encode(batch));
+
+        VectorOutputStream sequential;
+        {
+            CodedOutputStream out(&sequential);
+            for (const auto& m : batch) SerializeDelimited(m, &out);
+        }
+        std::vector<uint8_t> stitched;
+        for (const auto& c : encoder.chunks()) stitched.insert(stitched.end(), c.data, c.data + c.size);
+        EXPECT_EQ(stitched, sequential.buffer()) << n;
+        EXPECT_EQ(encoder.ByteCount(), static_cast<int64_t>(stitched.size()));
+    }
+}
+
+TEST(BatchCodec, DecodeDelimitedBuffer) {
+    quark::ThreadPool pool(3);
+    auto batch = MakeRecords(3000);
+    BatchEncoder<quark_test::Mixed> encoder(&pool, 16);
+    ASSERT_TRUE(encoder.Encode(batch));
+
+    // the scatter list reads back directly, without flattening
+    {
+        MultiBufferInputStream in(encoder.chunks());
+        CodedInputStream coded(&in);
+        quark_test::Mixed m;
+        for (size_t i = 0; i < batch.size(); ++i) ASSERT_TRUE(ParseDelimited(m, &coded));
+    }
+
+    std::vector<uint8_t> flat(encoder.ByteCount());
+    size_t pos = 0;
+    for (const auto& c : encoder.chunks()) {
+        std::memcpy(flat.data() + pos, c.data, c.size);
+        pos += c.size;
+    }
+    BatchDecoder decoder(&pool, 16);
+    std::vector<quark_test::Mixed> got;
+    ASSERT_TRUE(decoder.Decode(std::span<const uint8_t>(flat), got));
+    ExpectEqual(got, batch);
+
+    flat.pop_back();
+    EXPECT_FALSE(decoder.Decode(std::span<const uint8_t>(flat), got));
+}
+
+TEST(BatchCodec, DecodeRecordLog) {
+    quark::ThreadPool pool(3);
+    auto batch = MakeRecords(4000);
+    RecordLogOptions options;
+    options.block_size = 1024;
+    VectorOutputStream vos;
+    {
+        RecordWriter writer(&vos, options);
+        for (const auto& m : batch) ASSERT_TRUE(writer.AppendMessage(m));
+        ASSERT_TRUE(writer.Finish());
+    }
+    RecordReader log(vos.buffer());
+
+    BatchDecoder decoder(&pool);
+    std::vector<quark_test::Mixed> got;
+    ASSERT_TRUE(decoder.Decode(log, got));
+    ExpectEqual(got, batch);
+
+    // each worker gets its own arena
+    std::vector<std::atomic<int>> seen(batch.size());
+    std::atomic<size_t> value_bytes(0);
+    ASSERT_TRUE(decoder.ForEach(log, [&](const LogRecord& rec, quark::Arena& arena) {
+        std::span<const uint8_t> copy = arena.Copy(rec.value.data(), rec.value.size());
+        seen[rec.ordinal].fetch_add(1);
+        value_bytes += rec.value.size();
+        return std::equal(copy.begin(), copy.end(), rec.value.begin());
+    }));
+    for (auto& s : seen) EXPECT_EQ(s.load(), 1);
+    size_t used = 0;
+    for (size_t w = 0; w < pool.concurrency(); ++w) used += decoder.arena(w).SpaceUsed();
+    EXPECT_EQ(used, value_bytes.load());
+}
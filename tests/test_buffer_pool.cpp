@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include "quark/buffer_pool.h"
+#include "quark/io/zero_copy_stream.h"
+
+using namespace quark;
+using namespace quark::io;
+
+// ---------------------------
+// Buffer Pool Tests
+// ---------------------------
+
+// a released block satisfies later requests from its class or the class below
+TEST(BufferPool, RecyclesBlocksBySizeClass) {
+    BufferPool::Trim();
+    size_t size;
+    void* p = BufferPool::Allocate(1000, &size);
+    EXPECT_EQ(size, 1000u);
+    BufferPool::Deallocate(p, size);
+    EXPECT_EQ(BufferPool::CachedBytes(), 1000u);
+
+    size_t got;
+    EXPECT_EQ(BufferPool::Allocate(900, &got), p);     // same class, big enough
+    EXPECT_EQ(got, 1000u);
+    BufferPool::Deallocate(p, got);
+    EXPECT_EQ(BufferPool::Allocate(400, &got), p);     // class above
+    BufferPool::Deallocate(p, got);
+
+    void* q = BufferPool::Allocate(1010, &got);        // same class, too small
+    EXPECT_NE(q, p);
+    BufferPool::Deallocate(q, got);
+    BufferPool::Trim();
+    EXPECT_EQ(BufferPool::CachedBytes(), 0u);
+}
+
+TEST(BufferPool, BoundsTheCache) {
+    BufferPool::Trim();
+    std::vector<void*> blocks;
+    size_t size;
+    for (int i = 0; i < 20; ++i) blocks.push_back(BufferPool::Allocate(4096, &size));
+    for (void* p : blocks) BufferPool::Deallocate(p, 4096);
+    EXPECT_EQ(BufferPool::CachedBytes(), BufferPool::kMaxCachedPerClass * 4096);
+
+    // blocks past kMaxPooledSize are never kept
+    void* big = BufferPool::Allocate(BufferPool::kMaxPooledSize + 1, &size);
+    BufferPool::Deallocate(big, size);
+    EXPECT_EQ(BufferPool::CachedBytes(), BufferPool::kMaxCachedPerClass * 4096);
+    BufferPool::Trim();
+}
+
+// a vector that grew comes back with its capacity, cleared
+TEST(BufferPool, VectorsKeepTheirGrowth) {
+    BufferPool::Trim();
+    std::vector<uint8_t> v = BufferPool::TakeVector(64);
+    EXPECT_GE(v.capacity(), 64u);
+    v.resize(100000, 1);
+    const uint8_t* data = v.data();
+    BufferPool::GiveVector(std::move(v));
+
+    std::vector<uint8_t> again = BufferPool::TakeVector(64);
+    EXPECT_EQ(again.data(), data);
+    EXPECT_TRUE(again.empty());
+    EXPECT_GE(again.capacity(), 100000u);
+    BufferPool::Trim();
+}
+
+TEST(BufferPool, PooledBufferReturnsOnDestruction) {
+    BufferPool::Trim();
+    uint8_t* data;
+    {
+        PooledBuffer a(5000);
+        data = a.get();
+        PooledBuffer b = std::move(a);
+        EXPECT_FALSE(a);
+        EXPECT_EQ(b.get(), data);
+        EXPECT_EQ(b.size(), 5000u);
+    }
+    EXPECT_EQ(BufferPool::CachedBytes(), 5000u);
+    PooledBuffer c(4500);
+    EXPECT_EQ(c.get(), data);
+}
+
+// storage released on another thread stays in that thread's cache
+TEST(BufferPool, CachesArePerThread) {
+    BufferPool::Trim();
+    size_t size;
+    void* p = BufferPool::Allocate(2048, &size);
+    size_t other_cached = 0;
+    std::thread t([&] {
+        BufferPool::Deallocate(p, size);
+        other_cached = BufferPool::CachedBytes();
+    });
+    t.join();
+    EXPECT_EQ(other_cached, 2048u);
+    EXPECT_EQ(BufferPool::CachedBytes(), 0u);
+}
+
+// pooled storage freed during thread exit, after the thread's cache is gone,
+// is released directly instead of going back into the destroyed cache
+TEST(BufferPool, FreesAfterThreadCacheIsDestroyed) {
+    static std::atomic<size_t> cached_at_exit{1};
+    struct LateUser {
+        // built before the cache, so destroyed after it
+        ~LateUser() {
+            size_t size;
+            void* p = BufferPool::Allocate(3000, &size);
+            BufferPool::Deallocate(p, size);
+            std::vector<uint8_t> v = BufferPool::TakeVector(3000);
+            EXPECT_GE(v.capacity(), 3000u);
+            BufferPool::GiveVector(std::move(v));
+            cached_at_exit = BufferPool::CachedBytes();
+        }
+    };
+    std::thread t([] {
+        thread_local LateUser late;
+        thread_local Arena arena;
+        thread_local VectorOutputStream vos;
+        (void)late;
+        arena.Allocate(100000);
+        ASSERT_TRUE(SerializeString(&vos, std::string(5000, 'v')));
+    });
+    t.join();
+    EXPECT_EQ(cached_at_exit, 0u);
+}
+
+// ---------------------------
+// Stream Integration Tests
+// ---------------------------
+
+// a stream per message writes into the storage the previous message released
+TEST(BufferPool, StreamsReuseStorageAcrossMessages) {
+    BufferPool::Trim();
+    std::string payload(20000, 'p');
+    const uint8_t* vector_data;
+    {
+        VectorOutputStream vos;
+        ASSERT_TRUE(SerializeString(&vos, payload));
+        vector_data = vos.buffer().data();
+    }
+    {
+        VectorOutputStream vos;
+        ASSERT_TRUE(SerializeString(&vos, payload));
+        EXPECT_EQ(vos.buffer().data(), vector_data);
+        EXPECT_EQ(vos.buffer().size(), payload.size() + 4);
+    }
+
+    std::vector<MultiBufferInputStream::Chunk> first, second;
+    {
+        ChainedOutputStream out(4096);
+        ASSERT_TRUE(SerializeString(&out, payload));
+        out.AppendChunks(first);
+    }
+    {
+        ChainedOutputStream out(4096);
+        ASSERT_TRUE(SerializeString(&out, payload));
+        out.AppendChunks(second);
+    }
+    ASSERT_EQ(first.size(), second.size());
+    for (size_t i = 0; i < first.size(); ++i) {
+        EXPECT_NE(std::find_if(first.begin(), first.end(), [&](const auto& c) { return c.data == second[i].data; }),
+                  first.end());
+    }
+    BufferPool::Trim();
+}
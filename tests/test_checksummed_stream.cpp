@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include "quark/io/checksummed_stream.h"
+#include "test_util.h"
+
+using namespace quark::io;
+
+// writes 'n' framed records through blocks of 'block_size' bytes
+static std::vector<uint8_t> WriteRecords(int n, size_t block_size) {
+    VectorOutputStream vos(block_size);
+    ChecksummedOutputStream cs(&vos);
+    for (int i = 0; i < n; ++i) {
+        {
+            BasicCodedOutputStream<ChecksummedOutputStream> out(&cs);
+            EXPECT_TRUE(SerializeDelimited(MakeRecord(i), &out));
+        }
+        EXPECT_TRUE(cs.EndRecord());
+    }
+    return vos.buffer();
+}
+
+// ---------------------------
+// CRC32C Tests
+// ---------------------------
+
+TEST(Crc32c, KnownValues) {
+    EXPECT_EQ(Crc32c("", 0), 0u);
+    EXPECT_EQ(Crc32c("123456789", 9), 0xE3069283u);
+    std::vector<uint8_t> zeros(32, 0);
+    EXPECT_EQ(Crc32c(zeros.data(), zeros.size()), 0x8A9136AAu);
+}
+
+// the dispatched path (SSE4.2 / ARMv8 when available) must agree with the
+// table path at every length and alignment, and extending must chain
+TEST(Crc32c, HardwareMatchesSoftwareAndChains) {
+    std::vector<uint8_t> buf(300);
+    for (size_t i = 0; i < buf.size(); ++i) buf[i] = static_cast<uint8_t>(i * 131 + 7);
+
+    for (size_t off = 0; off < 8; ++off) {
+        for (size_t n = 0; off + n <= buf.size(); n += 13) {
+            uint32_t soft = ~detail::Crc32cSoftware(~0u, buf.data() + off, n);
+            ASSERT_EQ(Crc32c(buf.data() + off, n), soft) << off << " " << n;
+        }
+    }
+
+    uint32_t whole = Crc32c(buf.data(), buf.size());
+    for (size_t split : {0u, 1u, 7u, 8u, 9u, 150u, 300u}) {
+        uint32_t crc = Crc32cExtend(0, buf.data(), split);
+        EXPECT_EQ(Crc32cExtend(crc, buf.data() + split, buf.size() - split), whole) << split;
+    }
+}
+
+TEST(Crc32c, MaskRoundTrips) {
+    for (uint32_t crc : {0u, 1u, 0xE3069283u, 0xFFFFFFFFu}) {
+        EXPECT_NE(MaskCrc32c(crc), crc);
+        EXPECT_EQ(UnmaskCrc32c(MaskCrc32c(crc)), crc);
+    }
+}
+
+// ---------------------------
+// Checksummed Stream Tests
+// ---------------------------
+
+// the trailer covers exactly the payload bytes, whatever the block layout
+TEST(ChecksummedStream, TrailerCoversPayload) {
+    std::vector<uint8_t> expected;
+    {
+        VectorOutputStream vos;
+        {
+            CodedOutputStream out(&vos);
+            SerializeDelimited(MakeRecord(3), &out);
+        }
+        expected = vos.buffer();
+    }
+
+    for (size_t block : {1u, 5u, 4096u}) {
+        std::vector<uint8_t> framed = WriteRecords(4, block);
+        // the fourth record is MakeRecord(3); it ends the buffer
+        size_t payload = expected.size();
+        ASSERT_GE(framed.size(), payload + kRecordTrailerSize);
+        const uint8_t* last = framed.data() + framed.size() - payload - kRecordTrailerSize;
+        EXPECT_TRUE(std::equal(expected.begin(), expected.end(), last)) << block;
+        EXPECT_EQ(UnmaskCrc32c(LoadLittleEndian32(last + payload)), Crc32c(expected.data(), payload));
+    }
+}
+
+TEST(ChecksummedStream, RoundTripAcrossChunks) {
+    std::vector<uint8_t> framed = WriteRecords(20, 7);
+
+    for (size_t chunk : {1u, 3u, 11u, 4096u}) {
+        MultiBufferInputStream mb(SplitChunks(framed, chunk));
+        ChecksummedInputStream cs(&mb);
+        for (int i = 0; i < 20; ++i) {
+            quark_test::Mixed got;
+            {
+                BasicCodedInputStream<ChecksummedInputStream> in(&cs);
+                ASSERT_TRUE(ParseDelimited(got, &in)) << "chunk " << chunk;
+            }
+            ASSERT_TRUE(cs.VerifyRecord()) << "chunk " << chunk << " record " << i;
+            EXPECT_EQ(got.name, MakeRecord(i).name);
+            EXPECT_EQ(got.b, MakeRecord(i).b);
+        }
+        EXPECT_EQ(cs.ByteCount(), static_cast<int64_t>(framed.size()));
+        EXPECT_FALSE(cs.VerifyRecord());
+    }
+}
+
+// flipping any bit fails the record it lands in (or its framing) and
+// leaves earlier records intact
+TEST(ChecksummedStream, DetectsCorruption) {
+    std::vector<uint8_t> clean = WriteRecords(3, 4096);
+    for (size_t pos = 0; pos < clean.size(); pos += 5) {
+        std::vector<uint8_t> bad = clean;
+        bad[pos] ^= 0x10;
+
+        BufferInputStream bis(bad.data(), bad.size());
+        ChecksummedInputStream cs(&bis);
+        bool failed = false;
+        for (int i = 0; i < 3 && !failed; ++i) {
+            quark_test::Mixed got;
+            bool parsed;
+            {
+                BasicCodedInputStream<ChecksummedInputStream> in(&cs);
+                parsed = ParseDelimited(got, &in);
+            }
+            failed = !parsed || !cs.VerifyRecord();
+        }
+        EXPECT_TRUE(failed) << "bit flip at " << pos << " went unnoticed";
+    }
+}
+
+// skipped bytes count towards the checksum
+TEST(ChecksummedStream, SkipIsChecksummed) {
+    std::vector<uint8_t> framed = WriteRecords(2, 4096);
+    MultiBufferInputStream mb(SplitChunks(framed, 3));
+    ChecksummedInputStream cs(&mb);
+
+    uint32_t length;
+    {
+        BasicCodedInputStream<ChecksummedInputStream> in(&cs);
+        ASSERT_TRUE(in.ReadVarint32(length));
+    }
+    ASSERT_TRUE(cs.Skip(length));
+    EXPECT_TRUE(cs.VerifyRecord());
+
+    quark_test::Mixed got;
+    {
+        BasicCodedInputStream<ChecksummedInputStream> in(&cs);
+        ASSERT_TRUE(ParseDelimited(got, &in));
+    }
+    EXPECT_TRUE(cs.VerifyRecord());
+    EXPECT_EQ(got.id, 1);
+}
+
+TEST(ChecksummedStream, BackUpBeyondBlockThrows) {
+    VectorOutputStream vos(16);
+    ChecksummedOutputStream cs(&vos);
+    uint8_t* block;
+    size_t size;
+    ASSERT_TRUE(cs.Next(&block, &size));
+    cs.BackUp(size - 2);
+    EXPECT_THROW(cs.BackUp(3), std::runtime_error);
+}
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+#include <set>
+#include "quark/io/columnar.h"
+#include "message.quark.h"
+#include "test_util.h"
+
+using namespace quark::io;
+
+template <typename Message>
+static std::vector<uint8_t> EncodeColumnar(const std::vector<Message>& records) {
+    VectorOutputStream vos;
+    EXPECT_TRUE(SerializeColumnar(std::span<const Message>(records), &vos));
+    return vos.buffer();
+}
+
+// ---------------------------
+// Columnar Batch Tests
+// ---------------------------
+
+TEST(Columnar, RoundTrip) {
+    for (int n : {0, 1, 100, 5000}) {
+        auto records = MakeRecords(n);
+        std::vector<uint8_t> bytes = EncodeColumnar(records);
+        std::vector<quark_test::Mixed> got(3);
+        ASSERT_TRUE(ParseColumnar(got, bytes)) << n;
+        ASSERT_EQ(got.size(), records.size());
+        for (int i = 0; i < n; ++i) {
+            EXPECT_EQ(got[i].id, records[i].id);
+            EXPECT_EQ(got[i].score, records[i].score);
+            EXPECT_EQ(got[i].name, records[i].name);
+            EXPECT_EQ(got[i].a, records[i].a);
+            EXPECT_EQ(got[i].b, records[i].b);
+            EXPECT_EQ(got[i].tag, records[i].tag);
+        }
+    }
+}
+
+// 64-bit, zigzag, bool, double and bytes columns, extremes included
+TEST(Columnar, EveryScalarKindRoundTrips) {
+    std::vector<quark_test::Event> events(300);
+    for (int i = 0; i < 300; ++i) {
+        auto& e = events[i];
+        e.id = i % 7 == 0 ? ~0ull - i : 1000000ull * i;
+        e.timestamp = 0x0123456789ABCDEFull + i;
+        e.drift = i % 2 ? INT64_MIN + i : INT64_MAX - i;
+        e.valid = i % 3 == 0;
+        e.value = -1.5 * i;
+        e.digest = std::string(i % 9, static_cast<char>(i));
+        e.offset = -i;
+        e.delta = i % 2 ? INT32_MIN : i;
+    }
+    std::vector<quark_test::Event> got;
+    ASSERT_TRUE(ParseColumnar(got, EncodeColumnar(events)));
+    ASSERT_EQ(got.size(), events.size());
+    for (int i = 0; i < 300; ++i) {
+        EXPECT_EQ(got[i].id, events[i].id);
+        EXPECT_EQ(got[i].timestamp, events[i].timestamp);
+        EXPECT_EQ(got[i].drift, events[i].drift);
+        EXPECT_EQ(got[i].valid, events[i].valid);
+        EXPECT_EQ(got[i].value, events[i].value);
+        EXPECT_EQ(got[i].digest, events[i].digest);
+        EXPECT_EQ(got[i].offset, events[i].offset);
+        EXPECT_EQ(got[i].delta, events[i].delta);
+    }
+}
+
+// sorted ids come out as bit-packed deltas, scattered ones as plain varints
+// or bit-packed values; either way smaller than rows
+TEST(Columnar, PicksSmallestIntEncoding) {
+    auto records = MakeRecords(1000);
+    for (auto& r : records) r.b = static_cast<int32_t>(r.b * 2654435761u);   // scatter
+    std::vector<uint8_t> bytes = EncodeColumnar(records);
+    ColumnarReader batch;
+    ASSERT_TRUE(batch.Open(bytes));
+    EXPECT_EQ(batch.record_count(), 1000u);
+    EXPECT_EQ(batch.columns().size(), 6u);
+    // deltas 0, 1, 1, ...: the first block is min 0 plus 1 bit a value,
+    // the other seven are min 1 at width 0
+    EXPECT_EQ(batch.Find(1)->encoding, ColumnEncoding::kDeltaFor);
+    EXPECT_EQ(batch.Find(1)->payload.size(), (1 + 1 + 16) + 7 * (1 + 1));
+    EXPECT_EQ(batch.Find(4)->encoding, ColumnEncoding::kDeltaFor);
+    EXPECT_EQ(batch.Find(5)->encoding, ColumnEncoding::kFor);
+    EXPECT_EQ(batch.Find(2)->encoding, ColumnEncoding::kRaw);
+    EXPECT_EQ(batch.Find(3)->encoding, ColumnEncoding::kStrings);
+    EXPECT_EQ(batch.Find(7), nullptr);
+
+    VectorOutputStream rows;
+    {
+        CodedOutputStream out(&rows);
+        for (const auto& r : records) ASSERT_TRUE(Serialize(r, &out));
+    }
+    EXPECT_LT(bytes.size(), rows.buffer().size());
+}
+
+// one column decodes into a flat array without touching the others
+TEST(Columnar, ReadsSingleColumnIntoArray) {
+    auto records = MakeRecords(777);
+    std::vector<uint8_t> bytes = EncodeColumnar(records);
+    ColumnarReader batch;
+    ASSERT_TRUE(batch.Open(bytes));
+
+    std::vector<float> scores(batch.record_count());
+    ASSERT_TRUE(batch.ReadFixedColumn(2, scores.data()));
+    std::vector<int32_t> ids(batch.record_count());
+    ASSERT_TRUE(batch.ReadIntColumn(1, ids.data()));
+    StringColumn names;
+    ASSERT_TRUE(batch.ReadStringColumn(3, names));
+    ASSERT_EQ(names.size(), 777u);
+    size_t heap = 0;
+    for (int i = 0; i < 777; ++i) {
+        EXPECT_EQ(scores[i], records[i].score);
+        EXPECT_EQ(ids[i], records[i].id);
+        EXPECT_EQ(names[i], records[i].name);
+        heap += records[i].name.size();
+    }
+    EXPECT_EQ(names.heap().size(), heap);
+
+    // wrong kind or width
+    std::vector<double> wide(batch.record_count());
+    EXPECT_FALSE(batch.ReadFixedColumn(2, wide.data()));
+    EXPECT_FALSE(batch.ReadIntColumn(2, ids.data()));
+    EXPECT_FALSE(batch.ReadStringColumn(1, names));
+    EXPECT_FALSE(batch.ReadIntColumn(9, ids.data()));
+}
+
+// missing columns keep defaults; columns of unknown fields are ignored
+TEST(Columnar, MissingAndUnknownColumns) {
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        ASSERT_TRUE(WriteColumnarHeader(&out, 3));
+        ASSERT_TRUE(WriteFixedColumn<float>(&out, 2, 3, [](size_t i) { return 1.5f * i; }));
+        ASSERT_TRUE(WriteIntColumn(&out, 99, 3, [](size_t i) { return i; }));
+    }
+    std::vector<quark_gen::TestData> got;
+    ASSERT_TRUE(ParseColumnar(got, vos.buffer()));
+    ASSERT_EQ(got.size(), 3u);
+    for (size_t i = 0; i < 3; ++i) {
+        EXPECT_EQ(got[i].int_val, 0);
+        EXPECT_EQ(got[i].float_val, 1.5f * i);
+        EXPECT_EQ(got[i].str_val, "");
+    }
+}
+
+TEST(Columnar, RejectsMalformedBatches) {
+    auto records = MakeRecords(50);
+    std::vector<uint8_t> bytes = EncodeColumnar(records);
+    std::vector<quark_test::Mixed> got;
+
+    // a cut inside a column is caught; a cut between columns leaves a valid
+    // batch without the later ones
+    ColumnarReader batch;
+    ASSERT_TRUE(batch.Open(bytes));
+    std::set<size_t> boundaries = {1};   // after the one-byte record count
+    for (const auto& c : batch.columns()) boundaries.insert(c.payload.data() + c.payload.size() - bytes.data());
+    for (size_t cut = 0; cut < bytes.size(); ++cut) {
+        ColumnarReader part;
+        EXPECT_EQ(part.Open(std::span<const uint8_t>(bytes.data(), cut)), boundaries.count(cut) == 1) << cut;
+    }
+
+    // a record count the columns do not match
+    std::vector<uint8_t> bad = bytes;
+    bad[0] = 51;
+    EXPECT_FALSE(ParseColumnar(got, bad));
+
+    // a string offset running backwards
+    size_t at = batch.Find(3)->payload.data() - bytes.data();
+    bad = bytes;
+    StoreLittleEndian32(bad.data() + at + 4, 0xFFFFFFFF);
+    EXPECT_FALSE(ParseColumnar(got, bad));
+
+    // an unknown encoding byte
+    bad = bytes;
+    bad[at - 1] = 9;
+    EXPECT_FALSE(ParseColumnar(got, bad));
+}
@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+#include "quark/io/compressed_stream.h"
+#include "test_util.h"
+
+using namespace quark::io;
+
+// serializes records [first, first + n) through 'zs' and ends the compressed stream
+static void WriteBatch(CompressedOutputStream* zs, int n, int first = 0) {
+    {
+        CodedOutputStream out(zs);
+        for (int i = first; i < first + n; ++i) ASSERT_TRUE(SerializeDelimited(MakeRecord(i), &out));
+    }
+    ASSERT_TRUE(zs->Finish());
+}
+
+static void ExpectBatch(ZeroCopyInputStream* in, int n, int first = 0) {
+    CodedInputStream coded(in);
+    for (int i = first; i < first + n; ++i) {
+        quark_test::Mixed got;
+        ASSERT_TRUE(ParseDelimited(got, &coded)) << "record " << i;
+        EXPECT_EQ(got.id, i);
+        EXPECT_EQ(got.name, MakeRecord(i).name);
+        EXPECT_EQ(got.tag, MakeRecord(i).tag);
+    }
+}
+
+// ---------------------------
+// Compressed Stream Tests
+// ---------------------------
+
+TEST(CompressedStream, RoundTripAcrossBlocksAndChunks) {
+    CompressionOptions options;
+    options.block_size = 256;   // many compression steps per batch
+
+    VectorOutputStream vos(64);
+    CompressedOutputStream zs(&vos, options);
+    WriteBatch(&zs, 500);
+
+    VectorOutputStream plain;
+    {
+        CodedOutputStream out(&plain);
+        for (int i = 0; i < 500; ++i) SerializeDelimited(MakeRecord(i), &out);
+    }
+    EXPECT_EQ(zs.ByteCount(), static_cast<int64_t>(plain.buffer().size()));
+    EXPECT_LT(vos.buffer().size(), plain.buffer().size() / 2);
+
+    for (size_t chunk : {1u, 7u, 4096u}) {
+        MultiBufferInputStream mb(SplitChunks(vos.buffer(), chunk));
+        DecompressedInputStream in(&mb, options);
+        ExpectBatch(&in, 500);
+        const uint8_t* block;
+        size_t size;
+        EXPECT_FALSE(in.Next(&block, &size));
+        EXPECT_FALSE(in.HadError()) << "chunk " << chunk;
+        EXPECT_EQ(in.ByteCount(), static_cast<int64_t>(plain.buffer().size()));
+    }
+}
+
+// a dictionary of the common bytes makes a single small message compress
+TEST(CompressedStream, DictionaryShrinksSmallMessages) {
+    VectorOutputStream sample;
+    {
+        CodedOutputStream out(&sample);
+        quark_test::Mixed typical = MakeRecord(40);
+        typical.id = 0;
+        SerializeDelimited(typical, &out);
+    }
+    CompressionOptions with_dict;
+    with_dict.dictionary = sample.buffer();
+
+    auto compressed_size = [](const CompressionOptions& options, VectorOutputStream* vos) {
+        CompressedOutputStream zs(vos, options);
+        WriteBatch(&zs, 1, 40);
+        return vos->buffer().size();
+    };
+    VectorOutputStream plain_vos, dict_vos;
+    size_t plain = compressed_size({}, &plain_vos);
+    size_t dict = compressed_size(with_dict, &dict_vos);
+    EXPECT_LT(dict, plain / 2);
+
+    BufferInputStream bis(dict_vos.buffer().data(), dict_vos.buffer().size());
+    DecompressedInputStream in(&bis, with_dict);
+    ExpectBatch(&in, 1, 40);
+}
+
+// Reset() reuses the contexts; data after the compressed stream stays
+// readable from the underlying stream
+TEST(CompressedStream, ResetAndTrailingData) {
+    VectorOutputStream vos;
+    CompressedOutputStream zs(&vos);
+    WriteBatch(&zs, 10);
+    zs.Reset(&vos);
+    WriteBatch(&zs, 20);
+    {
+        CodedOutputStream out(&vos);
+        SerializeInt32(&out, 77);
+    }
+
+    MultiBufferInputStream mb(SplitChunks(vos.buffer(), 5));
+    DecompressedInputStream in(&mb);
+    ExpectBatch(&in, 10);
+    const uint8_t* block;
+    size_t size;
+    EXPECT_FALSE(in.Next(&block, &size));
+
+    in.Reset(&mb);
+    ExpectBatch(&in, 20);
+    EXPECT_FALSE(in.Next(&block, &size));
+    EXPECT_FALSE(in.HadError());
+
+    CodedInputStream rest(&mb);
+    int32_t value;
+    ASSERT_TRUE(DeserializeInt32(&rest, value));
+    EXPECT_EQ(value, 77);
+}
+
+TEST(CompressedStream, Flush) {
+    VectorOutputStream vos;
+    CompressedOutputStream zs(&vos);
+    {
+        CodedOutputStream out(&zs);
+        SerializeDelimited(MakeRecord(0), &out);
+    }
+    ASSERT_TRUE(zs.Flush());
+
+    // everything before the flush decodes without the stream end
+    std::vector<uint8_t> flushed = vos.buffer();
+    BufferInputStream bis(flushed.data(), flushed.size());
+    DecompressedInputStream in(&bis);
+    ExpectBatch(&in, 1);
+}
+
+// a flushed stream that never ends, cut off or followed by bytes that are
+// not a deflate block, still yields every byte inflated before the error;
+// the error is reported after them
+TEST(CompressedStream, FlushedStreamWithoutEnd) {
+    VectorOutputStream vos;
+    CompressedOutputStream zs(&vos);
+    {
+        CodedOutputStream out(&zs);
+        for (int i = 0; i < 50; ++i) ASSERT_TRUE(SerializeDelimited(MakeRecord(i), &out));
+    }
+    ASSERT_TRUE(zs.Flush());
+    std::vector<uint8_t> cut = vos.buffer();
+    std::vector<uint8_t> garbage = cut;
+    garbage.insert(garbage.end(), {0xff, 0xff});   // final block of reserved type 3
+
+    for (const auto& bytes : {cut, garbage}) {
+        for (size_t block_size : {1u, 7u, 64u, 4096u}) {
+            CompressionOptions options;
+            options.block_size = block_size;
+            BufferInputStream bis(bytes.data(), bytes.size());
+            DecompressedInputStream in(&bis, options);
+            ExpectBatch(&in, 50);
+            const uint8_t* block;
+            size_t size;
+            EXPECT_FALSE(in.Next(&block, &size));
+            EXPECT_TRUE(in.HadError()) << "block " << block_size;
+        }
+    }
+}
+
+TEST(CompressedStream, DetectsTruncationAndFullSink) {
+    VectorOutputStream vos;
+    CompressedOutputStream zs(&vos);
+    WriteBatch(&zs, 100);
+
+    BufferInputStream bis(vos.buffer().data(), vos.buffer().size() / 2);
+    DecompressedInputStream in(&bis);
+    const uint8_t* block;
+    size_t size;
+    while (in.Next(&block, &size)) {}
+    EXPECT_TRUE(in.HadError());
+
+    uint8_t small[8];
+    BufferOutputStream bos(small, sizeof(small));
+    CompressedOutputStream full(&bos);
+    {
+        CodedOutputStream out(&full);
+        for (int i = 0; i < 100; ++i) SerializeDelimited(MakeRecord(i), &out);
+    }
+    EXPECT_FALSE(full.Finish());
+    EXPECT_TRUE(full.HadError());
+}
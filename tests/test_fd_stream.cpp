@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <sys/socket.h>
+#include "quark/io/fd_stream.h"
+#include "test_util.h"
+
+using namespace quark::io;
+
+static std::string TempPath() {
+    char path[] = "/tmp/quark_fd_XXXXXX";
+    int fd = mkstemp(path);
+    EXPECT_GE(fd, 0);
+    close(fd);
+    return path;
+}
+
+static std::vector<uint8_t> ReadFile(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(f), {});
+}
+
+// small blocks so the pool wraps many times
+static FdStreamOptions SmallPool(bool io_uring) {
+    FdStreamOptions options;
+    options.block_size = 4096;
+    options.blocks = 4;
+    options.io_uring = io_uring;
+    return options;
+}
+
+// ---------------------------
+// File Output Stream Tests
+// ---------------------------
+
+TEST(FdStream, FileRoundTrip) {
+    for (bool io_uring : {false, true}) {
+        std::string path = TempPath();
+        VectorOutputStream expected;
+        {
+            FileOutputStream file(path, SmallPool(io_uring));
+            {
+                BasicCodedOutputStream<FileOutputStream> out(&file);
+                CodedOutputStream same(&expected);
+                for (int i = 0; i < 5000; ++i) {
+                    ASSERT_TRUE(SerializeDelimited(MakeRecord(i), &out));
+                    ASSERT_TRUE(SerializeDelimited(MakeRecord(i), &same));
+                }
+            }
+            EXPECT_EQ(file.ByteCount(), static_cast<int64_t>(expected.buffer().size()));
+            EXPECT_TRUE(file.Close()) << file.error();
+        }
+        EXPECT_EQ(ReadFile(path), expected.buffer()) << "io_uring " << io_uring;
+
+        MmapInputStream in(path);
+        BasicCodedInputStream<MmapInputStream> coded(&in);
+        quark_test::Mixed got;
+        for (int i = 0; i < 5000; ++i) {
+            ASSERT_TRUE(ParseDelimited(got, &coded)) << i;
+            ASSERT_EQ(got.id, i);
+        }
+        std::remove(path.c_str());
+    }
+}
+
+// Flush() makes everything written so far visible in the file
+TEST(FdStream, FlushWritesPartialBlock) {
+    for (bool io_uring : {false, true}) {
+        std::string path = TempPath();
+        FileOutputStream file(path, SmallPool(io_uring));
+        ASSERT_TRUE(file.WriteRaw("abc", 3));
+        EXPECT_TRUE(ReadFile(path).empty());
+        ASSERT_TRUE(file.Flush());
+        EXPECT_EQ(ReadFile(path).size(), 3u);
+        ASSERT_TRUE(file.WriteRaw("def", 3));
+        ASSERT_TRUE(file.Close());
+        std::vector<uint8_t> bytes = ReadFile(path);
+        EXPECT_EQ(std::string(bytes.begin(), bytes.end()), "abcdef");
+        EXPECT_FALSE(file.WriteRaw("x", 1));
+        std::remove(path.c_str());
+    }
+}
+
+// aliased payloads are written from the caller's memory, in order with the pool
+TEST(FdStream, AliasedPayloadsKeepOrder) {
+    for (bool io_uring : {false, true}) {
+        std::string path = TempPath();
+        std::string big(100000, 'z');
+        VectorOutputStream expected;
+        {
+            FileOutputStream file(path, SmallPool(io_uring));
+            BasicCodedOutputStream<FileOutputStream> out(&file);
+            CodedOutputStream same(&expected);
+            out.EnableAliasing(true);
+            EXPECT_TRUE(out.ShouldAlias(big.size()));
+            for (int i = 0; i < 3; ++i) {
+                ASSERT_TRUE(SerializeString(&out, "head" + std::to_string(i)));
+                ASSERT_TRUE(SerializeString(&out, big));
+                ASSERT_TRUE(SerializeString(&same, "head" + std::to_string(i)));
+                ASSERT_TRUE(SerializeString(&same, big));
+            }
+        }
+        EXPECT_EQ(ReadFile(path), expected.buffer()) << "io_uring " << io_uring;
+        std::remove(path.c_str());
+    }
+}
+
+TEST(FdStream, BackUpBeyondBlockThrows) {
+    std::string path = TempPath();
+    FileOutputStream file(path, SmallPool(false));
+    uint8_t* block;
+    size_t size;
+    ASSERT_TRUE(file.Next(&block, &size));
+    EXPECT_EQ(size, 4096u);
+    file.BackUp(4000);
+    EXPECT_THROW(file.BackUp(100), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST(FdStream, MissingDirectoryThrows) {
+    EXPECT_THROW(FileOutputStream("/nonexistent/quark.bin"), std::runtime_error);
+}
+
+// ---------------------------
+// Socket Output Stream Tests
+// ---------------------------
+
+TEST(FdStream, SocketRoundTrip) {
+    for (bool io_uring : {false, true}) {
+        int fds[2];
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+        std::vector<uint8_t> received;
+        std::thread reader([&] {
+            uint8_t buf[8192];
+            ssize_t n;
+            while ((n = ::read(fds[1], buf, sizeof(buf))) > 0) received.insert(received.end(), buf, buf + n);
+        });
+
+        VectorOutputStream expected;
+        {
+            SocketOutputStream sock(fds[0], SmallPool(io_uring));
+            BasicCodedOutputStream<SocketOutputStream> out(&sock);
+            CodedOutputStream same(&expected);
+            for (int i = 0; i < 20000; ++i) {
+                ASSERT_TRUE(SerializeDelimited(MakeRecord(i), &out));
+                ASSERT_TRUE(SerializeDelimited(MakeRecord(i), &same));
+            }
+        }
+        ::shutdown(fds[0], SHUT_WR);
+        reader.join();
+        ::close(fds[0]);
+        ::close(fds[1]);
+        EXPECT_EQ(received, expected.buffer()) << "io_uring " << io_uring;
+    }
+}
+
+// a closed peer fails the flush with EPIPE instead of raising SIGPIPE
+TEST(FdStream, ClosedPeerReportsError) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    ::close(fds[1]);
+    SocketOutputStream sock(fds[0]);
+    ASSERT_TRUE(sock.WriteRaw("hello", 5));
+    EXPECT_FALSE(sock.Flush());
+    EXPECT_TRUE(sock.HadError());
+    EXPECT_EQ(sock.error(), EPIPE);
+    uint8_t* block;
+    size_t size;
+    EXPECT_FALSE(sock.Next(&block, &size));
+    ::close(fds[0]);
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include "quark/io/message_view.h"
+#include "test_schema.quark.h"
+
+using namespace quark::io;
+
+template <typename Message>
+static std::vector<uint8_t> Encode(const Message& msg) {
+    VectorOutputStream vos;
+    EXPECT_TRUE(Serialize(msg, &vos));
+    return vos.buffer();
+}
+
+// ---------------------------
+// Message View Tests
+// ---------------------------
+
+// every scalar kind reads back as what the generated parser would produce
+TEST(MessageView, ReadsEveryScalarKind) {
+    quark_test::Sample s;
+    s.id = ~0ull - 5;
+    s.delta = -77;
+    s.count = -123456;
+    s.value = 2.75;
+    s.timestamp = 0x0123456789ABCDEFull;
+    s.offset = -9;
+    s.drift = INT64_MIN;
+    s.valid = true;
+    s.digest = "\x01\x02\x03";
+    std::vector<uint8_t> bytes = Encode(s);
+
+    MessageView view(std::span<const uint8_t>(bytes.data(), bytes.size()));
+    EXPECT_EQ(view.get<uint64_t>(1), s.id);
+    EXPECT_EQ(ZigZagDecode32(*view.get<uint32_t>(2)), s.delta);
+    EXPECT_EQ(view.get<int32_t>(3), s.count);
+    EXPECT_EQ(view.get<double>(4), s.value);
+    EXPECT_EQ(view.get<uint64_t>(5), s.timestamp);
+    EXPECT_EQ(view.get<int64_t>(6), s.offset);
+    EXPECT_EQ(ZigZagDecode64(*view.get<uint64_t>(7)), s.drift);
+    EXPECT_EQ(view.get<bool>(8), true);
+    auto digest = view.get<std::span<const uint8_t>>(9);
+    ASSERT_TRUE(digest);
+    EXPECT_EQ(std::string(digest->begin(), digest->end()), s.digest);
+
+    // absent fields and types the wire type cannot hold
+    EXPECT_FALSE(view.Has(10));
+    EXPECT_EQ(view.get<int32_t>(10), std::nullopt);
+    EXPECT_EQ(view.get<float>(4), std::nullopt);
+    EXPECT_EQ(view.get<std::string_view>(1), std::nullopt);
+    EXPECT_EQ(view.get<int16_t>(5), std::nullopt);
+}
+
+TEST(MessageView, NestedMessages) {
+    quark_test::Envelope env;
+    env.version = 3;
+    env.segment.from.x = 1.5f;
+    env.segment.to.layer = 9;
+    env.segment.label = "north";
+    env.payload.name = "payload";
+    env.weight = 0.25f;
+    std::vector<uint8_t> bytes = Encode(env);
+
+    MessageView view(std::span<const uint8_t>(bytes.data(), bytes.size()));
+    EXPECT_EQ(view.get<int32_t>(1), 3);
+    EXPECT_EQ(view.get<float>(4), 0.25f);
+    auto segment = view.get<MessageView>(2);
+    ASSERT_TRUE(segment);
+    EXPECT_EQ(segment->get<std::string_view>(3), "north");
+    EXPECT_EQ(segment->get<MessageView>(1)->get<float>(1), 1.5f);
+    EXPECT_EQ(segment->get<MessageView>(2)->get<int32_t>(3), 9);
+    EXPECT_EQ(view.get<MessageView>(3)->get<std::string_view>(3), "payload");
+}
+
+// a repeated field resolves to its last occurrence, at any field number
+TEST(MessageView, LastOccurrenceWins) {
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        for (uint32_t field : {5u, 1000u}) {
+            ASSERT_TRUE(SerializeStringField(&out, field, "first"));
+            ASSERT_TRUE(SerializeInt64Field(&out, 7, 1));
+            ASSERT_TRUE(SerializeStringField(&out, field, "last"));
+        }
+    }
+    MessageView view(std::span<const uint8_t>(vos.buffer().data(), vos.buffer().size()));
+    EXPECT_EQ(view.get<std::string_view>(5), "last");
+    EXPECT_EQ(view.get<std::string_view>(1000), "last");
+    EXPECT_FALSE(view.Has(999));
+    ASSERT_EQ(view.fields().size(), 6u);
+    EXPECT_EQ(view.fields()[3].number, 1000u);
+    EXPECT_EQ(view.fields()[3].type, WireType::LENGTH_DELIMITED);
+}
+
+// past kInlineFields occurrences the index moves to the heap
+TEST(MessageView, ManyFields) {
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        for (uint32_t field = 1; field <= 200; ++field) ASSERT_TRUE(SerializeUInt64Field(&out, field, field * 1000));
+    }
+    MessageView view(std::span<const uint8_t>(vos.buffer().data(), vos.buffer().size()));
+    EXPECT_EQ(view.fields().size(), 200u);
+    for (uint32_t field = 1; field <= 200; ++field) EXPECT_EQ(view.get<uint64_t>(field), field * 1000);
+
+    MessageView copy = view;
+    EXPECT_EQ(copy.get<uint64_t>(150), 150000u);
+}
+
+// views over a BufferInputStream or a mapped file cover the whole region
+TEST(MessageView, OverStreams) {
+    quark_test::Mixed m;
+    m.id = 42;
+    m.tag = "route-a";
+    std::vector<uint8_t> bytes = Encode(m);
+
+    BufferInputStream bis(bytes.data(), bytes.size());
+    MessageView view(bis);
+    EXPECT_EQ(view.get<int32_t>(1), 42);
+    EXPECT_EQ(view.get<std::string_view>(6), "route-a");
+
+    std::string path = ::testing::TempDir() + "message_view.bin";
+    {
+        std::ofstream f(path, std::ios::binary);
+        f.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+    {
+        MmapInputStream file(path);
+        MessageView mapped(file);
+        EXPECT_EQ(mapped.get<std::string_view>(6), "route-a");
+    }
+    std::remove(path.c_str());
+
+    MessageView empty;
+    EXPECT_TRUE(empty.Index());
+    EXPECT_FALSE(empty.Has(1));
+}
+
+TEST(MessageView, RejectsMalformedMessages) {
+    quark_test::Mixed m;
+    m.id = 1;
+    m.name = "abcdef";
+    m.tag = "xyz";
+    std::vector<uint8_t> bytes = Encode(m);
+
+    // a cut anywhere but a field boundary fails the whole view
+    MessageView whole(std::span<const uint8_t>(bytes.data(), bytes.size()));
+    ASSERT_TRUE(whole.Index());
+    std::vector<size_t> boundaries = {0};
+    for (const auto& f : whole.fields()) boundaries.push_back(f.offset + f.size);
+    for (size_t cut = 0; cut < bytes.size(); ++cut) {
+        MessageView part(std::span<const uint8_t>(bytes.data(), cut));
+        bool boundary = std::find(boundaries.begin(), boundaries.end(), cut) != boundaries.end();
+        EXPECT_EQ(part.Index(), boundary) << cut;
+        if (!boundary) {
+            EXPECT_FALSE(part.Has(1));
+            EXPECT_TRUE(part.fields().empty());
+        }
+    }
+
+    // field number 0, and a group wire type
+    uint8_t zero[] = {0x00, 0x01};
+    EXPECT_FALSE(MessageView(std::span<const uint8_t>(zero, sizeof(zero))).Index());
+    uint8_t group[] = {(1 << 3) | 3};
+    EXPECT_FALSE(MessageView(std::span<const uint8_t>(group, sizeof(group))).Index());
+}
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include "quark/pinned_view.h"
+#include "quark/io/zero_copy_stream.h"
+
+using namespace quark;
+using namespace quark::io;
+
+// encodes 'strings' into a refcounted buffer, as a network read would hand it over
+static std::shared_ptr<const std::vector<uint8_t>> EncodeShared(const std::vector<std::string>& strings) {
+    VectorOutputStream vos;
+    for (const std::string& s : strings) SerializeString(&vos, s);
+    return std::make_shared<const std::vector<uint8_t>>(std::move(vos.buffer()));
+}
+
+static bool Within(const PinnedView& view, const std::vector<uint8_t>& buf) {
+    auto p = reinterpret_cast<const uint8_t*>(view.data());
+    return p >= buf.data() && p + view.size() <= buf.data() + buf.size();
+}
+
+// ---------------------------
+// Pinned View Tests
+// ---------------------------
+
+// views share the chunk's owner and keep the buffer alive after the stream is gone
+TEST(PinnedView, ViewsOutliveChunks) {
+    auto buf = EncodeShared({"first", "second"});
+    std::weak_ptr<const void> watch = buf;
+
+    PinnedView a, b;
+    {
+        MultiBufferInputStream mb({{buf->data(), buf->size(), buf}});
+        CodedInputStream in(&mb);
+        ASSERT_TRUE(DeserializeString(&in, a));
+        ASSERT_TRUE(DeserializeString(&in, b));
+        EXPECT_TRUE(Within(a, *buf));
+        EXPECT_TRUE(Within(b, *buf));
+    }
+    buf.reset();
+    EXPECT_FALSE(watch.expired());
+    EXPECT_EQ(a.view(), "first");
+    EXPECT_EQ(b.view(), "second");
+
+    a.Reset();
+    EXPECT_FALSE(watch.expired());
+    b = PinnedView();
+    EXPECT_TRUE(watch.expired());
+}
+
+// a string straddling two owned chunks cannot be one view; it gets its own copy
+TEST(PinnedView, StraddlingStringIsCopied) {
+    auto buf = EncodeShared({"straddles two frames"});
+    std::weak_ptr<const void> watch = buf;
+
+    PinnedView s;
+    {
+        MultiBufferInputStream mb({{buf->data(), 8, buf}, {buf->data() + 8, buf->size() - 8, buf}});
+        CodedInputStream in(&mb);
+        ASSERT_TRUE(DeserializeString(&in, s));
+        EXPECT_FALSE(Within(s, *buf));
+    }
+    buf.reset();
+    EXPECT_TRUE(watch.expired());
+    EXPECT_EQ(s.view(), "straddles two frames");
+}
+
+// chunks without an owner (and streams that cannot pin) fall back to copies
+TEST(PinnedView, UnownedInputIsCopied) {
+    auto buf = EncodeShared({"borrowed"});
+    PinnedView a, b;
+    {
+        MultiBufferInputStream mb({{buf->data(), buf->size()}});
+        ASSERT_TRUE(DeserializeString(&mb, a));
+    }
+    {
+        BufferInputStream bis(buf->data(), buf->size());
+        ASSERT_TRUE(DeserializeString(&bis, b));
+    }
+    EXPECT_FALSE(Within(a, *buf));
+    EXPECT_FALSE(Within(b, *buf));
+    EXPECT_EQ(a.view(), "borrowed");
+    EXPECT_EQ(b.view(), "borrowed");
+    EXPECT_EQ(buf.use_count(), 1);
+}
+
+TEST(PinnedView, LengthDelimitedBytesAndLimits) {
+    VectorOutputStream vos;
+    const uint8_t data[4] = {1, 2, 3, 4};
+    WriteLengthDelimitedBytes(&vos, data, 4);
+    auto buf = std::make_shared<const std::vector<uint8_t>>(vos.buffer());
+
+    MultiBufferInputStream mb({{buf->data(), buf->size(), buf}});
+    CodedInputStream in(&mb);
+    PinnedView bytes;
+    ASSERT_TRUE(ReadLengthDelimitedBytes(&in, bytes));
+    EXPECT_EQ(bytes.size(), 4u);
+    EXPECT_EQ(bytes.owner(), buf);
+    EXPECT_FALSE(ReadLengthDelimitedBytes(&in, bytes));
+
+    // a length running past the input fails without allocating it
+    const uint8_t truncated[3] = {0x80, 0x80, 0x04};
+    BufferInputStream bis(truncated, sizeof(truncated));
+    BasicCodedInputStream<BufferInputStream> short_in(&bis);
+    EXPECT_FALSE(ReadLengthDelimitedBytes(&short_in, bytes));
+}
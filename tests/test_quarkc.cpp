@@ -0,0 +1,476 @@
+#include <gtest/gtest.h>
+#include "message.quark.h"
+#include "test_schema.quark.h"
+#include "test_util.h"
+
+using namespace quark::io;
+
+// ---------------------------
+// Generated Code Tests
+// ---------------------------
+
+// generated Serialize must produce the same bytes as hand-sequenced calls
+TEST(Quarkc, MatchesHandWrittenEncoding) {
+    quark_gen::TestData msg;
+    msg.int_val = -7;
+    msg.float_val = 2.25f;
+    msg.str_val = "generated";
+
+    VectorOutputStream generated;
+    EXPECT_TRUE(Serialize(msg, &generated));
+
+    VectorOutputStream manual;
+    {
+        CodedOutputStream out(&manual);
+        SerializeInt32Field(&out, 1, -7);
+        SerializeFloat32Field(&out, 2, 2.25f);
+        SerializeStringField(&out, 3, "generated");
+    }
+
+    EXPECT_EQ(generated.buffer(), manual.buffer());
+    EXPECT_LE(generated.buffer().size(), msg.MaxSize());
+}
+
+TEST(Quarkc, RoundTripAcrossChunkSizes) {
+    quark_test::Mixed msg;
+    msg.id = 123456;
+    msg.score = -0.5f;
+    msg.name = "a string long enough to straddle small chunks";
+    msg.a = 1;
+    msg.b = -1;
+    msg.tag = "t";
+
+    VectorOutputStream vos(64);
+    {
+        CodedOutputStream out(&vos);
+        for (int i = 0; i < 10; ++i) EXPECT_TRUE(SerializeDelimited(msg, &out));
+    }
+
+    for (size_t chunk : {1u, 3u, 11u, 4096u}) {
+        MultiBufferInputStream mb(SplitChunks(vos.buffer(), chunk));
+        CodedInputStream in(&mb);
+        for (int i = 0; i < 10; ++i) {
+            quark_test::Mixed got;
+            ASSERT_TRUE(ParseDelimited(got, &in)) << "chunk " << chunk;
+            EXPECT_EQ(got.id, msg.id);
+            EXPECT_EQ(got.score, msg.score);
+            EXPECT_EQ(got.name, msg.name);
+            EXPECT_EQ(got.a, msg.a);
+            EXPECT_EQ(got.b, msg.b);
+            EXPECT_EQ(got.tag, msg.tag);
+        }
+    }
+}
+
+TEST(Quarkc, FixedOnlyMessageHasConstexprSize) {
+    static_assert(quark_test::Point::kMaxSize == 15);
+    quark_test::Point p{1.0f, 2.0f, 3};
+
+    uint8_t buf[quark_test::Point::kMaxSize];
+    BufferOutputStream bos(buf, sizeof(buf));
+    EXPECT_TRUE(Serialize(p, &bos));
+    EXPECT_EQ(bos.ByteCount(), 15);
+
+    BufferInputStream bis(buf, sizeof(buf));
+    quark_test::Point q;
+    EXPECT_TRUE(Parse(q, &bis));
+    EXPECT_EQ(q.x, 1.0f);
+    EXPECT_EQ(q.y, 2.0f);
+    EXPECT_EQ(q.layer, 3);
+}
+
+// malformed tags and truncated payloads fail instead of being skipped
+TEST(Quarkc, RejectsMalformedFields) {
+    std::vector<std::vector<uint8_t>> inputs = {
+        {0x00},                         // field number 0
+        {0x0b, 0x00},                   // wire type 3 (unsupported)
+        {0x0d, 0x01, 0x02},             // FIXED32 cut short
+        {0x22, 0x05, 'a'},              // LENGTH_DELIMITED beyond the end
+        {0x80, 0x80, 0x80, 0x80, 0x80, 0x01},   // over-long tag varint
+    };
+    for (const auto& buf : inputs) {
+        BufferInputStream bis(buf.data(), buf.size());
+        quark_test::Point q;
+        EXPECT_FALSE(Parse(q, &bis)) << "first byte " << int(buf[0]);
+    }
+}
+
+// old readers skip fields they do not know; new readers keep defaults for missing ones
+TEST(Quarkc, ForwardAndBackwardCompatible) {
+    quark_test::PointV2 v2;
+    v2.x = 1.5f;
+    v2.y = -2.0f;
+    v2.layer = 4;
+    v2.note = std::string(1000, 'z');
+    v2.origin = {9.0f, 8.0f, 7};
+
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        EXPECT_TRUE(Serialize(v2, &out));
+        // fields from an even newer writer, one per remaining wire type
+        WriteTag(&out, 20, WireType::VARINT);
+        out.WriteVarint64(1ull << 62);
+        WriteTag(&out, 21, WireType::FIXED64);
+        out.WriteFixed64(42);
+    }
+
+    for (size_t chunk : {1u, 13u, 4096u}) {
+        MultiBufferInputStream mb(SplitChunks(vos.buffer(), chunk));
+        quark_test::Point old;
+        ASSERT_TRUE(Parse(old, &mb)) << "chunk " << chunk;
+        EXPECT_EQ(old.x, 1.5f);
+        EXPECT_EQ(old.y, -2.0f);
+        EXPECT_EQ(old.layer, 4);
+        EXPECT_EQ(mb.ByteCount(), static_cast<int64_t>(vos.buffer().size()));
+    }
+
+    quark_test::Point p{3.0f, 4.0f, 5};
+    VectorOutputStream old_bytes;
+    EXPECT_TRUE(Serialize(p, &old_bytes));
+    BufferInputStream bis(old_bytes.buffer().data(), old_bytes.buffer().size());
+    quark_test::PointV2 newer;
+    ASSERT_TRUE(Parse(newer, &bis));
+    EXPECT_EQ(newer.layer, 5);
+    EXPECT_TRUE(newer.note.empty());
+    EXPECT_EQ(newer.origin.layer, 0);
+}
+
+// fields may arrive in any order
+TEST(Quarkc, ParsesFieldsOutOfOrder) {
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        SerializeInt32Field(&out, 3, 30);
+        SerializeFloat32Field(&out, 2, 20.0f);
+        SerializeFloat32Field(&out, 1, 10.0f);
+    }
+    BufferInputStream bis(vos.buffer().data(), vos.buffer().size());
+    quark_test::Point q;
+    ASSERT_TRUE(Parse(q, &bis));
+    EXPECT_EQ(q.x, 10.0f);
+    EXPECT_EQ(q.y, 20.0f);
+    EXPECT_EQ(q.layer, 30);
+}
+
+// ByteSizeLong is exact, and the array path writes the same bytes as the stream path
+TEST(Quarkc, ByteSizeMatchesSerializedSize) {
+    quark_test::Mixed msg;
+    msg.id = 9;
+    msg.name = std::string(300, 'n');
+    msg.tag = "short";
+
+    size_t size = msg.ByteSizeLong();
+    EXPECT_EQ(msg.GetCachedSize(), size);
+    EXPECT_LE(size, msg.MaxSize());
+
+    VectorOutputStream vos;
+    EXPECT_TRUE(Serialize(msg, &vos));
+    EXPECT_EQ(vos.buffer().size(), size);
+
+    std::vector<uint8_t> buf(size);
+    EXPECT_EQ(SerializeToArray(msg, buf.data(), buf.size()), size);
+    EXPECT_EQ(buf, vos.buffer());
+    EXPECT_EQ(SerializeToArray(msg, buf.data(), size - 1), 0u);
+}
+
+// a window too small for the whole message falls back to the per-run path
+TEST(Quarkc, SerializeFallsBackWhenWindowIsSmall) {
+    quark_test::Mixed msg;
+    msg.name = "spans several output blocks";
+
+    ChainedOutputStream chained(16, 16);
+    {
+        CodedOutputStream out(&chained);
+        EXPECT_TRUE(Serialize(msg, &out));
+    }
+    std::vector<uint8_t> flat(chained.ByteCount());
+    chained.CopyTo(flat.data());
+
+    BufferInputStream bis(flat.data(), flat.size());
+    quark_test::Mixed got;
+    EXPECT_TRUE(Parse(got, &bis));
+    EXPECT_EQ(got.name, msg.name);
+    EXPECT_EQ(flat.size(), msg.ByteSizeLong());
+}
+
+static quark_test::Envelope MakeEnvelope() {
+    quark_test::Envelope env;
+    env.version = 3;
+    env.segment.from = {1.0f, 2.0f, 1};
+    env.segment.to = {3.0f, 4.0f, 2};
+    env.segment.label = "edge";
+    env.payload.id = 77;
+    env.payload.name = std::string(150, 'p');  // two-byte length prefix
+    env.payload.tag = "nested";
+    env.weight = 0.25f;
+    return env;
+}
+
+// nested messages are size-prefixed from cached sizes, with no temporary buffers
+TEST(Quarkc, NestedMessageEncoding) {
+    quark_test::Envelope env = MakeEnvelope();
+    size_t size = env.ByteSizeLong();
+    EXPECT_EQ(env.segment.GetCachedSize(), env.segment.ByteSizeLong());
+
+    VectorOutputStream manual;
+    {
+        CodedOutputStream out(&manual);
+        SerializeInt32Field(&out, 1, env.version);
+        SerializeMessageFieldHeader(&out, 2, env.segment.ByteSizeLong());
+        Serialize(env.segment, &out);
+        SerializeMessageFieldHeader(&out, 3, env.payload.ByteSizeLong());
+        Serialize(env.payload, &out);
+        SerializeFloat32Field(&out, 4, env.weight);
+    }
+
+    VectorOutputStream generated;
+    EXPECT_TRUE(Serialize(env, &generated));
+    EXPECT_EQ(generated.buffer(), manual.buffer());
+    EXPECT_EQ(generated.buffer().size(), size);
+    EXPECT_LE(size, env.MaxSize());
+
+    // per-field fallback path when the window is too small for the whole message
+    ChainedOutputStream chained(16, 16);
+    {
+        CodedOutputStream out(&chained);
+        EXPECT_TRUE(Serialize(env, &out));
+    }
+    std::vector<uint8_t> flat(chained.ByteCount());
+    chained.CopyTo(flat.data());
+    EXPECT_EQ(flat, manual.buffer());
+}
+
+TEST(Quarkc, NestedMessageRoundTripAcrossChunks) {
+    quark_test::Envelope env = MakeEnvelope();
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        for (int i = 0; i < 3; ++i) EXPECT_TRUE(SerializeDelimited(env, &out));
+    }
+
+    for (size_t chunk : {1u, 7u, 64u, 4096u}) {
+        MultiBufferInputStream mb(SplitChunks(vos.buffer(), chunk));
+        CodedInputStream in(&mb);
+        for (int i = 0; i < 3; ++i) {
+            quark_test::Envelope got;
+            ASSERT_TRUE(ParseDelimited(got, &in)) << "chunk " << chunk;
+            EXPECT_EQ(got.version, env.version);
+            EXPECT_EQ(got.segment.to.y, 4.0f);
+            EXPECT_EQ(got.segment.label, env.segment.label);
+            EXPECT_EQ(got.payload.name, env.payload.name);
+            EXPECT_EQ(got.payload.tag, env.payload.tag);
+            EXPECT_EQ(got.weight, env.weight);
+        }
+        EXPECT_EQ(in.BytesUntilLimit(), -1);
+    }
+}
+
+// a nested length that disagrees with the body is rejected, not read past
+TEST(Quarkc, NestedMessageLengthMismatch) {
+    quark_test::Segment seg;
+    seg.label = "x";
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        SerializeInt32Field(&out, 1, 1);
+        SerializeMessageFieldHeader(&out, 2, seg.ByteSizeLong() - 1);   // one byte short
+        Serialize(seg, &out);
+    }
+    BufferInputStream bis(vos.buffer().data(), vos.buffer().size());
+    quark_test::Envelope got;
+    EXPECT_FALSE(Parse(got, &bis));
+}
+
+static quark_test::Features MakeFeatures() {
+    quark_test::Features msg;
+    msg.id = 3;
+    msg.scale = 0.5f;
+    for (int i = 0; i < 500; ++i) msg.values.push_back(static_cast<float>(i) / 8.0f);
+    msg.ids = {-1, 0, 1, INT32_MAX};
+    msg.labels = {"a", "", std::string(200, 'l')};
+    msg.points.push_back({1.0f, 2.0f, 3});
+    msg.points.push_back({-1.0f, -2.0f, -3});
+    return msg;
+}
+
+// packed arrays are one tag + byte length + raw little-endian values
+TEST(Quarkc, RepeatedFixedFieldsArePacked) {
+    quark_test::Features msg;
+    msg.ids = {1, 2};
+
+    VectorOutputStream vos;
+    ASSERT_TRUE(Serialize(msg, &vos));
+    std::vector<uint8_t> expected = {
+        0x0d, 0, 0, 0, 0,                       // id
+        0x1a, 8, 1, 0, 0, 0, 2, 0, 0, 0,        // ids, packed
+        0x35, 0, 0, 0, 0,                       // scale
+    };
+    EXPECT_EQ(vos.buffer(), expected);
+}
+
+TEST(Quarkc, RepeatedFieldsRoundTripAcrossChunks) {
+    quark_test::Features msg = MakeFeatures();
+    size_t size = msg.ByteSizeLong();
+    EXPECT_LE(size, msg.MaxSize());
+
+    VectorOutputStream vos(64);
+    ASSERT_TRUE(Serialize(msg, &vos));
+    ASSERT_EQ(vos.buffer().size(), size);
+
+    std::vector<uint8_t> buf(size);
+    EXPECT_EQ(SerializeToArray(msg, buf.data(), buf.size()), size);
+    EXPECT_EQ(buf, vos.buffer());
+
+    for (size_t chunk : {size_t(1), size_t(7), size_t(256), size}) {
+        MultiBufferInputStream mb(SplitChunks(vos.buffer(), chunk));
+        quark_test::Features back;
+        ASSERT_TRUE(Parse(back, &mb));
+        EXPECT_EQ(back.id, msg.id);
+        EXPECT_EQ(back.scale, msg.scale);
+        EXPECT_EQ(back.values, msg.values);
+        EXPECT_EQ(back.ids, msg.ids);
+        EXPECT_EQ(back.labels, msg.labels);
+        ASSERT_EQ(back.points.size(), 2u);
+        EXPECT_EQ(back.points[1].layer, -3);
+        EXPECT_EQ(back.points[1].y, -2.0f);
+    }
+}
+
+// an unpacked array (one FIXED32 field per element) is accepted too, and
+// packed chunks of the same field concatenate
+TEST(Quarkc, RepeatedFixedAcceptsUnpackedAndSplitArrays) {
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        SerializeInt32Field(&out, 3, 7);
+        int32_t rest[] = {8, 9};
+        SerializePackedFixedField(&out, 3, rest, 2);
+        SerializeInt32Field(&out, 3, 10);
+    }
+    BufferInputStream bis(vos.buffer().data(), vos.buffer().size());
+    quark_test::Features msg;
+    ASSERT_TRUE(Parse(msg, &bis));
+    EXPECT_EQ(msg.ids, (std::vector<int32_t>{7, 8, 9, 10}));
+}
+
+// packed varints are one tag + byte length + a varint per element;
+// sint fields are zigzag-encoded first
+TEST(Quarkc, RepeatedVarintFieldsArePacked) {
+    quark_test::Series msg;
+    msg.counts = {1, 300};
+    msg.deltas = {-1, 1};
+    msg.flags = {true, false};
+
+    VectorOutputStream vos;
+    ASSERT_TRUE(Serialize(msg, &vos));
+    std::vector<uint8_t> expected = {
+        0x08, 0,                                // id
+        0x1a, 3, 1, 0xac, 0x02,                 // counts, packed
+        0x22, 2, 1, 2,                          // deltas, packed zigzag
+        0x32, 2, 1, 0,                          // flags, packed
+        0x3d, 0, 0, 0, 0,                       // scale
+    };
+    EXPECT_EQ(vos.buffer(), expected);
+}
+
+TEST(Quarkc, RepeatedVarintFieldsRoundTripAcrossChunks) {
+    quark_test::Series msg;
+    msg.id = 42;
+    msg.offsets = {0, -1, INT64_MIN, INT64_MAX, 127};
+    msg.counts = {0, 128, UINT64_MAX};
+    msg.deltas = {INT32_MIN, -2, 0, 3, INT32_MAX};
+    msg.drifts = {INT64_MIN, -64, 64, INT64_MAX};
+    msg.flags = {true, true, false, true};
+    msg.scale = 0.5f;
+
+    size_t size = msg.ByteSizeLong();
+    EXPECT_LE(size, msg.MaxSize());
+    VectorOutputStream vos(16);
+    ASSERT_TRUE(Serialize(msg, &vos));
+    ASSERT_EQ(vos.buffer().size(), size);
+
+    std::vector<uint8_t> buf(size);
+    EXPECT_EQ(SerializeToArray(msg, buf.data(), buf.size()), size);
+    EXPECT_EQ(buf, vos.buffer());
+
+    for (size_t chunk : {size_t(1), size_t(7), size}) {
+        MultiBufferInputStream mb(SplitChunks(vos.buffer(), chunk));
+        quark_test::Series back;
+        ASSERT_TRUE(Parse(back, &mb));
+        EXPECT_EQ(back.id, msg.id);
+        EXPECT_EQ(back.offsets, msg.offsets);
+        EXPECT_EQ(back.counts, msg.counts);
+        EXPECT_EQ(back.deltas, msg.deltas);
+        EXPECT_EQ(back.drifts, msg.drifts);
+        EXPECT_EQ(back.flags, msg.flags);
+        EXPECT_EQ(back.scale, msg.scale);
+    }
+}
+
+// one VARINT field per element (protobuf's [packed = false]) is accepted
+// too, next to packed chunks of the same field
+TEST(Quarkc, RepeatedVarintAcceptsUnpackedArrays) {
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        SerializeSInt32Field(&out, 4, -7);
+        SerializePackedVarintField<true>(&out, 4, std::vector<int32_t>{8, -9});
+        SerializeBoolField(&out, 6, true);
+    }
+    BufferInputStream bis(vos.buffer().data(), vos.buffer().size());
+    quark_test::Series msg;
+    ASSERT_TRUE(Parse(msg, &bis));
+    EXPECT_EQ(msg.deltas, (std::vector<int32_t>{-7, 8, -9}));
+    EXPECT_EQ(msg.flags, (std::vector<bool>{true}));
+}
+
+TEST(Quarkc, WideAndZigzagFieldsRoundTrip) {
+    quark_test::Sample msg;
+    msg.id = UINT64_MAX;
+    msg.delta = -2;
+    msg.count = 7;
+    msg.value = 3.25;
+    msg.timestamp = 1700000000123456789ull;
+    msg.offset = -1;
+    msg.drift = INT64_MIN;
+    msg.valid = true;
+    msg.digest = std::string("\x00\xff\x10", 3);
+    msg.history = {0.5, -0.25};
+
+    size_t size = msg.ByteSizeLong();
+    EXPECT_LE(size, msg.MaxSize());
+    VectorOutputStream vos(16);
+    ASSERT_TRUE(Serialize(msg, &vos));
+    ASSERT_EQ(vos.buffer().size(), size);
+
+    std::vector<uint8_t> buf(size);
+    EXPECT_EQ(SerializeToArray(msg, buf.data(), buf.size()), size);
+    EXPECT_EQ(buf, vos.buffer());
+
+    for (size_t chunk : {size_t(1), size_t(9), size}) {
+        MultiBufferInputStream mb(SplitChunks(vos.buffer(), chunk));
+        quark_test::Sample back;
+        ASSERT_TRUE(Parse(back, &mb));
+        EXPECT_EQ(back.id, msg.id);
+        EXPECT_EQ(back.delta, msg.delta);
+        EXPECT_EQ(back.count, msg.count);
+        EXPECT_EQ(back.value, msg.value);
+        EXPECT_EQ(back.timestamp, msg.timestamp);
+        EXPECT_EQ(back.offset, msg.offset);
+        EXPECT_EQ(back.drift, msg.drift);
+        EXPECT_EQ(back.valid, msg.valid);
+        EXPECT_EQ(back.digest, msg.digest);
+        EXPECT_EQ(back.history, msg.history);
+    }
+}
+
+// a small negative sint32 is a 1-byte varint where an int32 costs 4 bytes
+TEST(Quarkc, ZigzagKeepsSmallDeltasShort) {
+    quark_test::Sample msg;
+    msg.delta = -3;
+    size_t with_delta = msg.ByteSizeLong();
+    msg.delta = 0;
+    EXPECT_EQ(with_delta, msg.ByteSizeLong());
+    EXPECT_EQ(VarintFieldSize(2, ZigZagEncode32(-3)), 2u);
+}
@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+#include "quark/io/record_log.h"
+#include "test_util.h"
+
+using namespace quark::io;
+
+static std::string Key(int i) {
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "key-%06d", i);
+    return buf;
+}
+
+// 'n' records keyed key-000000.. (each key repeated 'dup' times), small blocks
+static std::vector<uint8_t> WriteLog(int n, int dup = 1, size_t block_size = 512) {
+    RecordLogOptions options;
+    options.block_size = block_size;
+    VectorOutputStream vos(100);
+    RecordWriter writer(&vos, options);
+    for (int i = 0; i < n; ++i) EXPECT_TRUE(writer.AppendMessage(MakeRecord(i), Key(i / dup)));
+    EXPECT_TRUE(writer.Finish());
+    EXPECT_EQ(writer.record_count(), static_cast<uint64_t>(n));
+    return vos.buffer();
+}
+
+// ---------------------------
+// Record Log Tests
+// ---------------------------
+
+TEST(RecordLog, GetEveryOrdinal) {
+    std::vector<uint8_t> file = WriteLog(2000);
+    RecordReader log(file);
+    ASSERT_EQ(log.record_count(), 2000u);
+    EXPECT_GT(log.block_count(), 50u);
+
+    for (int i = 0; i < 2000; ++i) {
+        LogRecord rec;
+        ASSERT_TRUE(log.Get(i, rec)) << i;
+        EXPECT_EQ(rec.ordinal, static_cast<uint64_t>(i));
+        EXPECT_EQ(rec.key, Key(i));
+        quark_test::Mixed got;
+        ASSERT_TRUE(ParseRecord(rec.value, got));
+        EXPECT_EQ(got.id, i);
+        EXPECT_EQ(got.name, MakeRecord(i).name);
+    }
+    LogRecord rec;
+    EXPECT_FALSE(log.Get(2000, rec));
+}
+
+TEST(RecordLog, FindByKey) {
+    // runs of four equal keys spill across block boundaries
+    std::vector<uint8_t> file = WriteLog(1200, 4, 300);
+    RecordReader log(file);
+
+    for (int k = 0; k < 300; ++k) {
+        LogRecord rec;
+        ASSERT_TRUE(log.Find(Key(k), rec)) << k;
+        EXPECT_EQ(rec.ordinal, static_cast<uint64_t>(k * 4)) << "first of the run";
+    }
+    LogRecord rec;
+    EXPECT_FALSE(log.Find("key-", rec));
+    EXPECT_FALSE(log.Find("key-000010x", rec));
+    EXPECT_FALSE(log.Find("zzz", rec));
+}
+
+TEST(RecordLog, WriterRejectsOutOfOrderKeys) {
+    VectorOutputStream vos;
+    RecordWriter writer(&vos);
+    uint8_t value[3] = {1, 2, 3};
+    EXPECT_TRUE(writer.Append(value, "b"));
+    EXPECT_TRUE(writer.Append(value, "b"));
+    EXPECT_FALSE(writer.Append(value, "a"));
+    EXPECT_FALSE(writer.Append(value));
+    EXPECT_TRUE(writer.Append(value, "c"));
+    ASSERT_TRUE(writer.Finish());
+    EXPECT_FALSE(writer.Append(value, "d"));
+
+    RecordReader log(vos.buffer());
+    EXPECT_EQ(log.record_count(), 3u);
+    LogRecord rec;
+    ASSERT_TRUE(log.Get(2, rec));
+    EXPECT_EQ(rec.key, "c");
+    EXPECT_TRUE(std::equal(rec.value.begin(), rec.value.end(), value));
+}
+
+// split ranges are contiguous, cover every block, and scanning them in
+// order yields every record once
+TEST(RecordLog, SplitScansEvenly) {
+    std::vector<uint8_t> file = WriteLog(3000);
+    RecordReader log(file);
+
+    for (size_t parts : {1u, 3u, 8u}) {
+        std::vector<BlockRange> ranges = log.Split(parts);
+        ASSERT_EQ(ranges.size(), parts);
+        uint64_t total = 0;
+        for (size_t b = 0; b < log.block_count(); ++b) total += log.block(b).size;
+
+        size_t next_block = 0;
+        uint64_t next_ordinal = 0;
+        for (const BlockRange& r : ranges) {
+            EXPECT_EQ(r.begin, next_block);
+            next_block = r.end;
+            uint64_t bytes = 0;
+            for (size_t b = r.begin; b < r.end; ++b) bytes += log.block(b).size;
+            EXPECT_LE(bytes, total / parts + 1024) << "at most one block over its share";
+
+            RecordCursor cursor = log.Scan(r.begin, r.end);
+            LogRecord rec;
+            while (cursor.Next(rec)) EXPECT_EQ(rec.ordinal, next_ordinal++);
+            EXPECT_FALSE(cursor.HadError());
+        }
+        EXPECT_EQ(next_block, log.block_count());
+        EXPECT_EQ(next_ordinal, 3000u);
+    }
+}
+
+TEST(RecordLog, OpensMappedFile) {
+    std::vector<uint8_t> bytes = WriteLog(500);
+    char path[] = "/tmp/quark_log_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    {
+        std::ofstream f(path, std::ios::binary);
+        f.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+
+    MmapInputStream file(path);
+    RecordReader log(file);
+    LogRecord rec;
+    ASSERT_TRUE(log.Get(321, rec));
+    quark_test::Mixed got;
+    ASSERT_TRUE(ParseRecord(rec.value, got));
+    EXPECT_EQ(got.id, 321);
+    std::remove(path);
+}
+
+TEST(RecordLog, EmptyLog) {
+    VectorOutputStream vos;
+    RecordWriter writer(&vos);
+    ASSERT_TRUE(writer.Finish());
+    RecordReader log(vos.buffer());
+    EXPECT_EQ(log.record_count(), 0u);
+    EXPECT_EQ(log.block_count(), 0u);
+    EXPECT_TRUE(log.Split(4).empty());
+    LogRecord rec;
+    EXPECT_FALSE(log.Get(0, rec));
+    EXPECT_FALSE(log.Scan().Next(rec));
+}
+
+TEST(RecordLog, DetectsCorruption) {
+    std::vector<uint8_t> clean = WriteLog(200);
+    RecordReader clean_log(clean);
+    const RecordBlock& second = clean_log.block(1);
+
+    // damaged record: the block's scan stops with an error, other blocks read fine
+    std::vector<uint8_t> bad = clean;
+    bad[second.offset + 12] ^= 0x01;
+    RecordReader log(bad);
+    LogRecord rec;
+    EXPECT_FALSE(log.Get(second.first_ordinal, rec));
+    EXPECT_TRUE(log.Get(0, rec));
+    RecordCursor cursor = log.Scan();
+    size_t n = 0;
+    while (cursor.Next(rec)) ++n;
+    EXPECT_TRUE(cursor.HadError());
+    EXPECT_EQ(n, second.first_ordinal);
+
+    // damaged sync marker
+    bad = clean;
+    bad[second.offset] ^= 0x01;
+    RecordReader bad_sync(bad);
+    EXPECT_FALSE(bad_sync.Get(second.first_ordinal, rec));
+
+    // damaged index or footer: the reader refuses to open
+    for (size_t from_end : {1u, 10u, 20u, 30u}) {
+        bad = clean;
+        bad[bad.size() - from_end] ^= 0x01;
+        EXPECT_THROW(RecordReader{bad}, std::runtime_error) << from_end;
+    }
+    std::vector<uint8_t> truncated(clean.begin(), clean.end() - 1);
+    EXPECT_THROW(RecordReader{truncated}, std::runtime_error);
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include "quark/io/ring_buffer_stream.h"
+#include "test_util.h"
+
+using namespace quark::io;
+
+static bool Produce(RingBufferOutputStream* out, int i) {
+    bool ok;
+    {
+        BasicCodedOutputStream<RingBufferOutputStream> coded(out);
+        ok = SerializeDelimited(MakeRecord(i), &coded);
+    }
+    if (ok) out->Publish();
+    else out->Rollback();
+    return ok;
+}
+
+// ---------------------------
+// Ring Buffer Stream Tests
+// ---------------------------
+
+TEST(RingBufferStream, CapacityRoundsUpToPowerOfTwo) {
+    EXPECT_EQ(RingBuffer(1).capacity(), 64u);
+    EXPECT_EQ(RingBuffer(100).capacity(), 128u);
+    EXPECT_EQ(RingBuffer(4096).capacity(), 4096u);
+}
+
+// messages wrap around the end of a small ring many times
+TEST(RingBufferStream, WrapsAround) {
+    RingBuffer ring(128);
+    RingBufferOutputStream out(&ring);
+    RingBufferInputStream in(&ring);
+
+    for (int i = 0; i < 500; ++i) {
+        ASSERT_TRUE(Produce(&out, i)) << i;
+        quark_test::Mixed got;
+        {
+            BasicCodedInputStream<RingBufferInputStream> coded(&in);
+            ASSERT_TRUE(ParseDelimited(got, &coded)) << i;
+        }
+        in.Release();
+        EXPECT_EQ(got.id, i);
+        EXPECT_EQ(got.name, MakeRecord(i).name);
+    }
+    EXPECT_EQ(in.ByteCount(), out.ByteCount());
+    EXPECT_GT(out.ByteCount(), 30 * 128);
+}
+
+TEST(RingBufferStream, ConsumerSeesOnlyPublishedBytes) {
+    RingBuffer ring(256);
+    RingBufferOutputStream out(&ring);
+    RingBufferInputStream in(&ring);
+
+    ASSERT_TRUE(Produce(&out, 1));
+    {
+        BasicCodedOutputStream<RingBufferOutputStream> coded(&out);
+        ASSERT_TRUE(SerializeDelimited(MakeRecord(2), &coded));
+    }
+    EXPECT_GT(out.unpublished(), 0u);
+
+    quark_test::Mixed got;
+    {
+        BasicCodedInputStream<RingBufferInputStream> coded(&in);
+        ASSERT_TRUE(ParseDelimited(got, &coded));
+        EXPECT_FALSE(ParseDelimited(got, &coded));
+    }
+    out.Publish();
+    {
+        BasicCodedInputStream<RingBufferInputStream> coded(&in);
+        ASSERT_TRUE(ParseDelimited(got, &coded));
+    }
+    EXPECT_EQ(got.id, 2);
+}
+
+// a message larger than the ring cannot be published; rolling it back
+// leaves the ring usable
+TEST(RingBufferStream, OversizedMessageRollsBack) {
+    RingBuffer ring(64);
+    RingBufferOutputStream out(&ring);
+    RingBufferInputStream in(&ring);
+
+    quark_test::Mixed big = MakeRecord(0);
+    big.name = std::string(100, 'x');
+    {
+        BasicCodedOutputStream<RingBufferOutputStream> coded(&out);
+        EXPECT_FALSE(SerializeDelimited(big, &coded));
+    }
+    out.Rollback();
+    EXPECT_EQ(out.unpublished(), 0u);
+
+    ASSERT_TRUE(Produce(&out, 3));
+    quark_test::Mixed got;
+    BasicCodedInputStream<RingBufferInputStream> coded(&in);
+    ASSERT_TRUE(ParseDelimited(got, &coded));
+    EXPECT_EQ(got.id, 3);
+}
+
+TEST(RingBufferStream, BackUpBeyondBlockThrows) {
+    RingBuffer ring(64);
+    RingBufferOutputStream out(&ring);
+    uint8_t* block;
+    size_t size;
+    ASSERT_TRUE(out.Next(&block, &size));
+    EXPECT_EQ(size, 64u);
+    out.BackUp(60);
+    EXPECT_THROW(out.BackUp(5), std::runtime_error);
+}
+
+// the producer blocks on a full ring until the consumer releases space
+TEST(RingBufferStream, CrossThreadHandoff) {
+    constexpr int kMessages = 50000;
+    RingBuffer ring(1024);
+
+    std::thread producer([&ring] {
+        RingBufferOutputStream out(&ring);
+        for (int i = 0; i < kMessages; ++i) {
+            if (!Produce(&out, i)) return;
+        }
+    });
+
+    RingBufferInputStream in(&ring);
+    int received = 0;
+    while (received < kMessages) {
+        {
+            BasicCodedInputStream<RingBufferInputStream> coded(&in);
+            quark_test::Mixed got;
+            while (received < kMessages && ParseDelimited(got, &coded)) {
+                ASSERT_EQ(got.id, received);
+                ASSERT_EQ(got.name.size(), MakeRecord(received).name.size());
+                ++received;
+            }
+        }
+        in.Release();
+        std::this_thread::yield();
+    }
+    producer.join();
+    EXPECT_EQ(received, kMessages);
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include <map>
+#include <thread>
+#include "quark/io/stats_stream.h"
+#include "test_util.h"
+
+using namespace quark::io;
+
+static std::vector<uint8_t> EncodeStrings(size_t n, size_t length) {
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        for (size_t i = 0; i < n; ++i) EXPECT_TRUE(SerializeString(&out, std::string(length, 'a' + i % 26)));
+    }
+    return vos.buffer();
+}
+
+// ---------------------------
+// Stats Stream Tests
+// ---------------------------
+
+// a parse through 7-byte chunks takes every chunk once and hands back what it did not use
+TEST(StatsStream, CountsInputTraffic) {
+    quark_test::Mixed m;
+    m.id = 7;
+    m.name = std::string(40, 'n');
+    m.tag = "stats";
+    VectorOutputStream vos;
+    ASSERT_TRUE(SerializeDelimited(m, &vos));
+    size_t record = vos.buffer().size();
+    std::vector<uint8_t> bytes = vos.buffer();
+    bytes.resize((record / 7 + 3) * 7, 0xEE);   // trailing bytes the parse never reads
+
+    MultiBufferInputStream mb(SplitChunks(bytes, 7));
+    StatsInputStream counted(&mb);
+    {
+        CodedInputStream in(&counted);
+        quark_test::Mixed got;
+        ASSERT_TRUE(ParseDelimited(got, &in));
+        EXPECT_EQ(got.name, m.name);
+        EXPECT_EQ(got.tag, m.tag);
+    }
+    const StreamStats& s = counted.stats();
+    EXPECT_GT(s.next_calls, 1u);
+    EXPECT_EQ(s.net_bytes(), record);
+    EXPECT_EQ(static_cast<int64_t>(s.net_bytes()), counted.ByteCount());
+    EXPECT_EQ(s.block_sizes[2], s.next_calls);      // 7 bytes: [4, 8)
+
+    ASSERT_TRUE(counted.Skip(5));
+    EXPECT_EQ(counted.stats().skip_calls, 1u);
+    EXPECT_EQ(counted.stats().skip_bytes, 5u);
+
+    counted.ResetStats();
+    EXPECT_EQ(counted.stats().next_calls, 0u);
+    EXPECT_EQ(counted.stats().block_sizes[2], 0u);
+}
+
+TEST(StatsStream, CountsOutputTraffic) {
+    VectorOutputStream vos(64);
+    StatsOutputStream counted(&vos);
+    {
+        CodedOutputStream out(&counted);
+        for (int i = 0; i < 50; ++i) ASSERT_TRUE(SerializeString(&out, std::string(30, 'x')));
+    }
+    ASSERT_TRUE(counted.Flush());
+    const StreamStats& s = counted.stats();
+    EXPECT_EQ(s.net_bytes(), vos.buffer().size());
+    EXPECT_GT(s.next_calls, 1u);
+    EXPECT_EQ(s.flush_calls, 1u);
+    EXPECT_EQ(counted.AllowsAliasing(), vos.AllowsAliasing());
+}
+
+TEST(StatsStream, ForEachNamesCounters) {
+    std::vector<uint8_t> bytes(100, 0);
+    BufferInputStream bis(bytes.data(), bytes.size());
+    StatsInputStream counted(&bis);
+    const uint8_t* block;
+    size_t size;
+    ASSERT_TRUE(counted.Next(&block, &size));
+    counted.BackUp(36);
+
+    std::map<std::string, uint64_t> exported;
+    counted.stats().ForEach([&](const char* name, uint64_t value) { exported[name] = value; });
+    EXPECT_EQ(exported["next_calls"], 1u);
+    EXPECT_EQ(exported["next_bytes"], 100u);
+    EXPECT_EQ(exported["backup_bytes"], 36u);
+    EXPECT_EQ(exported["blocks_log2_6"], 1u);       // 100 bytes: [64, 128)
+    EXPECT_EQ(exported.count("blocks_log2_5"), 0u);
+}
+
+// ---------------------------
+// IO Stats Tests
+// ---------------------------
+
+// strings that straddle 5-byte chunks are spilled; contiguous ones are aliased
+TEST(IoStats, CountsSpillsAndAliasing) {
+    std::vector<uint8_t> bytes = EncodeStrings(20, 12);
+    for (size_t chunk : {bytes.size(), static_cast<size_t>(5)}) {
+        ResetIoStats();
+        MultiBufferInputStream mb(SplitChunks(bytes, chunk));
+        CodedInputStream in(&mb);
+        quark::Arena arena;
+        for (int i = 0; i < 20; ++i) {
+            uint8_t tag;
+            std::span<const uint8_t> view;
+            ASSERT_TRUE(in.ReadRaw(&tag, 1));
+            ASSERT_TRUE(ReadLengthDelimitedBytes(&in, view, &arena));
+            ASSERT_EQ(view.size(), 12u);
+        }
+        IoStats stats = GetIoStats();
+        if constexpr (kStatsEnabled) {
+            bool whole = chunk == bytes.size();
+            EXPECT_EQ(stats[IoStat::kSpillCopies] == 0, whole);
+            EXPECT_EQ(stats[IoStat::kBytesCopied] + stats[IoStat::kBytesAliased], 20u * 12u);
+            EXPECT_EQ(stats.varints(1), 20u);
+            EXPECT_GE(stats[IoStat::kInputRefills], whole ? 1u : bytes.size() / 5);
+        } else {
+            stats.ForEach([](const char* name, uint64_t value) { EXPECT_EQ(value, 0u) << name; });
+        }
+    }
+}
+
+// counts made by a thread survive its exit
+TEST(IoStats, SumsExitedThreads) {
+    ResetIoStats();
+    std::thread t([] {
+        VectorOutputStream vos(16);
+        CodedOutputStream out(&vos);
+        for (int i = 0; i < 100; ++i) ASSERT_TRUE(out.WriteVarint64(1ull << 40));
+    });
+    t.join();
+    IoStats stats = GetIoStats();
+    if constexpr (kStatsEnabled) {
+        EXPECT_GT(stats[IoStat::kOutputRefills], 0u);
+        EXPECT_GT(stats[IoStat::kVectorGrows], 0u);
+    } else {
+        EXPECT_EQ(stats[IoStat::kOutputRefills], 0u);
+    }
+}
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include "quark/io/string_dict.h"
+
+using namespace quark::io;
+
+static std::vector<std::string> Labels(size_t n, size_t distinct) {
+    std::vector<std::string> v(n);
+    for (size_t i = 0; i < n; ++i) v[i] = "host-" + std::to_string(i * 7919 % distinct) + ".example.com";
+    return v;
+}
+
+static std::vector<uint8_t> EncodeAll(const std::vector<std::string>& strings, StringDictWriter& dict) {
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        for (const auto& s : strings) EXPECT_TRUE(SerializeDictString(&out, dict, s));
+    }
+    return vos.buffer();
+}
+
+// ---------------------------
+// Dictionary String Tests
+// ---------------------------
+
+TEST(StringDict, RoundTrip) {
+    auto strings = Labels(2000, 300);
+    strings.push_back("");
+    strings.push_back("");
+    StringDictWriter writer;
+    std::vector<uint8_t> bytes = EncodeAll(strings, writer);
+    EXPECT_EQ(writer.size(), 301u);
+
+    // contiguous and split into 5-byte chunks
+    for (size_t chunk : {bytes.size(), static_cast<size_t>(5)}) {
+        std::vector<MultiBufferInputStream::Chunk> chunks;
+        for (size_t off = 0; off < bytes.size(); off += chunk) {
+            chunks.push_back({bytes.data() + off, std::min(chunk, bytes.size() - off)});
+        }
+        MultiBufferInputStream mb(chunks);
+        CodedInputStream in(&mb);
+        StringDictReader reader;
+        for (const auto& s : strings) {
+            std::string_view got;
+            ASSERT_TRUE(DeserializeDictString(&in, reader, got));
+            EXPECT_EQ(got, s);
+        }
+        EXPECT_EQ(reader.size(), 301u);
+    }
+}
+
+// repeated labels cost a tag and a short index instead of the whole string
+TEST(StringDict, SmallerThanPlainStrings) {
+    auto strings = Labels(10000, 200);
+    StringDictWriter writer;
+    size_t dict = EncodeAll(strings, writer).size();
+    VectorOutputStream plain;
+    {
+        CodedOutputStream out(&plain);
+        for (const auto& s : strings) ASSERT_TRUE(SerializeString(&out, s));
+    }
+    EXPECT_LT(dict * 5, plain.buffer().size());
+}
+
+// entries are copied into the reader, so views outlive the input buffer
+TEST(StringDict, ViewsOutliveInput) {
+    auto strings = Labels(50, 10);
+    StringDictWriter writer;
+    StringDictReader reader;
+    std::vector<std::string_view> views;
+    {
+        std::vector<uint8_t> bytes = EncodeAll(strings, writer);
+        BufferInputStream bis(bytes.data(), bytes.size());
+        CodedInputStream in(&bis);
+        for (size_t i = 0; i < strings.size(); ++i) {
+            std::string_view got;
+            ASSERT_TRUE(DeserializeDictString(&in, reader, got));
+            views.push_back(got);
+        }
+        std::fill(bytes.begin(), bytes.end(), 0);
+    }
+    for (size_t i = 0; i < strings.size(); ++i) EXPECT_EQ(views[i], strings[i]);
+}
+
+// past max_entries new strings go out as plain STRING fields
+TEST(StringDict, FullTableFallsBackToPlainStrings) {
+    StringDictWriter writer(2);
+    std::vector<std::string> strings = {"a", "b", "c", "a", "c", "b"};
+    std::vector<uint8_t> bytes = EncodeAll(strings, writer);
+    EXPECT_EQ(writer.size(), 2u);
+    EXPECT_EQ(bytes[6], static_cast<uint8_t>(Type::STRING));
+
+    BufferInputStream bis(bytes.data(), bytes.size());
+    CodedInputStream in(&bis);
+    StringDictReader reader;
+    for (const auto& s : strings) {
+        std::string_view got;
+        ASSERT_TRUE(DeserializeDictString(&in, reader, got));
+        EXPECT_EQ(got, s);
+    }
+    EXPECT_EQ(reader.size(), 2u);
+}
+
+// both ends start over after Reset(); indices restart at 0
+TEST(StringDict, ResetStartsOver) {
+    StringDictWriter writer;
+    StringDictReader reader;
+    for (int batch = 0; batch < 3; ++batch) {
+        auto strings = Labels(100, 20 + batch);
+        std::vector<uint8_t> bytes = EncodeAll(strings, writer);
+        BufferInputStream bis(bytes.data(), bytes.size());
+        CodedInputStream in(&bis);
+        for (const auto& s : strings) {
+            std::string_view got;
+            ASSERT_TRUE(DeserializeDictString(&in, reader, got));
+            EXPECT_EQ(got, s);
+        }
+        EXPECT_EQ(reader.size(), writer.size());
+        writer.Reset();
+        reader.Reset();
+    }
+}
+
+TEST(StringDict, InternKeepsIndicesThroughGrowth) {
+    StringDictWriter writer;
+    uint32_t index;
+    bool added;
+    for (uint32_t i = 0; i < 5000; ++i) {
+        ASSERT_TRUE(writer.Intern(std::to_string(i), index, added));
+        EXPECT_TRUE(added);
+        EXPECT_EQ(index, i);
+    }
+    for (uint32_t i = 0; i < 5000; i += 7) {
+        ASSERT_TRUE(writer.Intern(std::to_string(i), index, added));
+        EXPECT_FALSE(added);
+        EXPECT_EQ(index, i);
+    }
+}
+
+TEST(StringDict, RejectsMalformedInput) {
+    StringDictReader reader;
+    std::string_view got;
+
+    // an index the table does not hold
+    uint8_t unknown[] = {static_cast<uint8_t>(Type::DICT_STRING), 2 << 1};
+    BufferInputStream bis(unknown, sizeof(unknown));
+    EXPECT_FALSE(DeserializeDictString(&bis, reader, got));
+
+    // another type's tag
+    uint8_t wrong[] = {static_cast<uint8_t>(Type::BYTES), 0};
+    BufferInputStream bis2(wrong, sizeof(wrong));
+    EXPECT_FALSE(DeserializeDictString(&bis2, reader, got));
+
+    // truncated anywhere
+    StringDictWriter writer;
+    std::vector<uint8_t> bytes = EncodeAll({"alpha", "beta", "alpha"}, writer);
+    for (size_t cut = 0; cut < bytes.size(); ++cut) {
+        StringDictReader r;
+        BufferInputStream in(bytes.data(), cut);
+        bool ok = true;
+        for (int i = 0; i < 3 && ok; ++i) ok = DeserializeDictString(&in, r, got);
+        EXPECT_FALSE(ok) << cut;
+    }
+}
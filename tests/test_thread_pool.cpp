@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include "quark/thread_pool.h"
+
+TEST(ThreadPool, RunsEveryTaskOnce) {
+    for (size_t threads : {0u, 1u, 3u}) {
+        quark::ThreadPool pool(threads);
+        ASSERT_EQ(pool.concurrency(), threads + 1);
+        for (size_t n : {0u, 1u, 2u, 17u, 1000u}) {
+            std::vector<std::atomic<int>> hits(n);
+            std::vector<std::atomic<int>> busy(pool.concurrency());
+            std::atomic<bool> overlap(false);
+            pool.ParallelFor(n, [&](size_t task, size_t worker) {
+                ASSERT_LT(worker, pool.concurrency());
+                // a worker index is never used by two threads at once
+                if (busy[worker].fetch_add(1) != 0) overlap = true;
+                hits[task].fetch_add(1);
+                busy[worker].fetch_sub(1);
+            });
+            for (size_t i = 0; i < n; ++i) EXPECT_EQ(hits[i].load(), 1) << threads << " " << n << " " << i;
+            EXPECT_FALSE(overlap);
+        }
+    }
+}
+
+// a run of slow tasks dealt to one worker is spread out by stealing
+TEST(ThreadPool, StealsFromBusyWorkers) {
+    quark::ThreadPool pool(3);
+    std::vector<std::atomic<int>> per_worker(pool.concurrency());
+    auto start = std::chrono::steady_clock::now();
+    // tasks 0..9 all start in worker 0's queue; run there alone, they take 100 ms
+    pool.ParallelFor(40, [&](size_t task, size_t worker) {
+        if (task < 10) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            per_worker[worker].fetch_add(1);
+        }
+    });
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_LT(elapsed, std::chrono::milliseconds(80));
+    int max_on_one = 0;
+    for (auto& n : per_worker) max_on_one = std::max(max_on_one, n.load());
+    EXPECT_LT(max_on_one, 10);
+}
+
+TEST(ThreadPool, RethrowsFirstException) {
+    quark::ThreadPool pool(2);
+    std::atomic<int> ran(0);
+    EXPECT_THROW(pool.ParallelFor(50, [&](size_t task, size_t) {
+        ++ran;
+        if (task == 7) throw std::runtime_error("task failed");
+    }), std::runtime_error);
+    EXPECT_EQ(ran.load(), 50);
+
+    // the pool stays usable
+    ran = 0;
+    pool.ParallelFor(10, [&](size_t, size_t) { ++ran; });
+    EXPECT_EQ(ran.load(), 10);
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include "quark/tlv.hpp"
+
+using namespace quark::io;
+
+// the raw-buffer API and the stream API share one encoding
+TEST(Tlv, MatchesStreamEncoding) {
+    std::string str(200, 's');
+    std::vector<uint8_t> raw(quark::serialized_size_int32() + quark::serialized_size_float32() +
+                             quark::serialized_size_string(str));
+    size_t pos = 0;
+    pos += quark::serialize_int32(raw.data() + pos, -7);
+    pos += quark::serialize_float32(raw.data() + pos, 1.5f);
+    pos += quark::serialize_string(raw.data() + pos, str);
+    ASSERT_EQ(pos, raw.size());
+
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        SerializeInt32(&out, -7);
+        SerializeFloat32(&out, 1.5f);
+        SerializeString(&out, str);
+    }
+    EXPECT_EQ(vos.buffer(), raw);
+
+    EXPECT_EQ(quark::deserialize_int32(raw.data()), -7);
+    EXPECT_EQ(quark::deserialize_float32(raw.data() + 5), 1.5f);
+    size_t used;
+    EXPECT_EQ(quark::deserialize_string(raw.data() + 10, used), str);
+    EXPECT_EQ(used, raw.size() - 10);
+    EXPECT_THROW(quark::deserialize_float32(raw.data()), std::runtime_error);
+}
+
+// the stream functions use the unchecked codecs inside the window and fall
+// back at window edges; both paths agree
+TEST(Tlv, WindowEdgesFallBackToStream) {
+    VectorOutputStream vos(3);
+    {
+        CodedOutputStream out(&vos);
+        for (int i = 0; i < 50; ++i) {
+            ASSERT_TRUE(SerializeInt32(&out, i));
+            ASSERT_TRUE(SerializeFloat32(&out, i * 0.5f));
+            ASSERT_TRUE(SerializeString(&out, std::string(i, 'x')));
+        }
+    }
+    const std::vector<uint8_t>& buf = vos.buffer();
+    size_t pos = 0;
+    for (int i = 0; i < 50; ++i) {
+        ASSERT_EQ(quark::deserialize_int32(buf.data() + pos), i);
+        pos += 5;
+        ASSERT_EQ(quark::deserialize_float32(buf.data() + pos), i * 0.5f);
+        pos += 5;
+        size_t used;
+        ASSERT_EQ(quark::deserialize_string(buf.data() + pos, used), std::string(i, 'x'));
+        pos += used;
+    }
+    EXPECT_EQ(pos, buf.size());
+
+    for (size_t chunk : {size_t(1), size_t(4), size_t(64)}) {
+        std::vector<MultiBufferInputStream::Chunk> chunks;
+        for (size_t off = 0; off < buf.size(); off += chunk) {
+            chunks.push_back({buf.data() + off, std::min(chunk, buf.size() - off)});
+        }
+        MultiBufferInputStream mb(chunks);
+        CodedInputStream in(&mb);
+        for (int i = 0; i < 50; ++i) {
+            int32_t iv;
+            float fv;
+            ASSERT_TRUE(DeserializeInt32(&in, iv));
+            ASSERT_TRUE(DeserializeFloat32(&in, fv));
+            EXPECT_EQ(iv, i);
+            EXPECT_EQ(fv, i * 0.5f);
+            quark::Arena arena;
+            std::string_view sv;
+            ASSERT_TRUE(DeserializeString(&in, sv, &arena));
+            EXPECT_EQ(sv, std::string(i, 'x'));
+        }
+    }
+}
+
+// a window clipped by PushLimit() never lets the unchecked reader cross it
+TEST(Tlv, WindowRespectsLimit) {
+    VectorOutputStream vos;
+    SerializeInt32(&vos, 1);
+    SerializeInt32(&vos, 2);
+    BufferInputStream bis(vos.buffer().data(), vos.buffer().size());
+    CodedInputStream in(&bis);
+    auto limit = in.PushLimit(7);
+    int32_t v;
+    EXPECT_TRUE(DeserializeInt32(&in, v));
+    EXPECT_EQ(in.GetDirectBufferForNBytesAndAdvance(kInt32FieldSize), nullptr);
+    EXPECT_FALSE(DeserializeInt32(&in, v));
+    in.PopLimit(limit);
+}
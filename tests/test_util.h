@@ -0,0 +1,38 @@
+#pragma once
+// test_util.h
+// Fixtures shared by the stream tests.
+
+#include <algorithm>
+#include <vector>
+#include "quark/io/zero_copy_stream.h"
+#include "test_schema.quark.h"
+
+// split a buffer into fixed-size chunks to force window refills
+inline std::vector<quark::io::MultiBufferInputStream::Chunk> SplitChunks(const std::vector<uint8_t>& buf, size_t chunk) {
+    std::vector<quark::io::MultiBufferInputStream::Chunk> chunks;
+    for (size_t off = 0; off < buf.size(); off += chunk) {
+        chunks.push_back({buf.data() + off, std::min(chunk, buf.size() - off)});
+    }
+    return chunks;
+}
+
+// a record whose every field depends on 'i'; names run 0..40 bytes and every
+// third tag is empty, so batches cover empty strings too
+inline quark_test::Mixed MakeRecord(int i) {
+    quark_test::Mixed msg;
+    msg.id = i;
+    msg.score = 0.5f * i;
+    msg.name = std::string(i % 41, static_cast<char>('a' + i % 26));
+    msg.a = -i;
+    msg.b = static_cast<int32_t>(static_cast<uint32_t>(i) * static_cast<uint32_t>(i));   // wraps past 46340
+    msg.tag = i % 3 ? "record" : "";
+    return msg;
+}
+
+// records MakeRecord(0) .. MakeRecord(n - 1)
+inline std::vector<quark_test::Mixed> MakeRecords(size_t n) {
+    std::vector<quark_test::Mixed> records;
+    records.reserve(n);
+    for (size_t i = 0; i < n; ++i) records.push_back(MakeRecord(static_cast<int>(i)));
+    return records;
+}
@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <random>
+#include "quark/io/zero_copy_stream.h"
+
+using namespace quark::io;
+
+// encode values back-to-back, followed by 'pad' zero bytes
+template <typename T>
+static std::vector<uint8_t> EncodeAll(const std::vector<T>& values, size_t pad = 0) {
+    std::vector<uint8_t> buf(values.size() * kMaxVarint64Bytes + pad);
+    uint8_t* p = buf.data();
+    for (T v : values) p = CodedOutputStream::EncodeVarint(p, v);
+    buf.resize(p - buf.data() + pad);
+    return buf;
+}
+
+// values whose encodings cover every varint length, mixed randomly
+static std::vector<uint32_t> MixedValues32(size_t n, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint32_t> values(n);
+    for (auto& v : values) {
+        int bits = std::uniform_int_distribution<int>(0, 32)(rng);
+        v = bits == 0 ? 0 : static_cast<uint32_t>(rng()) >> (32 - bits);
+    }
+    return values;
+}
+
+// ---------------------------
+// Single-value Decoder Tests
+// ---------------------------
+TEST(Varint, Unchecked32EveryLength) {
+    for (uint32_t v : {0u, 1u, 127u, 128u, 16383u, 16384u, (1u << 21) - 1, 1u << 21,
+                       (1u << 28) - 1, 1u << 28, 0xFFFFFFFFu}) {
+        auto buf = EncodeAll<uint32_t>({v}, 8);
+        uint32_t out;
+        const uint8_t* next = DecodeVarint32Unchecked(buf.data(), out);
+        ASSERT_NE(next, nullptr);
+        EXPECT_EQ(out, v);
+        EXPECT_EQ(static_cast<size_t>(next - buf.data()), buf.size() - 8);
+    }
+}
+
+TEST(Varint, Unchecked64EveryLength) {
+    for (int bits = 0; bits <= 64; ++bits) {
+        uint64_t v = bits == 0 ? 0 : (~0ull >> (64 - bits));
+        auto buf = EncodeAll<uint64_t>({v}, 10);
+        uint64_t out;
+        const uint8_t* next = DecodeVarint64Unchecked(buf.data(), out);
+        ASSERT_NE(next, nullptr) << bits;
+        EXPECT_EQ(out, v) << bits;
+        EXPECT_EQ(static_cast<size_t>(next - buf.data()), buf.size() - 10);
+    }
+}
+
+TEST(Varint, UncheckedRejectsOverlong) {
+    std::vector<uint8_t> buf(16, 0xFF);
+    uint32_t v32;
+    uint64_t v64;
+    EXPECT_EQ(DecodeVarint32Unchecked(buf.data(), v32), nullptr);
+    EXPECT_EQ(DecodeVarint64Unchecked(buf.data(), v64), nullptr);
+}
+
+// size helpers must agree with what the encoder actually writes
+TEST(Varint, SizeMatchesEncoding) {
+    uint8_t buf[kMaxVarint64Bytes];
+    for (int shift = 0; shift < 64; ++shift) {
+        for (uint64_t v : {uint64_t{1} << shift, (uint64_t{1} << shift) - 1}) {
+            size_t n = CodedOutputStream::EncodeVarint(buf, v) - buf;
+            EXPECT_EQ(VarintSize64(v), n) << v;
+            if (v <= UINT32_MAX) {
+                EXPECT_EQ(VarintSize32(static_cast<uint32_t>(v)), n) << v;
+            }
+        }
+    }
+    static_assert(VarintSize32(0) == 1 && VarintSize32(UINT32_MAX) == 5);
+    static_assert(VarintSize64(UINT64_MAX) == 10);
+}
+
+// ---------------------------
+// Bulk Decoder Tests
+// ---------------------------
+
+// every Masked-VByte table entry must agree with the scalar decoder
+TEST(Varint, ZigZag) {
+    static_assert(ZigZagEncode32(0) == 0 && ZigZagEncode32(-1) == 1 && ZigZagEncode32(1) == 2);
+    static_assert(ZigZagEncode32(INT32_MIN) == UINT32_MAX && ZigZagEncode32(INT32_MAX) == UINT32_MAX - 1);
+    static_assert(ZigZagEncode64(INT64_MIN) == UINT64_MAX);
+    for (int32_t v : {0, 1, -1, 63, -64, 64, INT32_MAX, INT32_MIN}) {
+        EXPECT_EQ(ZigZagDecode32(ZigZagEncode32(v)), v);
+        EXPECT_EQ(ZigZagDecode64(ZigZagEncode64(v)), v);
+    }
+    for (int64_t v : {INT64_MAX, INT64_MIN, int64_t{-1} << 40}) {
+        EXPECT_EQ(ZigZagDecode64(ZigZagEncode64(v)), v);
+    }
+    // small negative deltas stay one byte
+    EXPECT_EQ(VarintSize32(ZigZagEncode32(-64)), 1u);
+}
+
+TEST(Varint, MaskedVByteTableMatchesScalar) {
+    for (unsigned mask = 0; mask < 4096; ++mask) {
+        // bytes follow the mask's continuation bits; payloads vary per byte
+        std::vector<uint8_t> buf(64, 0);
+        for (int i = 0; i < 12; ++i) {
+            buf[i] = static_cast<uint8_t>(((i * 37 + mask) & 0x7F) | (((mask >> i) & 1) << 7));
+        }
+
+        std::vector<uint32_t> batch(32), scalar;
+        const uint8_t* p = buf.data();
+        size_t n = DecodeVarint32Batch(p, buf.data() + buf.size(), batch.data(), 16);
+
+        const uint8_t* q = buf.data();
+        while (q < p) {
+            uint32_t v = 0;
+            q = DecodeVarint32Unchecked(q, v);
+            ASSERT_NE(q, nullptr);
+            scalar.push_back(v);
+        }
+        ASSERT_EQ(q, p) << "mask " << mask;
+        ASSERT_EQ(scalar.size(), n) << "mask " << mask;
+        for (size_t i = 0; i < n; ++i) EXPECT_EQ(batch[i], scalar[i]) << "mask " << mask;
+    }
+}
+
+TEST(Varint, BatchMixedLengths) {
+    auto values = MixedValues32(10000, 42);
+    auto buf = EncodeAll(values);
+
+    BufferInputStream bis(buf.data(), buf.size());
+    std::vector<uint32_t> out(values.size());
+    EXPECT_TRUE(ReadVarint32Batch(&bis, out.data(), out.size()));
+    EXPECT_EQ(out, values);
+    EXPECT_EQ(bis.ByteCount(), static_cast<int64_t>(buf.size()));
+}
+
+// window edges fall back to the bytewise path without losing values
+TEST(Varint, BatchAcrossChunks) {
+    auto values = MixedValues32(2000, 7);
+    auto buf = EncodeAll(values);
+
+    for (size_t chunk : {1u, 5u, 17u, 100u}) {
+        std::vector<MultiBufferInputStream::Chunk> chunks;
+        for (size_t off = 0; off < buf.size(); off += chunk) {
+            chunks.push_back({buf.data() + off, std::min(chunk, buf.size() - off)});
+        }
+        MultiBufferInputStream mb(chunks);
+        CodedInputStream in(&mb);
+        std::vector<uint32_t> out(values.size());
+        EXPECT_TRUE(in.ReadVarint32Batch(out.data(), 1000));
+        EXPECT_TRUE(in.ReadVarint32Batch(out.data() + 1000, 1000));
+        EXPECT_EQ(out, values) << "chunk " << chunk;
+        uint32_t extra;
+        EXPECT_FALSE(in.ReadVarint32Batch(&extra, 1));
+    }
+}
+
+TEST(Varint, BatchRejectsMalformed) {
+    std::vector<uint8_t> buf(40, 0x01);
+    std::fill(buf.begin() + 20, buf.begin() + 26, 0xFF);  // six continuation bytes
+    BufferInputStream bis(buf.data(), buf.size());
+    std::vector<uint32_t> out(30);
+    EXPECT_FALSE(ReadVarint32Batch(&bis, out.data(), out.size()));
+}
+
+// ---------------------------
+// Performance Tests
+// ---------------------------
+TEST(Varint, BatchPerformanceMicro) {
+    auto values = MixedValues32(1 << 20, 1);
+    for (auto& v : values) v &= 0x3FFF;     // 1-2 byte varints, the common case
+    auto buf = EncodeAll(values);
+    std::vector<uint32_t> out(values.size());
+
+    auto time_us = [](auto f) {
+        auto start = std::chrono::high_resolution_clock::now();
+        f();
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::micro>(end - start).count();
+    };
+    double single_us = time_us([&]{
+        BufferInputStream bis(buf.data(), buf.size());
+        CodedInputStream in(&bis);
+        for (auto& v : out) in.ReadVarint32(v);
+    });
+    double batch_us = time_us([&]{
+        BufferInputStream bis(buf.data(), buf.size());
+        ReadVarint32Batch(&bis, out.data(), out.size());
+    });
+    EXPECT_EQ(out, values);
+    std::cout << "Varint32 decode x" << values.size() << ", one-at-a-time: " << single_us
+              << " us, batch: " << batch_us << " us\n";
+}
@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
 #include <chrono>
+#include <cstdio>
+#include <fstream>
 #include "quark/io/zero_copy_stream.h"
+#include "test_util.h"
 
 using namespace quark::io;
 
@@ -97,6 +100,134 @@ TEST(ZeroCopyStream, MultiBufferInputStream) {
     EXPECT_EQ(result, "abcdefghij");
 }
 
+// fixed-width values must decode at every possible split point
+TEST(ZeroCopyStream, FixedAcrossEveryChunkSplit) {
+    VectorOutputStream vos;
+    WriteFixed32(&vos, 0xDEADBEEFu);
+    WriteFixed64(&vos, 0x0123456789ABCDEFull);
+    const auto& buf = vos.buffer();
+    ASSERT_EQ(buf.size(), 12u);
+
+    for (size_t split = 1; split < buf.size(); ++split) {
+        std::vector<MultiBufferInputStream::Chunk> chunks = {
+            {buf.data(), split},
+            {buf.data() + split, buf.size() - split},
+        };
+        MultiBufferInputStream mb(chunks);
+        uint32_t a;
+        uint64_t b;
+        EXPECT_TRUE(ReadFixed32(&mb, a)) << "split " << split;
+        EXPECT_TRUE(ReadFixed64(&mb, b)) << "split " << split;
+        EXPECT_EQ(a, 0xDEADBEEFu);
+        EXPECT_EQ(b, 0x0123456789ABCDEFull);
+        EXPECT_EQ(mb.ByteCount(), 12);
+    }
+}
+
+// one byte per chunk: a fixed64 spans eight chunks
+TEST(ZeroCopyStream, FixedAcrossSingleByteChunks) {
+    VectorOutputStream vos;
+    for (uint64_t i = 0; i < 16; ++i) WriteFixed64(&vos, i * 0x1111111111111111ull);
+    const auto& buf = vos.buffer();
+    std::vector<MultiBufferInputStream::Chunk> chunks;
+    for (size_t i = 0; i < buf.size(); ++i) chunks.push_back({buf.data() + i, 1});
+
+    MultiBufferInputStream mb(chunks);
+    for (uint64_t i = 0; i < 16; ++i) {
+        uint64_t v;
+        ASSERT_TRUE(ReadFixed64(&mb, v));
+        EXPECT_EQ(v, i * 0x1111111111111111ull);
+    }
+    uint32_t tail;
+    EXPECT_FALSE(ReadFixed32(&mb, tail));
+}
+
+// unaligned load/store helpers must agree with the byte-wise wire format
+TEST(ZeroCopyStream, LittleEndianHelpers) {
+    uint8_t buf[9] = {0};
+    StoreLittleEndian32(buf + 1, 0x04030201u);
+    EXPECT_EQ(buf[1], 1);
+    EXPECT_EQ(buf[4], 4);
+    EXPECT_EQ(LoadLittleEndian32(buf + 1), 0x04030201u);
+    StoreLittleEndian64(buf + 1, 0x0807060504030201ull);
+    EXPECT_EQ(buf[8], 8);
+    EXPECT_EQ(LoadLittleEndian64(buf + 1), 0x0807060504030201ull);
+}
+
+// ---------------------------
+// MmapInputStream Tests
+// ---------------------------
+
+// writes 'bytes' to a fresh temp file and returns its path
+static std::string WriteTempFile(const std::vector<uint8_t>& bytes) {
+    char path[] = "/tmp/quark_mmap_XXXXXX";
+    int fd = mkstemp(path);
+    EXPECT_GE(fd, 0);
+    close(fd);
+    std::ofstream f(path, std::ios::binary);
+    f.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    return path;
+}
+
+TEST(MmapInputStream, ReadsWholeFileInWindows) {
+    std::vector<uint8_t> bytes(10000);
+    for (size_t i = 0; i < bytes.size(); ++i) bytes[i] = static_cast<uint8_t>(i * 31);
+    std::string path = WriteTempFile(bytes);
+
+    MmapOptions opts;
+    opts.window_size = 4096;
+    opts.readahead = 8192;
+    opts.huge_pages = true;
+    MmapInputStream in(path, opts);
+    EXPECT_EQ(in.size(), bytes.size());
+
+    std::vector<uint8_t> result;
+    const uint8_t* block;
+    size_t size;
+    while (in.Next(&block, &size)) {
+        EXPECT_LE(size, 4096u);
+        result.insert(result.end(), block, block + size);
+    }
+    EXPECT_EQ(result, bytes);
+    EXPECT_EQ(in.ByteCount(), 10000);
+    std::remove(path.c_str());
+}
+
+TEST(MmapInputStream, EmptyFile) {
+    std::string path = WriteTempFile({});
+    MmapInputStream in(path);
+    const uint8_t* block;
+    size_t size;
+    EXPECT_EQ(in.size(), 0u);
+    EXPECT_FALSE(in.Next(&block, &size));
+    EXPECT_TRUE(in.Skip(0));
+    EXPECT_FALSE(in.Skip(1));
+    std::remove(path.c_str());
+}
+
+TEST(MmapInputStream, BackUpSkipAndDecode) {
+    VectorOutputStream vos;
+    for (uint32_t i = 0; i < 100; ++i) WriteFixed32(&vos, i);
+    std::string path = WriteTempFile(vos.buffer());
+
+    MmapOptions opts;
+    opts.window_size = 6;
+    opts.populate = true;
+    MmapInputStream in(path, opts);
+    EXPECT_TRUE(in.Skip(40));
+    uint32_t v;
+    EXPECT_TRUE(ReadFixed32(&in, v));
+    EXPECT_EQ(v, 10u);
+    EXPECT_EQ(in.ByteCount(), 44);
+    EXPECT_FALSE(in.Skip(1000));
+    EXPECT_EQ(in.ByteCount(), 400);
+    std::remove(path.c_str());
+}
+
+TEST(MmapInputStream, MissingFileThrows) {
+    EXPECT_THROW(MmapInputStream("/nonexistent/quark.bin"), std::runtime_error);
+}
+
 // ---------------------------
 // BackUp & Skip Tests
 // ---------------------------
@@ -133,6 +264,157 @@ TEST(ZeroCopyStream, VectorOutputStreamGrowth) {
 
 }
 
+// ---------------------------
+// ChainedOutputStream Tests
+// ---------------------------
+TEST(ChainedOutputStream, GeometricGrowthAndIovecs) {
+    ChainedOutputStream cos(64, 256);
+    std::vector<uint8_t> expected;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(WriteVarint32(&cos, i));
+        uint8_t tmp[5];
+        expected.insert(expected.end(), tmp, CodedOutputStream::EncodeVarint(tmp, i));
+    }
+    EXPECT_EQ(static_cast<size_t>(cos.ByteCount()), expected.size());
+
+    // 64 + 128 + 256 + 256 + ... covers the 1872 bytes written
+    auto iov = cos.iovecs();
+    EXPECT_EQ(iov[0].iov_len, 64u);
+    EXPECT_EQ(iov[1].iov_len, 128u);
+    EXPECT_EQ(iov[2].iov_len, 256u);
+    std::vector<uint8_t> gathered;
+    for (const iovec& v : iov) {
+        EXPECT_LE(v.iov_len, 256u);
+        const uint8_t* p = static_cast<const uint8_t*>(v.iov_base);
+        gathered.insert(gathered.end(), p, p + v.iov_len);
+    }
+    EXPECT_EQ(gathered, expected);
+
+    std::vector<uint8_t> flat(cos.ByteCount());
+    cos.CopyTo(flat.data());
+    EXPECT_EQ(flat, expected);
+}
+
+// backed-up space is handed out again by the next Next()
+TEST(ChainedOutputStream, BackUpReusesBlockSpace) {
+    ChainedOutputStream cos(64);
+    const uint8_t data[5] = {1,2,3,4,5};
+    EXPECT_TRUE(cos.WriteRaw(data, 5));
+    EXPECT_TRUE(cos.WriteRaw(data, 5));
+    EXPECT_EQ(cos.ByteCount(), 10);
+    EXPECT_EQ(cos.block_count(), 1u);
+    EXPECT_THROW(cos.BackUp(100), std::runtime_error);
+
+    auto iov = cos.iovecs();
+    ASSERT_EQ(iov.size(), 1u);
+    EXPECT_EQ(iov[0].iov_len, 10u);
+}
+
+TEST(ChainedOutputStream, ClearKeepsBlocks) {
+    ChainedOutputStream cos(64);
+    std::vector<uint8_t> payload(1000, 0xAB);
+    EXPECT_TRUE(cos.WriteRaw(payload.data(), payload.size()));
+    size_t blocks = cos.block_count();
+    EXPECT_EQ(blocks, 16u);
+
+    cos.Clear();
+    EXPECT_EQ(cos.ByteCount(), 0);
+    EXPECT_TRUE(cos.iovecs().empty());
+    EXPECT_TRUE(cos.WriteRaw(payload.data(), payload.size()));
+    EXPECT_EQ(cos.block_count(), blocks);
+    EXPECT_EQ(cos.ByteCount(), 1000);
+}
+
+// a large payload is linked into the chain by reference, as its own iovec
+TEST(ChainedOutputStream, AliasedPayloadIsReferenced) {
+    std::string big(4096, 'a');
+    std::vector<uint8_t> blob(2048, 0x5A);
+
+    ChainedOutputStream cos;
+    {
+        CodedOutputStream out(&cos);
+        out.EnableAliasing(true);
+        ASSERT_TRUE(SerializeString(&out, big));
+        ASSERT_TRUE(SerializeString(&out, std::string("small")));
+        ASSERT_TRUE(SerializeBytes(&out, blob));
+        ASSERT_TRUE(WriteVarint32(&out, 7u));
+    }
+    auto iov = cos.iovecs();
+    ASSERT_EQ(iov.size(), 5u);
+    EXPECT_EQ(iov[1].iov_base, big.data());
+    EXPECT_EQ(iov[1].iov_len, big.size());
+    EXPECT_EQ(iov[3].iov_base, blob.data());
+
+    // same bytes as a copying encode
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        ASSERT_TRUE(SerializeString(&out, big));
+        ASSERT_TRUE(SerializeString(&out, std::string("small")));
+        ASSERT_TRUE(SerializeBytes(&out, blob));
+        ASSERT_TRUE(WriteVarint32(&out, 7u));
+    }
+    ASSERT_EQ(static_cast<size_t>(cos.ByteCount()), vos.buffer().size());
+    std::vector<uint8_t> flat(cos.ByteCount());
+    cos.CopyTo(flat.data());
+    EXPECT_EQ(flat, vos.buffer());
+}
+
+TEST(ChainedOutputStream, AliasingIsOptIn) {
+    std::string big(4096, 'b');
+    ChainedOutputStream cos;
+    ASSERT_TRUE(SerializeString(&cos, big));
+    for (const iovec& v : cos.iovecs()) EXPECT_NE(v.iov_base, big.data());
+
+    // below the threshold payloads are copied even when enabled
+    cos.Clear();
+    std::string mid(kMinAliasedSize - 1, 'm');
+    {
+        CodedOutputStream out(&cos);
+        out.EnableAliasing(true);
+        EXPECT_FALSE(out.ShouldAlias(mid.size()));
+        ASSERT_TRUE(SerializeString(&out, mid));
+    }
+    EXPECT_EQ(cos.iovecs().size(), 1u);
+}
+
+// streams without aliasing support copy, so enabling it is always safe
+TEST(ChainedOutputStream, AliasingFallsBackToCopy) {
+    std::string big(4096, 'c');
+    VectorOutputStream vos;
+    {
+        BasicCodedOutputStream<VectorOutputStream> out(&vos);
+        out.EnableAliasing(true);
+        EXPECT_FALSE(out.ShouldAlias(big.size()));
+        ASSERT_TRUE(out.WriteAliased(big.data(), big.size()));
+    }
+    ASSERT_EQ(vos.buffer().size(), big.size());
+    EXPECT_EQ(std::memcmp(vos.buffer().data(), big.data(), big.size()), 0);
+}
+
+// Clear() drops aliased blocks and reuses the owned ones, including a block
+// that was closed early by an alias
+TEST(ChainedOutputStream, ClearDropsAliasedBlocks) {
+    std::vector<uint8_t> payload(3000, 0x11);
+    std::vector<uint8_t> blob(5000, 0x22);
+    ChainedOutputStream cos(1024, 4096);
+    for (int round = 0; round < 3; ++round) {
+        cos.Clear();
+        EXPECT_TRUE(cos.WriteRaw(payload.data(), 100));
+        EXPECT_TRUE(cos.WriteAliasedRaw(blob.data(), blob.size()));
+        EXPECT_TRUE(cos.WriteRaw(payload.data(), payload.size()));
+        EXPECT_EQ(cos.ByteCount(), 8100);
+
+        auto iov = cos.iovecs();
+        ASSERT_EQ(iov.size(), 4u) << round;
+        EXPECT_EQ(iov[0].iov_len, 100u);
+        EXPECT_EQ(iov[1].iov_base, blob.data());
+        EXPECT_EQ(iov[2].iov_len, 2048u);
+        EXPECT_EQ(iov[3].iov_len, 952u);
+    }
+    EXPECT_EQ(cos.block_count(), 4u);
+}
+
 // ---------------------------
 // Performance Tests
 // ---------------------------
@@ -168,6 +450,35 @@ TEST(ZeroCopyStream, Fixed64PerformanceMicro) {
     std::cout << "Fixed64 write: " << write_us << " us, read: " << read_us << " us\n";
 }
 
+// mmap vs. the read()-into-a-vector + BufferInputStream path it replaces
+TEST(ZeroCopyStream, MmapVsBufferPerformanceMicro) {
+    const int N = 1 << 20;
+    VectorOutputStream vos;
+    for (uint32_t i = 0; i < N; ++i) WriteVarint32(&vos, i);
+    std::string path = WriteTempFile(vos.buffer());
+
+    uint64_t sum_buf = 0, sum_mmap = 0;
+    double buffer_us = measure_microseconds([&]{
+        std::ifstream f(path, std::ios::binary);
+        std::vector<uint8_t> bytes(vos.buffer().size());
+        f.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+        BufferInputStream bis(bytes.data(), bytes.size());
+        CodedInputStream in(&bis);
+        uint32_t val;
+        while (in.ReadVarint32(val)) sum_buf += val;
+    });
+    double mmap_us = measure_microseconds([&]{
+        MmapInputStream mis(path);
+        CodedInputStream in(&mis);
+        uint32_t val;
+        while (in.ReadVarint32(val)) sum_mmap += val;
+    });
+    EXPECT_EQ(sum_buf, sum_mmap);
+    std::cout << "Varint32 file scan, read+BufferInputStream: " << buffer_us
+              << " us, MmapInputStream: " << mmap_us << " us\n";
+    std::remove(path.c_str());
+}
+
 // ---------------------------
 // Edge Case Tests
 // ---------------------------
@@ -205,8 +516,8 @@ TEST(ZeroCopyStream, BackUpTooManyBytes) {
 TEST(ZeroCopyStream, SkipTooManyBytes) {
     uint8_t data[5] = {1,2,3,4,5};
     BufferInputStream bis(data, 5);
-    uint8_t block;
-    EXPECT_TRUE(bis.ReadRaw(&block, 3));
+    uint8_t block[3];
+    EXPECT_TRUE(bis.ReadRaw(block, 3));
     EXPECT_FALSE(bis.Skip(10));
     EXPECT_EQ(bis.ByteCount(), 5);
 }
@@ -233,5 +544,634 @@ TEST(ZeroCopyStream, MultiBlockBackUp) {
     EXPECT_THROW(vos.BackUp(10), std::runtime_error);
 }
 
+// ---------------------------
+// CodedStream Tests
+// ---------------------------
+
+TEST(CodedStream, MixedRoundTripAcrossChunks) {
+    VectorOutputStream vos(64);
+    {
+        CodedOutputStream out(&vos);
+        for (uint32_t i = 0; i < 200; ++i) {
+            EXPECT_TRUE(out.WriteVarint32(i * 7919u));
+            EXPECT_TRUE(out.WriteFixed32(i));
+            EXPECT_TRUE(out.WriteVarint64(static_cast<uint64_t>(i) << 40));
+            EXPECT_TRUE(out.WriteFixed64(~static_cast<uint64_t>(i)));
+        }
+        EXPECT_FALSE(out.HadError());
+    }
+    EXPECT_EQ(static_cast<size_t>(vos.ByteCount()), vos.buffer().size());
+
+    for (size_t chunk : {1u, 3u, 7u, 4096u}) {
+        MultiBufferInputStream mb(SplitChunks(vos.buffer(), chunk));
+        CodedInputStream in(&mb);
+        for (uint32_t i = 0; i < 200; ++i) {
+            uint32_t a, b;
+            uint64_t c, d;
+            ASSERT_TRUE(in.ReadVarint32(a));
+            ASSERT_TRUE(in.ReadFixed32(b));
+            ASSERT_TRUE(in.ReadVarint64(c));
+            ASSERT_TRUE(in.ReadFixed64(d));
+            EXPECT_EQ(a, i * 7919u);
+            EXPECT_EQ(b, i);
+            EXPECT_EQ(c, static_cast<uint64_t>(i) << 40);
+            EXPECT_EQ(d, ~static_cast<uint64_t>(i));
+        }
+        uint8_t extra;
+        EXPECT_FALSE(in.ReadByte(extra));
+    }
+}
+
+// destroying the cursor hands the unread window back to the stream
+TEST(CodedStream, BackUpRemainingOnDestruction) {
+    uint8_t data[10] = {1,2,3,4,5,6,7,8,9,10};
+    BufferInputStream bis(data, 10);
+    {
+        CodedInputStream in(&bis);
+        uint32_t v;
+        EXPECT_TRUE(in.ReadFixed32(v));
+        EXPECT_EQ(in.ByteCount(), 4);
+    }
+    EXPECT_EQ(bis.ByteCount(), 4);
+
+    uint8_t b = 0;
+    EXPECT_TRUE(bis.ReadRaw(&b, 1));
+    EXPECT_EQ(b, 5);
+}
+
+TEST(CodedStream, SerializeSequenceThroughCursor) {
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        EXPECT_TRUE(SerializeInt32(&out, -42));
+        EXPECT_TRUE(SerializeFloat32(&out, 3.5f));
+        EXPECT_TRUE(SerializeString(&out, "hello quark"));
+    }
+
+    BufferInputStream bis(vos.buffer().data(), vos.buffer().size());
+    CodedInputStream in(&bis);
+    int32_t i;
+    float f;
+    std::string str;
+    std::string_view view;
+    std::shared_ptr<std::vector<uint8_t>> spill;
+    EXPECT_TRUE(DeserializeInt32(&in, i));
+    EXPECT_TRUE(DeserializeFloat32(&in, f));
+    EXPECT_TRUE(DeserializeString(&in, str, spill, view));
+    EXPECT_EQ(i, -42);
+    EXPECT_EQ(f, 3.5f);
+    EXPECT_EQ(view, "hello quark");
+    EXPECT_FALSE(spill);
+}
+
+// a wrong type tag fails after consuming just the tag, whether or not the
+// field is contiguous in the window
+TEST(CodedStream, TypeMismatchConsumesOnlyTheTag) {
+    VectorOutputStream vos;
+    SerializeFloat32(&vos, 1.5f);
+    SerializeInt32(&vos, 9);
+
+    for (size_t chunk : {1u, 4096u}) {
+        MultiBufferInputStream mb(SplitChunks(vos.buffer(), chunk));
+        CodedInputStream in(&mb);
+        int32_t i = -1;
+        float f = 0;
+        EXPECT_FALSE(DeserializeInt32(&in, i));
+        EXPECT_EQ(i, -1);
+        EXPECT_EQ(in.ByteCount(), 1);
+        uint32_t bits;
+        ASSERT_TRUE(in.ReadFixed32(bits));
+        EXPECT_EQ(std::bit_cast<float>(bits), 1.5f);
+
+        EXPECT_FALSE(DeserializeFloat32(&in, f));
+        EXPECT_EQ(in.ByteCount(), static_cast<int64_t>(kFloat32FieldSize + 1)) << "chunk " << chunk;
+        ASSERT_TRUE(in.ReadFixed32(bits));
+        EXPECT_EQ(bits, 9u);
+    }
+}
+
+// the free functions still work on raw streams, one value at a time
+TEST(CodedStream, FreeFunctionsOnRawStreams) {
+    VectorOutputStream vos;
+    EXPECT_TRUE(SerializeInt32(&vos, 7));
+    EXPECT_TRUE(SerializeString(&vos, "split me"));
+    EXPECT_EQ(vos.buffer().size(), 5u + 1u + 1u + 8u);
+
+    MultiBufferInputStream mb(SplitChunks(vos.buffer(), 3));
+    int32_t i;
+    std::string str;
+    std::string_view view;
+    std::shared_ptr<std::vector<uint8_t>> spill;
+    EXPECT_TRUE(DeserializeInt32(&mb, i));
+    EXPECT_TRUE(DeserializeString(&mb, str, spill, view));
+    EXPECT_EQ(i, 7);
+    EXPECT_EQ(view, "split me");
+    EXPECT_TRUE(spill);
+    EXPECT_EQ(mb.ByteCount(), static_cast<int64_t>(vos.buffer().size()));
+}
+
+// *ToArray writers fill a pre-sized buffer with the same bytes the stream path writes
+TEST(CodedStream, ToArrayMatchesStreamEncoding) {
+    std::string text(200, 'x');   // two-byte length prefix
+
+    VectorOutputStream vos;
+    SerializeInt32(&vos, -42);
+    SerializeFloat32(&vos, 3.5f);
+    SerializeString(&vos, text);
+    SerializeString(&vos, "");
+
+    size_t size = kInt32FieldSize + kFloat32FieldSize + StringFieldSize(text.size()) + StringFieldSize(0);
+    ASSERT_EQ(size, vos.buffer().size());
+
+    std::vector<uint8_t> buf(size);
+    uint8_t* p = buf.data();
+    p = SerializeInt32ToArray(p, -42);
+    p = SerializeFloat32ToArray(p, 3.5f);
+    p = SerializeStringToArray(p, text);
+    p = SerializeStringToArray(p, "");
+    EXPECT_EQ(p, buf.data() + size);
+    EXPECT_EQ(buf, vos.buffer());
+}
+
+// a pushed limit clips every read, and popping it exposes the rest of the window
+TEST(CodedStream, PushLimitBoundsNestedReads) {
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        SerializeMessageHeader(&out, 9);
+        out.WriteFixed32(7);            // nested body: 4 + 5 bytes
+        SerializeInt32(&out, -1);
+        out.WriteVarint32(300);         // after the nested message
+    }
+
+    for (size_t chunk : {1u, 2u, 5u, 4096u}) {
+        MultiBufferInputStream mb(SplitChunks(vos.buffer(), chunk));
+        CodedInputStream in(&mb);
+        EXPECT_EQ(in.BytesUntilLimit(), -1);
+
+        size_t len = 0;
+        ASSERT_TRUE(DeserializeMessageHeader(&in, len));
+        ASSERT_EQ(len, 9u);
+        CodedInputStream::Limit limit = in.PushLimit(len);
+
+        uint32_t fixed = 0;
+        int32_t value = 0;
+        EXPECT_TRUE(in.ReadFixed32(fixed));
+        EXPECT_EQ(fixed, 7u);
+        EXPECT_TRUE(DeserializeInt32(&in, value));
+        EXPECT_EQ(value, -1);
+        EXPECT_EQ(in.BytesUntilLimit(), 0);
+
+        uint8_t byte;
+        EXPECT_FALSE(in.ReadByte(byte)) << "chunk " << chunk;
+        const uint8_t* p;
+        size_t n;
+        EXPECT_FALSE(in.GetDirectBufferPointer(&p, &n));
+
+        in.PopLimit(limit);
+        uint32_t tail = 0;
+        EXPECT_TRUE(in.ReadVarint32(tail)) << "chunk " << chunk;
+        EXPECT_EQ(tail, 300u);
+        EXPECT_EQ(in.ByteCount(), static_cast<int64_t>(vos.buffer().size()));
+    }
+}
+
+TEST(CodedStream, NestedLimitsAndSkip) {
+    std::vector<uint8_t> data(32);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<uint8_t>(i);
+
+    MultiBufferInputStream mb(SplitChunks(data, 8));
+    {
+        CodedInputStream in(&mb);
+        CodedInputStream::Limit outer = in.PushLimit(20);
+        CodedInputStream::Limit inner = in.PushLimit(100);   // clamped to the outer limit
+        EXPECT_EQ(in.BytesUntilLimit(), 20);
+        EXPECT_FALSE(in.Skip(21));
+        EXPECT_EQ(in.BytesUntilLimit(), 0);
+        in.PopLimit(inner);
+        in.PopLimit(outer);
+        EXPECT_EQ(in.BytesUntilLimit(), -1);
+
+        uint8_t byte = 0;
+        EXPECT_TRUE(in.ReadByte(byte));
+        EXPECT_EQ(byte, 20);
+    }
+    // hidden bytes go back to the underlying stream with the rest of the window
+    EXPECT_EQ(mb.ByteCount(), 21);
+}
+
+TEST(CodedStream, RecursionLimit) {
+    BufferInputStream bis(nullptr, 0);
+    CodedInputStream in(&bis);
+    in.SetRecursionLimit(2);
+    EXPECT_TRUE(in.IncrementRecursionDepth());
+    EXPECT_TRUE(in.IncrementRecursionDepth());
+    EXPECT_FALSE(in.IncrementRecursionDepth());
+    in.DecrementRecursionDepth();
+    in.DecrementRecursionDepth();
+    EXPECT_TRUE(in.IncrementRecursionDepth());
+}
+
+// ---------------------------
+// Static Dispatch Tests
+// ---------------------------
+
+static_assert(InputStream<ZeroCopyInputStream> && InputStream<BufferInputStream>);
+static_assert(OutputStream<ZeroCopyOutputStream> && OutputStream<VectorOutputStream>);
+static_assert(!InputStream<CodedInputStream> && !OutputStream<CodedOutputStream>);
+
+// cursors typed on a concrete stream must produce the same bytes as the type-erased ones
+TEST(CodedStream, TypedCursorMatchesVirtual) {
+    VectorOutputStream erased;
+    {
+        CodedOutputStream out(&erased);
+        WriteVarint64(&out, 1ull << 40);
+        SerializeString(&out, "typed");
+        SerializeFloat32(&out, 1.5f);
+    }
+
+    VectorOutputStream typed;
+    {
+        BasicCodedOutputStream<VectorOutputStream> out(&typed);
+        WriteVarint64(&out, 1ull << 40);
+        SerializeString(&out, "typed");
+        SerializeFloat32(&out, 1.5f);
+    }
+    EXPECT_EQ(typed.buffer(), erased.buffer());
+
+    BufferInputStream bis(typed.buffer().data(), typed.buffer().size());
+    BasicCodedInputStream<BufferInputStream> in(&bis);
+    uint64_t v = 0;
+    std::string str;
+    std::shared_ptr<std::vector<uint8_t>> spill;
+    std::string_view view;
+    float f = 0;
+    EXPECT_TRUE(ReadVarint64(&in, v));
+    EXPECT_TRUE(DeserializeString(&in, str, spill, view));
+    EXPECT_TRUE(DeserializeFloat32(&in, f));
+    EXPECT_EQ(v, 1ull << 40);
+    EXPECT_EQ(view, "typed");
+    EXPECT_EQ(f, 1.5f);
+}
+
+// BufferInputStream skips by moving its position instead of calling Next()
+TEST(ZeroCopyStream, BufferSkipIsPositional) {
+    uint8_t data[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    BufferInputStream bis(data, sizeof(data));
+    EXPECT_TRUE(bis.Skip(4));
+    const uint8_t* p;
+    size_t n;
+    ASSERT_TRUE(bis.Next(&p, &n));
+    EXPECT_EQ(p[0], 4);
+    bis.BackUp(n);
+    EXPECT_FALSE(bis.Skip(7));
+    EXPECT_EQ(bis.ByteCount(), 10);
+}
 
+// ---------------------------
+// Tagged Field Tests
+// ---------------------------
+
+TEST(TaggedFields, TagLayout) {
+    static_assert(MakeTag(1, WireType::FIXED32) == 0x0d);
+    static_assert(TagFieldNumber(MakeTag(300, WireType::LENGTH_DELIMITED)) == 300);
+    static_assert(TagWireType(MakeTag(300, WireType::FIXED64)) == WireType::FIXED64);
+    static_assert(TagSize(15) == 1 && TagSize(16) == 2 && TagSize(kMaxFieldNumber) == 5);
+}
 
+// SkipField steps over every wire type and lands on the next tag
+TEST(TaggedFields, SkipFieldEveryWireType) {
+    std::string big(5000, 'b');
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        WriteTag(&out, 1, WireType::VARINT);
+        out.WriteVarint64(~0ull);
+        WriteTag(&out, 2, WireType::FIXED64);
+        out.WriteFixed64(1);
+        SerializeStringField(&out, 3, big);
+        SerializeFloat32Field(&out, 4, 1.0f);
+        SerializeInt32Field(&out, 1000, 77);
+    }
+
+    for (size_t chunk : {1u, 3u, 4096u}) {
+        MultiBufferInputStream mb(SplitChunks(vos.buffer(), chunk));
+        CodedInputStream in(&mb);
+        uint32_t tag = 0;
+        for (uint32_t field : {1u, 2u, 3u, 4u}) {
+            ASSERT_TRUE(in.ReadTag(tag));
+            EXPECT_EQ(TagFieldNumber(tag), field);
+            EXPECT_TRUE(SkipField(&in, tag)) << "chunk " << chunk;
+        }
+        ASSERT_TRUE(in.ReadTag(tag));
+        EXPECT_EQ(tag, MakeTag(1000, WireType::FIXED32));
+        uint32_t v = 0;
+        EXPECT_TRUE(in.ReadFixed32(v));
+        EXPECT_EQ(v, 77u);
+        EXPECT_FALSE(in.ReadTag(tag));
+    }
+}
+
+TEST(TaggedFields, ToArrayMatchesStreamEncoding) {
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        SerializeInt32Field(&out, 1, -1);
+        SerializeFloat32Field(&out, 200, 0.5f);
+        SerializeStringField(&out, 3, "abc");
+        SerializeMessageFieldHeader(&out, 4, 0);
+    }
+    size_t size = Fixed32FieldSize(1) + Fixed32FieldSize(200) + LengthDelimitedFieldSize(3, 3) +
+                  LengthDelimitedFieldSize(4, 0);
+    ASSERT_EQ(size, vos.buffer().size());
+
+    std::vector<uint8_t> buf(size);
+    uint8_t* p = buf.data();
+    p = SerializeInt32FieldToArray(p, 1, -1);
+    p = SerializeFloat32FieldToArray(p, 200, 0.5f);
+    p = SerializeStringFieldToArray(p, 3, "abc");
+    p = SerializeMessageFieldHeaderToArray(p, 4, 0);
+    EXPECT_EQ(p, buf.data() + size);
+    EXPECT_EQ(buf, vos.buffer());
+}
+
+// a string longer than the enclosing limit is rejected before allocating
+TEST(TaggedFields, StringLengthCheckedAgainstLimit) {
+    VectorOutputStream vos;
+    WriteVarint32(&vos, 1u << 30);
+    BufferInputStream bis(vos.buffer().data(), vos.buffer().size());
+    CodedInputStream in(&bis);
+    CodedInputStream::Limit limit = in.PushLimit(vos.buffer().size());
+    std::string str;
+    EXPECT_FALSE(ReadLengthDelimitedString(&in, str));
+    EXPECT_TRUE(str.empty());
+    in.PopLimit(limit);
+}
+
+// ---------------------------
+// Packed Array Tests
+// ---------------------------
+
+TEST(PackedArrays, FixedRoundTripAcrossChunks) {
+    std::vector<float> floats(1000);
+    std::vector<uint64_t> words(300);
+    for (size_t i = 0; i < floats.size(); ++i) floats[i] = static_cast<float>(i) * 0.25f - 100.0f;
+    for (size_t i = 0; i < words.size(); ++i) words[i] = (static_cast<uint64_t>(i) << 40) | i;
+    int32_t ints[] = {0, -1, INT32_MAX, INT32_MIN, 42};
+
+    VectorOutputStream vos(64);
+    {
+        CodedOutputStream out(&vos);
+        EXPECT_TRUE(SerializeFloat32Array(&out, floats.data(), floats.size()));
+        EXPECT_TRUE(SerializeFixed64Array(&out, words.data(), words.size()));
+        EXPECT_TRUE(SerializeInt32Array(&out, ints, 5));
+        EXPECT_TRUE(SerializeInt32Array(&out, ints, 0));
+    }
+    EXPECT_EQ(vos.buffer().size(), 4 + PackedFixedSize<float>(1000) + PackedFixedSize<uint64_t>(300) +
+                                   PackedFixedSize<int32_t>(5) + PackedFixedSize<int32_t>(0));
+
+    for (size_t chunk : {size_t(1), size_t(7), size_t(4096), vos.buffer().size()}) {
+        MultiBufferInputStream mb(SplitChunks(vos.buffer(), chunk));
+        CodedInputStream in(&mb);
+        std::vector<float> f;
+        std::vector<uint64_t> w;
+        std::vector<int32_t> i32;
+        ASSERT_TRUE(DeserializeFloat32Array(&in, f));
+        ASSERT_TRUE(DeserializeFixed64Array(&in, w));
+        ASSERT_TRUE(DeserializeInt32Array(&in, i32));
+        ASSERT_TRUE(DeserializeInt32Array(&in, i32));
+        EXPECT_EQ(f, floats);
+        EXPECT_EQ(w, words);
+        EXPECT_EQ(i32, std::vector<int32_t>(ints, ints + 5));
+        uint8_t b;
+        EXPECT_FALSE(in.ReadByte(b));
+    }
+}
+
+// a contiguous aligned payload is aliased; a split or misaligned one lands in the arena
+TEST(PackedArrays, SpanAliasesOrCopiesToArena) {
+    uint32_t values[64];
+    for (uint32_t i = 0; i < 64; ++i) values[i] = i * 2654435761u;
+
+    VectorOutputStream vos;
+    WritePackedFixed(&vos, values, 64);
+    // length prefix is 2 bytes; shift by 2 so the payload is 4-byte aligned
+    alignas(8) uint8_t storage[512];
+    std::memcpy(storage + 2, vos.buffer().data(), vos.buffer().size());
+
+    quark::Arena arena;
+    {
+        BufferInputStream bis(storage + 2, vos.buffer().size());
+        std::span<const uint32_t> view;
+        ASSERT_TRUE(ReadPackedFixed(&bis, view, &arena));
+        EXPECT_EQ(reinterpret_cast<const uint8_t*>(view.data()), storage + 4);
+        EXPECT_TRUE(std::equal(view.begin(), view.end(), values));
+        EXPECT_EQ(arena.SpaceUsed(), 0u);
+    }
+    {
+        std::memcpy(storage + 3, vos.buffer().data(), vos.buffer().size());
+        BufferInputStream bis(storage + 3, vos.buffer().size());
+        std::span<const uint32_t> view;
+        ASSERT_TRUE(ReadPackedFixed(&bis, view, &arena));
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(view.data()) % alignof(uint32_t), 0u);
+        EXPECT_TRUE(std::equal(view.begin(), view.end(), values));
+        EXPECT_EQ(arena.SpaceUsed(), sizeof(values));
+    }
+    {
+        MultiBufferInputStream mb(SplitChunks(vos.buffer(), 10));
+        std::span<const uint32_t> view;
+        ASSERT_TRUE(ReadPackedFixed(&mb, view, &arena));
+        EXPECT_TRUE(std::equal(view.begin(), view.end(), values));
+        EXPECT_EQ(view.size(), 64u);
+    }
+}
+
+TEST(PackedArrays, VarintRoundTripAcrossChunks) {
+    std::vector<uint32_t> small(500);
+    std::vector<uint64_t> wide(100);
+    for (size_t i = 0; i < small.size(); ++i) small[i] = static_cast<uint32_t>(i * i * 31);
+    for (size_t i = 0; i < wide.size(); ++i) wide[i] = ~0ull >> (i % 64);
+
+    VectorOutputStream vos(64);
+    {
+        CodedOutputStream out(&vos);
+        EXPECT_TRUE(SerializeVarint32Array(&out, small.data(), small.size()));
+        EXPECT_TRUE(WritePackedVarint64(&out, wide.data(), wide.size()));
+    }
+    for (size_t chunk : {size_t(1), size_t(13), vos.buffer().size()}) {
+        MultiBufferInputStream mb(SplitChunks(vos.buffer(), chunk));
+        CodedInputStream in(&mb);
+        std::vector<uint32_t> s;
+        std::vector<uint64_t> w;
+        ASSERT_TRUE(DeserializeVarint32Array(&in, s));
+        ASSERT_TRUE(ReadPackedVarint64(&in, w));
+        EXPECT_EQ(s, small);
+        EXPECT_EQ(w, wide);
+    }
+}
+
+TEST(PackedArrays, RejectsMalformedLength) {
+    // 6 bytes is not a whole number of floats
+    uint8_t ragged[] = {static_cast<uint8_t>(Type::FLOAT32_ARRAY), 6, 0, 0, 0, 0, 0, 0};
+    BufferInputStream a(ragged, sizeof(ragged));
+    std::vector<float> f;
+    EXPECT_FALSE(DeserializeFloat32Array(&a, f));
+
+    // length runs past the input
+    uint8_t truncated[] = {static_cast<uint8_t>(Type::INT32_ARRAY), 8, 1, 0, 0, 0};
+    BufferInputStream b(truncated, sizeof(truncated));
+    std::vector<int32_t> i32;
+    EXPECT_FALSE(DeserializeInt32Array(&b, i32));
+
+    // wrong type tag
+    uint8_t wrong[] = {static_cast<uint8_t>(Type::INT32_ARRAY), 0};
+    BufferInputStream c(wrong, sizeof(wrong));
+    EXPECT_FALSE(DeserializeFloat32Array(&c, f));
+
+    // varint payload whose last byte has the continuation bit set
+    uint8_t cut[] = {static_cast<uint8_t>(Type::VARINT32_ARRAY), 2, 0x01, 0x80, 0x01};
+    BufferInputStream d(cut, sizeof(cut));
+    std::vector<uint32_t> v;
+    EXPECT_FALSE(DeserializeVarint32Array(&d, v));
+}
+
+TEST(PackedArrays, FieldToArrayMatchesStreamEncoding) {
+    double values[] = {1.5, -2.25, 1e300};
+    VectorOutputStream vos;
+    SerializePackedFixedField(&vos, 9, values, 3);
+    ASSERT_EQ(vos.buffer().size(), TagSize(9) + PackedFixedSize<double>(3));
+
+    std::vector<uint8_t> buf(vos.buffer().size());
+    EXPECT_EQ(SerializePackedFixedFieldToArray(buf.data(), 9, values, 3), buf.data() + buf.size());
+    EXPECT_EQ(buf, vos.buffer());
+
+    BufferInputStream bis(buf.data(), buf.size());
+    CodedInputStream in(&bis);
+    uint32_t tag;
+    ASSERT_TRUE(in.ReadTag(tag));
+    EXPECT_EQ(tag, MakeTag(9, WireType::LENGTH_DELIMITED));
+    std::vector<double> back;
+    ASSERT_TRUE(ReadPackedFixed(&in, back));
+    EXPECT_EQ(back, std::vector<double>(values, values + 3));
+}
+
+// ---------------------------
+// 64-bit, Zigzag, Bool, Double and Bytes Tests
+// ---------------------------
+
+TEST(WideTypes, RoundTripAcrossChunks) {
+    std::vector<uint8_t> blob(300);
+    for (size_t i = 0; i < blob.size(); ++i) blob[i] = static_cast<uint8_t>(i * 7);
+
+    VectorOutputStream vos(32);
+    {
+        CodedOutputStream out(&vos);
+        EXPECT_TRUE(SerializeInt64(&out, -5));
+        EXPECT_TRUE(SerializeInt64(&out, INT64_MAX));
+        EXPECT_TRUE(SerializeUInt64(&out, UINT64_MAX));
+        EXPECT_TRUE(SerializeSInt32(&out, INT32_MIN));
+        EXPECT_TRUE(SerializeSInt64(&out, -1234567890123ll));
+        EXPECT_TRUE(SerializeFixed64(&out, 0x0102030405060708ull));
+        EXPECT_TRUE(SerializeDouble(&out, -0.1));
+        EXPECT_TRUE(SerializeBool(&out, true));
+        EXPECT_TRUE(SerializeBool(&out, false));
+        EXPECT_TRUE(SerializeBytes(&out, blob));
+        EXPECT_TRUE(SerializeBytes(&out, blob));
+    }
+
+    for (size_t chunk : {size_t(1), size_t(5), vos.buffer().size()}) {
+        MultiBufferInputStream mb(SplitChunks(vos.buffer(), chunk));
+        CodedInputStream in(&mb);
+        int64_t i64;
+        uint64_t u64;
+        int32_t s32;
+        double d;
+        bool b;
+        ASSERT_TRUE(DeserializeInt64(&in, i64));
+        EXPECT_EQ(i64, -5);
+        ASSERT_TRUE(DeserializeInt64(&in, i64));
+        EXPECT_EQ(i64, INT64_MAX);
+        ASSERT_TRUE(DeserializeUInt64(&in, u64));
+        EXPECT_EQ(u64, UINT64_MAX);
+        ASSERT_TRUE(DeserializeSInt32(&in, s32));
+        EXPECT_EQ(s32, INT32_MIN);
+        ASSERT_TRUE(DeserializeSInt64(&in, i64));
+        EXPECT_EQ(i64, -1234567890123ll);
+        ASSERT_TRUE(DeserializeFixed64(&in, u64));
+        EXPECT_EQ(u64, 0x0102030405060708ull);
+        ASSERT_TRUE(DeserializeDouble(&in, d));
+        EXPECT_EQ(d, -0.1);
+        ASSERT_TRUE(DeserializeBool(&in, b));
+        EXPECT_TRUE(b);
+        ASSERT_TRUE(DeserializeBool(&in, b));
+        EXPECT_FALSE(b);
+        std::vector<uint8_t> copy;
+        ASSERT_TRUE(DeserializeBytes(&in, copy));
+        EXPECT_EQ(copy, blob);
+        quark::Arena arena;
+        std::span<const uint8_t> view;
+        ASSERT_TRUE(DeserializeBytes(&in, view, &arena));
+        EXPECT_TRUE(std::equal(view.begin(), view.end(), blob.begin(), blob.end()));
+        uint8_t tail;
+        EXPECT_FALSE(in.ReadByte(tail));
+    }
+}
+
+// zigzag keeps small negative values short; plain INT64 does not
+TEST(WideTypes, EncodedSizes) {
+    VectorOutputStream a, b;
+    SerializeSInt64(&a, -3);
+    SerializeInt64(&b, -3);
+    EXPECT_EQ(a.buffer().size(), 2u);
+    EXPECT_EQ(b.buffer().size(), 1u + kMaxVarint64Bytes);
+
+    // misread type tags are rejected
+    BufferInputStream bis(a.buffer().data(), a.buffer().size());
+    int64_t v;
+    EXPECT_FALSE(DeserializeInt64(&bis, v));
+}
+
+TEST(WideTypes, FieldToArrayMatchesStreamEncoding) {
+    const uint8_t raw[] = {1, 2, 3};
+    VectorOutputStream vos;
+    {
+        CodedOutputStream out(&vos);
+        SerializeInt64Field(&out, 1, -2);
+        SerializeUInt64Field(&out, 2, 300);
+        SerializeSInt32Field(&out, 3, -2);
+        SerializeSInt64Field(&out, 4, INT64_MIN);
+        SerializeFixed64Field(&out, 5, 42);
+        SerializeDoubleField(&out, 6, 2.5);
+        SerializeBoolField(&out, 7, true);
+        SerializeBytesField(&out, 8, raw);
+    }
+    size_t size = VarintFieldSize(1, static_cast<uint64_t>(-2)) + VarintFieldSize(2, 300) +
+                  VarintFieldSize(3, ZigZagEncode32(-2)) + VarintFieldSize(4, ZigZagEncode64(INT64_MIN)) +
+                  Fixed64FieldSize(5) + Fixed64FieldSize(6) + VarintFieldSize(7, 1) +
+                  LengthDelimitedFieldSize(8, 3);
+    ASSERT_EQ(size, vos.buffer().size());
+
+    std::vector<uint8_t> buf(size);
+    uint8_t* p = buf.data();
+    p = SerializeInt64FieldToArray(p, 1, -2);
+    p = SerializeUInt64FieldToArray(p, 2, 300);
+    p = SerializeSInt32FieldToArray(p, 3, -2);
+    p = SerializeSInt64FieldToArray(p, 4, INT64_MIN);
+    p = SerializeFixed64FieldToArray(p, 5, 42);
+    p = SerializeDoubleFieldToArray(p, 6, 2.5);
+    p = SerializeBoolFieldToArray(p, 7, true);
+    p = SerializeBytesFieldToArray(p, 8, raw);
+    EXPECT_EQ(p, buf.data() + size);
+    EXPECT_EQ(buf, vos.buffer());
+
+    // every field can be stepped over by wire type
+    BufferInputStream bis(buf.data(), buf.size());
+    CodedInputStream in(&bis);
+    uint32_t tag;
+    int fields = 0;
+    while (in.ReadTag(tag)) {
+        ASSERT_TRUE(SkipField(&in, tag));
+        ++fields;
+    }
+    EXPECT_EQ(fields, 8);
+}
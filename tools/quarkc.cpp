@@ -0,0 +1,1015 @@
+// quarkc.cpp
+// Schema compiler: reads a .proto-style schema and emits a header with one
+// C++ struct per message plus inline, non-virtual Serialize/Parse function
+// templates over quark::io::BasicCoded{Output,Input}Stream, so a concrete
+// stream type is carried all the way down to the refill calls.
+//
+// usage: quarkc <schema.proto> -o <out.h> [--namespace=ns]
+//
+// Supported subset:
+//   syntax / package / import / option statements (package -> namespace)
+//   message Name { <type> <name> = <number>; ... }
+//   field types: int32, float, string, and other messages in the same file
+//   (encoded as size-prefixed nested messages); int64, uint64, sint32,
+//   sint64 and bool (varints, zigzag for sint*), fixed64, double, bytes
+//   'repeated' on any of these (std::vector members)
+// Every field is written with a tag carrying its field number and wire type
+// (int32/float are FIXED32, fixed64/double FIXED64, strings, bytes and
+// messages LENGTH_DELIMITED), so generated parsers skip fields they do not
+// know. Repeated fixed-width fields are packed: one LENGTH_DELIMITED field
+// holding the raw little-endian array, written and read with a single
+// memcpy. Repeated varint fields are packed the same way, one varint per
+// element. Repeated strings, bytes and messages are one field per element.
+// Messages made only of singular scalar and string fields also get
+// SerializeColumnar()/ParseColumnar() for whole batches in the column-major
+// layout of quark/io/columnar.h.
+// Messages using anything else are skipped with a warning, so a schema that
+// also feeds protoc can be compiled as-is.
+
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// ---------------------------
+// Schema model
+// ---------------------------
+
+enum class FieldKind {
+    INT32, FLOAT32, STRING, MESSAGE,
+    INT64, UINT64, SINT32, SINT64, FIXED64, DOUBLE, BOOL, BYTES,
+};
+
+struct Field {
+    FieldKind kind;
+    std::string name;
+    int number;
+    std::string type_name;      // Message type, for FieldKind::MESSAGE
+    bool repeated = false;
+};
+
+struct Message {
+    std::string name;
+    std::vector<Field> fields;
+    std::string unsupported;    // Reason the message is skipped, if any
+};
+
+struct Schema {
+    std::string package;
+    std::vector<Message> messages;
+};
+
+// ---------------------------
+// Tokenizer
+// ---------------------------
+
+struct Token {
+    std::string text;
+    int line;
+};
+
+std::vector<Token> Tokenize(const std::string& src) {
+    std::vector<Token> tokens;
+    int line = 1;
+    size_t i = 0;
+    while (i < src.size()) {
+        char c = src[i];
+        if (c == '\n') { ++line; ++i; continue; }
+        if (std::isspace(static_cast<unsigned char>(c))) { ++i; continue; }
+        if (c == '/' && i + 1 < src.size() && src[i + 1] == '/') {
+            while (i < src.size() && src[i] != '\n') ++i;
+            continue;
+        }
+        if (c == '/' && i + 1 < src.size() && src[i + 1] == '*') {
+            i += 2;
+            while (i + 1 < src.size() && !(src[i] == '*' && src[i + 1] == '/')) {
+                if (src[i] == '\n') ++line;
+                ++i;
+            }
+            i += 2;
+            continue;
+        }
+        if (c == '"' || c == '\'') {
+            size_t j = i + 1;
+            while (j < src.size() && src[j] != c) ++j;
+            tokens.push_back({src.substr(i, j + 1 - i), line});
+            i = j + 1;
+            continue;
+        }
+        if (std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.') {
+            size_t j = i;
+            while (j < src.size() && (std::isalnum(static_cast<unsigned char>(src[j])) || src[j] == '_' || src[j] == '.')) ++j;
+            tokens.push_back({src.substr(i, j - i), line});
+            i = j;
+            continue;
+        }
+        tokens.push_back({std::string(1, c), line});
+        ++i;
+    }
+    return tokens;
+}
+
+// ---------------------------
+// Parser
+// ---------------------------
+
+class Parser {
+public:
+    explicit Parser(std::vector<Token> tokens) : tokens_(std::move(tokens)), pos_(0) {}
+
+    Schema Parse() {
+        Schema schema;
+        while (!AtEnd()) {
+            const Token& t = Peek();
+            if (t.text == "syntax" || t.text == "import" || t.text == "option") {
+                SkipStatement();
+            } else if (t.text == "package") {
+                Take();
+                schema.package = Take().text;
+                Expect(";");
+            } else if (t.text == "message") {
+                schema.messages.push_back(ParseMessage());
+            } else if (t.text == "enum" || t.text == "service") {
+                Take();
+                std::cerr << "quarkc: warning: line " << t.line << ": skipping " << t.text << " "
+                          << Peek().text << " (not supported)\n";
+                SkipBlock();
+            } else {
+                Fail("unexpected '" + t.text + "'");
+            }
+        }
+        return schema;
+    }
+
+private:
+    Message ParseMessage() {
+        Expect("message");
+        Message msg;
+        msg.name = Take().text;
+        Expect("{");
+        while (Peek().text != "}") {
+            const Token& t = Peek();
+            if (t.text == "message" || t.text == "enum" || t.text == "oneof") {
+                Take();
+                Unsupported(msg, "nested " + t.text);
+                SkipBlock();
+                continue;
+            }
+            if (t.text == "option" || t.text == "reserved") {
+                SkipStatement();
+                continue;
+            }
+            ParseField(msg);
+        }
+        Expect("}");
+        return msg;
+    }
+
+    void ParseField(Message& msg) {
+        const Token& first = Take();
+        std::string type = first.text;
+        if (type == "optional" || type == "map") {
+            Unsupported(msg, "'" + type + "' fields");
+            SkipStatement();
+            return;
+        }
+        bool repeated = type == "repeated";
+        if (repeated) type = Take().text;
+        std::string name = Take().text;
+        Expect("=");
+        const Token& number_token = Take();
+        int number = std::stoi(number_token.text);
+        if (number < 1 || number > (1 << 29) - 1) Fail("field number " + number_token.text + " out of range");
+        for (const Field& f : msg.fields) {
+            if (f.number == number) Fail("field number " + number_token.text + " used twice in " + msg.name);
+        }
+        SkipStatement();
+
+        static const std::map<std::string, FieldKind> kinds = {
+            {"int32", FieldKind::INT32},
+            {"float", FieldKind::FLOAT32},
+            {"string", FieldKind::STRING},
+            {"int64", FieldKind::INT64},
+            {"uint64", FieldKind::UINT64},
+            {"sint32", FieldKind::SINT32},
+            {"sint64", FieldKind::SINT64},
+            {"fixed64", FieldKind::FIXED64},
+            {"double", FieldKind::DOUBLE},
+            {"bool", FieldKind::BOOL},
+            {"bytes", FieldKind::BYTES},
+        };
+        auto it = kinds.find(type);
+        if (it == kinds.end()) {
+            // Resolved against the other messages once the whole file is parsed
+            msg.fields.push_back({FieldKind::MESSAGE, name, number, type, repeated});
+            return;
+        }
+        msg.fields.push_back({it->second, name, number, "", repeated});
+    }
+
+    void Unsupported(Message& msg, const std::string& what) {
+        if (msg.unsupported.empty()) msg.unsupported = what;
+    }
+
+    /// Skips through the next ';' (balancing [] option lists).
+    void SkipStatement() {
+        while (!AtEnd() && Take().text != ";") {}
+    }
+
+    /// Skips an optional name and a balanced { ... } block.
+    void SkipBlock() {
+        while (!AtEnd() && Peek().text != "{") Take();
+        int depth = 0;
+        do {
+            const std::string& t = Take().text;
+            if (t == "{") ++depth;
+            if (t == "}") --depth;
+        } while (depth > 0 && !AtEnd());
+    }
+
+    const Token& Peek() {
+        if (AtEnd()) Fail("unexpected end of file");
+        return tokens_[pos_];
+    }
+    const Token& Take() {
+        const Token& t = Peek();
+        ++pos_;
+        return t;
+    }
+    void Expect(const std::string& text) {
+        if (Peek().text != text) Fail("expected '" + text + "', got '" + Peek().text + "'");
+        ++pos_;
+    }
+    bool AtEnd() const { return pos_ >= tokens_.size(); }
+
+    [[noreturn]] void Fail(const std::string& what) {
+        int line = tokens_.empty() ? 0 : tokens_[std::min(pos_, tokens_.size() - 1)].line;
+        throw std::runtime_error("line " + std::to_string(line) + ": " + what);
+    }
+
+    std::vector<Token> tokens_;
+    size_t pos_;
+};
+
+// ---------------------------
+// Message resolution
+// ---------------------------
+
+/// Orders messages so every nested type is emitted before its users, and
+/// marks messages unsupported when they reference an unknown, skipped or
+/// recursive (which a value member cannot express) type.
+void ResolveMessages(Schema& schema) {
+    std::map<std::string, size_t> index;
+    for (size_t i = 0; i < schema.messages.size(); ++i) index[schema.messages[i].name] = i;
+
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (Message& msg : schema.messages) {
+            if (!msg.unsupported.empty()) continue;
+            for (const Field& f : msg.fields) {
+                if (f.kind != FieldKind::MESSAGE) continue;
+                auto it = index.find(f.type_name);
+                if (it == index.end()) {
+                    msg.unsupported = "field type '" + f.type_name + "'";
+                } else if (!schema.messages[it->second].unsupported.empty()) {
+                    msg.unsupported = "field type '" + f.type_name + "' (skipped)";
+                }
+                if (!msg.unsupported.empty()) {
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    std::vector<Message> ordered;
+    std::vector<int> state(schema.messages.size(), 0);    // 0 new, 1 visiting, 2 done
+    auto visit = [&](auto& self, size_t i) -> bool {
+        if (state[i] == 2) return true;
+        if (state[i] == 1) return false;
+        state[i] = 1;
+        Message& msg = schema.messages[i];
+        if (msg.unsupported.empty()) {
+            for (const Field& f : msg.fields) {
+                if (f.kind != FieldKind::MESSAGE) continue;
+                if (!self(self, index[f.type_name])) {
+                    msg.unsupported = "recursive field '" + f.name + "'";
+                    break;
+                }
+            }
+        }
+        state[i] = 2;
+        ordered.push_back(msg);
+        return msg.unsupported.empty();
+    };
+    for (size_t i = 0; i < schema.messages.size(); ++i) visit(visit, i);
+    schema.messages = std::move(ordered);
+}
+
+// ---------------------------
+// Code generator
+// ---------------------------
+
+/// Bytes of a fixed-width value (4 or 8), or 0 for other kinds.
+size_t FixedWidth(const Field& f) {
+    switch (f.kind) {
+        case FieldKind::INT32:
+        case FieldKind::FLOAT32: return 4;
+        case FieldKind::FIXED64:
+        case FieldKind::DOUBLE: return 8;
+        default: return 0;
+    }
+}
+
+bool IsFixedKind(const Field& f) { return FixedWidth(f) != 0; }
+
+/// A single fixed-width value; repeated fixed-width fields are packed instead.
+bool IsFixed(const Field& f) { return IsFixedKind(f) && !f.repeated; }
+
+bool IsVarintKind(const Field& f) {
+    switch (f.kind) {
+        case FieldKind::INT64:
+        case FieldKind::UINT64:
+        case FieldKind::SINT32:
+        case FieldKind::SINT64:
+        case FieldKind::BOOL: return true;
+        default: return false;
+    }
+}
+
+/// A single varint value; repeated varint fields are packed instead.
+bool IsVarint(const Field& f) { return IsVarintKind(f) && !f.repeated; }
+
+/// Template arguments of the quark::io packed varint helpers for field 'f'.
+std::string PackedVarintArgs(const Field& f) {
+    return f.kind == FieldKind::SINT32 || f.kind == FieldKind::SINT64 ? "<true>" : "";
+}
+
+/// string and bytes share the std::string member and LENGTH_DELIMITED encoding.
+bool IsString(const Field& f) { return f.kind == FieldKind::STRING || f.kind == FieldKind::BYTES; }
+
+std::string ElementType(const Field& f) {
+    switch (f.kind) {
+        case FieldKind::INT32: return "int32_t";
+        case FieldKind::FLOAT32: return "float";
+        case FieldKind::STRING: return "std::string";
+        case FieldKind::MESSAGE: return f.type_name;
+        case FieldKind::INT64: return "int64_t";
+        case FieldKind::UINT64: return "uint64_t";
+        case FieldKind::SINT32: return "int32_t";
+        case FieldKind::SINT64: return "int64_t";
+        case FieldKind::FIXED64: return "uint64_t";
+        case FieldKind::DOUBLE: return "double";
+        case FieldKind::BOOL: return "bool";
+        case FieldKind::BYTES: return "std::string";
+    }
+    return "";
+}
+
+std::string CppType(const Field& f) {
+    return f.repeated ? "std::vector<" + ElementType(f) + ">" : ElementType(f);
+}
+
+/// Name shared by the quark::io Serialize<Name>Field / <Name>FieldToArray writers.
+const char* WriterName(const Field& f) {
+    switch (f.kind) {
+        case FieldKind::INT32: return "Int32";
+        case FieldKind::FLOAT32: return "Float32";
+        case FieldKind::STRING:
+        case FieldKind::BYTES: return "String";
+        case FieldKind::MESSAGE: return "MessageFieldHeader";
+        case FieldKind::INT64: return "Int64";
+        case FieldKind::UINT64: return "UInt64";
+        case FieldKind::SINT32: return "SInt32";
+        case FieldKind::SINT64: return "SInt64";
+        case FieldKind::FIXED64: return "Fixed64";
+        case FieldKind::DOUBLE: return "Double";
+        case FieldKind::BOOL: return "Bool";
+    }
+    return "";
+}
+
+/// Wire type and its enumerator name, as emitted in generated code.
+int WireTypeValue(const Field& f) {
+    if (IsFixed(f)) return FixedWidth(f) == 4 ? 5 : 1;
+    if (IsVarint(f)) return 0;
+    return 2;
+}
+
+const char* WireTypeName(const Field& f) {
+    switch (WireTypeValue(f)) {
+        case 0: return "quark::io::WireType::VARINT";
+        case 1: return "quark::io::WireType::FIXED64";
+        case 5: return "quark::io::WireType::FIXED32";
+        default: return "quark::io::WireType::LENGTH_DELIMITED";
+    }
+}
+
+std::string TagExpr(const Field& f) {
+    return "quark::io::MakeTag(" + std::to_string(f.number) + ", " + WireTypeName(f) + ")";
+}
+
+/// Varint bytes of the field's tag, so fixed runs can store them as constants.
+std::vector<uint8_t> TagBytes(const Field& f) {
+    uint32_t tag = (static_cast<uint32_t>(f.number) << 3) | static_cast<uint32_t>(WireTypeValue(f));
+    std::vector<uint8_t> bytes;
+    while (tag >= 0x80) {
+        bytes.push_back(static_cast<uint8_t>(tag | 0x80));
+        tag >>= 7;
+    }
+    bytes.push_back(static_cast<uint8_t>(tag));
+    return bytes;
+}
+
+size_t FixedFieldSize(const Field& f) { return TagBytes(f).size() + FixedWidth(f); }
+
+/// Largest varint a varint field can produce.
+size_t MaxVarintBytes(const Field& f) {
+    if (f.kind == FieldKind::BOOL) return 1;
+    return f.kind == FieldKind::SINT32 ? 5 : 10;
+}
+
+/// The unsigned value a varint field puts on the wire.
+std::string VarintExpr(const Field& f, const std::string& value) {
+    switch (f.kind) {
+        case FieldKind::INT64: return "static_cast<uint64_t>(" + value + ")";
+        case FieldKind::SINT32: return "quark::io::ZigZagEncode32(" + value + ")";
+        case FieldKind::SINT64: return "quark::io::ZigZagEncode64(" + value + ")";
+        default: return value;
+    }
+}
+
+/// Converts the raw fixed-width word 'bits' back to the field's C++ type.
+std::string FixedDecodeExpr(const Field& f, const std::string& bits) {
+    switch (f.kind) {
+        case FieldKind::INT32: return "static_cast<int32_t>(" + bits + ")";
+        case FieldKind::FLOAT32: return "std::bit_cast<float>(" + bits + ")";
+        case FieldKind::DOUBLE: return "std::bit_cast<double>(" + bits + ")";
+        default: return bits;
+    }
+}
+
+/// Reads one fixed-width value of field 'f' into msg.<name>, or appends it
+/// for a repeated field.
+void EmitFixedRead(std::ostream& out, const Field& f, const std::string& indent) {
+    bool wide = FixedWidth(f) == 8;
+    out << indent << (wide ? "uint64_t" : "uint32_t") << " v;\n"
+        << indent << "if (!in->" << (wide ? "ReadFixed64" : "ReadFixed32") << "(v)) return false;\n";
+    if (f.repeated) {
+        out << indent << "msg." << f.name << ".push_back(" << FixedDecodeExpr(f, "v") << ");\n";
+    } else {
+        out << indent << "msg." << f.name << " = " << FixedDecodeExpr(f, "v") << ";\n";
+    }
+}
+
+/// A maximal run of consecutive fixed-width fields, encoded as one block.
+struct Run {
+    size_t begin, end;      // Field indices [begin, end)
+    size_t size;            // Encoded bytes (tags + 4 or 8 bytes each)
+};
+
+std::vector<Run> FixedRuns(const Message& msg) {
+    std::vector<Run> runs;
+    for (size_t i = 0; i < msg.fields.size();) {
+        if (!IsFixed(msg.fields[i])) { ++i; continue; }
+        size_t j = i;
+        size_t size = 0;
+        while (j < msg.fields.size() && IsFixed(msg.fields[j])) size += FixedFieldSize(msg.fields[j++]);
+        runs.push_back({i, j, size});
+        i = j;
+    }
+    return runs;
+}
+
+void EmitStruct(std::ostream& out, const Message& msg) {
+    size_t fixed = 0, string_overhead = 0;
+    bool variable = false;
+    for (const Field& f : msg.fields) {
+        if (IsFixed(f)) {
+            fixed += FixedFieldSize(f);
+        } else {
+            variable = true;
+            if (IsString(f) && !f.repeated) string_overhead += TagBytes(f).size() + 5;
+        }
+    }
+
+    out << "struct " << msg.name << " {\n";
+    for (const Field& f : msg.fields) {
+        out << "    " << CppType(f) << " " << f.name;
+        if (!f.repeated) {
+            if (f.kind == FieldKind::FLOAT32) out << " = 0.0f";
+            else if (f.kind == FieldKind::DOUBLE) out << " = 0.0";
+            else if (f.kind == FieldKind::BOOL) out << " = false";
+            else if (IsFixed(f) || IsVarint(f)) out << " = 0";
+        }
+        out << ";   // field " << f.number << "\n";
+    }
+    out << "\n"
+        << "    /// Encoded size of the fixed-width fields (tag + 4 or 8 bytes each).\n"
+        << "    static constexpr size_t kFixedSize = " << fixed << ";\n"
+        << "    /// Per-message overhead of string fields (tag + max varint length prefix).\n"
+        << "    static constexpr size_t kStringOverhead = " << string_overhead << ";\n";
+    if (!variable) {
+        out << "    /// Exact encoded size; every field is fixed-width.\n"
+            << "    static constexpr size_t kMaxSize = kFixedSize;\n";
+    }
+    out << "\n"
+        << "    /// Upper bound on the encoded size of this message.\n"
+        << "    constexpr size_t MaxSize() const {\n"
+        << "        size_t size = kFixedSize + kStringOverhead;\n";
+    for (const Field& f : msg.fields) {
+        size_t tag = TagBytes(f).size();
+        if (IsFixedKind(f) && f.repeated) {
+            out << "        size += " << tag + 5 << " + " << f.name << ".size() * " << FixedWidth(f) << ";\n";
+        } else if (IsVarintKind(f) && f.repeated) {
+            out << "        size += " << tag + 5 << " + " << f.name << ".size() * " << MaxVarintBytes(f) << ";\n";
+        } else if (IsString(f) && f.repeated) {
+            out << "        for (const auto& v : " << f.name << ") size += " << tag + 5 << " + v.size();\n";
+        } else if (IsString(f)) {
+            out << "        size += " << f.name << ".size();\n";
+        } else if (IsVarint(f)) {
+            out << "        size += " << tag + MaxVarintBytes(f) << ";   // " << f.name << "\n";
+        } else if (f.kind == FieldKind::MESSAGE && f.repeated) {
+            out << "        for (const auto& v : " << f.name << ") size += " << tag + 5 << " + v.MaxSize();\n";
+        } else if (f.kind == FieldKind::MESSAGE) {
+            out << "        size += " << tag + 5 << " + " << f.name << ".MaxSize();\n";
+        }
+    }
+    out << "        return size;\n"
+        << "    }\n\n"
+        << "    /// Exact encoded size. Also cached for GetCachedSize(), so a parent\n"
+        << "    /// can size its length prefix without recomputing this subtree.\n"
+        << "    size_t ByteSizeLong() const {\n"
+        << "        size_t size = kFixedSize;\n";
+    for (const Field& f : msg.fields) {
+        std::string number = std::to_string(f.number);
+        if (IsFixedKind(f) && f.repeated) {
+            out << "        if (!" << f.name << ".empty()) {\n"
+                << "            size += quark::io::TagSize(" << number << ") + quark::io::PackedFixedSize<"
+                << ElementType(f) << ">(" << f.name << ".size());\n"
+                << "        }\n";
+        } else if (IsVarintKind(f) && f.repeated) {
+            out << "        if (!" << f.name << ".empty()) {\n"
+                << "            size += quark::io::TagSize(" << number << ") + quark::io::PackedVarintSize"
+                << PackedVarintArgs(f) << "(" << f.name << ");\n"
+                << "        }\n";
+        } else if (IsString(f) && f.repeated) {
+            out << "        for (const auto& v : " << f.name << ") size += quark::io::LengthDelimitedFieldSize("
+                << number << ", v.size());\n";
+        } else if (IsString(f)) {
+            out << "        size += quark::io::LengthDelimitedFieldSize(" << number << ", " << f.name << ".size());\n";
+        } else if (IsVarint(f)) {
+            out << "        size += quark::io::VarintFieldSize(" << number << ", " << VarintExpr(f, f.name) << ");\n";
+        } else if (f.kind == FieldKind::MESSAGE && f.repeated) {
+            out << "        for (const auto& v : " << f.name << ") size += quark::io::LengthDelimitedFieldSize("
+                << number << ", v.ByteSizeLong());\n";
+        } else if (f.kind == FieldKind::MESSAGE) {
+            out << "        size += quark::io::LengthDelimitedFieldSize(" << number << ", " << f.name
+                << ".ByteSizeLong());\n";
+        }
+    }
+    out << "        cached_size_ = size;\n"
+        << "        return size;\n"
+        << "    }\n\n"
+        << "    /// Size computed by the last ByteSizeLong() call.\n"
+        << "    size_t GetCachedSize() const { return cached_size_; }\n\n"
+        << "    mutable size_t cached_size_ = 0;\n"
+        << "};\n\n";
+}
+
+/// Stores one fixed-width field (constant tag bytes + value) at p[offset].
+void EmitFixedStore(std::ostream& out, const Field& f, size_t offset, const std::string& indent) {
+    std::vector<uint8_t> tag = TagBytes(f);
+    bool wide = FixedWidth(f) == 8;
+    for (size_t b = 0; b < tag.size(); ++b) {
+        char hex[8];
+        std::snprintf(hex, sizeof(hex), "0x%02x", tag[b]);
+        out << indent << "p[" << offset + b << "] = " << hex << ";";
+        if (b == 0) out << "   // field " << f.number << (wide ? ", FIXED64" : ", FIXED32");
+        out << "\n";
+    }
+    std::string value = "msg." + f.name;
+    switch (f.kind) {
+        case FieldKind::INT32: value = "static_cast<uint32_t>(" + value + ")"; break;
+        case FieldKind::FLOAT32: value = "std::bit_cast<uint32_t>(" + value + ")"; break;
+        case FieldKind::DOUBLE: value = "std::bit_cast<uint64_t>(" + value + ")"; break;
+        default: break;
+    }
+    out << indent << "quark::io::" << (wide ? "StoreLittleEndian64" : "StoreLittleEndian32") << "(p + "
+        << offset + tag.size() << ", " << value << ");\n";
+}
+
+/// Unchecked writer for a repeated field: one packed field for fixed-width
+/// and varint kinds (omitted when empty), one field per element otherwise.
+void EmitRepeatedToArray(std::ostream& out, const Field& f) {
+    std::string number = std::to_string(f.number);
+    if (IsFixedKind(f)) {
+        out << "    if (!msg." << f.name << ".empty()) {\n"
+            << "        target = quark::io::SerializePackedFixedFieldToArray(target, " << number
+            << ", msg." << f.name << ".data(), msg." << f.name << ".size());\n"
+            << "    }\n";
+    } else if (IsVarintKind(f)) {
+        out << "    if (!msg." << f.name << ".empty()) {\n"
+            << "        target = quark::io::SerializePackedVarintFieldToArray" << PackedVarintArgs(f) << "(target, "
+            << number << ", msg." << f.name << ");\n"
+            << "    }\n";
+    } else if (IsString(f)) {
+        out << "    for (const auto& v : msg." << f.name << ") {\n"
+            << "        target = quark::io::SerializeStringFieldToArray(target, " << number << ", v);\n"
+            << "    }\n";
+    } else {
+        out << "    for (const auto& v : msg." << f.name << ") {\n"
+            << "        target = quark::io::SerializeMessageFieldHeaderToArray(target, " << number
+            << ", v.GetCachedSize());\n"
+            << "        target = SerializeWithCachedSizesToArray(v, target);\n"
+            << "    }\n";
+    }
+}
+
+/// Stream writer for a repeated field; same layout as EmitRepeatedToArray().
+void EmitRepeatedSerialize(std::ostream& out, const Field& f) {
+    std::string number = std::to_string(f.number);
+    if (IsFixedKind(f)) {
+        out << "    if (!msg." << f.name << ".empty() && !quark::io::SerializePackedFixedField(out, " << number
+            << ", msg." << f.name << ".data(), msg." << f.name << ".size())) return false;\n";
+    } else if (IsVarintKind(f)) {
+        out << "    if (!msg." << f.name << ".empty() && !quark::io::SerializePackedVarintField" << PackedVarintArgs(f)
+            << "(out, " << number << ", msg." << f.name << ")) return false;\n";
+    } else if (IsString(f)) {
+        out << "    for (const auto& v : msg." << f.name << ") {\n"
+            << "        if (!quark::io::SerializeStringField(out, " << number << ", v)) return false;\n"
+            << "    }\n";
+    } else {
+        out << "    for (const auto& v : msg." << f.name << ") {\n"
+            << "        if (!quark::io::SerializeMessageFieldHeader(out, " << number
+            << ", v.GetCachedSize())) return false;\n"
+            << "        if (!SerializeWithCachedSizes(v, out)) return false;\n"
+            << "    }\n";
+    }
+}
+
+void EmitSerializeToArray(std::ostream& out, const Message& msg) {
+    out << "/// Writes 'msg' into 'target' with unchecked pointer bumps. 'target' must\n"
+        << "/// hold msg.GetCachedSize() bytes; call ByteSizeLong() first.\n"
+        << "inline uint8_t* SerializeWithCachedSizesToArray(const " << msg.name << "& msg, uint8_t* target) {\n";
+    for (const Field& f : msg.fields) {
+        if (f.repeated) {
+            EmitRepeatedToArray(out, f);
+        } else if (f.kind == FieldKind::MESSAGE) {
+            out << "    target = quark::io::SerializeMessageFieldHeaderToArray(target, " << f.number
+                << ", msg." << f.name << ".GetCachedSize());\n"
+                << "    target = SerializeWithCachedSizesToArray(msg." << f.name << ", target);\n";
+        } else {
+            out << "    target = quark::io::Serialize" << WriterName(f) << "FieldToArray(target, " << f.number
+                << ", msg." << f.name << ");\n";
+        }
+    }
+    out << "    return target;\n}\n\n"
+        << "/// Encodes 'msg' into a caller buffer of 'size' bytes.\n"
+        << "/// @return Bytes written, or 0 if the buffer is too small.\n"
+        << "inline size_t SerializeToArray(const " << msg.name << "& msg, uint8_t* buf, size_t size) {\n"
+        << "    size_t needed = msg.ByteSizeLong();\n"
+        << "    if (needed > size) return 0;\n"
+        << "    SerializeWithCachedSizesToArray(msg, buf);\n"
+        << "    return needed;\n}\n\n";
+}
+
+void EmitSerialize(std::ostream& out, const Message& msg) {
+    auto runs = FixedRuns(msg);
+    out << "/// Encodes 'msg' using the sizes cached by the last ByteSizeLong(). The\n"
+        << "/// whole message is written in one unchecked pass when the window can\n"
+        << "/// hold it, otherwise per fixed-width run with stream fallbacks at\n"
+        << "/// window edges. Nested messages are prefixed with their cached size.\n"
+        << "template <typename S>\n"
+        << "inline bool SerializeWithCachedSizes(const " << msg.name << "& msg, quark::io::BasicCodedOutputStream<S>* out) {\n"
+        << "    if (uint8_t* p = out->GetDirectBufferForNBytesAndAdvance(msg.GetCachedSize())) {\n"
+        << "        SerializeWithCachedSizesToArray(msg, p);\n"
+        << "        return true;\n"
+        << "    }\n";
+    size_t i = 0;
+    size_t r = 0;
+    while (i < msg.fields.size()) {
+        const Field& f = msg.fields[i];
+        if (f.repeated) {
+            EmitRepeatedSerialize(out, f);
+            ++i;
+            continue;
+        }
+        if (f.kind == FieldKind::MESSAGE) {
+            out << "    if (!quark::io::SerializeMessageFieldHeader(out, " << f.number << ", msg." << f.name
+                << ".GetCachedSize())) return false;\n"
+                << "    if (!SerializeWithCachedSizes(msg." << f.name << ", out)) return false;\n";
+            ++i;
+            continue;
+        }
+        if (!IsFixed(f)) {
+            out << "    if (!quark::io::Serialize" << WriterName(f) << "Field(out, " << f.number << ", msg."
+                << f.name << ")) return false;\n";
+            ++i;
+            continue;
+        }
+        const Run& run = runs[r++];
+        out << "    if (uint8_t* p = out->GetDirectBufferForNBytesAndAdvance(" << run.size << ")) {\n";
+        size_t offset = 0;
+        for (size_t k = run.begin; k < run.end; ++k) {
+            EmitFixedStore(out, msg.fields[k], offset, "        ");
+            offset += FixedFieldSize(msg.fields[k]);
+        }
+        out << "    } else {\n";
+        for (size_t k = run.begin; k < run.end; ++k) {
+            const Field& g = msg.fields[k];
+            out << "        if (!quark::io::Serialize" << WriterName(g) << "Field(out, " << g.number << ", msg."
+                << g.name << ")) return false;\n";
+        }
+        out << "    }\n";
+        i = run.end;
+    }
+    out << "    return true;\n}\n\n"
+        << "/// Encodes 'msg' field by field in declaration order.\n"
+        << "template <typename S>\n"
+        << "inline bool Serialize(const " << msg.name << "& msg, quark::io::BasicCodedOutputStream<S>* out) {\n"
+        << "    msg.ByteSizeLong();\n"
+        << "    return SerializeWithCachedSizes(msg, out);\n}\n\n"
+        << "template <quark::io::OutputStream S>\n"
+        << "inline bool Serialize(const " << msg.name << "& msg, S* out) {\n"
+        << "    quark::io::BasicCodedOutputStream<S> coded(out);\n"
+        << "    return Serialize(msg, &coded);\n}\n\n"
+        << "/// Encodes 'msg' prefixed with its size, so several messages can share\n"
+        << "/// one stream and be read back with ParseDelimited().\n"
+        << "template <typename S>\n"
+        << "inline bool SerializeDelimited(const " << msg.name << "& msg, quark::io::BasicCodedOutputStream<S>* out) {\n"
+        << "    if (!out->WriteVarint32(static_cast<uint32_t>(msg.ByteSizeLong()))) return false;\n"
+        << "    return SerializeWithCachedSizes(msg, out);\n}\n\n"
+        << "template <quark::io::OutputStream S>\n"
+        << "inline bool SerializeDelimited(const " << msg.name << "& msg, S* out) {\n"
+        << "    quark::io::BasicCodedOutputStream<S> coded(out);\n"
+        << "    return SerializeDelimited(msg, &coded);\n}\n\n";
+}
+
+/// Reads a nested message body of 'len' bytes in place under a limit.
+void EmitNestedParse(std::ostream& out, const std::string& target, const std::string& indent) {
+    out << indent << "if (!in->IncrementRecursionDepth()) return false;\n"
+        << indent << "auto limit = in->PushLimit(len);\n"
+        << indent << "bool ok = Parse(" << target << ", in) && in->BytesUntilLimit() == 0;\n"
+        << indent << "in->PopLimit(limit);\n"
+        << indent << "in->DecrementRecursionDepth();\n"
+        << indent << "if (!ok) return false;\n";
+}
+
+/// Reads one varint field into msg.<name>, or appends it for a repeated field.
+void EmitVarintRead(std::ostream& out, const Field& f, const std::string& indent) {
+    bool narrow = f.kind == FieldKind::SINT32;
+    out << indent << (narrow ? "uint32_t" : "uint64_t") << " v;\n"
+        << indent << "if (!in->" << (narrow ? "ReadVarint32" : "ReadVarint64") << "(v)) return false;\n"
+        << indent << "msg." << f.name << (f.repeated ? ".push_back(" : " = ");
+    switch (f.kind) {
+        case FieldKind::INT64: out << "static_cast<int64_t>(v)"; break;
+        case FieldKind::SINT32: out << "quark::io::ZigZagDecode32(v)"; break;
+        case FieldKind::SINT64: out << "quark::io::ZigZagDecode64(v)"; break;
+        case FieldKind::BOOL: out << "v != 0"; break;
+        default: out << "v"; break;
+    }
+    out << (f.repeated ? ");\n" : ";\n");
+}
+
+/// Parser cases for a repeated field. Packed fixed-width arrays are appended
+/// with one ReadRaw(), packed varints one by one; the unpacked form (one
+/// field per element, as written by protobuf's [packed = false]) is
+/// accepted as well.
+void EmitRepeatedParse(std::ostream& out, const Field& f) {
+    if (IsFixedKind(f)) {
+        const char* wire = FixedWidth(f) == 8 ? "FIXED64" : "FIXED32";
+        out << "        case " << TagExpr(f) << ":   // " << f.name << " (packed)\n"
+            << "            if (!quark::io::ReadPackedFixed(in, msg." << f.name << ")) return false;\n"
+            << "            break;\n"
+            << "        case quark::io::MakeTag(" << f.number << ", quark::io::WireType::" << wire << "): {   // "
+            << f.name << " (unpacked)\n";
+        EmitFixedRead(out, f, "            ");
+        out << "            break;\n"
+            << "        }\n";
+    } else if (IsVarintKind(f)) {
+        out << "        case " << TagExpr(f) << ":   // " << f.name << " (packed)\n"
+            << "            if (!quark::io::ReadPackedVarint" << PackedVarintArgs(f) << "(in, msg." << f.name
+            << ")) return false;\n"
+            << "            break;\n"
+            << "        case quark::io::MakeTag(" << f.number << ", quark::io::WireType::VARINT): {   // "
+            << f.name << " (unpacked)\n";
+        EmitVarintRead(out, f, "            ");
+        out << "            break;\n"
+            << "        }\n";
+    } else if (IsString(f)) {
+        out << "        case " << TagExpr(f) << ":   // " << f.name << "\n"
+            << "            if (!quark::io::ReadLengthDelimitedString(in, msg." << f.name
+            << ".emplace_back())) return false;\n"
+            << "            break;\n";
+    } else {
+        out << "        case " << TagExpr(f) << ": {   // " << f.name << "\n"
+            << "            uint32_t len;\n"
+            << "            if (!in->ReadVarint32(len)) return false;\n";
+        EmitNestedParse(out, "msg." + f.name + ".emplace_back()", "            ");
+        out << "            break;\n"
+            << "        }\n";
+    }
+}
+
+void EmitParse(std::ostream& out, const Message& msg) {
+    out << "/// Decodes tagged fields until the end of the stream (or of the current\n"
+        << "/// limit). Known fields are matched on their full tag; unknown field\n"
+        << "/// numbers and mismatched wire types are skipped without being read.\n"
+        << "/// Fields absent from the input keep their current values.\n"
+        << "template <typename S>\n"
+        << "inline bool Parse(" << msg.name << "& msg, quark::io::BasicCodedInputStream<S>* in) {\n"
+        << "    uint32_t tag;\n"
+        << "    while (in->ReadTag(tag)) {\n"
+        << "        switch (tag) {\n";
+    for (const Field& f : msg.fields) {
+        if (f.repeated) {
+            EmitRepeatedParse(out, f);
+            continue;
+        }
+        out << "        case " << TagExpr(f) << ": {   // " << f.name << "\n";
+        if (IsFixed(f)) {
+            EmitFixedRead(out, f, "            ");
+        } else if (IsVarint(f)) {
+            EmitVarintRead(out, f, "            ");
+        } else if (IsString(f)) {
+            out << "            if (!quark::io::ReadLengthDelimitedString(in, msg." << f.name << ")) return false;\n";
+        } else {
+            out << "            uint32_t len;\n"
+                << "            if (!in->ReadVarint32(len)) return false;\n";
+            EmitNestedParse(out, "msg." + f.name, "            ");
+        }
+        out << "            break;\n"
+            << "        }\n";
+    }
+    out << "        default:\n"
+        << "            if (!quark::io::SkipField(in, tag)) return false;\n"
+        << "        }\n"
+        << "    }\n"
+        << "    return true;\n}\n\n"
+        << "template <quark::io::InputStream S>\n"
+        << "inline bool Parse(" << msg.name << "& msg, S* in) {\n"
+        << "    quark::io::BasicCodedInputStream<S> coded(in);\n"
+        << "    return Parse(msg, &coded);\n}\n\n"
+        << "/// Decodes one message written by SerializeDelimited().\n"
+        << "template <typename S>\n"
+        << "inline bool ParseDelimited(" << msg.name << "& msg, quark::io::BasicCodedInputStream<S>* in) {\n"
+        << "    uint32_t len;\n"
+        << "    if (!in->ReadVarint32(len)) return false;\n"
+        << "    auto limit = in->PushLimit(len);\n"
+        << "    bool ok = Parse(msg, in) && in->BytesUntilLimit() == 0;\n"
+        << "    in->PopLimit(limit);\n"
+        << "    return ok;\n}\n\n"
+        << "template <quark::io::InputStream S>\n"
+        << "inline bool ParseDelimited(" << msg.name << "& msg, S* in) {\n"
+        << "    quark::io::BasicCodedInputStream<S> coded(in);\n"
+        << "    return ParseDelimited(msg, &coded);\n}\n\n";
+}
+
+/// Singular scalar and string fields only, so every field maps to one column.
+bool IsColumnar(const Message& msg) {
+    for (const Field& f : msg.fields) {
+        if (f.repeated || f.kind == FieldKind::MESSAGE) return false;
+    }
+    return true;
+}
+
+/// Integer kinds go in varint/delta columns; the other fixed-width kinds in raw ones.
+bool IsIntColumn(const Field& f) { return IsVarint(f) || f.kind == FieldKind::INT32; }
+
+void EmitColumnar(std::ostream& out, const Message& msg) {
+    out << "/// Encodes 'records' as one columnar batch (see quark/io/columnar.h): a\n"
+        << "/// column per field instead of a tagged field per record.\n"
+        << "template <typename S>\n"
+        << "inline bool SerializeColumnar(std::span<const " << msg.name
+        << "> records, quark::io::BasicCodedOutputStream<S>* out) {\n"
+        << "    size_t n = records.size();\n"
+        << "    if (!quark::io::WriteColumnarHeader(out, n)) return false;\n";
+    for (const Field& f : msg.fields) {
+        std::string number = std::to_string(f.number);
+        out << "    if (!quark::io::";
+        if (IsString(f)) {
+            out << "WriteStringColumn(out, " << number
+                << ", n, [&](size_t i) -> std::string_view { return records[i]." << f.name << "; })";
+        } else if (IsIntColumn(f)) {
+            out << "WriteIntColumn(out, " << number << ", n, [&](size_t i) { return records[i]." << f.name << "; })";
+        } else {
+            out << "WriteFixedColumn<" << ElementType(f) << ">(out, " << number
+                << ", n, [&](size_t i) { return records[i]." << f.name << "; })";
+        }
+        out << ") return false;\n";
+    }
+    out << "    return true;\n}\n\n"
+        << "template <quark::io::OutputStream S>\n"
+        << "inline bool SerializeColumnar(std::span<const " << msg.name << "> records, S* out) {\n"
+        << "    quark::io::BasicCodedOutputStream<S> coded(out);\n"
+        << "    return SerializeColumnar(records, &coded);\n}\n\n"
+        << "/// Decodes a batch written by SerializeColumnar(), replacing the contents\n"
+        << "/// of 'records'. A column the batch lacks leaves its field at the default;\n"
+        << "/// columns of unknown fields are not read.\n"
+        << "inline bool ParseColumnar(std::vector<" << msg.name << ">& records, std::span<const uint8_t> data) {\n"
+        << "    quark::io::ColumnarReader batch;\n"
+        << "    if (!batch.Open(data)) return false;\n"
+        << "    records.assign(batch.record_count(), " << msg.name << "());\n";
+    for (const Field& f : msg.fields) {
+        std::string number = std::to_string(f.number);
+        std::string type = ElementType(f);
+        if (IsString(f)) {
+            out << "    if (batch.Has(" << number << ")) {   // " << f.name << "\n"
+                << "        quark::io::StringColumn column;\n"
+                << "        if (!batch.ReadStringColumn(" << number << ", column)) return false;\n"
+                << "        for (size_t i = 0; i < column.size(); ++i) records[i]." << f.name << ".assign(column[i]);\n"
+                << "    }\n";
+        } else {
+            out << "    if (batch.Has(" << number << ") && !batch."
+                << (IsIntColumn(f) ? "DecodeIntColumn<" : "DecodeFixedColumn<") << type << ">(" << number
+                << ", [&](size_t i, " << type << " v) { records[i]." << f.name << " = v; })) return false;\n";
+        }
+    }
+    out << "    return true;\n}\n\n";
+}
+
+std::string Generate(const Schema& schema, const std::string& source, std::string ns) {
+    if (ns.empty()) {
+        ns = schema.package.empty() ? "quark_gen" : schema.package;
+        for (size_t pos; (pos = ns.find('.')) != std::string::npos;) ns.replace(pos, 1, "::");
+    }
+
+    std::ostringstream out;
+    out << "#pragma once\n"
+        << "// Generated by quarkc from " << source << ". Do not edit.\n\n"
+        << "#include <bit>\n"
+        << "#include <cstdint>\n"
+        << "#include <span>\n"
+        << "#include <string>\n"
+        << "#include <vector>\n"
+        << "#include \"quark/io/columnar.h\"\n"
+        << "#include \"quark/io/zero_copy_stream.h\"\n\n"
+        << "namespace " << ns << " {\n\n";
+    for (const Message& msg : schema.messages) {
+        if (!msg.unsupported.empty()) {
+            std::cerr << "quarkc: warning: skipping message " << msg.name << " ("
+                      << msg.unsupported << " not supported)\n";
+            out << "// " << msg.name << ": skipped (" << msg.unsupported << " not supported)\n\n";
+            continue;
+        }
+        EmitStruct(out, msg);
+        EmitSerializeToArray(out, msg);
+        EmitSerialize(out, msg);
+        EmitParse(out, msg);
+        if (IsColumnar(msg)) EmitColumnar(out, msg);
+    }
+    out << "} // namespace " << ns << "\n";
+    return out.str();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string input, output, ns;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else if (arg.rfind("--namespace=", 0) == 0) {
+            ns = arg.substr(12);
+        } else {
+            input = arg;
+        }
+    }
+    if (input.empty() || output.empty()) {
+        std::cerr << "usage: quarkc <schema.proto> -o <out.h> [--namespace=ns]\n";
+        return 2;
+    }
+
+    std::ifstream in(input);
+    if (!in) {
+        std::cerr << "quarkc: cannot open " << input << "\n";
+        return 1;
+    }
+    std::stringstream src;
+    src << in.rdbuf();
+
+    try {
+        Schema schema = Parser(Tokenize(src.str())).Parse();
+        ResolveMessages(schema);
+        std::string base = input.substr(input.find_last_of('/') + 1);
+        std::ofstream out(output);
+        out << Generate(schema, base, ns);
+        if (!out) {
+            std::cerr << "quarkc: cannot write " << output << "\n";
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "quarkc: " << input << ": " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}